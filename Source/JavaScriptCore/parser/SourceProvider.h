@@ -30,6 +30,7 @@
 
 #include "SourceOrigin.h"
 #include <wtf/RefCounted.h>
+#include <wtf/Seconds.h>
 #include <wtf/URL.h>
 #include <wtf/text/TextPosition.h>
 #include <wtf/text/WTFString.h>
@@ -118,6 +119,10 @@ namespace JSC {
         virtual StringView source() const = 0;
         virtual const CachedBytecode* cachedBytecode() const { return nullptr; }
         virtual void cacheBytecode(const BytecodeCacheGenerator&) const { }
+        // Called after the bytecode returned by cachedBytecode() was decoded,
+        // or could not be used, and after bytecode was generated from source
+        virtual void didDecodeCachedBytecode(bool, Seconds) const { }
+        virtual void didGenerateBytecode(Seconds) const { }
 
         StringView getRange(int start, int end) const
         {
@@ -78,7 +78,10 @@ UnlinkedCodeBlockType* CodeCache::getUnlinkedGlobalCodeBlock(VM& vm, ExecutableT
     }
 
     VariableEnvironment variablesUnderTDZ;
+    MonotonicTime generateStart = MonotonicTime::now();
     unlinkedCodeBlock = generateUnlinkedCodeBlock<UnlinkedCodeBlockType, ExecutableType>(vm, executable, source, strictMode, scriptMode, debuggerMode, error, evalContextType, &variablesUnderTDZ);
+    if (unlinkedCodeBlock)
+        source.provider()->didGenerateBytecode(MonotonicTime::now() - generateStart);
 
     if (unlinkedCodeBlock && Options::useCodeCache())
         m_sourceCode.addCache(key, SourceCodeValue(vm, unlinkedCodeBlock, m_sourceCode.age()));
@@ -109,7 +109,9 @@ public:
         const CachedBytecode* cachedBytecode = key.source().provider().cachedBytecode();
         if (cachedBytecode && cachedBytecode->size()) {
             VERBOSE_LOG("Found cached CodeBlock in the SourceProvider");
+            MonotonicTime decodeStart = MonotonicTime::now();
             UnlinkedCodeBlockType* unlinkedCodeBlock = decodeCodeBlock<UnlinkedCodeBlockType>(vm, key, cachedBytecode->data(), cachedBytecode->size());
+            key.source().provider().didDecodeCachedBytecode(!!unlinkedCodeBlock, MonotonicTime::now() - decodeStart);
             if (unlinkedCodeBlock)
                 return unlinkedCodeBlock;
         }
@@ -121,6 +121,12 @@ CachedBytecode generateModuleBytecode(VM& vm, const SourceCode& source, ParserEr
     return serializeBytecode(vm, unlinkedCodeBlock, source, SourceCodeType::ModuleType, strictMode, scriptMode, debuggerMode);
 }
 
+void writeCodeCache(VM& vm)
+{
+    JSLockHolder lock(vm);
+    vm.codeCache()->write(vm);
+}
+
 JSValue evaluate(ExecState* exec, const SourceCode& source, JSValue thisValue, NakedPtr<Exception>& returnedException)
 {
     VM& vm = exec->vm();
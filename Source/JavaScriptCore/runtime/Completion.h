@@ -44,6 +44,9 @@ JS_EXPORT_PRIVATE bool checkModuleSyntax(ExecState*, const SourceCode&, ParserEr
 
 JS_EXPORT_PRIVATE CachedBytecode generateBytecode(VM&, const SourceCode&, ParserError&);
 JS_EXPORT_PRIVATE CachedBytecode generateModuleBytecode(VM&, const SourceCode&, ParserError&);
+// Offers the code blocks generated since the last call to their source
+// providers, see SourceProvider::cacheBytecode()
+JS_EXPORT_PRIVATE void writeCodeCache(VM&);
 
 JS_EXPORT_PRIVATE JSValue evaluate(ExecState*, const SourceCode&, JSValue thisValue, NakedPtr<Exception>& returnedException);
 inline JSValue evaluate(ExecState* exec, const SourceCode& sourceCode, JSValue thisValue = JSValue())
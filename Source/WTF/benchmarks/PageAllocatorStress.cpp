@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Runs the AROS page allocator on a POSIX host, backed by mmap. You can build this like so:
+// g++ -o PageAllocatorStress Source/WTF/benchmarks/PageAllocatorStress.cpp Source/WTF/wtf/mui/PageAllocator.cpp -O2 -W -ISource/WTF -std=c++14
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <wtf/mui/PageAllocator.h>
+
+namespace {
+
+class MmapBackend : public WTF::PageAllocator::Backend {
+public:
+    void* allocateBlock(size_t bytes, bool executable, uintptr_t& cookie) override
+    {
+        void* memory = mmap(nullptr, bytes, protection(executable), MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            return nullptr;
+        cookie = reinterpret_cast<uintptr_t>(memory);
+        return memory;
+    }
+
+    void releaseBlock(void* address, size_t bytes, bool, uintptr_t) override
+    {
+        munmap(address, bytes);
+    }
+
+private:
+    static int protection(bool executable)
+    {
+        return PROT_READ | PROT_WRITE | (executable ? PROT_EXEC : 0);
+    }
+};
+
+struct StressResult {
+    uint64_t operations;
+    double seconds;
+    size_t peakReservedBytes;
+    size_t peakAllocatedBytes;
+    size_t reservedBytesWhileDecommitted; // after decommitting every live allocation at once
+    size_t finalReservedBytes; // after freeing everything, anything but 0 is a leak
+    uint64_t blocksReleased;
+    bool verified; // no allocation overlapped another one
+};
+
+struct StressAllocation {
+    uint8_t* address;
+    size_t pages;
+    bool decommitted;
+};
+
+class StressRandom {
+public:
+    explicit StressRandom(uint32_t seed)
+        : m_state(seed ? seed : 0x9e3779b9)
+    {
+    }
+
+    uint32_t next()
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return m_state;
+    }
+
+    uint32_t below(uint32_t limit) { return next() % limit; }
+
+private:
+    uint32_t m_state;
+};
+
+const size_t pageSize = WTF::PageAllocator::pageSize;
+
+// Stamps the first word of every page with its owner so overlapping allocations get noticed
+void stampAllocation(const StressAllocation& allocation, uintptr_t owner)
+{
+    for (size_t i = 0; i < allocation.pages; i++)
+        reinterpret_cast<uintptr_t*>(allocation.address + i * pageSize)[0] = owner + i;
+}
+
+bool checkAllocation(const StressAllocation& allocation, uintptr_t owner)
+{
+    if (allocation.decommitted)
+        return true;
+    for (size_t i = 0; i < allocation.pages; i++) {
+        if (reinterpret_cast<uintptr_t*>(allocation.address + i * pageSize)[0] != owner + i)
+            return false;
+    }
+    return true;
+}
+
+// Random mix of small, large, aligned and partial allocations, frees, decommits and commits
+StressResult stress(WTF::PageAllocator::Backend& backend, uint64_t operations, uint32_t seed)
+{
+    static const size_t slotCount = 1024;
+    static const uint64_t decommitAllInterval = 25000;
+
+    StressResult result;
+    memset(&result, 0, sizeof(result));
+    result.verified = true;
+
+    WTF::PageAllocator allocator(backend);
+    StressRandom random(seed);
+    StressAllocation* slots = static_cast<StressAllocation*>(calloc(slotCount, sizeof(StressAllocation)));
+    if (!slots)
+        return result;
+
+    auto owner = [](size_t slot) { return uintptr_t(slot) << 16; };
+    auto started = std::chrono::steady_clock::now();
+
+    for (uint64_t operation = 0; operation < operations; operation++) {
+        size_t slot = random.below(slotCount);
+        StressAllocation& allocation = slots[slot];
+
+        if (!allocation.address) {
+            // Mostly small runs, with MarkedBlock like aligned ones and the occasional big one
+            uint32_t kind = random.below(100);
+            size_t pages;
+            size_t alignment = pageSize;
+            if (kind < 40)
+                pages = 1 + random.below(4);
+            else if (kind < 70) {
+                pages = 4;
+                alignment = 4 * pageSize;
+            } else if (kind < 95)
+                pages = 5 + random.below(60);
+            else
+                pages = 65 + random.below(960);
+
+            allocation.address = static_cast<uint8_t*>(allocator.allocate(pages, alignment, false));
+            if (!allocation.address)
+                continue;
+            allocation.pages = pages;
+            allocation.decommitted = false;
+            if (reinterpret_cast<uintptr_t>(allocation.address) & (alignment - 1))
+                result.verified = false;
+            stampAllocation(allocation, owner(slot));
+        } else {
+            uint32_t action = random.below(100);
+            if (!checkAllocation(allocation, owner(slot)))
+                result.verified = false;
+
+            if (action < 60) {
+                allocator.free(allocation.address);
+                allocation.address = nullptr;
+            } else if (action < 70 && allocation.pages > 1 && !allocation.decommitted) {
+                // give back the tail, as PageReservation users may
+                size_t keep = allocation.pages / 2;
+                allocator.free(allocation.address + keep * pageSize, allocation.pages - keep);
+                allocation.pages = keep;
+            } else if (!allocation.decommitted) {
+                allocator.decommit(allocation.address, allocation.pages);
+                allocation.decommitted = true;
+            } else {
+                allocator.commit(allocation.address, allocation.pages);
+                allocation.decommitted = false;
+                stampAllocation(allocation, owner(slot));
+            }
+        }
+
+        if (!(operation % 64)) {
+            WTF::PageAllocator::Statistics statistics = allocator.statistics();
+            if (statistics.reservedBytes > result.peakReservedBytes)
+                result.peakReservedBytes = statistics.reservedBytes;
+            if (statistics.allocatedBytes > result.peakAllocatedBytes)
+                result.peakAllocatedBytes = statistics.allocatedBytes;
+        }
+
+        // Now and then behave like a closed tab: everything gets decommitted, then used again
+        if (!((operation + 1) % decommitAllInterval)) {
+            for (size_t i = 0; i < slotCount; i++) {
+                if (slots[i].address && !slots[i].decommitted) {
+                    allocator.decommit(slots[i].address, slots[i].pages);
+                    slots[i].decommitted = true;
+                }
+            }
+
+            size_t reserved = allocator.statistics().reservedBytes;
+            if (!result.reservedBytesWhileDecommitted || reserved < result.reservedBytesWhileDecommitted)
+                result.reservedBytesWhileDecommitted = reserved;
+
+            for (size_t i = 0; i < slotCount; i++) {
+                if (slots[i].address) {
+                    allocator.commit(slots[i].address, slots[i].pages);
+                    slots[i].decommitted = false;
+                    stampAllocation(slots[i], owner(i));
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < slotCount; i++) {
+        if (!slots[i].address)
+            continue;
+        if (!checkAllocation(slots[i], owner(i)))
+            result.verified = false;
+        allocator.free(slots[i].address);
+    }
+
+    result.operations = operations;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    WTF::PageAllocator::Statistics statistics = allocator.statistics();
+    result.finalReservedBytes = statistics.reservedBytes;
+    result.blocksReleased = statistics.blocksReleased;
+
+    free(slots);
+    return result;
+}
+
+[[noreturn]] void usage()
+{
+    printf("Usage: PageAllocatorStress [<operations> [<seed>]]\n");
+    exit(1);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long long operations = 1000000;
+    unsigned seed = 1;
+
+    if (argc > 3)
+        usage();
+    if (argc > 1 && sscanf(argv[1], "%llu", &operations) != 1)
+        usage();
+    if (argc > 2 && sscanf(argv[2], "%u", &seed) != 1)
+        usage();
+
+    MmapBackend backend;
+    StressResult result = stress(backend, operations, seed);
+
+    printf("%llu operations in %.3f s, %.0f ops/s\n", static_cast<unsigned long long>(result.operations), result.seconds,
+        result.seconds > 0 ? result.operations / result.seconds : 0);
+    printf("peak reserved %zu KB, peak allocated %zu KB\n", result.peakReservedBytes / 1024, result.peakAllocatedBytes / 1024);
+    printf("reserved with everything decommitted %zu KB\n", result.reservedBytesWhileDecommitted / 1024);
+    printf("blocks released %llu\n", static_cast<unsigned long long>(result.blocksReleased));
+    printf("reserved after freeing everything %zu KB\n", result.finalReservedBytes / 1024);
+    printf("%s\n", result.verified ? "verified" : "FAILED: allocations overlapped or were misaligned");
+
+    return result.verified && !result.finalReservedBytes ? 0 : 1;
+}
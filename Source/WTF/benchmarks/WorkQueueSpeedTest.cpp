@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Simulates the decoding traffic of an image gallery page: every image owns a serial queue, like
+// ImageSource's decoding queue, on which its frames get decoded into a fresh buffer. Animated images
+// schedule their following frames with dispatchAfter. "pool" runs this on WorkQueue, "threads" on one
+// dedicated thread per queue the way WorkQueueGeneric used to. "blocking" runs a decoding loop per
+// queue on WorkQueue, blocking its thread on a request queue until the image goes away, while the
+// frames are requested from the main thread. With more images than pool threads, it only completes
+// if the pool starts threads for the work waiting behind the blocked ones, which it does for up to
+// 64 threads. Run each mode in its own process so the peak resident size is meaningful. On Linux,
+// you can build this like so:
+// g++ -o WorkQueueSpeedTest Source/WTF/benchmarks/WorkQueueSpeedTest.cpp -O2 -W -ISource/WTF -I<build dir> -DHAVE_CONFIG_H=1 -DBUILDING_WITH_CMAKE=1 -L<build dir>/lib -lWTF -licuuc -lpthread -std=c++14
+
+#include "config.h"
+
+#include <cstring>
+#include <stdlib.h>
+#include <stdio.h>
+#include <wtf/Condition.h>
+#include <wtf/DataLog.h>
+#include <wtf/Deque.h>
+#include <wtf/Lock.h>
+#include <wtf/MonotonicTime.h>
+#include <wtf/SynchronizedFixedQueue.h>
+#include <wtf/Threading.h>
+#include <wtf/Vector.h>
+#include <wtf/WorkQueue.h>
+#include <wtf/text/CString.h>
+
+namespace {
+
+unsigned numImages;
+unsigned framesPerImage;
+unsigned animatedEvery;
+unsigned frameSize;
+Seconds frameDelay;
+
+Lock completionLock;
+Condition completionCondition;
+unsigned framesLeft;
+unsigned checksum;
+
+NO_RETURN void usage()
+{
+    printf("Usage: WorkQueueSpeedTest pool|threads|blocking <num images> <frames per image> <every nth image animated> <frame size in pixels> <frame delay in ms>\n");
+    exit(1);
+}
+
+// Stands in for a decoder writing out a frame: touches every pixel of a new buffer.
+void decodeFrame(unsigned image, unsigned frame)
+{
+    Vector<uint32_t> pixels(frameSize);
+    uint32_t value = image * 2654435761u + frame;
+    for (auto& pixel : pixels) {
+        value = value * 1103515245u + 12345u;
+        pixel = value;
+    }
+
+    auto locker = holdLock(completionLock);
+    checksum += pixels[frameSize / 2];
+    if (!--framesLeft)
+        completionCondition.notifyAll();
+}
+
+// What WorkQueueGeneric did before the pool: a thread per queue sleeping on its own timers.
+class DedicatedThreadQueue : public ThreadSafeRefCounted<DedicatedThreadQueue> {
+public:
+    static Ref<DedicatedThreadQueue> create(const char* name)
+    {
+        return adoptRef(*new DedicatedThreadQueue(name));
+    }
+
+    ~DedicatedThreadQueue()
+    {
+        {
+            auto locker = holdLock(m_lock);
+            m_stopped = true;
+            m_condition.notifyOne();
+        }
+        m_thread->waitForCompletion();
+    }
+
+    void dispatch(Function<void()>&& function)
+    {
+        dispatchAfter(0_s, WTFMove(function));
+    }
+
+    void dispatchAfter(Seconds delay, Function<void()>&& function)
+    {
+        auto locker = holdLock(m_lock);
+        m_functions.append({ MonotonicTime::now() + delay, WTFMove(function) });
+        m_condition.notifyOne();
+    }
+
+private:
+    struct Item {
+        MonotonicTime time;
+        Function<void()> function;
+    };
+
+    DedicatedThreadQueue(const char* name)
+    {
+        m_thread = Thread::create(name, [this] { run(); });
+    }
+
+    void run()
+    {
+        auto locker = holdLock(m_lock);
+        while (!m_stopped) {
+            MonotonicTime now = MonotonicTime::now();
+            MonotonicTime earliest = MonotonicTime::infinity();
+            size_t index = notFound;
+            for (size_t i = 0; i < m_functions.size(); ++i) {
+                if (m_functions[i].time < earliest) {
+                    earliest = m_functions[i].time;
+                    index = i;
+                }
+            }
+            if (index == notFound || earliest > now) {
+                m_condition.waitUntil(m_lock, earliest);
+                continue;
+            }
+            auto function = WTFMove(m_functions[index].function);
+            m_functions.remove(index);
+            m_lock.unlock();
+            function();
+            function = nullptr;
+            m_lock.lock();
+        }
+    }
+
+    Lock m_lock;
+    Condition m_condition;
+    Vector<Item> m_functions;
+    bool m_stopped { false };
+    RefPtr<Thread> m_thread;
+};
+
+template<typename QueueType>
+void scheduleFrame(QueueType& queue, unsigned image, unsigned frame)
+{
+    auto decode = [&queue, image, frame] {
+        decodeFrame(image, frame);
+        if (frame + 1 < framesPerImage)
+            scheduleFrame(queue, image, frame + 1);
+    };
+
+    // Still images decode all frames (sizes for srcset, say) back to back, animated ones on a timer.
+    if (frame && animatedEvery && !(image % animatedEvery))
+        queue.dispatchAfter(frameDelay, WTFMove(decode));
+    else
+        queue.dispatch(WTFMove(decode));
+}
+
+unsigned long statusValue(const char* field)
+{
+    FILE* file = fopen("/proc/self/status", "r");
+    if (!file)
+        return 0;
+    char line[256];
+    unsigned long value = 0;
+    size_t length = strlen(field);
+    while (fgets(line, sizeof(line), file)) {
+        if (!strncmp(line, field, length) && line[length] == ':') {
+            value = strtoul(line + length + 1, nullptr, 10);
+            break;
+        }
+    }
+    fclose(file);
+    return value;
+}
+
+template<typename QueueType, typename CreateFunction>
+void runGallery(const char* name, const CreateFunction& createQueue)
+{
+    framesLeft = numImages * framesPerImage;
+    unsigned long peakThreads = 0;
+    MonotonicTime before = MonotonicTime::now();
+    {
+        Vector<Ref<QueueType>> queues;
+        for (unsigned i = 0; i < numImages; ++i)
+            queues.append(createQueue());
+        for (unsigned i = 0; i < numImages; ++i)
+            scheduleFrame(queues[i].get(), i, 0);
+
+        auto locker = holdLock(completionLock);
+        while (framesLeft) {
+            completionCondition.waitFor(completionLock, 10_ms);
+            peakThreads = std::max(peakThreads, statusValue("Threads"));
+        }
+    }
+    Seconds elapsed = MonotonicTime::now() - before;
+
+    printf("%s: %u images, %u frames in %.1lf ms, %.0lf frames/s\n", name, numImages, numImages * framesPerImage, elapsed.milliseconds(), numImages * framesPerImage / elapsed.seconds());
+    printf("%s: peak threads %lu, peak resident %lu kB, resident %lu kB (checksum %08x)\n", name, peakThreads, statusValue("VmHWM"), statusValue("VmRSS"), checksum);
+}
+
+// Like ImageSource's frame request queue; frames per image may not exceed its size, or requesting
+// the frames of an image whose decoding loop didn't start yet would block the main thread.
+const size_t requestQueueSize = 256;
+using RequestQueue = SynchronizedFixedQueue<unsigned, requestQueueSize>;
+
+void runBlockingGallery(const char* name)
+{
+    framesLeft = numImages * framesPerImage;
+    unsigned long peakThreads = 0;
+    bool stalled = false;
+    MonotonicTime before = MonotonicTime::now();
+    {
+        Vector<Ref<WorkQueue>> queues;
+        Vector<Ref<RequestQueue>> requestQueues;
+        for (unsigned i = 0; i < numImages; ++i) {
+            queues.append(WorkQueue::create("ImageDecoder"));
+            requestQueues.append(RequestQueue::create());
+            queues[i]->dispatch([image = i, requestQueue = requestQueues[i].copyRef()] {
+                unsigned frame;
+                while (requestQueue->dequeue(frame))
+                    decodeFrame(image, frame);
+            });
+        }
+        for (unsigned frame = 0; frame < framesPerImage; ++frame) {
+            for (unsigned i = 0; i < numImages; ++i)
+                requestQueues[i]->enqueue(frame);
+        }
+
+        {
+            auto locker = holdLock(completionLock);
+            unsigned lastFramesLeft = framesLeft;
+            MonotonicTime lastProgress = MonotonicTime::now();
+            while (framesLeft) {
+                completionCondition.waitFor(completionLock, 10_ms);
+                peakThreads = std::max(peakThreads, statusValue("Threads"));
+                if (framesLeft != lastFramesLeft) {
+                    lastFramesLeft = framesLeft;
+                    lastProgress = MonotonicTime::now();
+                } else if (MonotonicTime::now() - lastProgress > 10_s) {
+                    stalled = true;
+                    break;
+                }
+            }
+        }
+
+        // The images go away, ending their decoding loops.
+        for (auto& requestQueue : requestQueues)
+            requestQueue->close();
+    }
+    Seconds elapsed = MonotonicTime::now() - before;
+
+    if (stalled) {
+        printf("%s: stalled with %u of %u frames left to decode\n", name, framesLeft, numImages * framesPerImage);
+        exit(1);
+    }
+    printf("%s: %u images, %u frames in %.1lf ms, %.0lf frames/s\n", name, numImages, numImages * framesPerImage, elapsed.milliseconds(), numImages * framesPerImage / elapsed.seconds());
+    printf("%s: peak threads %lu, peak resident %lu kB, resident %lu kB (checksum %08x)\n", name, peakThreads, statusValue("VmHWM"), statusValue("VmRSS"), checksum);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    WTF::initializeThreading();
+
+    double delayMilliseconds;
+    if (argc != 7
+        || sscanf(argv[2], "%u", &numImages) != 1
+        || sscanf(argv[3], "%u", &framesPerImage) != 1
+        || sscanf(argv[4], "%u", &animatedEvery) != 1
+        || sscanf(argv[5], "%u", &frameSize) != 1
+        || sscanf(argv[6], "%lf", &delayMilliseconds) != 1
+        || !numImages || !framesPerImage || !frameSize)
+        usage();
+    frameDelay = Seconds::fromMilliseconds(delayMilliseconds);
+
+    if (!strcmp(argv[1], "pool"))
+        runGallery<WorkQueue>(argv[1], [] { return WorkQueue::create("ImageDecoder"); });
+    else if (!strcmp(argv[1], "threads"))
+        runGallery<DedicatedThreadQueue>(argv[1], [] { return DedicatedThreadQueue::create("ImageDecoder"); });
+    else if (!strcmp(argv[1], "blocking") && framesPerImage <= requestQueueSize)
+        runBlockingGallery(argv[1]);
+    else
+        usage();
+
+    return 0;
+}
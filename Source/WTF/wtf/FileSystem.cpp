@@ -276,7 +276,9 @@ bool excludeFromBackup(const String&)
 
 MappedFileData::~MappedFileData()
 {
-#if !OS(WINDOWS) && !PLATFORM(MUI)
+#if PLATFORM(MUI)
+    fastFree(m_fileData);
+#elif !OS(WINDOWS)
     if (!m_fileData)
         return;
     munmap(m_fileData, m_fileSize);
@@ -285,9 +287,40 @@ MappedFileData::~MappedFileData()
 
 MappedFileData::MappedFileData(const String& filePath, bool& success)
 {
-#if OS(WINDOWS) || PLATFORM(MUI)
+#if OS(WINDOWS)
     // FIXME: Implement mapping
     success = false;
+#elif PLATFORM(MUI)
+    // There is no mmap(), the file is read into memory instead
+    success = false;
+    PlatformFileHandle handle = openFile(filePath, FileOpenMode::Read);
+    if (!isHandleValid(handle))
+        return;
+    auto closeHandle = makeScopeExit([&] {
+        closeFile(handle);
+    });
+
+    long long fileSize;
+    unsigned size;
+    if (!getFileSize(handle, fileSize) || !WTF::convertSafely(fileSize, size))
+        return;
+
+    if (!size) {
+        success = true;
+        return;
+    }
+
+    void* data;
+    if (!tryFastMalloc(size).getValue(data))
+        return;
+    if (readFromFile(handle, static_cast<char*>(data), size) != static_cast<int>(size)) {
+        fastFree(data);
+        return;
+    }
+
+    success = true;
+    m_fileData = data;
+    m_fileSize = size;
 #else
     CString fsRep = fileSystemRepresentation(filePath);
     int fd = !fsRep.isNull() ? open(fsRep.data(), O_RDONLY) : -1;
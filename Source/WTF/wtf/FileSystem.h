@@ -212,8 +212,9 @@ inline MappedFileData::MappedFileData(MappedFileData&& other)
 
 inline MappedFileData& MappedFileData::operator=(MappedFileData&& other)
 {
-    m_fileData = std::exchange(other.m_fileData, nullptr);
-    m_fileSize = std::exchange(other.m_fileSize, 0);
+    // The previous data is released with other
+    std::swap(m_fileData, other.m_fileData);
+    std::swap(m_fileSize, other.m_fileSize);
     return *this;
 }
 
@@ -42,6 +42,13 @@ WTFLogChannel LogMemoryPressure = { WTFLogChannelOn, "MemoryPressure", WTFLogLev
 
 WTF_EXPORT_PRIVATE bool MemoryPressureHandler::ReliefLogger::s_loggingEnabled = false;
 
+#if PLATFORM(MUI)
+// Machines running MUI have little memory and nothing to page out to, so look more often.
+static const Seconds s_measurementInterval { 5_s };
+#else
+static const Seconds s_measurementInterval { 30_s };
+#endif
+
 MemoryPressureHandler& MemoryPressureHandler::singleton()
 {
     static NeverDestroyed<MemoryPressureHandler> memoryPressureHandler;
@@ -62,15 +69,18 @@ MemoryPressureHandler::MemoryPressureHandler()
 
 void MemoryPressureHandler::setShouldUsePeriodicMemoryMonitor(bool use)
 {
+#if !PLATFORM(MUI)
+    // MUI always uses the system malloc, memoryFootprint() measures it in MemoryFootprintGeneric.cpp.
     if (!isFastMallocEnabled()) {
         // If we're running with FastMalloc disabled, some kind of testing or debugging is probably happening.
         // Let's be nice and not enable the memory kill mechanism.
         return;
     }
+#endif
 
     if (use) {
         m_measurementTimer = std::make_unique<RunLoop::Timer<MemoryPressureHandler>>(RunLoop::main(), this, &MemoryPressureHandler::measurementTimerFired);
-        m_measurementTimer->startRepeating(30_s);
+        m_measurementTimer->startRepeating(s_measurementInterval);
     } else
         m_measurementTimer = nullptr;
 }
@@ -120,6 +130,10 @@ static size_t thresholdForPolicy(MemoryUsagePolicy policy)
 #if PLATFORM(IOS_FAMILY)
     const double conservativeThresholdFraction = 0.5;
     const double strictThresholdFraction = 0.65;
+#elif PLATFORM(MUI)
+    // ramSize() is what was free at startup here, the browser is expected to use most of it.
+    const double conservativeThresholdFraction = 0.6;
+    const double strictThresholdFraction = 0.8;
 #else
     const double conservativeThresholdFraction = 0.33;
     const double strictThresholdFraction = 0.5;
@@ -186,7 +200,7 @@ void MemoryPressureHandler::measurementTimerFired()
 {
     size_t footprint = memoryFootprint();
     RELEASE_LOG(MemoryPressure, "Current memory footprint: %zu MB", footprint / MB);
-    if (footprint >= thresholdForMemoryKill()) {
+    if (m_memoryKillCallback && footprint >= thresholdForMemoryKill()) {
         shrinkOrDie();
         return;
     }
@@ -85,7 +85,7 @@ public:
     bool isUnderMemoryPressure() const
     {
         return m_underMemoryPressure
-#if PLATFORM(MAC)
+#if PLATFORM(MAC) || PLATFORM(MUI)
             || m_memoryUsagePolicy >= MemoryUsagePolicy::Strict
 #endif
             || m_isSimulatingMemoryPressure;
@@ -57,13 +57,13 @@ void* OSAllocator::reserveAndCommit(size_t bytes, Usage, bool, bool executable,
 
 void OSAllocator::commit(void* address, size_t bytes, bool, bool)
 {
+    allocator_commit(address, bytes);
     memset(address, 0, bytes);
 }
 
 void OSAllocator::decommit(void* address, size_t bytes)
 {
-    (void)address;
-    (void)bytes;
+    allocator_decommit(address, bytes);
 }
 
 void OSAllocator::releaseDecommitted(void* address, size_t bytes)
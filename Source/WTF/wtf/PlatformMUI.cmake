@@ -1,5 +1,6 @@
 list(APPEND WTF_SOURCES
     mui/execallocator.cpp
+    mui/PageAllocator.cpp
     OSAllocatorAROS.cpp
     posix/ThreadingPOSIX.cpp
     posix/FileSystemPOSIX.cpp
@@ -87,6 +87,22 @@ public:
         return true;
     }
 
+    bool tryEnqueue(const T& value)
+    {
+        LockHolder lockHolder(m_mutex);
+
+        // The queue is closing or full, exit immediately.
+        if (!m_open || m_queue.size() >= BufferSize)
+            return false;
+
+        // Add the item in the queue.
+        m_queue.append(value);
+
+        // Notify the other threads that an item was added to the queue.
+        m_condition.notifyAll();
+        return true;
+    }
+
     bool dequeue(T& value)
     {
         LockHolder lockHolder(m_mutex);
@@ -107,6 +123,23 @@ public:
         return true;
     }
 
+    bool tryDequeue(T& value)
+    {
+        LockHolder lockHolder(m_mutex);
+
+        // The queue is closing or empty, exit immediately.
+        if (!m_open || m_queue.isEmpty())
+            return false;
+
+        // Get a copy from m_queue.first and then remove it.
+        value = m_queue.first();
+        m_queue.removeFirst();
+
+        // Notify the other threads that an item was removed from the queue.
+        m_condition.notifyAll();
+        return true;
+    }
+
 private:
     SynchronizedFixedQueue()
     {
@@ -42,11 +42,16 @@
 #include <wtf/Vector.h>
 #endif
 
-#if USE(GLIB_EVENT_LOOP) || USE(GENERIC_EVENT_LOOP)
+#if USE(GLIB_EVENT_LOOP)
 #include <wtf/Condition.h>
 #include <wtf/RunLoop.h>
 #endif
 
+#if USE(GENERIC_EVENT_LOOP)
+#include <wtf/Deque.h>
+#include <wtf/Lock.h>
+#endif
+
 namespace WTF {
 
 class WorkQueue final : public FunctionDispatcher {
@@ -74,7 +79,7 @@ public:
 
 #if USE(COCOA_EVENT_LOOP)
     dispatch_queue_t dispatchQueue() const { return m_dispatchQueue; }
-#elif USE(GLIB_EVENT_LOOP) || USE(GENERIC_EVENT_LOOP)
+#elif USE(GLIB_EVENT_LOOP)
     RunLoop& runLoop() const { return *m_runLoop; }
 #endif
 
@@ -93,6 +98,10 @@ private:
     void performWorkOnRegisteredWorkThread();
 #endif
 
+#if USE(GENERIC_EVENT_LOOP)
+    void performWork();
+#endif
+
 #if USE(COCOA_EVENT_LOOP)
     static void executeFunction(void*);
     dispatch_queue_t m_dispatchQueue;
@@ -103,8 +112,15 @@ private:
     Vector<Function<void()>> m_functionQueue;
 
     HANDLE m_timerQueue;
-#elif USE(GLIB_EVENT_LOOP) || USE(GENERIC_EVENT_LOOP)
+#elif USE(GLIB_EVENT_LOOP)
     RunLoop* m_runLoop;
+#elif USE(GENERIC_EVENT_LOOP)
+    // Queues have no thread of their own, they run on threads shared by all
+    // queues. A serial queue is in the pool while it has functions to run.
+    Type m_type;
+    Lock m_functionsLock;
+    Deque<Function<void()>> m_functions;
+    bool m_isScheduled { false };
 #endif
 };
 
@@ -28,14 +28,44 @@
 
 #if !(defined(USE_SYSTEM_MALLOC) && USE_SYSTEM_MALLOC) && OS(LINUX)
 #include <bmalloc/bmalloc.h>
+#elif PLATFORM(MUI)
+#include <proto/exec.h>
+#elif OS(LINUX)
+#include <stdio.h>
+#include <unistd.h>
 #endif
 
 namespace WTF {
 
+#if PLATFORM(MUI)
+// Exec keeps no per task accounting and everything shares one address space, so what the
+// browser holds is measured as the memory that went missing since startup. Memory taken by
+// other applications is counted as well, which is what we want before the system runs dry.
+static size_t availableMemoryAtStartup = AvailMem(MEMF_ANY);
+#endif
+
 size_t memoryFootprint()
 {
 #if !(defined(USE_SYSTEM_MALLOC) && USE_SYSTEM_MALLOC) && OS(LINUX)
     return bmalloc::api::memoryFootprint();
+#elif PLATFORM(MUI)
+    size_t available = AvailMem(MEMF_ANY);
+    return available < availableMemoryAtStartup ? availableMemoryAtStartup - available : 0;
+#elif OS(LINUX)
+    // The system malloc can't be asked, so count the private resident pages. This also covers
+    // what the JavaScript heap maps directly.
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file)
+        return 0;
+
+    unsigned long size;
+    unsigned long resident;
+    unsigned long shared;
+    int scannedCount = fscanf(file, "%lu %lu %lu", &size, &resident, &shared);
+    fclose(file);
+    if (scannedCount != 3 || shared > resident)
+        return 0;
+    return (resident - shared) * sysconf(_SC_PAGESIZE);
 #else
     return 0;
 #endif
@@ -26,6 +26,8 @@
 #include "config.h"
 #include <wtf/MemoryPressureHandler.h>
 
+#include <wtf/MemoryFootprint.h>
+
 namespace WTF {
 
 void MemoryPressureHandler::platformReleaseMemory(Critical)
@@ -34,23 +36,29 @@ void MemoryPressureHandler::platformReleaseMemory(Critical)
 
 void MemoryPressureHandler::install()
 {
+    m_installed = true;
 }
 
 void MemoryPressureHandler::uninstall()
 {
+    m_installed = false;
 }
 
 void MemoryPressureHandler::holdOff(Seconds)
 {
 }
 
-void MemoryPressureHandler::respondToMemoryPressure(Critical, Synchronous)
+void MemoryPressureHandler::respondToMemoryPressure(Critical critical, Synchronous synchronous)
 {
+    releaseMemory(critical, synchronous);
 }
 
 Optional<MemoryPressureHandler::ReliefLogger::MemoryUsage> MemoryPressureHandler::ReliefLogger::platformMemoryUsage()
 {
-    return WTF::nullopt;
+    size_t footprint = memoryFootprint();
+    if (!footprint)
+        return WTF::nullopt;
+    return MemoryUsage { footprint, footprint };
 }
 
 } // namespace WTF
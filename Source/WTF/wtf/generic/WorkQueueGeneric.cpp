@@ -30,6 +30,8 @@
 #include "config.h"
 #include <wtf/WorkQueue.h>
 
+#if USE(GLIB_EVENT_LOOP)
+
 #include <wtf/WallTime.h>
 #include <wtf/text/WTFString.h>
 #include <wtf/threads/BinarySemaphore.h>
@@ -71,3 +73,259 @@ void WorkQueue::dispatchAfter(Seconds delay, Function<void()>&& function)
         function();
     });
 }
+
+#else
+
+#include <wtf/Condition.h>
+#include <wtf/NeverDestroyed.h>
+#include <wtf/NumberOfCores.h>
+#include <wtf/PriorityQueue.h>
+
+namespace WTF {
+
+// Threads shared by all work queues. Ready work is taken from one FIFO: a
+// serial queue is in it at most once, concurrent queues add each function.
+// Threads are started as work arrives, up to one per core but never fewer
+// than minimumThreadCount, and exit after idling for a while. Functions
+// dispatched with a delay wait in one timer heap, the idle threads sleep until
+// its earliest deadline.
+// A function may block its thread for a long time, e.g. ImageSource's decoding
+// loop waits for frame requests as long as the image lives. When work has been
+// waiting a starvationInterval while no thread took any, a monitor thread
+// starts more threads, up to maximumThreadCount.
+class WorkQueuePool {
+    WTF_MAKE_NONCOPYABLE(WorkQueuePool);
+    friend NeverDestroyed<WorkQueuePool>;
+public:
+    static WorkQueuePool& singleton()
+    {
+        static NeverDestroyed<WorkQueuePool> pool;
+        return pool;
+    }
+
+    void schedule(Function<void()>&& function)
+    {
+        auto locker = holdLock(m_lock);
+        m_readyFunctions.append(WTFMove(function));
+        wakeUpThread(locker);
+    }
+
+    void scheduleAfter(Seconds delay, Ref<WorkQueue>&& queue, Function<void()>&& function)
+    {
+        auto locker = holdLock(m_lock);
+        MonotonicTime time = MonotonicTime::now() + delay;
+        bool isEarliest = m_delayedFunctions.isEmpty() || time < m_delayedFunctions.peek().time;
+        m_delayedFunctions.enqueue(DelayedFunction { time, m_nextSequence++, WTFMove(queue), WTFMove(function) });
+        if (isEarliest)
+            wakeUpThread(locker);
+    }
+
+private:
+    static const unsigned minimumThreadCount = 4;
+    static const unsigned maximumThreadCount = 64;
+    static constexpr Seconds idleTimeout { 10_s };
+    static constexpr Seconds starvationInterval { 100_ms };
+
+    struct DelayedFunction {
+        MonotonicTime time;
+        uint64_t sequence;
+        RefPtr<WorkQueue> queue;
+        Function<void()> function;
+    };
+
+    static bool isEarlier(const DelayedFunction& a, const DelayedFunction& b)
+    {
+        if (a.time != b.time)
+            return a.time < b.time;
+        return a.sequence < b.sequence;
+    }
+
+    WorkQueuePool()
+        : m_targetThreadCount(std::min<unsigned>(std::max<unsigned>(numberOfProcessorCores(), minimumThreadCount), maximumThreadCount))
+    {
+    }
+
+    void wakeUpThread(const AbstractLocker& locker)
+    {
+        if (m_idleThreadCount) {
+            m_condition.notifyOne();
+            return;
+        }
+        if (m_threadCount < m_targetThreadCount) {
+            startThread(locker);
+            return;
+        }
+
+        // Every thread is busy, possibly blocked
+        if (!m_hasMonitorThread) {
+            m_hasMonitorThread = true;
+            Thread::create("WorkQueue Monitor", [this] {
+                monitorThreadBody();
+            })->detach();
+        } else if (m_isMonitorThreadSleeping)
+            m_monitorCondition.notifyOne();
+    }
+
+    void startThread(const AbstractLocker&)
+    {
+        m_threadCount++;
+        Thread::create("WorkQueue", [this] {
+            threadBody();
+        })->detach();
+    }
+
+    bool hasWaitingWork(MonotonicTime now) const
+    {
+        return !m_readyFunctions.isEmpty() || (!m_delayedFunctions.isEmpty() && m_delayedFunctions.peek().time <= now);
+    }
+
+    void monitorThreadBody()
+    {
+        auto locker = holdLock(m_lock);
+        while (true) {
+            uint64_t takenCount = m_takenCount;
+            m_monitorCondition.waitFor(m_lock, starvationInterval);
+            if (!hasWaitingWork(MonotonicTime::now())) {
+                // Sleep until work can't be handed to a thread again or a
+                // delayed function is due
+                m_isMonitorThreadSleeping = true;
+                m_monitorCondition.waitUntil(m_lock, m_delayedFunctions.isEmpty() ? MonotonicTime::infinity() : m_delayedFunctions.peek().time);
+                m_isMonitorThreadSleeping = false;
+                continue;
+            }
+            if (m_idleThreadCount || m_takenCount != takenCount)
+                continue;
+
+            // A thread for each waiting function, at most doubling the threads
+            size_t count = std::min<size_t>({ std::max<size_t>(m_readyFunctions.size(), 1), std::max(m_threadCount, 1u), maximumThreadCount - m_threadCount });
+            while (count--)
+                startThread(locker);
+        }
+    }
+
+    void threadBody()
+    {
+        auto locker = holdLock(m_lock);
+        MonotonicTime idleSince = MonotonicTime::now();
+        while (true) {
+            MonotonicTime now = MonotonicTime::now();
+            // Functions and the queues they hold are released without the lock,
+            // they may dispatch more work
+            if (!m_delayedFunctions.isEmpty() && m_delayedFunctions.peek().time <= now) {
+                DelayedFunction delayed = m_delayedFunctions.dequeue();
+                m_takenCount++;
+                m_lock.unlock();
+                delayed.queue->dispatch(WTFMove(delayed.function));
+                delayed = { };
+                m_lock.lock();
+                continue;
+            }
+
+            if (!m_readyFunctions.isEmpty()) {
+                auto function = m_readyFunctions.takeFirst();
+                m_takenCount++;
+                m_lock.unlock();
+                function();
+                function = nullptr;
+                m_lock.lock();
+                idleSince = MonotonicTime::now();
+                continue;
+            }
+
+            // The last thread stays while there are delayed functions
+            if (now - idleSince >= idleTimeout && (m_delayedFunctions.isEmpty() || m_threadCount > 1)) {
+                m_threadCount--;
+                return;
+            }
+
+            MonotonicTime deadline = m_delayedFunctions.isEmpty() ? MonotonicTime::infinity() : m_delayedFunctions.peek().time;
+            if (now - idleSince < idleTimeout)
+                deadline = std::min(deadline, idleSince + idleTimeout);
+            m_idleThreadCount++;
+            m_condition.waitUntil(m_lock, deadline);
+            m_idleThreadCount--;
+        }
+    }
+
+    Lock m_lock;
+    Condition m_condition;
+    Condition m_monitorCondition;
+    Deque<Function<void()>> m_readyFunctions;
+    PriorityQueue<DelayedFunction, &isEarlier> m_delayedFunctions;
+    uint64_t m_nextSequence { 0 };
+    uint64_t m_takenCount { 0 };
+    unsigned m_threadCount { 0 };
+    unsigned m_idleThreadCount { 0 };
+    unsigned m_targetThreadCount;
+    bool m_hasMonitorThread { false };
+    bool m_isMonitorThreadSleeping { false };
+};
+
+constexpr Seconds WorkQueuePool::idleTimeout;
+constexpr Seconds WorkQueuePool::starvationInterval;
+
+// A serial queue yields its thread to other ready queues after this many
+// functions
+static const unsigned maximumFunctionsPerTurn = 16;
+
+void WorkQueue::platformInitialize(const char*, Type type, QOS)
+{
+    m_type = type;
+}
+
+void WorkQueue::platformInvalidate()
+{
+    // Pending functions keep their queue alive, there is nothing left to run
+    ASSERT(m_functions.isEmpty());
+}
+
+void WorkQueue::dispatch(Function<void()>&& function)
+{
+    if (m_type == Type::Concurrent) {
+        WorkQueuePool::singleton().schedule([protect = makeRef(*this), function = WTFMove(function)] {
+            function();
+        });
+        return;
+    }
+
+    {
+        auto locker = holdLock(m_functionsLock);
+        m_functions.append(WTFMove(function));
+        if (m_isScheduled)
+            return;
+        m_isScheduled = true;
+    }
+    WorkQueuePool::singleton().schedule([protect = makeRef(*this)] {
+        protect->performWork();
+    });
+}
+
+void WorkQueue::dispatchAfter(Seconds delay, Function<void()>&& function)
+{
+    WorkQueuePool::singleton().scheduleAfter(delay, makeRef(*this), WTFMove(function));
+}
+
+void WorkQueue::performWork()
+{
+    for (unsigned i = 0; i < maximumFunctionsPerTurn; ++i) {
+        Function<void()> function;
+        {
+            auto locker = holdLock(m_functionsLock);
+            if (m_functions.isEmpty()) {
+                m_isScheduled = false;
+                return;
+            }
+            function = m_functions.takeFirst();
+        }
+        function();
+    }
+
+    // Still scheduled, go to the back of the ready functions
+    WorkQueuePool::singleton().schedule([protect = makeRef(*this)] {
+        protect->performWork();
+    });
+}
+
+} // namespace WTF
+
+#endif // USE(GLIB_EVENT_LOOP)
@@ -0,0 +1,468 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "PageAllocator.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace WTF {
+
+static const size_t blockSizes[] = { 1024, 512, 256, 128, 64 }; /* In pages, tried in turn */
+
+static inline unsigned floorSizeClass(size_t pages)
+{
+    unsigned sizeClass = 0;
+    while (pages >>= 1)
+        sizeClass++;
+    return sizeClass;
+}
+
+static inline unsigned ceilSizeClass(size_t pages)
+{
+    unsigned sizeClass = floorSizeClass(pages);
+    return (size_t(1) << sizeClass) < pages ? sizeClass + 1 : sizeClass;
+}
+
+PageAllocator::PageAllocator(Backend& backend)
+    : m_backend(backend)
+    , m_blocks(nullptr)
+    , m_blockCount(0)
+    , m_blockCapacity(0)
+    , m_allocations(0)
+    , m_frees(0)
+    , m_blocksAllocated(0)
+    , m_blocksReleased(0)
+{
+    memset(m_freeLists, 0, sizeof(m_freeLists));
+    memset(m_nonEmptyLists, 0, sizeof(m_nonEmptyLists));
+}
+
+PageAllocator::~PageAllocator()
+{
+    while (m_blockCount)
+        destroyBlock(m_blocks[m_blockCount - 1]);
+    ::free(m_blocks);
+}
+
+void* PageAllocator::allocateBlockMemory(size_t minimumPages, bool executable, size_t& pageCount, uintptr_t& cookie)
+{
+    for (;;) {
+        size_t previous = 0;
+        for (size_t i = 0; i < sizeof(blockSizes) / sizeof(blockSizes[0]); i++) {
+            pageCount = blockSizes[i] > minimumPages ? blockSizes[i] : minimumPages;
+            if (pageCount == previous)
+                continue;
+            previous = pageCount;
+            if (void* memory = m_backend.allocateBlock(pageCount * pageSize, executable, cookie))
+                return memory;
+        }
+
+        if (!m_backend.retryAfterAllocationFailure(pageCount * pageSize))
+            return nullptr;
+    }
+}
+
+PageAllocator::Block* PageAllocator::allocateBlock(size_t minimumPages, bool executable)
+{
+    uintptr_t cookie = 0;
+    size_t pageCount = 0;
+    void* memory = allocateBlockMemory(minimumPages, executable, pageCount, cookie);
+    if (!memory)
+        return nullptr;
+
+    if (m_blockCount == m_blockCapacity) {
+        size_t capacity = m_blockCapacity ? m_blockCapacity * 2 : 16;
+        Block** blocks = static_cast<Block**>(realloc(m_blocks, capacity * sizeof(Block*)));
+        if (!blocks) {
+            m_backend.releaseBlock(memory, pageCount * pageSize, executable, cookie);
+            return nullptr;
+        }
+        m_blocks = blocks;
+        m_blockCapacity = capacity;
+    }
+
+    Block* block = static_cast<Block*>(malloc(sizeof(Block)));
+    Page* pages = static_cast<Page*>(calloc(pageCount, sizeof(Page)));
+    if (!block || !pages) {
+        ::free(block);
+        ::free(pages);
+        m_backend.releaseBlock(memory, pageCount * pageSize, executable, cookie);
+        return nullptr;
+    }
+
+    block->start = reinterpret_cast<uintptr_t>(memory);
+    block->pageCount = pageCount;
+    block->freePages = pageCount;
+    block->decommittedPages = 0;
+    block->cookie = cookie;
+    block->executable = executable;
+    block->pages = pages;
+
+    size_t position = m_blockCount;
+    while (position && m_blocks[position - 1]->start > block->start) {
+        m_blocks[position] = m_blocks[position - 1];
+        position--;
+    }
+    m_blocks[position] = block;
+    m_blockCount++;
+    m_blocksAllocated++;
+
+    insertFreeRun(block, 0, pageCount);
+    return block;
+}
+
+void PageAllocator::destroyBlock(Block* block)
+{
+    unlinkBlockFreeRuns(block);
+    m_backend.releaseBlock(reinterpret_cast<void*>(block->start), block->pageCount * pageSize, block->executable, block->cookie);
+    m_blocksReleased++;
+
+    for (size_t i = 0; i < m_blockCount; i++) {
+        if (m_blocks[i] == block) {
+            memmove(&m_blocks[i], &m_blocks[i + 1], (m_blockCount - i - 1) * sizeof(Block*));
+            m_blockCount--;
+            break;
+        }
+    }
+
+    ::free(block->pages);
+    ::free(block);
+}
+
+void PageAllocator::releaseBlockIfUnused(Block* block)
+{
+    // Decommitted pages are still reserved by their owner, only a block with nothing allocated goes back
+    if (block->freePages == block->pageCount)
+        destroyBlock(block);
+}
+
+PageAllocator::Block* PageAllocator::findBlock(uintptr_t address, size_t& index) const
+{
+    size_t low = 0;
+    size_t high = m_blockCount;
+
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        Block* block = m_blocks[middle];
+        if (address < block->start)
+            high = middle;
+        else if (address >= block->start + block->pageCount * pageSize)
+            low = middle + 1;
+        else {
+            index = (address - block->start) / pageSize;
+            return block;
+        }
+    }
+
+    return nullptr;
+}
+
+size_t PageAllocator::alignedIndex(const Block* block, size_t index, size_t alignmentPages)
+{
+    if (alignmentPages <= 1)
+        return index;
+
+    uintptr_t alignment = alignmentPages * pageSize;
+    uintptr_t address = block->start + index * pageSize;
+    uintptr_t aligned = (address + alignment - 1) & ~(alignment - 1);
+    return index + (aligned - address) / pageSize;
+}
+
+PageAllocator::Page* PageAllocator::findFreeRun(bool executable, size_t pageCount, size_t alignmentPages) const
+{
+    unsigned kind = executable ? 1 : 0;
+
+    // Every run in a list from this class up fits, whatever alignment it ends up needing
+    unsigned sizeClass = ceilSizeClass(pageCount + alignmentPages - 1);
+    uint32_t candidates = sizeClass < sizeClassCount ? m_nonEmptyLists[kind] & (~uint32_t(0) << sizeClass) : 0;
+    if (candidates)
+        return m_freeLists[kind][__builtin_ctz(candidates)];
+
+    // Smaller classes may still hold a run that is long enough
+    for (unsigned smaller = floorSizeClass(pageCount); smaller < sizeClass && smaller < sizeClassCount; smaller++) {
+        for (Page* page = m_freeLists[kind][smaller]; page; page = page->nextFree) {
+            size_t index = page - page->block->pages;
+            if (alignedIndex(page->block, index, alignmentPages) + pageCount <= index + page->run)
+                return page;
+        }
+    }
+
+    return nullptr;
+}
+
+void PageAllocator::linkFreeRun(Block* block, size_t index)
+{
+    Page* page = &block->pages[index];
+    unsigned kind = block->executable ? 1 : 0;
+    unsigned sizeClass = floorSizeClass(page->run);
+
+    page->block = block;
+    page->prevFree = nullptr;
+    page->nextFree = m_freeLists[kind][sizeClass];
+    if (page->nextFree)
+        page->nextFree->prevFree = page;
+    m_freeLists[kind][sizeClass] = page;
+    m_nonEmptyLists[kind] |= uint32_t(1) << sizeClass;
+}
+
+void PageAllocator::unlinkFreeRun(Block* block, size_t index)
+{
+    Page* page = &block->pages[index];
+    unsigned kind = block->executable ? 1 : 0;
+    unsigned sizeClass = floorSizeClass(page->run);
+
+    if (page->prevFree)
+        page->prevFree->nextFree = page->nextFree;
+    else
+        m_freeLists[kind][sizeClass] = page->nextFree;
+    if (page->nextFree)
+        page->nextFree->prevFree = page->prevFree;
+    if (!m_freeLists[kind][sizeClass])
+        m_nonEmptyLists[kind] &= ~(uint32_t(1) << sizeClass);
+
+    page->block = nullptr;
+    page->nextFree = page->prevFree = nullptr;
+}
+
+void PageAllocator::insertFreeRun(Block* block, size_t index, size_t length)
+{
+    Page& head = block->pages[index];
+    Page& tail = block->pages[index + length - 1];
+
+    head.run = length;
+    head.tags = RunHead | FreeHead;
+    tail.run = length;
+    tail.tags |= FreeTail;
+
+    linkFreeRun(block, index);
+}
+
+void PageAllocator::removeFreeRun(Block* block, size_t index)
+{
+    Page& head = block->pages[index];
+    size_t length = head.run;
+
+    unlinkFreeRun(block, index);
+
+    head.tags = 0;
+    block->pages[index + length - 1].tags = 0;
+}
+
+void PageAllocator::unlinkBlockFreeRuns(Block* block)
+{
+    for (size_t index = 0; index < block->pageCount; index += block->pages[index].run) {
+        if (block->pages[index].tags & FreeHead)
+            unlinkFreeRun(block, index);
+    }
+}
+
+void* PageAllocator::allocate(size_t pageCount, size_t alignment, bool executable)
+{
+    if (!pageCount)
+        pageCount = 1;
+
+    size_t alignmentPages = alignment > pageSize ? alignment / pageSize : 1;
+
+    Page* page = findFreeRun(executable, pageCount, alignmentPages);
+    Block* block;
+
+    if (page)
+        block = page->block;
+    else {
+        block = allocateBlock(pageCount + alignmentPages - 1, executable);
+        if (!block)
+            return nullptr;
+        page = block->pages;
+    }
+
+    size_t index = page - block->pages;
+    size_t runEnd = index + page->run;
+    size_t start = alignedIndex(block, index, alignmentPages);
+    size_t end = start + pageCount;
+
+    removeFreeRun(block, index);
+    if (start > index)
+        insertFreeRun(block, index, start - index);
+    if (end < runEnd)
+        insertFreeRun(block, end, runEnd - end);
+
+    block->pages[start].run = pageCount;
+    block->pages[start].tags = RunHead;
+    block->freePages -= pageCount;
+    m_allocations++;
+
+    return reinterpret_cast<void*>(block->start + start * pageSize);
+}
+
+bool PageAllocator::free(void* address, size_t pageCount)
+{
+    size_t index;
+    Block* block = findBlock(reinterpret_cast<uintptr_t>(address), index);
+    if (!block || !pageCount)
+        return false;
+
+    // Find the allocation these pages belong to, freeing only part of one is rare
+    size_t head = index;
+    while (head && !(block->pages[head].tags & RunHead))
+        head--;
+
+    Page& allocation = block->pages[head];
+    if ((allocation.tags & (RunHead | FreeHead)) != RunHead || index + pageCount > head + allocation.run)
+        return false;
+
+    size_t allocationEnd = head + allocation.run;
+    if (head < index)
+        allocation.run = index - head;
+    else
+        allocation.tags = 0;
+
+    if (index + pageCount < allocationEnd) {
+        block->pages[index + pageCount].run = allocationEnd - index - pageCount;
+        block->pages[index + pageCount].tags = RunHead;
+    }
+
+    if (block->decommittedPages) {
+        for (size_t i = index; i < index + pageCount; i++) {
+            if (block->pages[i].decommitted) {
+                block->pages[i].decommitted = false;
+                block->decommittedPages--;
+            }
+        }
+    }
+
+    block->freePages += pageCount;
+    m_frees++;
+
+    // Coalesce with the free runs around
+    size_t start = index;
+    size_t length = pageCount;
+
+    size_t next = index + pageCount;
+    if (next < block->pageCount && (block->pages[next].tags & FreeHead)) {
+        length += block->pages[next].run;
+        removeFreeRun(block, next);
+    }
+
+    if (start && (block->pages[start - 1].tags & FreeTail)) {
+        size_t previousLength = block->pages[start - 1].run;
+        start -= previousLength;
+        length += previousLength;
+        removeFreeRun(block, start);
+    }
+
+    insertFreeRun(block, start, length);
+    releaseBlockIfUnused(block);
+    return true;
+}
+
+bool PageAllocator::free(void* address)
+{
+    size_t index;
+    Block* block = findBlock(reinterpret_cast<uintptr_t>(address), index);
+    if (!block || (block->pages[index].tags & (RunHead | FreeHead)) != RunHead)
+        return false;
+
+    return free(address, block->pages[index].run);
+}
+
+void PageAllocator::decommit(void* address, size_t pageCount)
+{
+    size_t index;
+    Block* block = findBlock(reinterpret_cast<uintptr_t>(address), index);
+    if (!block)
+        return;
+
+    size_t end = index + pageCount < block->pageCount ? index + pageCount : block->pageCount;
+
+    // Walk the runs covering the range, only allocated pages can be decommitted
+    size_t run = index;
+    while (run && !(block->pages[run].tags & RunHead))
+        run--;
+
+    for (; run < end; run += block->pages[run].run) {
+        if (block->pages[run].tags & FreeHead)
+            continue;
+
+        size_t first = run > index ? run : index;
+        size_t last = run + block->pages[run].run < end ? run + block->pages[run].run : end;
+        for (size_t i = first; i < last; i++) {
+            if (!block->pages[i].decommitted) {
+                block->pages[i].decommitted = true;
+                block->decommittedPages++;
+            }
+        }
+    }
+}
+
+void PageAllocator::commit(void* address, size_t pageCount)
+{
+    size_t index;
+    Block* block = findBlock(reinterpret_cast<uintptr_t>(address), index);
+    if (!block || !block->decommittedPages)
+        return;
+
+    size_t end = index + pageCount < block->pageCount ? index + pageCount : block->pageCount;
+    for (size_t i = index; i < end; i++) {
+        if (block->pages[i].decommitted) {
+            block->pages[i].decommitted = false;
+            block->decommittedPages--;
+        }
+    }
+}
+
+PageAllocator::Statistics PageAllocator::statistics() const
+{
+    Statistics statistics;
+    memset(&statistics, 0, sizeof(statistics));
+
+    for (size_t i = 0; i < m_blockCount; i++) {
+        const Block* block = m_blocks[i];
+        size_t bytes = block->pageCount * pageSize;
+
+        statistics.blocks++;
+        statistics.reservedBytes += bytes;
+        statistics.freeBytes += block->freePages * pageSize;
+        statistics.allocatedBytes += (block->pageCount - block->freePages) * pageSize;
+        statistics.decommittedBytes += block->decommittedPages * pageSize;
+    }
+
+    for (unsigned kind = 0; kind < 2; kind++) {
+        if (!m_nonEmptyLists[kind])
+            continue;
+        unsigned sizeClass = 31 - __builtin_clz(m_nonEmptyLists[kind]);
+        for (const Page* page = m_freeLists[kind][sizeClass]; page; page = page->nextFree) {
+            if (page->run * pageSize > statistics.largestFreeRunBytes)
+                statistics.largestFreeRunBytes = page->run * pageSize;
+        }
+    }
+
+    statistics.allocations = m_allocations;
+    statistics.frees = m_frees;
+    statistics.blocksAllocated = m_blocksAllocated;
+    statistics.blocksReleased = m_blocksReleased;
+    return statistics;
+}
+
+} // namespace WTF
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PageAllocator_h
+#define PageAllocator_h
+
+#include <cstddef>
+#include <cstdint>
+
+namespace WTF {
+
+// Hands out runs of pages carved from large blocks obtained from the system. Free runs sit in lists
+// segregated by power of two size, so finding one is a bitmask lookup rather than a scan over every
+// page, and neighbouring runs are coalesced on free through tags on their first and last pages.
+//
+// Pages of an allocation may be decommitted. Without virtual memory this only keeps count of them,
+// the reservation stays mapped so that committing never fails. A block goes back to the system once
+// none of its pages are allocated anymore.
+//
+// Does not depend on the OS (the Backend does) and is not thread safe, callers serialize access.
+// Source/WTF/benchmarks/PageAllocatorStress.cpp runs a stress test of it on a development host.
+class PageAllocator {
+public:
+    static const size_t pageSize = 4096;
+
+    class Backend {
+    public:
+        virtual ~Backend() { }
+
+        // Returns page aligned memory, cookie identifies the system allocation for the calls below
+        virtual void* allocateBlock(size_t bytes, bool executable, uintptr_t& cookie) = 0;
+        virtual void releaseBlock(void* address, size_t bytes, bool executable, uintptr_t cookie) = 0;
+        // Called once every block size failed to allocate, return true to try again
+        virtual bool retryAfterAllocationFailure(size_t) { return false; }
+    };
+
+    struct Statistics {
+        size_t blocks;
+        size_t reservedBytes; // held from the system
+        size_t allocatedBytes; // handed out, including decommitted pages
+        size_t decommittedBytes;
+        size_t freeBytes; // free within the blocks held from the system
+        size_t largestFreeRunBytes;
+        uint64_t allocations;
+        uint64_t frees;
+        uint64_t blocksAllocated;
+        uint64_t blocksReleased;
+    };
+
+    explicit PageAllocator(Backend&);
+    ~PageAllocator();
+
+    // alignment is in bytes and a power of two, anything up to pageSize means page aligned
+    void* allocate(size_t pageCount, size_t alignment, bool executable);
+    // Frees pageCount pages at address, which may be just a part of an allocation
+    bool free(void* address, size_t pageCount);
+    // Frees the whole allocation starting at address
+    bool free(void* address);
+
+    void decommit(void* address, size_t pageCount);
+    void commit(void* address, size_t pageCount);
+
+    Statistics statistics() const;
+
+private:
+    struct Block;
+
+    struct Page {
+        uint32_t run; // first page of a run: its length, last page of a free run: its length too
+        uint8_t tags;
+        bool decommitted;
+        Block* block; // set on the first page of a free run while it is listed
+        Page* nextFree;
+        Page* prevFree;
+    };
+
+    struct Block {
+        uintptr_t start;
+        size_t pageCount;
+        size_t freePages;
+        size_t decommittedPages;
+        uintptr_t cookie;
+        bool executable;
+        Page* pages;
+    };
+
+    enum PageTag : uint8_t {
+        RunHead = 1,
+        FreeHead = 2,
+        FreeTail = 4,
+    };
+
+    static const unsigned sizeClassCount = 32;
+
+    void* allocateBlockMemory(size_t minimumPages, bool executable, size_t& pageCount, uintptr_t& cookie);
+    Block* allocateBlock(size_t minimumPages, bool executable);
+    void destroyBlock(Block*);
+    void releaseBlockIfUnused(Block*);
+    Block* findBlock(uintptr_t address, size_t& index) const;
+
+    Page* findFreeRun(bool executable, size_t pageCount, size_t alignmentPages) const;
+    void insertFreeRun(Block*, size_t index, size_t length);
+    void removeFreeRun(Block*, size_t index);
+    void linkFreeRun(Block*, size_t index);
+    void unlinkFreeRun(Block*, size_t index);
+    void unlinkBlockFreeRuns(Block*);
+
+    static size_t alignedIndex(const Block*, size_t index, size_t alignmentPages);
+
+    Backend& m_backend;
+    Block** m_blocks; // sorted by address
+    size_t m_blockCount;
+    size_t m_blockCapacity;
+    Page* m_freeLists[2][sizeClassCount];
+    uint32_t m_nonEmptyLists[2];
+    uint64_t m_allocations;
+    uint64_t m_frees;
+    uint64_t m_blocksAllocated;
+    uint64_t m_blocksReleased;
+};
+
+} // namespace WTF
+
+#endif // PageAllocator_h
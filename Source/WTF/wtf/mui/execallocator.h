@@ -27,10 +27,19 @@
 #define _EXEC_ALLOCATOR_
 
 #include <cstring>
+#include "PageAllocator.h"
 
 void * allocator_getmem_page_aligned(size_t bytes, bool executable);
 void * allocator_getmem_aligned(size_t bytes, size_t alignment);
 void   allocator_freemem(void * address, size_t bytes);
 void   allocator_freemem(void * address);
 
+/* Decommitted pages stay allocated from exec, these only keep count of them */
+void   allocator_commit(void * address, size_t bytes);
+void   allocator_decommit(void * address, size_t bytes);
+
+WTF::PageAllocator::Statistics allocator_statistics();
+/* Usage summary. Free with free() */
+char * allocator_report();
+
 #endif /* _EXEC_ALLOCATOR_ */
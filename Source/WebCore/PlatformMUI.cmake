@@ -20,7 +20,10 @@ list(APPEND WebCore_INCLUDE_DIRECTORIES
 
 list(APPEND WebCore_SOURCES
 
+    bindings/js/ScriptBytecodeCache.cpp
+
     loader/AdBlock.cpp
+    loader/AdBlockContentExtension.cpp
 
     platform/bal/ObserverServiceBookmarklet.cpp
     platform/bal/ObserverServiceData.cpp
@@ -41,6 +44,7 @@ list(APPEND WebCore_SOURCES
     platform/graphics/mui/AcinerellaHLS.cpp
     platform/graphics/mui/AcinerellaMuxer.cpp
     platform/graphics/mui/AcinerellaPointer.cpp
+    platform/graphics/mui/AcinerellaVideoConverter.cpp
     platform/graphics/mui/AcinerellaVideoDecoder.cpp
     platform/graphics/mui/AudioTrackPrivateMorphOS.cpp
     platform/graphics/mui/MediaDescriptionMorphOS.cpp
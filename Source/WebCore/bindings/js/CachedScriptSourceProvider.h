@@ -29,6 +29,7 @@
 #include "CachedResourceHandle.h"
 #include "CachedScript.h"
 #include "CachedScriptFetcher.h"
+#include "ScriptBytecodeCache.h"
 #include <JavaScriptCore/SourceProvider.h>
 
 namespace WebCore {
@@ -46,15 +47,28 @@ public:
     unsigned hash() const override { return m_cachedScript->scriptHash(); }
     StringView source() const override { return m_cachedScript->script(); }
 
+#if PLATFORM(MUI) && USE(CURL)
+    const JSC::CachedBytecode* cachedBytecode() const override { return m_bytecode.cachedBytecode(hash(), source().length()); }
+    void cacheBytecode(const JSC::BytecodeCacheGenerator& generator) const override { m_bytecode.cacheBytecode(hash(), source().length(), generator); }
+    void didDecodeCachedBytecode(bool decoded, Seconds decodeTime) const override { m_bytecode.didDecodeCachedBytecode(decoded, decodeTime); }
+    void didGenerateBytecode(Seconds generateTime) const override { m_bytecode.didGenerateBytecode(generateTime); }
+#endif
+
 private:
     CachedScriptSourceProvider(CachedScript* cachedScript, JSC::SourceProviderSourceType sourceType, Ref<CachedScriptFetcher>&& scriptFetcher)
         : SourceProvider(JSC::SourceOrigin { cachedScript->response().url(), WTFMove(scriptFetcher) }, URL(cachedScript->response().url()), TextPosition(), sourceType)
         , m_cachedScript(cachedScript)
+#if PLATFORM(MUI) && USE(CURL)
+        , m_bytecode(cachedScript->url().string())
+#endif
     {
         m_cachedScript->addClient(*this);
     }
 
     CachedResourceHandle<CachedScript> m_cachedScript;
+#if PLATFORM(MUI) && USE(CURL)
+    mutable ScriptBytecodeCache::Script m_bytecode;
+#endif
 };
 
 } // namespace WebCore
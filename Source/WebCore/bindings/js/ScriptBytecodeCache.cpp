@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "ScriptBytecodeCache.h"
+
+#if PLATFORM(MUI) && USE(CURL)
+
+#include "CommonVM.h"
+#include "CurlCacheManager.h"
+#include <JavaScriptCore/Completion.h>
+
+namespace WebCore {
+
+// Smaller scripts are generated about as fast as they are read back
+static const unsigned minimumSourceLength = 8 * 1024;
+static const Seconds writeDelay { 5_s };
+
+// Header of a bytecode file, followed by the bytecode. Its size keeps the
+// bytecode as aligned as the buffer it is read into.
+struct ScriptBytecodeHeader {
+    char magic[8];
+    uint32_t sourceHash;
+    uint32_t sourceLength;
+    double generateTime;
+    uint64_t bytecodeSize;
+};
+static_assert(!(sizeof(ScriptBytecodeHeader) % 16), "bytecode must stay 16 byte aligned");
+
+static const char bytecodeMagic[8] = { 'O', 'W', 'B', 'J', 'S', 'B', 'C', '1' };
+
+ScriptBytecodeCache& ScriptBytecodeCache::singleton()
+{
+    static NeverDestroyed<ScriptBytecodeCache> sharedInstance;
+    return sharedInstance;
+}
+
+ScriptBytecodeCache::ScriptBytecodeCache()
+    : m_writeTimer(*this, &ScriptBytecodeCache::writeTimerFired)
+{
+}
+
+void ScriptBytecodeCache::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    if (!enabled)
+        m_writeTimer.stop();
+}
+
+void ScriptBytecodeCache::writePendingBytecode()
+{
+    if (!m_writeTimer.isActive())
+        return;
+
+    m_writeTimer.stop();
+    writeTimerFired();
+}
+
+void ScriptBytecodeCache::writeTimerFired()
+{
+    JSC::writeCodeCache(commonVM());
+}
+
+const JSC::CachedBytecode* ScriptBytecodeCache::Script::cachedBytecode(unsigned sourceHash, unsigned sourceLength)
+{
+    // Decoded code blocks are not kept by the code cache, the bytecode is
+    // decoded again whenever the script is evaluated again
+    if (!m_didLoad) {
+        m_didLoad = true;
+        load(sourceHash, sourceLength);
+    }
+    return &m_cachedBytecode;
+}
+
+void ScriptBytecodeCache::Script::load(unsigned sourceHash, unsigned sourceLength)
+{
+    if (sourceLength < minimumSourceLength || !singleton().isEnabled())
+        return;
+
+    m_file = CurlCacheManager::singleton().loadBytecode(m_url);
+    if (m_file.size() < sizeof(ScriptBytecodeHeader)) {
+        m_file = { };
+        return;
+    }
+
+    auto* header = static_cast<const ScriptBytecodeHeader*>(m_file.data());
+    if (memcmp(header->magic, bytecodeMagic, sizeof(bytecodeMagic))
+        || header->sourceHash != sourceHash
+        || header->sourceLength != sourceLength
+        || header->bytecodeSize != m_file.size() - sizeof(ScriptBytecodeHeader)) {
+        singleton().m_statistics.rejected++;
+        m_file = { };
+        return;
+    }
+
+    m_recordedGenerateTime = Seconds(header->generateTime);
+    m_cachedBytecode = JSC::CachedBytecode { header + 1, static_cast<size_t>(header->bytecodeSize) };
+}
+
+void ScriptBytecodeCache::Script::didDecodeCachedBytecode(bool decoded, Seconds decodeTime)
+{
+    auto& statistics = singleton().m_statistics;
+    statistics.decodeTime += decodeTime;
+    if (!decoded) {
+        // Written by another JSC build or for another source, it is replaced
+        // once the bytecode generated instead is written
+        statistics.rejected++;
+        m_cachedBytecode = { };
+        m_file = { };
+        return;
+    }
+
+    statistics.hits++;
+    if (m_recordedGenerateTime > decodeTime)
+        statistics.timeSaved += m_recordedGenerateTime - decodeTime;
+}
+
+void ScriptBytecodeCache::Script::didGenerateBytecode(Seconds generateTime)
+{
+    auto& cache = singleton();
+    if (!cache.isEnabled())
+        return;
+
+    m_generateTime += generateTime;
+    cache.m_statistics.generateTime += generateTime;
+    cache.m_writeTimer.startOneShot(writeDelay);
+}
+
+void ScriptBytecodeCache::Script::cacheBytecode(unsigned sourceHash, unsigned sourceLength, const JSC::BytecodeCacheGenerator& generator)
+{
+    if (!m_generateTime || sourceLength < minimumSourceLength || !singleton().isEnabled())
+        return;
+
+    JSC::CachedBytecode bytecode = generator();
+    if (!bytecode.size())
+        return;
+
+    ScriptBytecodeHeader header { };
+    memcpy(header.magic, bytecodeMagic, sizeof(bytecodeMagic));
+    header.sourceHash = sourceHash;
+    header.sourceLength = sourceLength;
+    header.generateTime = m_generateTime.seconds();
+    header.bytecodeSize = bytecode.size();
+
+    Vector<char> data;
+    data.reserveInitialCapacity(sizeof(header) + bytecode.size());
+    data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    data.append(static_cast<const char*>(bytecode.data()), bytecode.size());
+    if (CurlCacheManager::singleton().storeBytecode(m_url, WTFMove(data)))
+        singleton().m_statistics.stores++;
+}
+
+} // namespace WebCore
+
+#endif // PLATFORM(MUI) && USE(CURL)
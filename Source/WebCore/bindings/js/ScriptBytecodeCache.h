@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#if PLATFORM(MUI) && USE(CURL)
+
+#include "Timer.h"
+#include <JavaScriptCore/SourceProvider.h>
+#include <wtf/FileSystem.h>
+#include <wtf/NeverDestroyed.h>
+#include <wtf/Seconds.h>
+#include <wtf/text/WTFString.h>
+
+namespace WebCore {
+
+// Keeps the bytecode of scripts loaded through the Curl disk cache next to
+// their cached body, so that the next evaluation of the same script decodes
+// its top level code instead of parsing and generating it again. Bytecode is
+// written a while after it was generated, once functions run during the load
+// have been compiled too. JSC rejects bytecode of another JSC build, it is
+// then generated and written again.
+class ScriptBytecodeCache {
+    WTF_MAKE_NONCOPYABLE(ScriptBytecodeCache);
+    friend NeverDestroyed<ScriptBytecodeCache>;
+public:
+    WEBCORE_EXPORT static ScriptBytecodeCache& singleton();
+
+    // Off by default
+    WEBCORE_EXPORT void setEnabled(bool);
+    bool isEnabled() const { return m_enabled; }
+    // Writes the bytecode generated since the last write right away, used
+    // at shutdown
+    WEBCORE_EXPORT void writePendingBytecode();
+
+    struct Statistics {
+        unsigned hits { 0 };
+        unsigned rejected { 0 };
+        unsigned stores { 0 };
+        // Generation time recorded with the decoded bytecode, less the time
+        // spent decoding it
+        Seconds timeSaved;
+        Seconds decodeTime;
+        Seconds generateTime;
+    };
+    const Statistics& statistics() const { return m_statistics; }
+
+    // Bytecode of one script, kept by its source provider
+    class Script {
+        WTF_MAKE_NONCOPYABLE(Script);
+    public:
+        explicit Script(const String& url) : m_url(url) { }
+
+        // The source is named by its hash and length
+        const JSC::CachedBytecode* cachedBytecode(unsigned sourceHash, unsigned sourceLength);
+        void cacheBytecode(unsigned sourceHash, unsigned sourceLength, const JSC::BytecodeCacheGenerator&);
+        void didDecodeCachedBytecode(bool decoded, Seconds);
+        void didGenerateBytecode(Seconds);
+
+    private:
+        void load(unsigned sourceHash, unsigned sourceLength);
+
+        String m_url;
+        bool m_didLoad { false };
+        FileSystem::MappedFileData m_file;
+        JSC::CachedBytecode m_cachedBytecode;
+        Seconds m_recordedGenerateTime;
+        Seconds m_generateTime;
+    };
+
+private:
+    ScriptBytecodeCache();
+
+    void writeTimerFired();
+
+    bool m_enabled { false };
+    Statistics m_statistics;
+    Timer m_writeTimer;
+};
+
+} // namespace WebCore
+
+#endif // PLATFORM(MUI) && USE(CURL)
@@ -26,15 +26,35 @@
  */
 
 #include "config.h"
+#include "AdBlockContentExtension.h"
+#include "AdBlockRule.h"
 #include "CachedResource.h"
+#include "CSSParserContext.h"
+#include "Document.h"
+#include "ExtensionStyleSheets.h"
+#include "StyleSheetContents.h"
+#include "Timer.h"
 #include <wtf/text/CString.h>
 #include "TextEncoding.h"
 #include <JavaScriptCore/RegularExpression.h>
+#include <wtf/FileSystem.h>
 #include <wtf/HashMap.h>
+#include <wtf/HashSet.h>
+#include <wtf/ListHashSet.h>
+#include <wtf/Lock.h>
+#include <wtf/MainThread.h>
+#include <wtf/MonotonicTime.h>
+#include <wtf/NeverDestroyed.h>
+#include <wtf/Optional.h>
 #include <wtf/Vector.h>
-#include <wtf/text/StringView.h>
+#include <wtf/text/StringBuilder.h>
+#include <wtf/text/StringConcatenateNumbers.h>
 
+#include <atomic>
+#include <limits>
+#include <memory>
 #include <stdio.h>
+#include <string.h>
 #include <clib/debug_protos.h>
 #include "gui.h"
 
@@ -50,58 +70,635 @@ constexpr auto to_underlying(E e) noexcept
 namespace WebCore {
 
 #define DOCUMENT_TYPE 9
-#define CACHE_SIZE 1009
+#define CACHE_SIZE 4096
 #define SHORTCUT_SIZE 8
 #define FILTER_PATH "PROGDIR:conf/blocked.prefs"
+#define SNAPSHOT_PATH "PROGDIR:conf/blocked.bin"
+#define SNAPSHOT_VERSION 5
+#define SNAPSHOT_IN_BYTECODE 1
+#define SNAPSHOT_HAS_BYTECODE 1
+#define BYTECODE_DENY_PATH "PROGDIR:conf/blocked-deny.dfa"
+#define BYTECODE_ALLOW_PATH "PROGDIR:conf/blocked-allow.dfa"
+/* Entry count limit of the content extension parser */
+#define BYTECODE_MAX_RULES 50000
+/* Delay after the last edit before the bytecode is recompiled */
+#define BYTECODE_RECOMPILE_DELAY 2_s
+#define SNAPSHOT_ELEMENT_HIDING_LIST 2
+#define HOST_STYLESHEET_CACHE_SIZE 32
+
+/*
+ * Filter engine
+ *
+ * Rules are compiled into a small glob program (segments separated by '*',
+ * '^' separator placeholders and start/domain/end anchors) that is matched
+ * directly against the lowercased URL, so only real /regex/ rules go through
+ * Yarr. Every glob rule is indexed by its rarest 8 character literal run
+ * (packed into a 64 bit key), and a URL only tests the rules whose shortcut
+ * occurs in it, plus the few rules that have no usable shortcut.
+ */
+
+typedef uint64_t AdShortcut;
+
+enum class AdAnchor { None, Start, Domain };
+
+class AdTarget {
+public:
+    AdTarget(const String& url)
+        : m_url(url)
+        , m_lowered(url.convertToASCIILowercase().latin1())
+        , m_hostStart(0)
+        , m_hostEnd(0)
+    {
+        const char* text = m_lowered.data();
+        size_t length = m_lowered.length();
+        const char* scheme = strstr(text, "://");
+        if (scheme) {
+            m_hostStart = scheme - text + 3;
+            m_hostEnd = m_hostStart;
+            while (m_hostEnd < length && text[m_hostEnd] != '/' && text[m_hostEnd] != '?' && text[m_hostEnd] != '#' && text[m_hostEnd] != ':')
+                m_hostEnd++;
+        }
+    }
+
+    const String& url() const { return m_url; }
+    const char* data() const { return m_lowered.data(); }
+    size_t length() const { return m_lowered.length(); }
+    size_t hostStart() const { return m_hostStart; }
+    size_t hostEnd() const { return m_hostEnd; }
+
+private:
+    String m_url;
+    CString m_lowered;
+    size_t m_hostStart;
+    size_t m_hostEnd;
+};
 
 class AdPattern {
 public:
-	AdPattern() : m_string(""), m_re(JSC::Yarr::RegularExpression("", JSC::Yarr::TextCaseInsensitive)), m_types(0) { }
-	AdPattern(String str, const JSC::Yarr::RegularExpression& re, int types)
-		: m_string(str), m_re(re), m_types(types) { }
-    bool matches(const String& target, int type) {
-		return ((1<<type) & m_types) && m_re.match(target) >= 0;
-    }
-	String m_string;
-    JSC::Yarr::RegularExpression m_re;
+    AdPattern() : m_snapshotRule(0), m_snapshotRuleLength(0), m_compiled(false), m_isRegularExpression(false), m_inBytecode(false), m_anchor(AdAnchor::None), m_anchorEnd(false), m_shortcut(0), m_types(0) { }
+    AdPattern(const String& rule, int types);
+    // Rules restored from the snapshot keep pointing into the mapped file and
+    // are only compiled once they become a match candidate.
+    AdPattern(const char* rule, unsigned ruleLength, int types, AdShortcut shortcut);
+
+    bool matches(const AdTarget& target, int type)
+    {
+        if (!((1<<type) & m_types))
+            return false;
+        compile();
+        if (m_isRegularExpression) {
+            if (!m_re)
+                m_re = std::make_unique<JSC::Yarr::RegularExpression>(m_regularExpression, JSC::Yarr::TextCaseInsensitive);
+            return m_re->match(target.url()) >= 0;
+        }
+        return matchesGlob(target);
+    }
+
+    const String& rule();
+    void detachFromSnapshot() { rule(); m_snapshotRule = 0; }
+    int types() const { return m_types; }
+    // Rules compiled into the content extension bytecode are skipped here.
+    bool isInBytecode() const { return m_inBytecode; }
+    void setInBytecode(bool inBytecode) { m_inBytecode = inBytecode; }
+    AdShortcut shortcut() const { return m_shortcut; }
+    void setShortcut(AdShortcut shortcut) { m_shortcut = shortcut; }
+    bool isRegularExpression() { compile(); return m_isRegularExpression; }
+    const Vector<CString>& segments() { compile(); return m_segments; }
+
 private:
+    void compile();
+    bool matchesGlob(const AdTarget&) const;
+    bool matchesSegmentsAt(const char* text, size_t length, size_t start) const;
+
+    String m_string;
+    const char* m_snapshotRule;
+    unsigned m_snapshotRuleLength;
+    bool m_compiled;
+    bool m_isRegularExpression;
+    bool m_inBytecode;
+    String m_regularExpression;
+    std::unique_ptr<JSC::Yarr::RegularExpression> m_re;
+    Vector<CString> m_segments;
+    AdAnchor m_anchor;
+    bool m_anchorEnd;
+    AdShortcut m_shortcut;
     unsigned int m_types;
 };
 
-class CacheEntry {
+static inline bool isSeparator(char c)
+{
+    return !(isASCIIAlphanumeric(c) || c == '_' || c == '-' || c == '.' || c == '%');
+}
+
+// Returns the end of the match of segment at position, or notFound.
+static size_t matchSegmentAt(const char* text, size_t length, size_t position, const CString& segment)
+{
+    const char* pattern = segment.data();
+    size_t segmentLength = segment.length();
+    for (size_t i = 0; i < segmentLength; i++) {
+        if (position + i >= length) {
+            // '^' also matches the end of the address.
+            return (pattern[i] == '^' && i == segmentLength - 1) ? length : notFound;
+        }
+        char c = text[position + i];
+        if (pattern[i] == '^') {
+            if (!isSeparator(c))
+                return notFound;
+        } else if (pattern[i] != c)
+            return notFound;
+    }
+    return position + segmentLength;
+}
+
+AdPattern::AdPattern(const String& rule, int types)
+    : m_string(rule)
+    , m_snapshotRule(0)
+    , m_snapshotRuleLength(0)
+    , m_compiled(false)
+    , m_isRegularExpression(false)
+    , m_inBytecode(false)
+    , m_anchor(AdAnchor::None)
+    , m_anchorEnd(false)
+    , m_shortcut(0)
+    , m_types(types)
+{
+}
+
+AdPattern::AdPattern(const char* rule, unsigned ruleLength, int types, AdShortcut shortcut)
+    : m_snapshotRule(rule)
+    , m_snapshotRuleLength(ruleLength)
+    , m_compiled(false)
+    , m_isRegularExpression(false)
+    , m_inBytecode(false)
+    , m_anchor(AdAnchor::None)
+    , m_anchorEnd(false)
+    , m_shortcut(shortcut)
+    , m_types(types)
+{
+}
+
+const String& AdPattern::rule()
+{
+    if (m_string.isNull() && m_snapshotRule)
+        m_string = String::fromUTF8(m_snapshotRule, m_snapshotRuleLength);
+    return m_string;
+}
+
+void AdPattern::compile()
+{
+    if (m_compiled)
+        return;
+    m_compiled = true;
+
+    String pattern = splitAdBlockRule(rule()).pattern;
+
+    if (pattern.length() > 1 && pattern.startsWith("/") && pattern.endsWith("/")) {
+        m_isRegularExpression = true;
+        m_regularExpression = pattern.substring(1, pattern.length() - 2);
+        return;
+    }
+
+    String glob = pattern.convertToASCIILowercase();
+    if (glob.startsWith("||")) {
+        m_anchor = AdAnchor::Domain;
+        glob = glob.substring(2);
+    } else if (glob.startsWith("|")) {
+        m_anchor = AdAnchor::Start;
+        glob = glob.substring(1);
+    }
+    if (glob.endsWith("|")) {
+        m_anchorEnd = true;
+        glob = glob.left(glob.length() - 1);
+    }
+
+    for (auto& segment : glob.split('*'))
+        m_segments.append(segment.latin1());
+}
+
+bool AdPattern::matchesSegmentsAt(const char* text, size_t length, size_t start) const
+{
+    bool anchored = m_anchor != AdAnchor::None;
+    size_t position = start;
+    size_t count = m_segments.size();
+
+    for (size_t i = 0; i < count; i++) {
+        const CString& segment = m_segments[i];
+        size_t end = notFound;
+
+        if (!i && anchored) {
+            end = matchSegmentAt(text, length, position, segment);
+        } else if (i == count - 1 && m_anchorEnd) {
+            // The last segment has to end exactly at the end of the address.
+            size_t segmentLength = segment.length();
+            if (segmentLength <= length && length - segmentLength >= position)
+                end = matchSegmentAt(text, length, length - segmentLength, segment);
+            if (end != length && segmentLength && segment.data()[segmentLength - 1] == '^' && length + 1 >= segmentLength && length + 1 - segmentLength >= position)
+                end = matchSegmentAt(text, length, length + 1 - segmentLength, segment);
+        } else {
+            for (size_t candidate = position; candidate <= length && end == notFound; candidate++)
+                end = matchSegmentAt(text, length, candidate, segment);
+        }
+
+        if (end == notFound)
+            return false;
+        position = end;
+    }
+
+    return !m_anchorEnd || position == length;
+}
+
+bool AdPattern::matchesGlob(const AdTarget& target) const
+{
+    const char* text = target.data();
+    size_t length = target.length();
+
+    switch (m_anchor) {
+    case AdAnchor::Start:
+        return matchesSegmentsAt(text, length, 0);
+    case AdAnchor::Domain:
+        if (target.hostEnd() <= target.hostStart())
+            return false;
+        if (matchesSegmentsAt(text, length, target.hostStart()))
+            return true;
+        for (size_t i = target.hostStart(); i < target.hostEnd(); i++) {
+            if (text[i] == '.' && matchesSegmentsAt(text, length, i + 1))
+                return true;
+        }
+        return false;
+    case AdAnchor::None:
+        break;
+    }
+    return matchesSegmentsAt(text, length, 0);
+}
+
+/*
+ * Decision cache
+ *
+ * LRU of recent decisions keyed by the URL's StringImpl hash and the
+ * resource type. The URL is kept in the entry so that hash collisions are
+ * detected and treated as misses. It has its own lock, so that hits do not
+ * wait for decisions being computed under the matcher lock.
+ */
+class AdBlockDecisionCache {
+    WTF_MAKE_NONCOPYABLE(AdBlockDecisionCache);
 public:
-    String target;
-    bool block;
+    explicit AdBlockDecisionCache(unsigned capacity)
+        : m_capacity(capacity)
+    {
+    }
+
+    struct Statistics {
+        unsigned hits;
+        unsigned misses;
+        unsigned size;
+    };
+
+    Optional<bool> lookup(const String& url, int type, const String& context)
+    {
+        auto locker = holdLock(m_lock);
+        uint64_t key = makeKey(url, type, context);
+        auto it = m_entries.find(key);
+        if (it == m_entries.end() || it->value.url != url || it->value.context != context) {
+            m_misses++;
+            return WTF::nullopt;
+        }
+        m_order.appendOrMoveToLast(key);
+        m_hits++;
+        return it->value.block;
+    }
+
+    void store(const String& url, int type, const String& context, bool block)
+    {
+        auto locker = holdLock(m_lock);
+        uint64_t key = makeKey(url, type, context);
+        if (!m_capacity)
+            return;
+        m_entries.set(key, Entry { url.isolatedCopy(), context.isolatedCopy(), block });
+        m_order.appendOrMoveToLast(key);
+        shrinkToCapacity();
+    }
+
+    void clear()
+    {
+        auto locker = holdLock(m_lock);
+        m_entries.clear();
+        m_order.clear();
+    }
+
+    Statistics statistics()
+    {
+        auto locker = holdLock(m_lock);
+        return { m_hits, m_misses, m_entries.size() };
+    }
+
+private:
+    struct Entry {
+        String url;
+        String context;
+        bool block;
+    };
+
+    // The context is the host of the main document, which third-party and
+    // domain restricted rules depend on.
+    static uint64_t makeKey(const String& url, int type, const String& context)
+    {
+        // Never 0 nor the deleted value, as StringImpl hashes only use 24 bits.
+        uint64_t urlHash = url.impl() ? url.impl()->hash() : 0;
+        uint64_t contextHash = context.impl() ? context.impl()->hash() : 0;
+        return ((contextHash << 32) | (urlHash << 8) | (type & 0xff)) + 1;
+    }
+
+    void shrinkToCapacity()
+    {
+        while (m_entries.size() > m_capacity)
+            m_entries.remove(m_order.takeFirst());
+    }
+
+    Lock m_lock;
+    HashMap<uint64_t, Entry> m_entries;
+    ListHashSet<uint64_t> m_order;
+    unsigned m_capacity;
+    unsigned m_hits { 0 };
+    unsigned m_misses { 0 };
 };
 
 class PatternMatcher {
 public:
 	AdPattern* addPattern(const String& pat);
+    AdPattern* addSnapshotPattern(const char* rule, unsigned length, int types, AdShortcut shortcut);
 	bool updatePattern(const String& pat, AdPattern* newpattern);
-    bool matches(const String& target, int type);
+    void removePattern(AdPattern*);
+    bool matches(const AdTarget& target, int type);
 	Vector<AdPattern *>* patterns() { return &m_patterns; }
 private:
+    bool compilePattern(const String& pat, AdPattern& result);
+    void indexPattern(AdPattern*);
+    void insertIntoIndex(AdPattern*);
+    void unindexPattern(AdPattern*);
+
 	Vector<AdPattern *> m_patterns;
-//	  HashMap<String, AdPattern> m_shortcuts;
+    HashMap<AdShortcut, Vector<AdPattern *>> m_shortcuts;
+    Vector<AdPattern *> m_unindexed;
 };
 
-bool ad_block_enabled = false;
-static CacheEntry *ab_cache;
-static PatternMatcher ab_blackList;
-static PatternMatcher ab_whiteList;
+/*
+ * Matcher
+ *
+ * Owns the white and black lists, their bytecode and the decision cache.
+ * Patterns compile lazily while matching, so the lists are only touched
+ * with lock() held, by the loader as well as by the block manager editing
+ * them. Decisions are answered from the cache first, which only takes the
+ * cache's own lock. Loading the lists stays on the main thread, loads
+ * checked from other threads before that are not blocked.
+ */
+class AdBlockMatcher {
+    WTF_MAKE_NONCOPYABLE(AdBlockMatcher);
+    friend class NeverDestroyed<AdBlockMatcher>;
+public:
+    static AdBlockMatcher& singleton()
+    {
+        static NeverDestroyed<AdBlockMatcher> matcher;
+        return matcher;
+    }
 
-AdPattern* PatternMatcher::addPattern(const String& pat)
+    Lock& lock() { return m_lock; }
+    PatternMatcher& whiteList() { return m_whiteList; }
+    PatternMatcher& blackList() { return m_blackList; }
+#if ENABLE(CONTENT_EXTENSIONS)
+    RefPtr<AdBlockContentExtension>& whiteListBytecode() { return m_whiteListBytecode; }
+    RefPtr<AdBlockContentExtension>& blackListBytecode() { return m_blackListBytecode; }
+    // Set once the in bytecode flags of the rules come from compiling the
+    // current text list, as opposed to a freshly parsed or edited list.
+    bool bytecodeCompiled() const { return m_bytecodeCompiled; }
+    void setBytecodeCompiled(bool compiled) { m_bytecodeCompiled = compiled; }
+#endif
+
+    bool shouldBlock(const URL&, int type, const URL& mainDocumentURL);
+    // Bypasses the cache, lock() has to be held.
+    bool computeDecision(const URL&, int type, const URL& mainDocumentURL);
+
+    void flushCache() { m_cache.clear(); }
+    AdBlockDecisionCache::Statistics cacheStatistics() { return m_cache.statistics(); }
+
+private:
+    AdBlockMatcher() = default;
+
+    bool matchesList(PatternMatcher&, const AdTarget&, int type, const URL&, const URL& mainDocumentURL);
+
+    Lock m_lock;
+    PatternMatcher m_whiteList;
+    PatternMatcher m_blackList;
+#if ENABLE(CONTENT_EXTENSIONS)
+    RefPtr<AdBlockContentExtension> m_whiteListBytecode;
+    RefPtr<AdBlockContentExtension> m_blackListBytecode;
+    bool m_bytecodeCompiled { false };
+#endif
+    AdBlockDecisionCache m_cache { CACHE_SIZE };
+};
+
+/*
+ * Element hiding
+ *
+ * "domains##selector" rules hide matching elements, "domains#@#selector"
+ * rules are exceptions; an empty domain list makes the rule generic and
+ * "~domain" entries exclude a domain. For each document, all applicable
+ * selectors are turned into a single user stylesheet. Hosts without any
+ * domain specific rule share one parsed generic sheet, the others get a
+ * merged sheet that is parsed once and kept in a small per host cache.
+ */
+class ElementHidingRules {
+public:
+    bool addRule(const String& line);
+    RefPtr<StyleSheetContents> styleSheetForHost(const String& host);
+    const Vector<String>& rules() const { return m_rules; }
+    void clear();
+
+private:
+    struct DomainRule {
+        Vector<String> includedDomains;
+        Vector<String> excludedDomains;
+        String selector;
+        bool exception;
+    };
+
+    static bool matchesDomain(const String& host, const Vector<String>& domains);
+    static Ref<StyleSheetContents> createStyleSheet(const Vector<String>& selectors);
+
+    Vector<String> m_rules;
+    Vector<String> m_genericSelectors;
+    HashSet<String> m_genericExceptions;
+    Vector<DomainRule> m_domainRules;
+    HashMap<String, Vector<unsigned>> m_domainIndex;
+    Vector<unsigned> m_unindexedDomainRules;
+    RefPtr<StyleSheetContents> m_genericStyleSheet;
+    HashMap<String, RefPtr<StyleSheetContents>> m_hostStyleSheets;
+};
+
+bool ElementHidingRules::addRule(const String& line)
+{
+    size_t separator = line.find("##");
+    size_t selectorStart = separator + 2;
+    bool exception = false;
+    if (separator == notFound) {
+        separator = line.find("#@#");
+        if (separator == notFound)
+            return false;
+        selectorStart = separator + 3;
+        exception = true;
+    }
+
+    // "###" leaves a bare "#", which names no element either.
+    String selector = line.substring(selectorStart).stripWhiteSpace();
+    if (selector.find([](UChar c) { return c != '#' && c != '.'; }) == notFound)
+        return false;
+
+    DomainRule rule;
+    rule.selector = selector;
+    rule.exception = exception;
+    for (auto& domain : line.left(separator).convertToASCIILowercase().split(',')) {
+        String trimmed = domain.stripWhiteSpace();
+        if (trimmed.startsWith('~'))
+            rule.excludedDomains.append(trimmed.substring(1));
+        else if (!trimmed.isEmpty())
+            rule.includedDomains.append(trimmed);
+    }
+
+    m_rules.append(line);
+    m_genericStyleSheet = nullptr;
+    m_hostStyleSheets.clear();
+
+    if (rule.includedDomains.isEmpty() && rule.excludedDomains.isEmpty()) {
+        if (exception)
+            m_genericExceptions.add(selector);
+        else
+            m_genericSelectors.append(selector);
+        return true;
+    }
+
+    unsigned index = m_domainRules.size();
+    if (rule.includedDomains.isEmpty())
+        m_unindexedDomainRules.append(index);
+    for (auto& domain : rule.includedDomains)
+        m_domainIndex.add(domain, Vector<unsigned>()).iterator->value.append(index);
+    m_domainRules.append(WTFMove(rule));
+    return true;
+}
+
+bool ElementHidingRules::matchesDomain(const String& host, const Vector<String>& domains)
+{
+    for (auto& domain : domains) {
+        if (host == domain || (host.endsWith(domain) && host.length() > domain.length() && host[host.length() - domain.length() - 1] == '.'))
+            return true;
+    }
+    return false;
+}
+
+Ref<StyleSheetContents> ElementHidingRules::createStyleSheet(const Vector<String>& selectors)
 {
-	AdPattern *ret = 0;
-	size_t delim = pat.find("#");
-    String pattern, optpart;
-	if (delim == notFound) {
-        delim = pat.length();
+    // One rule per selector, so that a selector the parser rejects only
+    // drops its own rule.
+    StringBuilder builder;
+    for (auto& selector : selectors) {
+        builder.append(selector);
+        builder.appendLiteral("{display:none!important}\n");
+    }
+
+    auto sheet = StyleSheetContents::create(CSSParserContext(HTMLStandardMode));
+    sheet->setIsUserStyleSheet(true);
+    sheet->parseString(builder.toString());
+    return sheet;
+}
+
+RefPtr<StyleSheetContents> ElementHidingRules::styleSheetForHost(const String& host)
+{
+    // Collect the domain specific rules that apply to this host by walking
+    // up its labels in the domain index.
+    Vector<unsigned> candidates = m_unindexedDomainRules;
+    for (size_t start = 0; start != notFound && start < host.length(); ) {
+        auto it = m_domainIndex.find(host.substring(start));
+        if (it != m_domainIndex.end())
+            candidates.appendVector(it->value);
+        start = host.find('.', start);
+        if (start != notFound)
+            start++;
+    }
+
+    Vector<String> hostSelectors;
+    HashSet<String> hostExceptions;
+    for (unsigned index : candidates) {
+        const DomainRule& rule = m_domainRules[index];
+        if (matchesDomain(host, rule.excludedDomains))
+            continue;
+        if (!rule.includedDomains.isEmpty() && !matchesDomain(host, rule.includedDomains))
+            continue;
+        if (rule.exception)
+            hostExceptions.add(rule.selector);
+        else
+            hostSelectors.append(rule.selector);
+    }
+
+    if (hostSelectors.isEmpty() && hostExceptions.isEmpty()) {
+        if (m_genericSelectors.isEmpty())
+            return nullptr;
+        if (!m_genericStyleSheet) {
+            Vector<String> selectors;
+            for (auto& selector : m_genericSelectors) {
+                if (!m_genericExceptions.contains(selector))
+                    selectors.append(selector);
+            }
+            m_genericStyleSheet = createStyleSheet(selectors);
+        }
+        return m_genericStyleSheet;
     }
-    optpart = pat.substring(delim+1);
-    pattern = pat.left(delim);
 
-    Vector<String> opts = optpart.split(",");
+    auto cached = m_hostStyleSheets.find(host);
+    if (cached != m_hostStyleSheets.end())
+        return cached->value;
+
+    Vector<String> selectors;
+    for (auto& selector : m_genericSelectors) {
+        if (!m_genericExceptions.contains(selector) && !hostExceptions.contains(selector))
+            selectors.append(selector);
+    }
+    for (auto& selector : hostSelectors) {
+        if (!m_genericExceptions.contains(selector) && !hostExceptions.contains(selector))
+            selectors.append(selector);
+    }
+
+    RefPtr<StyleSheetContents> sheet;
+    if (!selectors.isEmpty())
+        sheet = createStyleSheet(selectors);
+
+    if (m_hostStyleSheets.size() >= HOST_STYLESHEET_CACHE_SIZE)
+        m_hostStyleSheets.clear();
+    m_hostStyleSheets.set(host, sheet);
+    return sheet;
+}
+
+void ElementHidingRules::clear()
+{
+    m_rules.clear();
+    m_genericSelectors.clear();
+    m_genericExceptions.clear();
+    m_domainRules.clear();
+    m_domainIndex.clear();
+    m_unindexedDomainRules.clear();
+    m_genericStyleSheet = nullptr;
+    m_hostStyleSheets.clear();
+}
+
+bool ad_block_enabled = false;
+static std::atomic<bool> ab_initialized;
+static ElementHidingRules ab_elementHiding;
+static FileSystem::MappedFileData ab_snapshot;
+
+bool PatternMatcher::compilePattern(const String& pat, AdPattern& result)
+{
+    AdBlockRuleParts parts = splitAdBlockRule(pat);
+    if (parts.pattern.isNull())
+        return false;
+
+    Vector<String> opts = parts.options.split(",");
     int types = -1;
     for (unsigned i = 0; i < opts.size(); i++) {
         const String &opt = opts[i];
@@ -135,159 +732,452 @@ AdPattern* PatternMatcher::addPattern(const String& pat)
     }
 
     if (!types) {
-		return 0;
-    }
-    if (pattern.startsWith("/") && pattern.endsWith("/")) {
-        pattern = pattern.substring(1, pattern.length()-2);
-		ret = new AdPattern(pat, JSC::Yarr::RegularExpression(pattern, JSC::Yarr::TextCaseInsensitive), types);
-		m_patterns.append(ret);
-		return ret;
-    }
-    int pos = 0;
-	JSC::Yarr::RegularExpression nonchar("\\W", JSC::Yarr::TextCaseInsensitive);
-	while ((pos = nonchar.match(pattern, pos)) >= 0) {
-        pattern.insert("\\", pos);
-        pos += 2;
-    }
-
-	replace(pattern, JSC::Yarr::RegularExpression("\\\\\\*", JSC::Yarr::TextCaseInsensitive), ".*");
-	replace(pattern, JSC::Yarr::RegularExpression("^\\\\\\|", JSC::Yarr::TextCaseInsensitive), "^");
-	replace(pattern, JSC::Yarr::RegularExpression("\\\\\\|$", JSC::Yarr::TextCaseInsensitive), "$");
-
-	/*
-    String text = pat.left(delim).lower();
-	replace(text, RegularExpression("^\\|", TextCaseInsensitive), "");
-	replace(text, RegularExpression("\\|$", TextCaseInsensitive), "");
-    for (pos = text.length() - SHORTCUT_SIZE; pos >= 0; pos--) {
-        String sub = text.substring(pos, SHORTCUT_SIZE);
-        if (sub.find("*") < 0 && !m_shortcuts.contains(sub)) {
-			m_shortcuts.set(sub, AdPattern(pat, RegularExpression(pattern, TextCaseInsensitive), types));
-            return;
+		return false;
+    }
+
+    result = AdPattern(pat, types);
+    return true;
+}
+
+// Picks the literal 8 character run of the rule that is shared by the fewest
+// already indexed rules, so that candidate lists stay short.
+void PatternMatcher::indexPattern(AdPattern* pattern)
+{
+    AdShortcut best = 0;
+    size_t bestCount = std::numeric_limits<size_t>::max();
+
+    if (!pattern->isRegularExpression()) {
+        for (auto& segment : pattern->segments()) {
+            const char* text = segment.data();
+            size_t length = segment.length();
+            AdShortcut key = 0;
+            size_t run = 0;
+            for (size_t i = 0; i < length && bestCount; i++) {
+                if (text[i] == '^') {
+                    run = 0;
+                    key = 0;
+                    continue;
+                }
+                key = (key << 8) | static_cast<unsigned char>(text[i]);
+                if (++run < SHORTCUT_SIZE)
+                    continue;
+                auto it = m_shortcuts.find(key);
+                size_t count = it == m_shortcuts.end() ? 0 : it->value.size();
+                if (count < bestCount) {
+                    best = key;
+                    bestCount = count;
+                }
+            }
         }
     }
-	*/
-	ret = new AdPattern(pat, JSC::Yarr::RegularExpression(pattern, JSC::Yarr::TextCaseInsensitive), types);
+
+    if (best == std::numeric_limits<AdShortcut>::max())
+        best = 0;
+
+    pattern->setShortcut(best);
+    insertIntoIndex(pattern);
+}
+
+void PatternMatcher::insertIntoIndex(AdPattern* pattern)
+{
+    if (!pattern->shortcut()) {
+        m_unindexed.append(pattern);
+        return;
+    }
+
+    m_shortcuts.add(pattern->shortcut(), Vector<AdPattern *>()).iterator->value.append(pattern);
+}
+
+void PatternMatcher::unindexPattern(AdPattern* pattern)
+{
+    if (!pattern->shortcut()) {
+        m_unindexed.removeFirst(pattern);
+        return;
+    }
+
+    auto it = m_shortcuts.find(pattern->shortcut());
+    if (it == m_shortcuts.end())
+        return;
+    it->value.removeFirst(pattern);
+    if (it->value.isEmpty())
+        m_shortcuts.remove(it);
+}
+
+AdPattern* PatternMatcher::addPattern(const String& pat)
+{
+    AdPattern compiled;
+    if (!compilePattern(pat, compiled))
+        return 0;
+
+    AdPattern* ret = new AdPattern(WTFMove(compiled));
 	m_patterns.append(ret);
+    indexPattern(ret);
 	return ret;
 }
 
 bool PatternMatcher::updatePattern(const String& pat, AdPattern* newpattern)
 {
-	size_t delim = pat.find("#");
-    String pattern, optpart;
-	if (delim == notFound) {
-        delim = pat.length();
+    AdPattern compiled;
+    if (!compilePattern(pat, compiled))
+        return false;
+
+    unindexPattern(newpattern);
+    *newpattern = WTFMove(compiled);
+    indexPattern(newpattern);
+	return true;
+}
+
+AdPattern* PatternMatcher::addSnapshotPattern(const char* rule, unsigned length, int types, AdShortcut shortcut)
+{
+    AdPattern* ret = new AdPattern(rule, length, types, shortcut);
+    m_patterns.append(ret);
+    insertIntoIndex(ret);
+    return ret;
+}
+
+void PatternMatcher::removePattern(AdPattern* pattern)
+{
+    unindexPattern(pattern);
+    m_patterns.removeFirst(pattern);
+}
+
+bool PatternMatcher::matches(const AdTarget& target, int type)
+{
+    for (auto* pattern : m_unindexed) {
+        if (!pattern->isInBytecode() && pattern->matches(target, type))
+            return true;
     }
-    optpart = pat.substring(delim+1);
-    pattern = pat.left(delim);
 
-    Vector<String> opts = optpart.split(",");
-    int types = -1;
-    for (unsigned i = 0; i < opts.size(); i++) {
-        const String &opt = opts[i];
-        if (opts[i] == "match-case") {
+    if (m_shortcuts.isEmpty())
+        return false;
+
+    const char* text = target.data();
+    size_t length = target.length();
+    AdShortcut key = 0;
+    for (size_t i = 0; i < length; i++) {
+        key = (key << 8) | static_cast<unsigned char>(text[i]);
+        if (i + 1 < SHORTCUT_SIZE || key == std::numeric_limits<AdShortcut>::max())
             continue;
-        }
-        bool invert = false;
-        String typeOpt = opt;
-        int typeMask = 0;
-        if (typeOpt.startsWith("~")) {
-            invert = true;
-            typeOpt = typeOpt.substring(1);
-        }
-        if (typeOpt == "image") {
-            typeMask = 1<<to_underlying(CachedResource::Type::ImageResource);
-        } else if (typeOpt == "stylesheet") {
-            typeMask = 1<<to_underlying(CachedResource::Type::CSSStyleSheet);
-        } else if (typeOpt == "script") {
-            typeMask = 1<<to_underlying(CachedResource::Type::Script);
-        } else if (typeOpt == "subdocument") {
-            typeMask = 1<<DOCUMENT_TYPE;
-        }
-        if (invert) {
-            types &= ~typeMask;
-        } else {
-            if (types == -1) {
-                types = 0;
-            }
-            types |= typeMask;
+        auto it = m_shortcuts.find(key);
+        if (it == m_shortcuts.end())
+            continue;
+        for (auto* pattern : it->value) {
+            if (!pattern->isInBytecode() && pattern->matches(target, type))
+                return true;
         }
     }
+    return false;
+}
 
-    if (!types) {
-		return false;
-    }
-    if (pattern.startsWith("/") && pattern.endsWith("/")) {
-        pattern = pattern.substring(1, pattern.length()-2);
-		*newpattern = AdPattern(pat, JSC::Yarr::RegularExpression(pattern, JSC::Yarr::TextCaseInsensitive), types);
-		return true;
+/*
+ * Compiled filter snapshot
+ *
+ * The rule table (list, type mask, shortcut and rule text) is saved next to
+ * the text list, stamped with the size and modification time of that list.
+ * At startup the snapshot is mapped and the index is rebuilt from the stored
+ * shortcuts without parsing or compiling a single rule; rules are compiled
+ * the first time they become a match candidate. The snapshot is rewritten
+ * whenever the text list is.
+ */
+
+struct AdSnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t ruleCount;
+    int64_t sourceSize;
+    int64_t sourceModificationTime;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+struct AdSnapshotRule {
+    AdShortcut shortcut;
+    uint32_t offset;
+    uint32_t length;
+    int32_t types;
+    uint16_t list;
+    uint16_t flags;
+};
+
+static const char snapshotMagic[8] = { 'O', 'W', 'B', 'A', 'D', 'B', 'L', 'K' };
+
+static bool sourceStamp(int64_t& size, int64_t& modificationTime)
+{
+    long long fileSize;
+    if (!FileSystem::getFileSize(FILTER_PATH, fileSize))
+        return false;
+    auto time = FileSystem::getFileModificationTime(FILTER_PATH);
+    if (!time)
+        return false;
+    size = fileSize;
+    modificationTime = static_cast<int64_t>(time->secondsSinceEpoch().value());
+    return true;
+}
+
+static bool loadSnapshot()
+{
+    auto& matcher = AdBlockMatcher::singleton();
+    int64_t sourceSize, sourceModificationTime;
+    if (!sourceStamp(sourceSize, sourceModificationTime))
+        return false;
+
+    bool success;
+    FileSystem::MappedFileData mapped(SNAPSHOT_PATH, success);
+    if (!success || mapped.size() < sizeof(AdSnapshotHeader))
+        return false;
+
+    const char* data = static_cast<const char*>(mapped.data());
+    const AdSnapshotHeader* header = reinterpret_cast<const AdSnapshotHeader*>(data);
+    if (memcmp(header->magic, snapshotMagic, sizeof(snapshotMagic))
+        || header->version != SNAPSHOT_VERSION
+        || header->sourceSize != sourceSize
+        || header->sourceModificationTime != sourceModificationTime)
+        return false;
+
+    size_t rulesSize = static_cast<size_t>(header->ruleCount) * sizeof(AdSnapshotRule);
+    if (rulesSize / sizeof(AdSnapshotRule) != header->ruleCount || mapped.size() - sizeof(AdSnapshotHeader) < rulesSize)
+        return false;
+
+    const AdSnapshotRule* rules = reinterpret_cast<const AdSnapshotRule*>(data + sizeof(AdSnapshotHeader));
+    const char* strings = data + sizeof(AdSnapshotHeader) + rulesSize;
+    size_t stringsSize = mapped.size() - sizeof(AdSnapshotHeader) - rulesSize;
+
+    for (uint32_t i = 0; i < header->ruleCount; i++) {
+        const AdSnapshotRule& rule = rules[i];
+        if (rule.offset > stringsSize || rule.length > stringsSize - rule.offset || rule.list > SNAPSHOT_ELEMENT_HIDING_LIST)
+            return false;
     }
-    int pos = 0;
-	JSC::Yarr::RegularExpression nonchar("\\W", JSC::Yarr::TextCaseInsensitive);
-	while ((pos = nonchar.match(pattern, pos)) >= 0) {
-        pattern.insert("\\", pos);
-        pos += 2;
-    }
-
-	replace(pattern, JSC::Yarr::RegularExpression("\\\\\\*", JSC::Yarr::TextCaseInsensitive), ".*");
-	replace(pattern, JSC::Yarr::RegularExpression("^\\\\\\|", JSC::Yarr::TextCaseInsensitive), "^");
-	replace(pattern, JSC::Yarr::RegularExpression("\\\\\\|$", JSC::Yarr::TextCaseInsensitive), "$");
-
-	/*
-    String text = pat.left(delim).lower();
-	replace(text, RegularExpression("^\\|", TextCaseInsensitive), "");
-	replace(text, RegularExpression("\\|$", TextCaseInsensitive), "");
-    for (pos = text.length() - SHORTCUT_SIZE; pos >= 0; pos--) {
-        String sub = text.substring(pos, SHORTCUT_SIZE);
-        if (sub.find("*") < 0 && !m_shortcuts.contains(sub)) {
-			m_shortcuts.set(sub, AdPattern(pat, RegularExpression(pattern, TextCaseInsensitive), types));
-            return;
+
+    for (uint32_t i = 0; i < header->ruleCount; i++) {
+        const AdSnapshotRule& rule = rules[i];
+        if (rule.list == SNAPSHOT_ELEMENT_HIDING_LIST) {
+            ab_elementHiding.addRule(String::fromUTF8(strings + rule.offset, rule.length));
+            continue;
         }
+        PatternMatcher& list = rule.list ? matcher.whiteList() : matcher.blackList();
+        AdPattern* pattern = list.addSnapshotPattern(strings + rule.offset, rule.length, rule.types, rule.shortcut);
+        pattern->setInBytecode(rule.flags & SNAPSHOT_IN_BYTECODE);
     }
-	*/
-	*newpattern = AdPattern(pat, JSC::Yarr::RegularExpression(pattern, JSC::Yarr::TextCaseInsensitive), types);
-	return true;
+#if ENABLE(CONTENT_EXTENSIONS)
+    matcher.setBytecodeCompiled(header->flags & SNAPSHOT_HAS_BYTECODE);
+#endif
+
+    ab_snapshot = WTFMove(mapped);
+    return true;
 }
 
-bool PatternMatcher::matches(const String& target, int type)
+static void appendSnapshotRules(PatternMatcher& list, uint16_t listType, Vector<AdSnapshotRule>& rules, Vector<char>& strings)
 {
-    int i;
-	/*
-    for (i = target.length() - SHORTCUT_SIZE; i >= 0; i--) {
-        String sub = target.substring(i, SHORTCUT_SIZE);
-		AdPattern pattern = m_shortcuts.get(sub);
-        if (pattern.matches(target, type)) {
-            return true;
+    for (auto* pattern : *list.patterns()) {
+        CString text = pattern->rule().utf8();
+        AdSnapshotRule rule;
+        rule.shortcut = pattern->shortcut();
+        rule.offset = strings.size();
+        rule.length = text.length();
+        rule.types = pattern->types();
+        rule.list = listType;
+        rule.flags = pattern->isInBytecode() ? SNAPSHOT_IN_BYTECODE : 0;
+        rules.append(rule);
+        strings.append(text.data(), text.length());
+    }
+}
+
+static bool writeSnapshot()
+{
+    auto& matcher = AdBlockMatcher::singleton();
+    AdSnapshotHeader header;
+    memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = SNAPSHOT_VERSION;
+#if ENABLE(CONTENT_EXTENSIONS)
+    header.flags = matcher.bytecodeCompiled() ? SNAPSHOT_HAS_BYTECODE : 0;
+#else
+    header.flags = 0;
+#endif
+    header.reserved = 0;
+    if (!sourceStamp(header.sourceSize, header.sourceModificationTime))
+        return false;
+
+    // Nothing may point into the old mapping once it gets replaced.
+    for (auto* pattern : *matcher.whiteList().patterns())
+        pattern->detachFromSnapshot();
+    for (auto* pattern : *matcher.blackList().patterns())
+        pattern->detachFromSnapshot();
+    ab_snapshot = FileSystem::MappedFileData();
+
+    Vector<AdSnapshotRule> rules;
+    Vector<char> strings;
+    appendSnapshotRules(matcher.whiteList(), 1, rules, strings);
+    appendSnapshotRules(matcher.blackList(), 0, rules, strings);
+    for (auto& line : ab_elementHiding.rules()) {
+        CString text = line.utf8();
+        AdSnapshotRule rule = { 0, static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(text.length()), 0, SNAPSHOT_ELEMENT_HIDING_LIST, 0 };
+        rules.append(rule);
+        strings.append(text.data(), text.length());
+    }
+    header.ruleCount = rules.size();
+
+    String temporaryPath = SNAPSHOT_PATH ".tmp";
+    FileSystem::PlatformFileHandle handle = FileSystem::openFile(temporaryPath, FileSystem::FileOpenMode::Write);
+    if (!FileSystem::isHandleValid(handle))
+        return false;
+
+    int rulesSize = rules.size() * sizeof(AdSnapshotRule);
+    bool success = FileSystem::writeToFile(handle, reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header)
+        && FileSystem::writeToFile(handle, reinterpret_cast<const char*>(rules.data()), rulesSize) == rulesSize
+        && FileSystem::writeToFile(handle, strings.data(), strings.size()) == static_cast<int>(strings.size());
+    FileSystem::closeFile(handle);
+
+    if (!success) {
+        FileSystem::deleteFile(temporaryPath);
+        return false;
+    }
+
+    FileSystem::deleteFile(SNAPSHOT_PATH);
+    return FileSystem::moveFile(temporaryPath, SNAPSHOT_PATH);
+}
+
+#if ENABLE(CONTENT_EXTENSIONS)
+/*
+ * Content extension bytecode
+ *
+ * Every rule that can be expressed as a content extension trigger is
+ * compiled into the DFA bytecode of its list and flagged, so that only the
+ * remaining rules (regular expressions, unsupported options) go through the
+ * shortcut index. The bytecode is stored with the same source stamp as the
+ * snapshot and recompiled only when the text list changes; editing rules in
+ * the block manager drops it and recompiles it shortly after the last edit.
+ */
 
+static RefPtr<AdBlockContentExtension> compileBytecode(PatternMatcher& list, const char* identifier)
+{
+    StringBuilder json;
+    json.append('[');
+    bool first = true;
+    unsigned count = 0;
+    for (auto* pattern : *list.patterns()) {
+        pattern->setInBytecode(false);
+        unsigned length = json.length();
+        bool wasFirst = first;
+        unsigned entries = AdBlockContentExtension::appendRule(json, pattern->rule(), first);
+        if (!entries)
+            continue;
+        // The limit applies to the emitted entries, not to the source rules.
+        if (count + entries > BYTECODE_MAX_RULES) {
+            json.resize(length);
+            first = wasFirst;
+            continue;
         }
+        pattern->setInBytecode(true);
+        count += entries;
     }
-	*/
-    int size = m_patterns.size();
-    for (i = 0; i < size; i++) {
-		if (m_patterns[i]->matches(target, type)) {
+    json.append(']');
+
+    auto bytecode = count ? AdBlockContentExtension::compile(identifier, json.toString()) : nullptr;
+    if (!bytecode) {
+        for (auto* pattern : *list.patterns())
+            pattern->setInBytecode(false);
+    }
+    return bytecode;
+}
+
+static void dropBytecode()
+{
+    auto& matcher = AdBlockMatcher::singleton();
+    for (auto* pattern : *matcher.whiteList().patterns())
+        pattern->setInBytecode(false);
+    for (auto* pattern : *matcher.blackList().patterns())
+        pattern->setInBytecode(false);
+    matcher.blackListBytecode() = nullptr;
+    matcher.whiteListBytecode() = nullptr;
+    matcher.setBytecodeCompiled(false);
+}
+
+static bool hasBytecodeRules(PatternMatcher& list)
+{
+    for (auto* pattern : *list.patterns()) {
+        if (pattern->isInBytecode())
             return true;
-        }
     }
     return false;
 }
 
-// XXX: Figure out how to use existing String hash buried in a nest of templates
-static
-unsigned ab_hash(const String& str)
+// A list without any rule in bytecode has no bytecode file to load.
+static bool loadBytecode(PatternMatcher& list, RefPtr<AdBlockContentExtension>& bytecode, const char* identifier, const char* path, int64_t sourceSize, int64_t sourceModificationTime)
 {
-    unsigned result = 0;
-    unsigned size = str.length();
-    auto upconvertedCharacters = StringView(str).upconvertedCharacters();
-    const UChar *p = upconvertedCharacters;
-    for (unsigned i = 0; i < size; i++) {
-        result = 31 * result + (unsigned)p[i];
+    if (!hasBytecodeRules(list)) {
+        bytecode = nullptr;
+        return true;
     }
-    return result;
+    bytecode = AdBlockContentExtension::load(identifier, path, sourceSize, sourceModificationTime);
+    return bytecode;
+}
+
+// Returns true when the bytecode had to be rebuilt, in which case the
+// snapshot needs to be written again to record the new flags.
+static bool loadOrCompileBytecode()
+{
+    auto& matcher = AdBlockMatcher::singleton();
+    int64_t sourceSize, sourceModificationTime;
+    if (!sourceStamp(sourceSize, sourceModificationTime)) {
+        dropBytecode();
+        return false;
+    }
+
+    if (matcher.bytecodeCompiled()
+        && loadBytecode(matcher.blackList(), matcher.blackListBytecode(), "adblock-deny", BYTECODE_DENY_PATH, sourceSize, sourceModificationTime)
+        && loadBytecode(matcher.whiteList(), matcher.whiteListBytecode(), "adblock-allow", BYTECODE_ALLOW_PATH, sourceSize, sourceModificationTime))
+        return false;
+
+    matcher.blackListBytecode() = compileBytecode(matcher.blackList(), "adblock-deny");
+    matcher.whiteListBytecode() = compileBytecode(matcher.whiteList(), "adblock-allow");
+    matcher.setBytecodeCompiled(true);
+
+    if (matcher.blackListBytecode())
+        matcher.blackListBytecode()->save(BYTECODE_DENY_PATH, sourceSize, sourceModificationTime);
+    else
+        FileSystem::deleteFile(BYTECODE_DENY_PATH);
+    if (matcher.whiteListBytecode())
+        matcher.whiteListBytecode()->save(BYTECODE_ALLOW_PATH, sourceSize, sourceModificationTime);
+    else
+        FileSystem::deleteFile(BYTECODE_ALLOW_PATH);
+    return true;
+}
+
+// Recompiles the bytecode of the edited lists once the block manager has
+// been left alone for a moment, matching goes through the shortcut index
+// alone until then.
+static void recompileBytecode()
+{
+    auto& matcher = AdBlockMatcher::singleton();
+    auto locker = holdLock(matcher.lock());
+    matcher.setBytecodeCompiled(false);
+    loadOrCompileBytecode();
+    writeSnapshot();
+    matcher.flushCache();
 }
 
+static Timer& bytecodeRecompileTimer()
+{
+    static NeverDestroyed<Timer> timer(recompileBytecode);
+    return timer;
+}
+#endif
 
-static CacheEntry* initialize()
+static void initialize()
 {
+    ASSERT(isMainThread());
+    auto& matcher = AdBlockMatcher::singleton();
+    auto locker = holdLock(matcher.lock());
+    ab_initialized = true;
+
+    if (loadSnapshot()) {
+#if ENABLE(CONTENT_EXTENSIONS)
+        if (loadOrCompileBytecode())
+            writeSnapshot();
+#endif
+        return;
+    }
+
     FILE *file = fopen(FILTER_PATH, "r");
     if (file) {
         char buf[512];
@@ -296,120 +1186,186 @@ static CacheEntry* initialize()
 		{
             String line(buf);
             line.replace("\n","");
-			if (line.startsWith("@@"))
+			if (isElementHidingRule(line))
 			{
-				AdPattern *pattern = ab_whiteList.addPattern(line.substring(2));
-				DoMethod(app, MM_BlockManagerGroup_DidInsert, line.substring(2).utf8().data(), 1, (void *) pattern);
+				ab_elementHiding.addRule(line);
+			}
+			else if (line.startsWith("@@"))
+			{
+				matcher.whiteList().addPattern(line.substring(2));
 			}
 			else if (!line.startsWith("!") && !line.startsWith("#") && !line.isEmpty())
 			{
-				AdPattern *pattern = ab_blackList.addPattern(line);
-				DoMethod(app, MM_BlockManagerGroup_DidInsert, line.utf8().data(), 0, (void *) pattern);
+				matcher.blackList().addPattern(line);
             }
         }
         fclose(file);
+#if ENABLE(CONTENT_EXTENSIONS)
+        loadOrCompileBytecode();
+#endif
+        writeSnapshot();
     }
-    return new CacheEntry[CACHE_SIZE];
 }
 
 void deinitialize()
 {
-	delete [] ab_cache;
-	ab_cache = 0;
+	ASSERT(isMainThread());
+	auto& matcher = AdBlockMatcher::singleton();
+	auto locker = holdLock(matcher.lock());
+	matcher.flushCache();
+	ab_initialized = false;
 
-	for(size_t i = 0; i < (*ab_whiteList.patterns()).size(); i++)
+	for(size_t i = 0; i < (*matcher.whiteList().patterns()).size(); i++)
 	{
-		delete (*ab_whiteList.patterns())[i];
+		delete (*matcher.whiteList().patterns())[i];
 	}
 
-	for(size_t i = 0; i < (*ab_blackList.patterns()).size(); i++)
+	for(size_t i = 0; i < (*matcher.blackList().patterns()).size(); i++)
 	{
-		delete (*ab_blackList.patterns())[i];
+		delete (*matcher.blackList().patterns())[i];
 	}
+
+	ab_elementHiding.clear();
+	ab_snapshot = FileSystem::MappedFileData();
+#if ENABLE(CONTENT_EXTENSIONS)
+	bytecodeRecompileTimer().stop();
+	matcher.blackListBytecode() = nullptr;
+	matcher.whiteListBytecode() = nullptr;
+	matcher.setBytecodeCompiled(false);
+#endif
 }
 
 void flushCache()
 {
-	if(ab_cache)
-	{
-		delete [] ab_cache;
-	}
-    ab_cache = new CacheEntry[CACHE_SIZE];
+	AdBlockMatcher::singleton().flushCache();
 }
 
 void loadCache()
 {
-	if(!ab_cache)
+	ASSERT(isMainThread());
+	if(!ab_initialized)
 	{
-		ab_cache = initialize();
+		initialize();
 	} 
 }
 
+void decisionCacheStatistics(unsigned& hits, unsigned& misses, unsigned& size)
+{
+	auto statistics = AdBlockMatcher::singleton().cacheStatistics();
+	hits = statistics.hits;
+	misses = statistics.misses;
+	size = statistics.size;
+}
+
 bool writeCache()
 {
+	ASSERT(isMainThread());
+	if (!ab_initialized) {
+		initialize();
+	}
+
+	auto& matcher = AdBlockMatcher::singleton();
+	auto locker = holdLock(matcher.lock());
+
 	FILE *file = fopen(FILTER_PATH, "w");
 	if (file)
 	{
-	    if (!ab_cache) {
-	        ab_cache = initialize();
-	    }
-
 		fprintf(file, "[Adblock]\n");
 		fprintf(file, "!---- Generated by OWB ----!\n");
 
 		fprintf(file, "!---- White List ----!\n");
-		for(size_t i = 0; i < (*ab_whiteList.patterns()).size(); i++)
+		for(size_t i = 0; i < (*matcher.whiteList().patterns()).size(); i++)
 		{
-			fprintf(file, "@@%s\n", (*ab_whiteList.patterns())[i]->m_string.latin1().data());
+			fprintf(file, "@@%s\n", (*matcher.whiteList().patterns())[i]->rule().latin1().data());
 		}
 
 		fprintf(file, "!---- Black List ----!\n");
-		for(size_t i = 0; i < (*ab_blackList.patterns()).size(); i++)
+		for(size_t i = 0; i < (*matcher.blackList().patterns()).size(); i++)
 		{
-			fprintf(file, "%s\n", (*ab_blackList.patterns())[i]->m_string.latin1().data());
+			fprintf(file, "%s\n", (*matcher.blackList().patterns())[i]->rule().latin1().data());
+		}
+
+		fprintf(file, "!---- Element Hiding ----!\n");
+		for(auto& rule : ab_elementHiding.rules())
+		{
+			fprintf(file, "%s\n", rule.latin1().data());
 		}
 
         fclose(file);
 
+#if ENABLE(CONTENT_EXTENSIONS)
+		dropBytecode();
+		bytecodeRecompileTimer().startOneShot(BYTECODE_RECOMPILE_DELAY);
+#endif
+		writeSnapshot();
+
 		return true;
     }
 
 	return false;
 }
 
+size_t cacheEntryCount(int type)
+{
+	ASSERT(isMainThread());
+	auto& matcher = AdBlockMatcher::singleton();
+	auto locker = holdLock(matcher.lock());
+	PatternMatcher& list = type ? matcher.whiteList() : matcher.blackList();
+	return list.patterns()->size();
+}
+
+void *cacheEntryAt(int type, size_t index, String& rule)
+{
+	ASSERT(isMainThread());
+	auto& matcher = AdBlockMatcher::singleton();
+	auto locker = holdLock(matcher.lock());
+	PatternMatcher& list = type ? matcher.whiteList() : matcher.blackList();
+	if (index >= list.patterns()->size())
+		return NULL;
+	AdPattern *pattern = (*list.patterns())[index];
+	rule = pattern->rule();
+	return pattern;
+}
+
 void *addCacheEntry(String rule, int type)
 {
+	ASSERT(isMainThread());
+	auto& matcher = AdBlockMatcher::singleton();
+	auto locker = holdLock(matcher.lock());
 	if(type == 0)
 	{
-		return ab_blackList.addPattern(rule);
+		return matcher.blackList().addPattern(rule);
 	}
 	else if(type == 1)
 	{
-		return ab_whiteList.addPattern(rule);
+		return matcher.whiteList().addPattern(rule);
 	}
 	return NULL;
 }
 
 void updateCacheEntry(String rule, int type, void *ptr)
 {
+	ASSERT(isMainThread());
+	auto& matcher = AdBlockMatcher::singleton();
+	auto locker = holdLock(matcher.lock());
 	if(type == 0)
 	{
-		for(size_t i = 0; i < (*ab_blackList.patterns()).size(); i++)
+		for(size_t i = 0; i < (*matcher.blackList().patterns()).size(); i++)
 		{
-			if((void *) (*ab_blackList.patterns())[i] == ptr)
+			if((void *) (*matcher.blackList().patterns())[i] == ptr)
 			{
-				ab_blackList.updatePattern(rule, (*ab_blackList.patterns())[i]);
+				matcher.blackList().updatePattern(rule, (*matcher.blackList().patterns())[i]);
 				break;
 			}
 		}
 	}
 	else if(type == 1)
 	{
-		for(size_t i = 0; i < (*ab_whiteList.patterns()).size(); i++)
+		for(size_t i = 0; i < (*matcher.whiteList().patterns()).size(); i++)
 		{
-			if((void *) (*ab_whiteList.patterns())[i] == ptr)
+			if((void *) (*matcher.whiteList().patterns())[i] == ptr)
 			{
-				ab_whiteList.updatePattern(rule, (*ab_whiteList.patterns())[i]);
+				matcher.whiteList().updatePattern(rule, (*matcher.whiteList().patterns())[i]);
 				break;
 			}
 		}
@@ -419,13 +1375,16 @@ void updateCacheEntry(String rule, int type, void *ptr)
 
 void removeCacheEntry(void *ptr, int type)
 {
+	ASSERT(isMainThread());
+	auto& matcher = AdBlockMatcher::singleton();
+	auto locker = holdLock(matcher.lock());
 	if(type == 0)
 	{
-		for(size_t i = 0; i < (*ab_blackList.patterns()).size(); i++)
+		for(size_t i = 0; i < (*matcher.blackList().patterns()).size(); i++)
 		{
-			if((void *) (*ab_blackList.patterns())[i] == ptr)
+			if((void *) (*matcher.blackList().patterns())[i] == ptr)
 			{
-				(*ab_blackList.patterns()).remove(i);
+				matcher.blackList().removePattern((AdPattern *)ptr);
 				delete (AdPattern *)ptr;
 				break;
 			}
@@ -433,11 +1392,11 @@ void removeCacheEntry(void *ptr, int type)
 	}
 	else if(type == 1)
 	{
-		for(size_t i = 0; i < (*ab_whiteList.patterns()).size(); i++)
+		for(size_t i = 0; i < (*matcher.whiteList().patterns()).size(); i++)
 		{
-			if((void *) (*ab_whiteList.patterns())[i] == ptr)
+			if((void *) (*matcher.whiteList().patterns())[i] == ptr)
 			{
-				(*ab_whiteList.patterns()).remove(i);
+				matcher.whiteList().removePattern((AdPattern *)ptr);
 				delete (AdPattern *)ptr;
 				break;
 			}
@@ -447,6 +1406,7 @@ void removeCacheEntry(void *ptr, int type)
 
 void blockResource(const URL& url, int type, int mode)
 {
+	ASSERT(isMainThread());
 	String target = url.string();
 	String typeOpt = "";
 	String pat;
@@ -507,29 +1467,145 @@ void blockResource(const URL& url, int type, int mode)
 	    pat.append(typeOpt);
 	}
 
-	AdPattern *pattern = ab_blackList.addPattern(pat);
+	AdPattern *pattern;
+	{
+		auto& matcher = AdBlockMatcher::singleton();
+		auto locker = holdLock(matcher.lock());
+		pattern = matcher.blackList().addPattern(pat);
+	}
 	DoMethod(app, MM_BlockManagerGroup_DidInsert, pat.utf8().data(), 0, (void *) pattern);
 	writeCache();
     flushCache();
 }
 
-bool shouldBlock(const URL& url, int type)
+void injectElementHidingStyleSheet(Document& document)
+{
+    ASSERT(isMainThread());
+    if (!ad_block_enabled) { return; }
+    if (!document.url().protocolIsInHTTPFamily()) { return; }
+
+    if (!ab_initialized) {
+        initialize();
+    }
+
+    if (auto sheet = ab_elementHiding.styleSheetForHost(document.url().host().convertToASCIILowercase())) {
+        document.extensionStyleSheets().addUserStyleSheet(sheet.releaseNonNull());
+    }
+}
+
+bool AdBlockMatcher::matchesList(PatternMatcher& list, const AdTarget& target, int type, const URL& url, const URL& mainDocumentURL)
+{
+    if (list.matches(target, type))
+        return true;
+#if ENABLE(CONTENT_EXTENSIONS)
+    AdBlockContentExtension* bytecode = &list == &m_whiteList ? m_whiteListBytecode.get() : m_blackListBytecode.get();
+    if (bytecode) {
+        ResourceType resourceType = type == DOCUMENT_TYPE ? ResourceType::Document : toResourceType(static_cast<CachedResource::Type>(type));
+        return bytecode->matches(url, resourceType, mainDocumentURL);
+    }
+#else
+    UNUSED_PARAM(url);
+    UNUSED_PARAM(mainDocumentURL);
+#endif
+    return false;
+}
+
+bool AdBlockMatcher::computeDecision(const URL& url, int type, const URL& mainDocumentURL)
+{
+    AdTarget adTarget(url.string());
+    return (!matchesList(m_whiteList, adTarget, type, url, mainDocumentURL))
+           && matchesList(m_blackList, adTarget, type, url, mainDocumentURL);
+}
+
+bool AdBlockMatcher::shouldBlock(const URL& url, int type, const URL& mainDocumentURL)
+{
+    // Without a main document, the load is considered first party.
+    const URL& documentURL = mainDocumentURL.isEmpty() ? url : mainDocumentURL;
+    String target = url.string();
+    String context = documentURL.host().toString();
+    if (auto cached = m_cache.lookup(target, type, context)) {
+        return *cached;
+    }
+
+    // Stored under the lock so an edit flushing the cache in between can't
+    // leave a stale decision behind.
+    auto locker = holdLock(m_lock);
+    bool block = computeDecision(url, type, documentURL);
+    m_cache.store(target, type, context, block);
+    return block;
+}
+
+bool shouldBlock(const URL& url, int type, const URL& mainDocumentURL)
 {
     if (url.protocolIs("data")) { return false; }
     if (!ad_block_enabled) { return false; }
     if (type < 0) { type = DOCUMENT_TYPE; }
 
-    if (!ab_cache) {
-        ab_cache = initialize();
+    if (!ab_initialized) {
+        // The lists are loaded from the main thread only, loads started
+        // elsewhere before that are let through.
+        if (!isMainThread()) { return false; }
+        initialize();
     }
-    String target = url.string();
-    CacheEntry& ent = ab_cache[ab_hash(target) % CACHE_SIZE];
-    if (ent.target != target) {
-        ent.target = target;
-        ent.block = (!ab_whiteList.matches(target, type))
-                   && ab_blackList.matches(target, type);
+
+    return AdBlockMatcher::singleton().shouldBlock(url, type, mainDocumentURL);
+}
+
+#ifndef NDEBUG
+/*
+ * Replays a recorded list of URLs (one per line) against the loaded filter
+ * lists, bypassing the decision cache, and reports the matching throughput.
+ * Only built into debug builds.
+ */
+String benchmarkAdBlock(const char *path)
+{
+    ASSERT(isMainThread());
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return "ERROR: cannot open URL list";
+
+    loadCache();
+
+    auto& matcher = AdBlockMatcher::singleton();
+    Vector<String> urls;
+    char buf[4096];
+    while (fgets(buf, sizeof(buf), file)) {
+        String line = String(buf).stripWhiteSpace();
+        if (!line.isEmpty())
+            urls.append(line);
     }
-    return ent.block;
+    fclose(file);
+
+    static const int types[] = {
+        to_underlying(CachedResource::Type::ImageResource),
+        to_underlying(CachedResource::Type::Script),
+        to_underlying(CachedResource::Type::CSSStyleSheet),
+        DOCUMENT_TYPE
+    };
+
+    unsigned blocked = 0;
+    unsigned lookups = 0;
+    MonotonicTime start = MonotonicTime::now();
+    auto locker = holdLock(matcher.lock());
+    for (auto& url : urls) {
+        URL parsed({ }, url);
+        for (int type : types) {
+            if (matcher.computeDecision(parsed, type, parsed))
+                blocked++;
+            lookups++;
+        }
+    }
+    double elapsed = (MonotonicTime::now() - start).milliseconds();
+
+    auto statistics = matcher.cacheStatistics();
+
+    String result = makeString("rules: ", matcher.blackList().patterns()->size() + matcher.whiteList().patterns()->size(),
+        " urls: ", urls.size(), " lookups: ", lookups, " blocked: ", blocked,
+        " time: ", FormattedNumber::fixedWidth(elapsed, 2), " ms",
+        " per lookup: ", FormattedNumber::fixedWidth(lookups ? elapsed * 1000 / lookups : 0, 2), " us",
+        " cache hits: ", statistics.hits, " misses: ", statistics.misses, " entries: ", statistics.size);
+    return result;
 }
+#endif
 
 }
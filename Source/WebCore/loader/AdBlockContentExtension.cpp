@@ -0,0 +1,463 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "AdBlockContentExtension.h"
+
+#if ENABLE(CONTENT_EXTENSIONS)
+
+#include "AdBlockRule.h"
+#include "CompiledContentExtension.h"
+#include "ContentExtensionActions.h"
+#include "ContentExtensionCompiler.h"
+#include "ContentExtensionParser.h"
+#include <wtf/FileSystem.h>
+#include <wtf/HashSet.h>
+#include <string.h>
+
+namespace WebCore {
+
+#define BYTECODE_VERSION 1
+
+struct AdBlockBytecodeHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t conditionsApplyOnlyToDomain;
+    int64_t sourceSize;
+    int64_t sourceModificationTime;
+    uint32_t actionsLength;
+    uint32_t filtersWithoutConditionsLength;
+    uint32_t filtersWithConditionsLength;
+    uint32_t topURLFiltersLength;
+};
+
+static const char bytecodeMagic[8] = { 'O', 'W', 'B', 'A', 'D', 'D', 'F', 'A' };
+
+// The compiled form, laid out exactly like the file: the header followed by
+// the actions and the three bytecode sections. It is either built in memory
+// by the compiler or mapped from disk.
+class AdBlockContentExtension::Bytecode final : public ContentExtensions::CompiledContentExtension {
+public:
+    static Ref<Bytecode> create(Vector<uint8_t>&& buffer)
+    {
+        return adoptRef(*new Bytecode(WTFMove(buffer)));
+    }
+
+    static RefPtr<Bytecode> create(FileSystem::MappedFileData&& mapped)
+    {
+        if (!isValid(mapped.data(), mapped.size()))
+            return nullptr;
+        return adoptRef(*new Bytecode(WTFMove(mapped)));
+    }
+
+    static bool isValid(const void* data, size_t size)
+    {
+        if (size < sizeof(AdBlockBytecodeHeader))
+            return false;
+        auto& header = *static_cast<const AdBlockBytecodeHeader*>(data);
+        uint64_t expectedSize = sizeof(AdBlockBytecodeHeader);
+        expectedSize += header.actionsLength;
+        expectedSize += header.filtersWithoutConditionsLength;
+        expectedSize += header.filtersWithConditionsLength;
+        expectedSize += header.topURLFiltersLength;
+        return !memcmp(header.magic, bytecodeMagic, sizeof(bytecodeMagic))
+            && header.version == BYTECODE_VERSION
+            && expectedSize == size;
+    }
+
+    const AdBlockBytecodeHeader& header() const { return *reinterpret_cast<const AdBlockBytecodeHeader*>(m_data); }
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    const DFABytecode* filtersWithoutConditionsBytecode() const final { return m_data + sizeof(AdBlockBytecodeHeader) + header().actionsLength; }
+    unsigned filtersWithoutConditionsBytecodeLength() const final { return header().filtersWithoutConditionsLength; }
+    const DFABytecode* filtersWithConditionsBytecode() const final { return filtersWithoutConditionsBytecode() + filtersWithoutConditionsBytecodeLength(); }
+    unsigned filtersWithConditionsBytecodeLength() const final { return header().filtersWithConditionsLength; }
+    const DFABytecode* topURLFiltersBytecode() const final { return filtersWithConditionsBytecode() + filtersWithConditionsBytecodeLength(); }
+    unsigned topURLFiltersBytecodeLength() const final { return header().topURLFiltersLength; }
+    const ContentExtensions::SerializedActionByte* actions() const final { return m_data + sizeof(AdBlockBytecodeHeader); }
+    unsigned actionsLength() const final { return header().actionsLength; }
+    bool conditionsApplyOnlyToDomain() const final { return header().conditionsApplyOnlyToDomain; }
+
+private:
+    explicit Bytecode(Vector<uint8_t>&& buffer)
+        : m_buffer(WTFMove(buffer))
+        , m_data(m_buffer.data())
+        , m_size(m_buffer.size())
+    {
+    }
+
+    explicit Bytecode(FileSystem::MappedFileData&& mapped)
+        : m_mapped(WTFMove(mapped))
+        , m_data(static_cast<const uint8_t*>(m_mapped.data()))
+        , m_size(m_mapped.size())
+    {
+    }
+
+    Vector<uint8_t> m_buffer;
+    FileSystem::MappedFileData m_mapped;
+    const uint8_t* m_data;
+    size_t m_size;
+};
+
+class AdBlockCompilationClient final : public ContentExtensions::ContentExtensionCompilationClient {
+public:
+    void writeSource(String&&) final { }
+
+    void writeActions(Vector<ContentExtensions::SerializedActionByte>&& actions, bool conditionsApplyOnlyToDomain) final
+    {
+        m_actions = WTFMove(actions);
+        m_conditionsApplyOnlyToDomain = conditionsApplyOnlyToDomain;
+    }
+
+    void writeFiltersWithoutConditionsBytecode(Vector<DFABytecode>&& bytecode) final { m_filtersWithoutConditions.appendVector(bytecode); }
+    void writeFiltersWithConditionsBytecode(Vector<DFABytecode>&& bytecode) final { m_filtersWithConditions.appendVector(bytecode); }
+    void writeTopURLFiltersBytecode(Vector<DFABytecode>&& bytecode) final { m_topURLFilters.appendVector(bytecode); }
+    void finalize() final { }
+
+    Vector<uint8_t> takeBuffer()
+    {
+        AdBlockBytecodeHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, bytecodeMagic, sizeof(bytecodeMagic));
+        header.version = BYTECODE_VERSION;
+        header.conditionsApplyOnlyToDomain = m_conditionsApplyOnlyToDomain;
+        header.actionsLength = m_actions.size();
+        header.filtersWithoutConditionsLength = m_filtersWithoutConditions.size();
+        header.filtersWithConditionsLength = m_filtersWithConditions.size();
+        header.topURLFiltersLength = m_topURLFilters.size();
+
+        Vector<uint8_t> buffer;
+        buffer.reserveInitialCapacity(sizeof(header) + m_actions.size() + m_filtersWithoutConditions.size() + m_filtersWithConditions.size() + m_topURLFilters.size());
+        buffer.append(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+        buffer.appendVector(m_actions);
+        buffer.appendVector(m_filtersWithoutConditions);
+        buffer.appendVector(m_filtersWithConditions);
+        buffer.appendVector(m_topURLFilters);
+        return buffer;
+    }
+
+private:
+    Vector<ContentExtensions::SerializedActionByte> m_actions;
+    Vector<DFABytecode> m_filtersWithoutConditions;
+    Vector<DFABytecode> m_filtersWithConditions;
+    Vector<DFABytecode> m_topURLFilters;
+    bool m_conditionsApplyOnlyToDomain { false };
+};
+
+static const char* const allResourceTypes[] = {
+    "document", "image", "style-sheet", "script", "font", "raw", "svg-document", "media", "popup"
+};
+
+// Returns an entry of allResourceTypes, so results can be compared by address.
+static const char* resourceTypeForOption(const String& option)
+{
+    if (option == "subdocument")
+        return allResourceTypes[0];
+    if (option == "image")
+        return allResourceTypes[1];
+    if (option == "stylesheet")
+        return allResourceTypes[2];
+    if (option == "script")
+        return allResourceTypes[3];
+    if (option == "font")
+        return allResourceTypes[4];
+    if (option == "xmlhttprequest" || option == "other")
+        return allResourceTypes[5];
+    if (option == "media")
+        return allResourceTypes[7];
+    return nullptr;
+}
+
+static void appendJSONString(StringBuilder& builder, const String& string)
+{
+    builder.append('"');
+    for (unsigned i = 0; i < string.length(); i++) {
+        UChar c = string[i];
+        if (c == '"' || c == '\\')
+            builder.append('\\');
+        builder.append(c);
+    }
+    builder.append('"');
+}
+
+// Translates the Adblock Plus pattern language into the regular expression
+// subset understood by URLFilterParser. A trailing separator placeholder may
+// also match the end of the address, which needs a second filter since the
+// parser only allows '$' at the very end.
+static Vector<String> urlFiltersForPattern(const String& pattern)
+{
+    if (!pattern.isAllASCII())
+        return { };
+    if (pattern.length() > 1 && pattern.startsWith('/') && pattern.endsWith('/'))
+        return { };
+
+    StringBuilder filter;
+    String body = pattern;
+    if (body.startsWith("||")) {
+        filter.appendLiteral("^[^:]+://+([^/]+\\.)?");
+        body = body.substring(2);
+    } else if (body.startsWith('|')) {
+        filter.append('^');
+        body = body.substring(1);
+    }
+
+    bool anchorEnd = false;
+    if (body.endsWith('|')) {
+        anchorEnd = true;
+        body = body.left(body.length() - 1);
+    }
+
+    bool trailingSeparator = false;
+    if (!anchorEnd && body.endsWith('^')) {
+        trailingSeparator = true;
+        body = body.left(body.length() - 1);
+    }
+
+    for (unsigned i = 0; i < body.length(); i++) {
+        UChar c = body[i];
+        switch (c) {
+        case '*':
+            filter.appendLiteral(".*");
+            break;
+        case '^':
+            filter.appendLiteral("[^a-zA-Z0-9_.%-]");
+            break;
+        case '.':
+        case '+':
+        case '?':
+        case '(':
+        case ')':
+        case '[':
+        case ']':
+        case '{':
+        case '}':
+        case '\\':
+        case '$':
+        case '|':
+            filter.append('\\');
+            filter.append(c);
+            break;
+        default:
+            filter.append(c);
+        }
+    }
+
+    if (anchorEnd)
+        filter.append('$');
+
+    if (!trailingSeparator)
+        return { filter.toString() };
+
+    String prefix = filter.toString();
+    return { makeString(prefix, "[^a-zA-Z0-9_.%-]"), makeString(prefix, '$') };
+}
+
+unsigned AdBlockContentExtension::appendRule(StringBuilder& builder, const String& rule, bool& first)
+{
+    AdBlockRuleParts parts = splitAdBlockRule(rule);
+    if (parts.pattern.isNull())
+        return 0;
+    const String& pattern = parts.pattern;
+    const String& options = parts.options;
+
+    bool caseSensitive = false;
+    const char* loadType = nullptr;
+    Vector<String> ifDomains;
+    Vector<String> unlessDomains;
+    Vector<const char*> includedTypes;
+    HashSet<const char*> excludedTypes;
+
+    for (auto& option : options.convertToASCIILowercase().split(',')) {
+        if (option == "match-case") {
+            caseSensitive = true;
+            continue;
+        }
+        if (option == "third-party") {
+            loadType = "third-party";
+            continue;
+        }
+        if (option == "~third-party") {
+            loadType = "first-party";
+            continue;
+        }
+        if (option.startsWith("domain=")) {
+            for (auto& domain : option.substring(7).split('|')) {
+                if (!domain.isAllASCII())
+                    return 0;
+                if (domain.startsWith('~'))
+                    unlessDomains.append(makeString('*', domain.substring(1)));
+                else
+                    ifDomains.append(makeString('*', domain));
+            }
+            continue;
+        }
+
+        bool invert = option.startsWith('~');
+        const char* type = resourceTypeForOption(invert ? option.substring(1) : option);
+        if (!type)
+            return 0;
+        if (invert)
+            excludedTypes.add(type);
+        else
+            includedTypes.append(type);
+    }
+
+    // A trigger can only carry one kind of domain condition.
+    if (!ifDomains.isEmpty() && !unlessDomains.isEmpty())
+        return 0;
+
+    Vector<const char*> types;
+    if (!includedTypes.isEmpty()) {
+        for (auto* type : includedTypes) {
+            if (!excludedTypes.contains(type) && !types.contains(type))
+                types.append(type);
+        }
+        if (types.isEmpty())
+            return 0;
+    } else if (!excludedTypes.isEmpty()) {
+        for (auto* type : allResourceTypes) {
+            if (!excludedTypes.contains(type))
+                types.append(type);
+        }
+    }
+
+    Vector<String> filters = urlFiltersForPattern(pattern);
+    if (filters.isEmpty())
+        return 0;
+
+    for (auto& filter : filters) {
+        if (!first)
+            builder.append(',');
+        first = false;
+
+        builder.appendLiteral("{\"trigger\":{\"url-filter\":");
+        appendJSONString(builder, filter);
+        if (caseSensitive)
+            builder.appendLiteral(",\"url-filter-is-case-sensitive\":true");
+        if (!types.isEmpty()) {
+            builder.appendLiteral(",\"resource-type\":[");
+            for (size_t i = 0; i < types.size(); i++) {
+                if (i)
+                    builder.append(',');
+                builder.append('"');
+                builder.append(types[i]);
+                builder.append('"');
+            }
+            builder.append(']');
+        }
+        if (loadType) {
+            builder.appendLiteral(",\"load-type\":[\"");
+            builder.append(loadType);
+            builder.appendLiteral("\"]");
+        }
+        const Vector<String>& domains = ifDomains.isEmpty() ? unlessDomains : ifDomains;
+        if (!domains.isEmpty()) {
+            builder.appendLiteral(ifDomains.isEmpty() ? ",\"unless-domain\":[" : ",\"if-domain\":[");
+            for (size_t i = 0; i < domains.size(); i++) {
+                if (i)
+                    builder.append(',');
+                appendJSONString(builder, domains[i]);
+            }
+            builder.append(']');
+        }
+        builder.appendLiteral("},\"action\":{\"type\":\"block\"}}");
+    }
+    return filters.size();
+}
+
+AdBlockContentExtension::AdBlockContentExtension(const String& identifier, Ref<Bytecode>&& bytecode)
+    : m_bytecode(WTFMove(bytecode))
+{
+    m_backend.addContentExtension(identifier, m_bytecode.copyRef(), ContentExtensions::ContentExtension::ShouldCompileCSS::No);
+}
+
+RefPtr<AdBlockContentExtension> AdBlockContentExtension::compile(const String& identifier, String&& json)
+{
+    auto parsedRules = ContentExtensions::parseRuleList(json);
+    if (!parsedRules.has_value())
+        return nullptr;
+
+    AdBlockCompilationClient client;
+    if (ContentExtensions::compileRuleList(client, WTFMove(json), WTFMove(parsedRules.value())))
+        return nullptr;
+
+    return adoptRef(*new AdBlockContentExtension(identifier, Bytecode::create(client.takeBuffer())));
+}
+
+RefPtr<AdBlockContentExtension> AdBlockContentExtension::load(const String& identifier, const String& path, int64_t sourceSize, int64_t sourceModificationTime)
+{
+    bool success;
+    FileSystem::MappedFileData mapped(path, success);
+    if (!success)
+        return nullptr;
+
+    auto bytecode = Bytecode::create(WTFMove(mapped));
+    if (!bytecode)
+        return nullptr;
+    if (bytecode->header().sourceSize != sourceSize || bytecode->header().sourceModificationTime != sourceModificationTime)
+        return nullptr;
+
+    return adoptRef(*new AdBlockContentExtension(identifier, bytecode.releaseNonNull()));
+}
+
+bool AdBlockContentExtension::save(const String& path, int64_t sourceSize, int64_t sourceModificationTime) const
+{
+    AdBlockBytecodeHeader header = m_bytecode->header();
+    header.sourceSize = sourceSize;
+    header.sourceModificationTime = sourceModificationTime;
+
+    String temporaryPath = makeString(path, ".tmp");
+    FileSystem::PlatformFileHandle handle = FileSystem::openFile(temporaryPath, FileSystem::FileOpenMode::Write);
+    if (!FileSystem::isHandleValid(handle))
+        return false;
+
+    int bodySize = m_bytecode->size() - sizeof(header);
+    bool success = FileSystem::writeToFile(handle, reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header)
+        && FileSystem::writeToFile(handle, reinterpret_cast<const char*>(m_bytecode->data() + sizeof(header)), bodySize) == bodySize;
+    FileSystem::closeFile(handle);
+
+    if (!success) {
+        FileSystem::deleteFile(temporaryPath);
+        return false;
+    }
+
+    FileSystem::deleteFile(path);
+    return FileSystem::moveFile(temporaryPath, path);
+}
+
+bool AdBlockContentExtension::matches(const URL& url, ResourceType type, const URL& mainDocumentURL) const
+{
+    ResourceLoadInfo info { url, mainDocumentURL, type };
+    auto actions = m_backend.actionsForResourceLoad(info);
+    for (auto& action : actions.first) {
+        if (action.type() == ContentExtensions::ActionType::BlockLoad)
+            return true;
+    }
+    return false;
+}
+
+} // namespace WebCore
+
+#endif // ENABLE(CONTENT_EXTENSIONS)
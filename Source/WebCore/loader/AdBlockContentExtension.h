@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#if ENABLE(CONTENT_EXTENSIONS)
+
+#include "ContentExtensionsBackend.h"
+#include "ResourceLoadInfo.h"
+#include <wtf/RefCounted.h>
+#include <wtf/URL.h>
+#include <wtf/text/StringBuilder.h>
+
+namespace WebCore {
+
+// Runs a list of AdBlock rules through the content extension DFA compiler.
+// Rules are converted from Adblock Plus syntax into content extension JSON,
+// compiled once, and the resulting bytecode is kept on disk so later runs
+// only map it. Each instance holds one list (deny or allow); a URL matches
+// when any of its rules produces a block action.
+class AdBlockContentExtension : public RefCounted<AdBlockContentExtension> {
+public:
+    // Appends the JSON for one rule ("pattern$options" or the "pattern#options"
+    // form used by blocked.prefs) to builder, preceded by a comma unless it is
+    // the first one. Returns the number of rule list entries appended, as one
+    // rule may need several triggers, or 0, leaving builder untouched, when
+    // the rule cannot be expressed as a content extension trigger.
+    static unsigned appendRule(StringBuilder&, const String& rule, bool& first);
+
+    static RefPtr<AdBlockContentExtension> compile(const String& identifier, String&& json);
+    static RefPtr<AdBlockContentExtension> load(const String& identifier, const String& path, int64_t sourceSize, int64_t sourceModificationTime);
+
+    bool save(const String& path, int64_t sourceSize, int64_t sourceModificationTime) const;
+    bool matches(const URL&, ResourceType, const URL& mainDocumentURL) const;
+
+private:
+    class Bytecode;
+
+    AdBlockContentExtension(const String& identifier, Ref<Bytecode>&&);
+
+    Ref<Bytecode> m_bytecode;
+    ContentExtensions::ContentExtensionsBackend m_backend;
+};
+
+} // namespace WebCore
+
+#endif // ENABLE(CONTENT_EXTENSIONS)
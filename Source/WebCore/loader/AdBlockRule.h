@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <wtf/text/WTFString.h>
+
+namespace WebCore {
+
+// "domains##selector" and "domains#@#selector" hide elements instead of
+// filtering requests.
+inline bool isElementHidingRule(const String& rule)
+{
+    return rule.contains("##") || rule.contains("#@#");
+}
+
+inline bool isRuleOptionCharacter(UChar c)
+{
+    return isASCIIAlphanumeric(c) || c == '_' || c == '-' || c == '.' || c == ',' || c == '=' || c == '~' || c == '|';
+}
+
+struct AdBlockRuleParts {
+    String pattern;
+    String options;
+};
+
+// Splits a request filter into its pattern and comma separated options.
+// Options follow the last '$' as in Adblock Plus lists, as long as what
+// follows it reads as an option list (a regular expression rule may end
+// with '$' itself), and the first '#' otherwise, which is the form
+// blockResource() writes to blocked.prefs. Element hiding rules have no
+// request pattern and come back with a null one.
+inline AdBlockRuleParts splitAdBlockRule(const String& rule)
+{
+    if (isElementHidingRule(rule))
+        return { };
+
+    size_t delim = rule.reverseFind('$');
+    if (delim != notFound) {
+        String options = rule.substring(delim + 1);
+        if (options.isEmpty() || options.find([](UChar c) { return !isRuleOptionCharacter(c); }) != notFound)
+            delim = notFound;
+    }
+    if (delim == notFound)
+        delim = rule.find('#');
+
+    if (delim == notFound)
+        return { rule, emptyString() };
+    return { rule.left(delim), rule.substring(delim + 1) };
+}
+
+} // namespace WebCore
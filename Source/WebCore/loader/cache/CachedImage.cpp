@@ -475,8 +475,9 @@ void CachedImage::updateBufferInternal(SharedBuffer& data)
         return;
     }
 
-    // Tell our observers to try to draw.
-    notifyObservers();
+    // Tell our observers to try to draw, limited to the part of the image the new data changed if it's known.
+    auto changedRect = m_image->dataChangedRect();
+    notifyObservers(changedRect ? &changedRect.value() : nullptr);
 }
 
 bool CachedImage::shouldDeferUpdateImageData() const
@@ -90,6 +90,11 @@
 
 namespace WebCore {
 
+#if PLATFORM(MUI)
+// AdBlock.cpp, a negative type stands for a subframe document.
+extern bool shouldBlock(const URL&, int type, const URL& mainDocumentURL);
+#endif
+
 // Timeout for link preloads to be used after window.onload
 static const Seconds unusedPreloadTimeout { 3_s };
 
@@ -832,6 +837,24 @@ ResourceErrorOr<CachedResourceHandle<CachedResource>> CachedResourceLoader::requ
     }
 #endif
 
+#if PLATFORM(MUI)
+    if (frame() && frame()->page() && !(type == CachedResource::Type::MainResource && frame()->isMainFrame())) {
+        auto* page = frame()->page();
+        auto* mainDocument = frame()->mainFrame().document();
+        if (shouldBlock(url, type == CachedResource::Type::MainResource ? -1 : static_cast<int>(type), mainDocument ? mainDocument->url() : URL())) {
+            RELEASE_LOG_IF_ALLOWED("requestResource: Resource blocked by ad blocker (frame = %p)", frame());
+            if (type == CachedResource::Type::MainResource) {
+                CachedResourceHandle<CachedResource> resource = createResource(type, WTFMove(request), page->sessionID(), &page->cookieJar());
+                ASSERT(resource);
+                resource->error(CachedResource::Status::LoadError);
+                resource->setResourceError(ResourceError { errorDomainWebKitInternal, 0, url, "Frame blocked by ad blocker"_s, ResourceError::Type::AccessControl });
+                return resource;
+            }
+            return makeUnexpected(ResourceError { errorDomainWebKitInternal, 0, url, "Resource blocked by ad blocker"_s, ResourceError::Type::AccessControl });
+        }
+    }
+#endif
+
     if (frame() && m_documentLoader && !m_documentLoader->customHeaderFields().isEmpty()) {
         bool sameOriginRequest = false;
         auto requestedOrigin = SecurityOrigin::create(url);
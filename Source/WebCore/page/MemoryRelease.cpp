@@ -56,6 +56,10 @@
 #include "ResourceUsageThread.h"
 #endif
 
+#if USE(CAIRO)
+#include "GlyphRasterCacheCairo.h"
+#endif
+
 namespace WebCore {
 
 static void releaseNoncriticalMemory()
@@ -67,6 +71,10 @@ static void releaseNoncriticalMemory()
     clearWidthCaches();
     TextPainter::clearGlyphDisplayLists();
 
+#if USE(CAIRO)
+    GlyphRasterCache::singleton().clear();
+#endif
+
     for (auto* document : Document::allDocuments())
         document->clearSelectorQueryCache();
 
@@ -11,6 +11,7 @@ list(APPEND WebCore_SOURCES
     platform/network/curl/CookieUtil.cpp
     platform/network/curl/CredentialStorageCurl.cpp
     platform/network/curl/CurlCacheEntry.cpp
+    platform/network/curl/CurlCacheIOQueue.cpp
     platform/network/curl/CurlCacheManager.cpp
     platform/network/curl/CurlContext.cpp
     platform/network/curl/CurlDownload.cpp
@@ -23,6 +24,7 @@ list(APPEND WebCore_SOURCES
     platform/network/curl/CurlStream.cpp
     platform/network/curl/CurlSSLHandle.cpp
     platform/network/curl/CurlSSLVerifier.cpp
+    platform/network/curl/CurlSocketReactor.cpp
     platform/network/curl/DNSResolveQueueCurl.cpp
     platform/network/curl/NetworkStorageSessionCurl.cpp
     platform/network/curl/ProtectionSpaceCurl.cpp
@@ -106,11 +106,45 @@ void BitmapImage::destroyDecodedDataIfNecessary(bool destroyAll)
 
 EncodedDataStatus BitmapImage::dataChanged(bool allDataReceived)
 {
-    if (m_source->decodedSize() && !canUseAsyncDecodingForLargeImages())
-        m_source->destroyIncompleteDecodedData();
+    m_dataChangedRect = WTF::nullopt;
 
-    m_currentFrameDecodingStatus = DecodingStatus::Invalid;
-    return m_source->dataChanged(data(), allDataReceived);
+    if (!m_source->decodedSize() || canUseAsyncDecodingForLargeImages()) {
+        m_currentFrameDecodingStatus = DecodingStatus::Invalid;
+        return m_source->dataChanged(data(), allDataReceived);
+    }
+
+    // A partially decoded first frame which has been drawn already is brought up to date right away,
+    // so the decoder can tell which rows the new data filled in and only those get repainted.
+    bool updateDrawnFrame = !allDataReceived && !m_currentFrame && m_currentFrameDecodingStatus == DecodingStatus::Partial;
+
+    m_source->destroyIncompleteDecodedData();
+    EncodedDataStatus status = m_source->dataChanged(data(), allDataReceived);
+    if (!updateDrawnFrame || status < EncodedDataStatus::SizeAvailable) {
+        m_currentFrameDecodingStatus = DecodingStatus::Invalid;
+        return status;
+    }
+
+    // Rows decoded for the previous draw have been painted already.
+    m_source->takeChangedRectAtIndex(m_currentFrame);
+    frameImageAtIndexCacheIfNeeded(m_currentFrame, m_currentSubsamplingLevel);
+    m_currentFrameDecodingStatus = frameDecodingStatusAtIndex(m_currentFrame);
+
+    auto changedRect = m_source->takeChangedRectAtIndex(m_currentFrame);
+    IntSize frameSize = m_source->frameSizeAtIndex(m_currentFrame, m_currentSubsamplingLevel);
+    if (!changedRect || frameSize.isEmpty())
+        return status;
+
+    // Decoded rows are not rows of a rotated or flipped image.
+    if (frameOrientationAtIndex(m_currentFrame) != DefaultImageOrientation)
+        return status;
+
+    // The decoder counts rows of the possibly subsampled frame.
+    IntSize imageSize = m_source->size();
+    float scale = static_cast<float>(imageSize.height()) / frameSize.height();
+    int top = std::floor(changedRect->y() * scale);
+    int bottom = std::ceil(changedRect->maxY() * scale);
+    m_dataChangedRect = IntRect(0, top, imageSize.width(), bottom - top);
+    return status;
 }
     
 void BitmapImage::setCurrentFrameDecodingStatusIfNecessary(DecodingStatus decodingStatus)
@@ -365,6 +399,16 @@ SubsamplingLevel BitmapImage::subsamplingLevelForScaleFactor(GraphicsContext& co
 
     int result = std::ceil(std::log2(1 / scale));
     return static_cast<SubsamplingLevel>(std::min(result, static_cast<int>(m_source->maximumSubsamplingLevel())));
+#elif PLATFORM(MUI)
+    UNUSED_PARAM(context);
+
+    float scale = std::min(float(1), std::max(scaleFactor.width(), scaleFactor.height()));
+    if (!(scale > 0 && scale <= 1))
+        return SubsamplingLevel::Default;
+
+    // Round down, an image decoded smaller than it is drawn would have to be scaled up.
+    int result = std::floor(std::log2(1 / scale));
+    return static_cast<SubsamplingLevel>(std::min(result, static_cast<int>(m_source->maximumSubsamplingLevel())));
 #else
     UNUSED_PARAM(context);
     UNUSED_PARAM(scaleFactor);
@@ -71,6 +71,7 @@ public:
     bool hasSingleSecurityOrigin() const override { return true; }
 
     EncodedDataStatus dataChanged(bool allDataReceived) override;
+    Optional<IntRect> dataChangedRect() const override { return m_dataChangedRect; }
     unsigned decodedSize() const { return m_source->decodedSize(); }
 
     EncodedDataStatus encodedDataStatus() const { return m_source->encodedDataStatus(); }
@@ -212,6 +213,7 @@ private:
     size_t m_currentFrame { 0 }; // The index of the current frame of animation.
     SubsamplingLevel m_currentSubsamplingLevel { SubsamplingLevel::Default };
     DecodingStatus m_currentFrameDecodingStatus { DecodingStatus::Invalid };
+    Optional<IntRect> m_dataChangedRect;
     std::unique_ptr<Timer> m_frameTimer;
     RepetitionCount m_repetitionsComplete { RepetitionCountNone }; // How many repetitions we've finished.
     MonotonicTime m_desiredFrameStartTime; // The system time at which we hope to see the next call to startAnimation().
@@ -221,7 +223,7 @@ private:
     bool m_animationFinished { false };
 
     // The default value of m_allowSubsampling should be the same as defaultImageSubsamplingEnabled in Settings.cpp
-#if PLATFORM(IOS_FAMILY)
+#if PLATFORM(IOS_FAMILY) || PLATFORM(MUI)
     bool m_allowSubsampling { true };
 #else
     bool m_allowSubsampling { false };
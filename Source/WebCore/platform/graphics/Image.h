@@ -33,6 +33,7 @@
 #include "GraphicsTypes.h"
 #include "ImageOrientation.h"
 #include "ImageTypes.h"
+#include "IntRect.h"
 #include "NativeImage.h"
 #include "Timer.h"
 #include <wtf/Optional.h>
@@ -122,6 +123,8 @@ public:
 
     WEBCORE_EXPORT EncodedDataStatus setData(RefPtr<SharedBuffer>&& data, bool allDataReceived);
     virtual EncodedDataStatus dataChanged(bool /*allDataReceived*/) { return EncodedDataStatus::Unknown; }
+    // The part of the image, in image coordinates, which the last dataChanged() call altered, or nullopt if unknown.
+    virtual Optional<IntRect> dataChangedRect() const { return WTF::nullopt; }
 
     virtual String uti() const { return String(); } // null string if unknown
     virtual String filenameExtension() const { return String(); } // null string if unknown
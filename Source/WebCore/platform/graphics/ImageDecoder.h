@@ -29,6 +29,7 @@
 #include "ImageOrientation.h"
 #include "ImageTypes.h"
 #include "IntPoint.h"
+#include "IntRect.h"
 #include "IntSize.h"
 #include "NativeImage.h"
 #include <wtf/Optional.h>
@@ -75,6 +76,10 @@ public:
 
     virtual NativeImagePtr createFrameImageAtIndex(size_t, SubsamplingLevel = SubsamplingLevel::Default, const DecodingOptions& = DecodingOptions(DecodingMode::Synchronous)) = 0;
 
+    // The part of a frame decoded since the last call, in frame coordinates. WTF::nullopt if the
+    // decoder can't tell.
+    virtual Optional<IntRect> takeChangedRectAtIndex(size_t) { return WTF::nullopt; }
+
     virtual void setExpectedContentSize(long long) { }
     virtual void setData(SharedBuffer&, bool allDataReceived) = 0;
     virtual bool isAllDataReceived() const = 0;
@@ -159,6 +159,13 @@ void ImageSource::clearFrameBufferCache(size_t beforeFrame)
     m_decoder->clearFrameBufferCache(beforeFrame);
 }
 
+Optional<IntRect> ImageSource::takeChangedRectAtIndex(size_t index)
+{
+    if (!isDecoderAvailable())
+        return WTF::nullopt;
+    return m_decoder->takeChangedRectAtIndex(index);
+}
+
 void ImageSource::encodedDataStatusChanged(EncodedDataStatus status)
 {
     if (status == m_encodedDataStatus)
@@ -345,12 +352,20 @@ void ImageSource::startAsyncDecodingQueue()
     if (hasAsyncDecodingQueue() || !isDecoderAvailable())
         return;
 
+    decodingQueue();
+    frameRequestQueue();
+}
+
+void ImageSource::dispatchAsyncDecoding()
+{
+    // The decoding loop returns once m_frameRequestQueue is empty, so it does not hold a WorkQueue thread
+    // while the image waits for its next request. Every request dispatches it again.
     // We need to protect this, m_decodingQueue and m_decoder from being deleted while we are in the decoding loop.
     decodingQueue().dispatch([protectedThis = makeRef(*this), protectedDecodingQueue = makeRef(decodingQueue()), protectedFrameRequestQueue = makeRef(frameRequestQueue()), protectedDecoder = makeRef(*m_decoder), sourceURL = sourceURL().string().isolatedCopy()] {
         ImageFrameRequest frameRequest;
         Seconds minDecodingDuration = protectedThis->frameDecodingDurationForTesting();
 
-        while (protectedFrameRequestQueue->dequeue(frameRequest)) {
+        while (protectedFrameRequestQueue->tryDequeue(frameRequest)) {
             TraceScope tracingScope(AsyncImageDecodeStart, AsyncImageDecodeEnd);
 
             MonotonicTime startingTime;
@@ -376,6 +391,7 @@ void ImageSource::startAsyncDecodingQueue()
                 if (protectedQueue.ptr() == protectedThis->m_decodingQueue && protectedDecoder.ptr() == protectedThis->m_decoder) {
                     ASSERT(protectedThis->m_frameCommitQueue.first() == frameRequest);
                     protectedThis->m_frameCommitQueue.removeFirst();
+                    protectedThis->enqueueDeferredFrameRequests();
                     protectedThis->cacheNativeImageAtIndexAsync(WTFMove(nativeImage), frameRequest.index, frameRequest.subsamplingLevel, frameRequest.decodingOptions, frameRequest.decodingStatus);
                 } else
                     LOG(Images, "ImageSource::%s - %p - url: %s [frame %ld will not cached]", __FUNCTION__, protectedThis.ptr(), sourceURL.utf8().data(), frameRequest.index);
@@ -394,8 +410,32 @@ void ImageSource::requestFrameAsyncDecodingAtIndex(size_t index, SubsamplingLeve
     DecodingStatus decodingStatus = m_decoder->frameIsCompleteAtIndex(index) ? DecodingStatus::Complete : DecodingStatus::Partial;
 
     LOG(Images, "ImageSource::%s - %p - url: %s [enqueuing frame %ld for decoding]", __FUNCTION__, this, sourceURL().string().utf8().data(), index);
-    m_frameRequestQueue->enqueue({ index, subsamplingLevel, sizeForDrawing, decodingStatus });
     m_frameCommitQueue.append({ index, subsamplingLevel, sizeForDrawing, decodingStatus });
+    m_deferredFrameRequestCount++;
+    enqueueDeferredFrameRequests();
+}
+
+// Waiting for room in m_frameRequestQueue would block the main thread until the decoding loop gets a WorkQueue
+// thread, which may be busy with other images. Requests that don't fit wait at the end of m_frameCommitQueue
+// and are enqueued, in order, as decoded frames are committed.
+void ImageSource::enqueueDeferredFrameRequests()
+{
+    if (!m_deferredFrameRequestCount || !hasAsyncDecodingQueue())
+        return;
+
+    auto it = m_frameCommitQueue.end();
+    for (size_t i = 0; i < m_deferredFrameRequestCount; ++i)
+        --it;
+
+    size_t enqueuedCount = 0;
+    for (; it != m_frameCommitQueue.end() && m_frameRequestQueue->tryEnqueue(*it); ++it)
+        enqueuedCount++;
+
+    if (!enqueuedCount)
+        return;
+
+    m_deferredFrameRequestCount -= enqueuedCount;
+    dispatchAsyncDecoding();
 }
 
 bool ImageSource::isAsyncDecodingQueueIdle() const
@@ -421,6 +461,7 @@ void ImageSource::stopAsyncDecodingQueue()
     m_frameRequestQueue->close();
     m_frameRequestQueue = nullptr;
     m_frameCommitQueue.clear();
+    m_deferredFrameRequestCount = 0;
     m_decodingQueue = nullptr;
     LOG(Images, "ImageSource::%s - %p - url: %s [decoding has been stopped]", __FUNCTION__, this, sourceURL().string().utf8().data());
 }
@@ -589,10 +630,15 @@ SubsamplingLevel ImageSource::maximumSubsamplingLevel()
     if (!isDecoderAvailable() || !m_decoder->frameAllowSubsamplingAtIndex(0))
         return SubsamplingLevel::Default;
 
+#if PLATFORM(MUI)
+    // Memory is scarce, so anything bigger than a thumbnail may be decoded at a fraction of its size.
+    const int maximumImageAreaBeforeSubsampling = 256 * 1024;
+#else
     // FIXME: this value was chosen to be appropriate for iOS since the image
     // subsampling is only enabled by default on iOS. Choose a different value
     // if image subsampling is enabled on other platform.
     const int maximumImageAreaBeforeSubsampling = 5 * 1024 * 1024;
+#endif
     SubsamplingLevel level = SubsamplingLevel::First;
 
     for (; level < SubsamplingLevel::Last; ++level) {
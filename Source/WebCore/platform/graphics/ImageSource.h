@@ -66,6 +66,7 @@ public:
     void destroyDecodedDataBeforeFrame(size_t beforeFrame) { destroyDecodedData(beforeFrame, beforeFrame); }
     void destroyIncompleteDecodedData();
     void clearFrameBufferCache(size_t beforeFrame);
+    Optional<IntRect> takeChangedRectAtIndex(size_t);
 
     void growFrames();
     void clearMetadata();
@@ -154,6 +155,8 @@ private:
     static const int BufferSize = 8;
     WorkQueue& decodingQueue();
     SynchronizedFixedQueue<ImageFrameRequest, BufferSize>& frameRequestQueue();
+    void dispatchAsyncDecoding();
+    void enqueueDeferredFrameRequests();
 
     const ImageFrame& frameAtIndexCacheIfNeeded(size_t, ImageFrame::Caching, const Optional<SubsamplingLevel>& = { });
 
@@ -183,6 +186,8 @@ private:
     using FrameCommitQueue = Deque<ImageFrameRequest, BufferSize>;
     RefPtr<FrameRequestQueue> m_frameRequestQueue;
     FrameCommitQueue m_frameCommitQueue;
+    // Requests at the end of m_frameCommitQueue that did not fit in m_frameRequestQueue yet
+    size_t m_deferredFrameRequestCount { 0 };
     RefPtr<WorkQueue> m_decodingQueue;
     Seconds m_frameDecodingDurationForTesting;
 
@@ -39,6 +39,7 @@
 #include "DrawErrorUnderline.h"
 #include "FloatConversion.h"
 #include "FloatRect.h"
+#include "GlyphRasterCacheCairo.h"
 #include "GraphicsContext.h"
 #include "GraphicsContextPlatformPrivateCairo.h"
 #include "Image.h"
@@ -319,6 +320,12 @@ static inline StrokeStyle focusRingStrokeStyle()
 #endif
 }
 
+static void showGlyphs(cairo_t* context, cairo_scaled_font_t* scaledFont, const Vector<cairo_glyph_t>& glyphs)
+{
+    if (!GlyphRasterCache::singleton().drawGlyphs(context, scaledFont, glyphs))
+        cairo_show_glyphs(context, glyphs.data(), glyphs.size());
+}
+
 static void drawGlyphsToContext(cairo_t* context, cairo_scaled_font_t* scaledFont, double syntheticBoldOffset, const Vector<cairo_glyph_t>& glyphs)
 {
     cairo_matrix_t originalTransform;
@@ -326,11 +333,11 @@ static void drawGlyphsToContext(cairo_t* context, cairo_scaled_font_t* scaledFon
         cairo_get_matrix(context, &originalTransform);
 
     cairo_set_scaled_font(context, scaledFont);
-    cairo_show_glyphs(context, glyphs.data(), glyphs.size());
+    showGlyphs(context, scaledFont, glyphs);
 
     if (syntheticBoldOffset) {
         cairo_translate(context, syntheticBoldOffset, 0);
-        cairo_show_glyphs(context, glyphs.data(), glyphs.size());
+        showGlyphs(context, scaledFont, glyphs);
 
         cairo_set_matrix(context, &originalTransform);
     }
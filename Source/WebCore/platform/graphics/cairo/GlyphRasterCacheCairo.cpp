@@ -0,0 +1,467 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "GlyphRasterCacheCairo.h"
+
+#if USE(CAIRO)
+
+#include "CairoUtilities.h"
+#include "Color.h"
+#include "FloatRect.h"
+#include "FontCascade.h"
+#include "FontCascadeDescription.h"
+#include "GraphicsContext.h"
+#include "PlatformContextCairo.h"
+#include "TextRun.h"
+#include <wtf/MonotonicTime.h>
+#include <wtf/text/StringBuilder.h>
+#include <wtf/text/StringConcatenateNumbers.h>
+
+namespace WebCore {
+
+// Glyphs larger than this are left to cairo, they are rare and would take a big share of the budget.
+static const int maximumGlyphArea = 128 * 128;
+// Same for runs which would need a bigger mask, after clipping.
+static const int maximumRunArea = 2048 * 512;
+
+GlyphRasterCache& GlyphRasterCache::singleton()
+{
+    static NeverDestroyed<GlyphRasterCache> cache;
+    return cache;
+}
+
+void GlyphRasterCache::setCapacity(unsigned bytes)
+{
+    auto locker = holdLock(m_lock);
+    m_capacity = bytes;
+    prune(m_capacity);
+}
+
+void GlyphRasterCache::clear()
+{
+    auto locker = holdLock(m_lock);
+    prune(0);
+}
+
+GlyphRasterCache::Statistics GlyphRasterCache::statistics()
+{
+    auto locker = holdLock(m_lock);
+    Statistics statistics = m_statistics;
+    statistics.size = m_size;
+    statistics.count = m_rasters.size();
+    return statistics;
+}
+
+void GlyphRasterCache::prune(unsigned targetSize)
+{
+    while (m_size > targetSize && !m_order.isEmpty()) {
+        auto raster = m_rasters.take(m_order.takeFirst());
+        m_size -= cost(*raster);
+        ++m_statistics.evictions;
+    }
+}
+
+bool GlyphRasterCache::canCacheScaledFont(cairo_scaled_font_t* scaledFont)
+{
+    // The answer can't change for a scaled font, so it is kept with the font.
+    static cairo_user_data_key_t cacheableKey;
+    static char cacheable;
+    static char notCacheable;
+
+    if (void* data = cairo_scaled_font_get_user_data(scaledFont, &cacheableKey))
+        return data == &cacheable;
+
+    bool canCache = cairo_scaled_font_status(scaledFont) == CAIRO_STATUS_SUCCESS;
+
+    // Subpixel antialiased glyphs carry a coverage value per color component, which an A8 mask can't hold.
+    if (canCache) {
+        cairo_font_options_t* options = cairo_font_options_create();
+        cairo_scaled_font_get_font_options(scaledFont, options);
+        canCache = cairo_font_options_get_antialias(options) != CAIRO_ANTIALIAS_SUBPIXEL;
+        cairo_font_options_destroy(options);
+    }
+
+#if USE(FREETYPE)
+    // Color glyphs, like emoji, are drawn as images rather than masks.
+    if (canCache && cairo_scaled_font_get_type(scaledFont) == CAIRO_FONT_TYPE_FT) {
+        if (FT_Face face = cairo_ft_scaled_font_lock_face(scaledFont)) {
+            canCache = !FT_HAS_COLOR(face);
+            cairo_ft_scaled_font_unlock_face(scaledFont);
+        } else
+            canCache = false;
+    } else
+        canCache = false;
+#else
+    canCache = false;
+#endif
+
+    cairo_scaled_font_set_user_data(scaledFont, &cacheableKey, canCache ? &cacheable : &notCacheable, nullptr);
+    return canCache;
+}
+
+std::unique_ptr<GlyphRasterCache::Raster> GlyphRasterCache::rasterize(cairo_scaled_font_t* scaledFont, Glyph glyph, unsigned subpixelOffset)
+{
+    cairo_glyph_t cairoGlyph = { glyph, 0, 0 };
+    cairo_text_extents_t extents;
+    cairo_scaled_font_glyph_extents(scaledFont, &cairoGlyph, 1, &extents);
+    if (cairo_scaled_font_status(scaledFont) != CAIRO_STATUS_SUCCESS)
+        return nullptr;
+
+    auto raster = std::make_unique<Raster>();
+    raster->scaledFont = scaledFont;
+
+    // Nothing to draw for blank glyphs like spaces, but remembering that is worth it as well.
+    if (extents.width <= 0 || extents.height <= 0)
+        return raster;
+
+    // Leave a pixel on every side for antialiasing and hinting, which the extents don't account for.
+    double offset = static_cast<double>(subpixelOffset) / subpixelPositions;
+    int left = std::floor(offset + extents.x_bearing) - 1;
+    int top = std::floor(extents.y_bearing) - 1;
+    int right = std::ceil(offset + extents.x_bearing + extents.width) + 1;
+    int bottom = std::ceil(extents.y_bearing + extents.height) + 1;
+    if ((right - left) * (bottom - top) > maximumGlyphArea)
+        return nullptr;
+
+    raster->bounds = IntRect(left, top, right - left, bottom - top);
+
+    RefPtr<cairo_surface_t> surface = adoptRef(cairo_image_surface_create(CAIRO_FORMAT_A8, raster->bounds.width(), raster->bounds.height()));
+    RefPtr<cairo_t> cr = adoptRef(cairo_create(surface.get()));
+    cairo_set_scaled_font(cr.get(), scaledFont);
+    cairoGlyph.x = offset - left;
+    cairoGlyph.y = -top;
+    cairo_show_glyphs(cr.get(), &cairoGlyph, 1);
+    cairo_surface_flush(surface.get());
+    if (cairo_status(cr.get()) != CAIRO_STATUS_SUCCESS)
+        return nullptr;
+
+    int width = raster->bounds.width();
+    int stride = cairo_image_surface_get_stride(surface.get());
+    const uint8_t* data = cairo_image_surface_get_data(surface.get());
+    raster->coverage.resize(width * raster->bounds.height());
+    for (int y = 0; y < raster->bounds.height(); ++y)
+        memcpy(raster->coverage.data() + y * width, data + y * stride, width);
+
+    return raster;
+}
+
+const GlyphRasterCache::Raster* GlyphRasterCache::rasterForGlyph(cairo_scaled_font_t* scaledFont, Glyph glyph, unsigned subpixelOffset)
+{
+    Key key(scaledFont, glyph, subpixelOffset);
+    auto it = m_rasters.find(key);
+    if (it != m_rasters.end()) {
+        ++m_statistics.hits;
+        m_order.appendOrMoveToLast(key);
+        return it->value.get();
+    }
+
+    ++m_statistics.misses;
+    auto raster = rasterize(scaledFont, glyph, subpixelOffset);
+    if (!raster)
+        return nullptr;
+
+    // Not pruned right away, the run being drawn may still use the least recently used rasters.
+    m_size += cost(*raster);
+    m_order.appendOrMoveToLast(key);
+    return m_rasters.add(key, WTFMove(raster)).iterator->value.get();
+}
+
+static bool isBoundedOperator(cairo_operator_t op)
+{
+    switch (op) {
+    case CAIRO_OPERATOR_CLEAR:
+    case CAIRO_OPERATOR_SOURCE:
+    case CAIRO_OPERATOR_IN:
+    case CAIRO_OPERATOR_OUT:
+    case CAIRO_OPERATOR_DEST_IN:
+    case CAIRO_OPERATOR_DEST_ATOP:
+        return false;
+    default:
+        return true;
+    }
+}
+
+bool GlyphRasterCache::drawGlyphs(cairo_t* cr, cairo_scaled_font_t* scaledFont, const Vector<cairo_glyph_t>& glyphs)
+{
+    auto locker = holdLock(m_lock);
+    if (!m_capacity || glyphs.isEmpty())
+        return false;
+
+    // Masks are composed in device pixels, so user space must be device space moved by a translation.
+    cairo_matrix_t matrix;
+    cairo_get_matrix(cr, &matrix);
+    cairo_surface_t* target = cairo_get_group_target(cr);
+    double xScale, yScale;
+    cairoSurfaceGetDeviceScale(target, xScale, yScale);
+    // Unbounded operators would also affect what lies outside of the glyphs, but not outside of the run's mask.
+    if (matrix.xx != 1 || matrix.yy != 1 || matrix.xy || matrix.yx || xScale != 1 || yScale != 1
+        || !isBoundedOperator(cairo_get_operator(cr)) || !canCacheScaledFont(scaledFont)) {
+        ++m_statistics.fallbacks;
+        return false;
+    }
+
+    double deviceOffsetX, deviceOffsetY;
+    cairo_surface_get_device_offset(target, &deviceOffsetX, &deviceOffsetY);
+    double originX = matrix.x0 + deviceOffsetX;
+    double originY = matrix.y0 + deviceOffsetY;
+
+    double clipX1, clipY1, clipX2, clipY2;
+    cairo_clip_extents(cr, &clipX1, &clipY1, &clipX2, &clipY2);
+    IntRect clipRect(enclosingIntRect(FloatRect(clipX1 + originX, clipY1 + originY, clipX2 - clipX1, clipY2 - clipY1)));
+
+    Vector<std::pair<const Raster*, IntPoint>, 128> placedRasters;
+    placedRasters.reserveInitialCapacity(glyphs.size());
+    IntRect runRect;
+    for (auto& glyph : glyphs) {
+        // Horizontal positions are quantized to a fraction of a pixel, vertical ones are rounded like
+        // cairo's image compositor does.
+        double x = glyph.x + originX;
+        double flooredX = std::floor(x);
+        unsigned subpixelOffset = std::min<unsigned>((x - flooredX) * subpixelPositions, subpixelPositions - 1);
+        IntPoint origin(flooredX, std::floor(glyph.y + originY + 0.5));
+
+        const Raster* raster = rasterForGlyph(scaledFont, glyph.index, subpixelOffset);
+        if (!raster) {
+            prune(m_capacity);
+            ++m_statistics.fallbacks;
+            return false;
+        }
+        if (raster->bounds.isEmpty())
+            continue;
+
+        IntRect glyphRect = raster->bounds;
+        glyphRect.moveBy(origin);
+        if (!glyphRect.intersects(clipRect))
+            continue;
+        runRect.unite(glyphRect);
+        placedRasters.uncheckedAppend({ raster, origin });
+    }
+
+    runRect.intersect(clipRect);
+    if (runRect.isEmpty()) {
+        prune(m_capacity);
+        return true;
+    }
+    if (runRect.width() * runRect.height() > maximumRunArea) {
+        prune(m_capacity);
+        ++m_statistics.fallbacks;
+        return false;
+    }
+
+    // Overlapping glyphs add up their coverage, as they do when cairo composites a run.
+    int stride = cairo_format_stride_for_width(CAIRO_FORMAT_A8, runRect.width());
+    size_t maskSize = stride * runRect.height();
+    if (m_runMask.size() < maskSize)
+        m_runMask.grow(maskSize);
+    memset(m_runMask.data(), 0, maskSize);
+
+    for (auto& placedRaster : placedRasters) {
+        const Raster& raster = *placedRaster.first;
+        IntRect glyphRect = raster.bounds;
+        glyphRect.moveBy(placedRaster.second);
+        IntRect visibleRect = intersection(glyphRect, runRect);
+        if (visibleRect.isEmpty())
+            continue;
+
+        int width = visibleRect.width();
+        for (int y = visibleRect.y(); y < visibleRect.maxY(); ++y) {
+            const uint8_t* source = raster.coverage.data() + (y - glyphRect.y()) * glyphRect.width() + visibleRect.x() - glyphRect.x();
+            uint8_t* destination = m_runMask.data() + (y - runRect.y()) * stride + visibleRect.x() - runRect.x();
+            for (int x = 0; x < width; ++x)
+                destination[x] = std::min(destination[x] + source[x], 255);
+        }
+    }
+
+    RefPtr<cairo_surface_t> mask = adoptRef(cairo_image_surface_create_for_data(m_runMask.data(), CAIRO_FORMAT_A8, runRect.width(), runRect.height(), stride));
+    cairo_mask_surface(cr, mask.get(), runRect.x() - originX, runRect.y() - originY);
+    // The mask's memory is reused by the next run, have cairo copy it if it kept a reference.
+    cairo_surface_finish(mask.get());
+
+    prune(m_capacity);
+    return true;
+}
+
+#ifndef NDEBUG
+// A short vocabulary with the word length distribution of English prose, plus some of the
+// capitalized words, numbers and punctuation that an encyclopedia article is full of.
+static const char* const benchmarkWords[] = {
+    "the", "of", "and", "in", "to", "was", "is", "for", "as", "on", "by", "with", "from", "at", "that", "which",
+    "his", "an", "were", "are", "also", "it", "first", "after", "their", "its", "who", "during", "between", "city",
+    "population", "government", "century", "national", "university", "history", "river", "company", "became",
+    "including", "released", "several", "development", "known", "however", "between", "territory", "published",
+    "Roman", "Empire", "European", "American", "Kingdom", "Republic", "Association", "Church", "Council", "Army",
+    "1848", "1914", "2003", "17th", "12,500", "(born", "1962)", "[1]", "[23]", "[citation needed]", "–", "km²",
+    "Ottoman", "Saint-Étienne", "Dvořák", "Łódź", "naïve", "café"
+};
+
+static unsigned nextBenchmarkRandom(unsigned& seed)
+{
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 16;
+}
+
+static String benchmarkSentence(unsigned& seed)
+{
+    StringBuilder sentence;
+    unsigned wordCount = 8 + nextBenchmarkRandom(seed) % 18;
+    for (unsigned i = 0; i < wordCount; ++i) {
+        String word = String::fromUTF8(benchmarkWords[nextBenchmarkRandom(seed) % WTF_ARRAY_LENGTH(benchmarkWords)]);
+        if (!i)
+            word = makeString(word.substring(0, 1).convertToUppercaseWithoutLocale(), word.substring(1));
+        if (i)
+            sentence.append(nextBenchmarkRandom(seed) % 11 ? " " : ", ");
+        sentence.append(word);
+    }
+    sentence.appendLiteral(". ");
+    return sentence.toString();
+}
+
+static FontCascade benchmarkFont(const char* family, float size, bool bold, bool italic)
+{
+    FontCascadeDescription description;
+    description.setOneFamily(family);
+    description.setSpecifiedSize(size);
+    description.setComputedSize(size);
+    if (bold)
+        description.setWeight(boldWeightValue());
+    description.setIsItalic(italic);
+
+    FontCascade font(WTFMove(description));
+    font.update(nullptr);
+    return font;
+}
+
+String benchmarkTextPainting(unsigned paintCount)
+{
+    static const int viewportWidth = 800;
+    static const int viewportHeight = 600;
+    static const float margin = 20;
+
+    enum { Heading, Subheading, Body, Hatnote, Reference, FontCount };
+    FontCascade fonts[FontCount] = {
+        benchmarkFont("serif", 27, false, false),
+        benchmarkFont("sans-serif", 17, true, false),
+        benchmarkFont("sans-serif", 14, false, false),
+        benchmarkFont("sans-serif", 14, false, true),
+        benchmarkFont("sans-serif", 12, false, false),
+    };
+
+    struct Line {
+        unsigned font;
+        String text;
+        float y;
+    };
+    Vector<Line> lines;
+    float y = margin;
+
+    auto addText = [&](unsigned fontIndex, const String& text) {
+        auto& font = fonts[fontIndex];
+        float lineHeight = font.fontMetrics().lineSpacing();
+        float availableWidth = viewportWidth - 2 * margin;
+        unsigned lineStart = 0;
+        unsigned lastBreak = 0;
+        for (unsigned i = 0; i <= text.length(); ++i) {
+            if (i < text.length() && text[i] != ' ')
+                continue;
+            if (lastBreak > lineStart && font.width(TextRun(StringView(text).substring(lineStart, i - lineStart))) > availableWidth) {
+                y += lineHeight;
+                lines.append({ fontIndex, text.substring(lineStart, lastBreak - lineStart), y });
+                lineStart = lastBreak + 1;
+            }
+            lastBreak = i;
+        }
+        y += lineHeight;
+        lines.append({ fontIndex, text.substring(lineStart), y });
+        y += lineHeight / 2;
+    };
+
+    // About 25 screens of an article: sections of paragraphs, the odd hatnote, then the references.
+    unsigned seed = 1;
+    addText(Heading, "Lorem (historical region)");
+    for (unsigned section = 0; section < 12; ++section) {
+        addText(Subheading, makeString("Section ", section + 1, ": ", benchmarkSentence(seed)));
+        if (!(section % 4))
+            addText(Hatnote, makeString("Main article: ", benchmarkSentence(seed)));
+        for (unsigned paragraph = 0; paragraph < 4; ++paragraph) {
+            StringBuilder text;
+            unsigned sentenceCount = 3 + nextBenchmarkRandom(seed) % 5;
+            for (unsigned i = 0; i < sentenceCount; ++i)
+                text.append(benchmarkSentence(seed));
+            addText(Body, text.toString());
+        }
+    }
+    addText(Subheading, "References");
+    for (unsigned reference = 0; reference < 120; ++reference)
+        addText(Reference, makeString(reference + 1, ". ^ ", benchmarkSentence(seed), "Retrieved 12 March 2019."));
+
+    float documentHeight = y + margin;
+    RefPtr<cairo_surface_t> surface = adoptRef(cairo_image_surface_create(CAIRO_FORMAT_RGB24, viewportWidth, viewportHeight));
+    RefPtr<cairo_t> cr = adoptRef(cairo_create(surface.get()));
+    PlatformContextCairo platformContext(cr.get());
+    GraphicsContext context(&platformContext);
+    context.setFillColor(Color::black);
+
+    auto paint = [&](unsigned index) {
+        // Scroll by an odd amount so that every paint shows a different part of the article.
+        float scrollPosition = (index * 173) % static_cast<unsigned>(documentHeight - viewportHeight);
+        context.fillRect(FloatRect(0, 0, viewportWidth, viewportHeight), Color::white);
+        for (auto& line : lines) {
+            float lineSpacing = fonts[line.font].fontMetrics().lineSpacing();
+            if (line.y + lineSpacing < scrollPosition || line.y - lineSpacing > scrollPosition + viewportHeight)
+                continue;
+            fonts[line.font].drawText(context, TextRun(line.text), FloatPoint(margin, line.y - scrollPosition));
+        }
+    };
+
+    auto& cache = GlyphRasterCache::singleton();
+    unsigned capacity = cache.capacity();
+
+    auto millisecondsPerPaint = [&] {
+        paint(0);
+        MonotonicTime before = MonotonicTime::now();
+        for (unsigned i = 0; i < paintCount; ++i)
+            paint(i);
+        cairo_surface_flush(surface.get());
+        return (MonotonicTime::now() - before).milliseconds() / std::max(paintCount, 1u);
+    };
+
+    cache.setCapacity(0);
+    double uncached = millisecondsPerPaint();
+
+    cache.setCapacity(capacity);
+    auto before = cache.statistics();
+    double cached = millisecondsPerPaint();
+    auto after = cache.statistics();
+
+    return makeString(lines.size(), " lines, ", paintCount, " paints of ", viewportWidth, 'x', viewportHeight,
+        ": cairo ", FormattedNumber::fixedWidth(uncached, 2), " ms, glyph cache ", FormattedNumber::fixedWidth(cached, 2), " ms",
+        " (hits ", after.hits - before.hits, " misses ", after.misses - before.misses, " evictions ", after.evictions - before.evictions,
+        " fallbacks ", after.fallbacks - before.fallbacks, ", ", after.count, " glyphs in ", after.size / 1024, " kB of ", capacity / 1024, " kB)");
+}
+#endif
+
+} // namespace WebCore
+
+#endif // USE(CAIRO)
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#if USE(CAIRO)
+
+#include "Glyph.h"
+#include "IntRect.h"
+#include "RefPtrCairo.h"
+#include <cairo.h>
+#include <wtf/HashMap.h>
+#include <wtf/ListHashSet.h>
+#include <wtf/Lock.h>
+#include <wtf/NeverDestroyed.h>
+#include <wtf/Vector.h>
+#include <wtf/text/WTFString.h>
+
+namespace WebCore {
+
+// Rasterized glyphs shared by every page, keyed by scaled font, glyph and horizontal subpixel offset.
+// The scaled font stands for the font platform data and size, both are fixed when it is created.
+// Runs drawn with an untransformed CTM are composed from the cached coverage masks into a single mask,
+// so that cairo does not have to rasterize them again after its own per font caches were dropped.
+class GlyphRasterCache {
+    WTF_MAKE_NONCOPYABLE(GlyphRasterCache);
+    friend class NeverDestroyed<GlyphRasterCache>;
+public:
+    WEBCORE_EXPORT static GlyphRasterCache& singleton();
+
+    // Returns false when the run has to be drawn by cairo_show_glyphs instead, e.g. for transformed
+    // contexts, color fonts or subpixel antialiasing.
+    bool drawGlyphs(cairo_t*, cairo_scaled_font_t*, const Vector<cairo_glyph_t>&);
+
+    // A capacity of 0 disables the cache.
+    WEBCORE_EXPORT void setCapacity(unsigned bytes);
+    unsigned capacity() const { return m_capacity; }
+    WEBCORE_EXPORT void clear();
+
+    struct Statistics {
+        unsigned hits { 0 };
+        unsigned misses { 0 };
+        unsigned evictions { 0 };
+        unsigned fallbacks { 0 };
+        unsigned size { 0 };
+        unsigned count { 0 };
+    };
+    WEBCORE_EXPORT Statistics statistics();
+
+private:
+    GlyphRasterCache() = default;
+
+    static const unsigned subpixelPositions = 4;
+
+    struct Key {
+        Key() = default;
+        Key(cairo_scaled_font_t* scaledFont, Glyph glyph, unsigned subpixelOffset)
+            : scaledFont(scaledFont)
+            , glyph(glyph)
+            , subpixelOffset(subpixelOffset)
+        {
+        }
+        Key(WTF::HashTableDeletedValueType)
+            : scaledFont(reinterpret_cast<cairo_scaled_font_t*>(-1))
+        {
+        }
+        bool isHashTableDeletedValue() const { return scaledFont == reinterpret_cast<cairo_scaled_font_t*>(-1); }
+        bool operator==(const Key& other) const { return scaledFont == other.scaledFont && glyph == other.glyph && subpixelOffset == other.subpixelOffset; }
+
+        cairo_scaled_font_t* scaledFont { nullptr };
+        Glyph glyph { 0 };
+        unsigned subpixelOffset { 0 };
+    };
+
+    struct KeyHash {
+        static unsigned hash(const Key& key) { return WTF::pairIntHash(PtrHash<cairo_scaled_font_t*>::hash(key.scaledFont), key.glyph * subpixelPositions + key.subpixelOffset); }
+        static bool equal(const Key& a, const Key& b) { return a == b; }
+        static const bool safeToCompareToEmptyOrDeleted = true;
+    };
+
+    struct KeyHashTraits : SimpleClassHashTraits<Key> { };
+
+    struct Raster {
+        // Keeps the font alive so its address can't be reused by another font while it's part of a key.
+        RefPtr<cairo_scaled_font_t> scaledFont;
+        // Coverage relative to the integer glyph origin, one byte per pixel without padding.
+        IntRect bounds;
+        Vector<uint8_t> coverage;
+    };
+
+    static bool canCacheScaledFont(cairo_scaled_font_t*);
+    std::unique_ptr<Raster> rasterize(cairo_scaled_font_t*, Glyph, unsigned subpixelOffset);
+    const Raster* rasterForGlyph(cairo_scaled_font_t*, Glyph, unsigned subpixelOffset);
+    static unsigned cost(const Raster& raster) { return raster.coverage.size() + sizeof(Raster); }
+    void prune(unsigned targetSize);
+
+    Lock m_lock;
+    HashMap<Key, std::unique_ptr<Raster>, KeyHash, KeyHashTraits> m_rasters;
+    ListHashSet<Key, KeyHash> m_order;
+    unsigned m_capacity { 2 * 1024 * 1024 };
+    unsigned m_size { 0 };
+    Statistics m_statistics;
+    Vector<uint8_t> m_runMask;
+};
+
+#ifndef NDEBUG
+// Lays out a long article in a few fonts and paints it scrolling through a window, with and without
+// the glyph raster cache, reporting milliseconds per painted window. Only built into debug builds.
+WEBCORE_EXPORT String benchmarkTextPainting(unsigned paintCount);
+#endif
+
+} // namespace WebCore
+
+#endif // USE(CAIRO)
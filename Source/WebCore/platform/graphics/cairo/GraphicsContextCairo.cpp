@@ -37,6 +37,7 @@
 
 #include "AffineTransform.h"
 #include "CairoOperations.h"
+#include "CairoUtilities.h"
 #include "FloatRect.h"
 #include "FloatRoundedRect.h"
 #include "GraphicsContextImpl.h"
@@ -125,14 +126,20 @@ void GraphicsContext::drawNativeImage(const NativeImagePtr& image, const FloatSi
     if (paintingDisabled())
         return;
 
+    // The image may have been decoded at a fraction of its size, see SubsamplingLevel.
+    FloatRect adjustedSrcRect(srcRect);
+    FloatSize surfaceSize(cairoSurfaceSize(image.get()));
+    if (!imageSize.isEmpty() && surfaceSize != imageSize)
+        adjustedSrcRect.scale(surfaceSize.width() / imageSize.width(), surfaceSize.height() / imageSize.height());
+
     if (m_impl) {
-        m_impl->drawNativeImage(image, imageSize, destRect, srcRect, compositeOperator, blendMode, orientation);
+        m_impl->drawNativeImage(image, imageSize, destRect, adjustedSrcRect, compositeOperator, blendMode, orientation);
         return;
     }
 
     ASSERT(hasPlatformContext());
     auto& state = this->state();
-    Cairo::drawNativeImage(*platformContext(), image.get(), destRect, srcRect, compositeOperator, blendMode, orientation, state.imageInterpolationQuality, state.alpha, Cairo::ShadowState(state));
+    Cairo::drawNativeImage(*platformContext(), image.get(), destRect, adjustedSrcRect, compositeOperator, blendMode, orientation, state.imageInterpolationQuality, state.alpha, Cairo::ShadowState(state));
 }
 
 // This is only used to draw borders, so we should not draw shadows.
@@ -69,6 +69,10 @@ public:
 			m_isPaused = false;
 		}
 
+		m_bytesReceived = 0;
+		m_activeTime = 0_s;
+		m_downloadStarted = m_activeSince = MonotonicTime::now();
+
 		m_request = ResourceRequest(m_url);
 		m_curlRequest = createCurlRequest(m_request);
 		if (m_curlRequest)
@@ -215,6 +219,7 @@ public:
 				}
 			}
 			D(dprintf("%s(%p): resuming...\n", __PRETTY_FUNCTION__, this));
+			m_activeSince = MonotonicTime::now();
 			m_isPaused = false;
 		}
 	}
@@ -329,6 +334,7 @@ public:
 				{
 					auto lock = holdLock(m_bufferLock);
 					m_bufferSize += buffer->size();
+					m_bytesReceived += buffer->size();
 					m_buffer.push(RefPtr<SharedBuffer>(WTFMove(buffer)));
 
 					if (m_bufferSize > m_readAhead && !m_isPaused)
@@ -337,6 +343,7 @@ public:
 						{
 							D(dprintf("%s: suspending...\n", __PRETTY_FUNCTION__));
 							m_curlRequest->suspend();
+							m_activeTime += MonotonicTime::now() - m_activeSince;
 							m_isPaused = true;
 						}
 					}
@@ -356,6 +363,13 @@ public:
 			m_eventSemaphore.signal();
 			m_curlRequest->cancel();
 			m_curlRequest = nullptr;
+
+			if (m_downloadObserver && !m_dead)
+			{
+				auto observer = WTFMove(m_downloadObserver);
+				m_activeTime += MonotonicTime::now() - m_activeSince;
+				observer(m_bytesReceived, m_downloadStarted, m_activeTime);
+			}
 		}
 	}
 	
@@ -389,6 +403,11 @@ protected:
 	bool                             m_didFailLoading = false;
 	bool                             m_isPaused = false;
 	bool                             m_seekProcessed = true;
+	// download accounting for the DownloadObserver
+	uint64_t                         m_bytesReceived = 0;
+	MonotonicTime                    m_downloadStarted;
+	MonotonicTime                    m_activeSince;
+	Seconds                          m_activeTime;
 };
 
 #if 0
@@ -532,6 +551,7 @@ void AcinerellaNetworkBuffer::die()
 		m_provider->deref();
 	m_provider = nullptr;
 	m_dead = true;
+	m_downloadObserver = nullptr;
 	stop();
 }
 
@@ -5,6 +5,7 @@
 #if ENABLE(VIDEO)
 
 #include <wtf/MainThread.h>
+#include <wtf/MonotonicTime.h>
 #include <wtf/NeverDestroyed.h>
 #include <wtf/text/WTFString.h>
 #include <wtf/Function.h>
@@ -52,6 +53,11 @@ public:
 	virtual bool canSeek() { return true; }
 	void die();
 
+	// Called once the whole resource has been received. activeTime excludes the periods the download
+	// was suspended waiting for the reader to catch up
+	using DownloadObserver = Function<void(uint64_t bytes, MonotonicTime started, Seconds activeTime)>;
+	void setDownloadObserver(DownloadObserver&& observer) { m_downloadObserver = WTFMove(observer); }
+
 	virtual bool hasStreamSelection() const { return false; }
 	virtual double initialTimeStamp() const { return .0; }
 
@@ -71,6 +77,7 @@ protected:
     int64_t                                        m_length;
     int                                            m_readAhead;
     bool                                           m_dead = false;
+	DownloadObserver                               m_downloadObserver;
 };
 
 class AcinerellaNetworkFileRequest : public ThreadSafeRefCounted<AcinerellaNetworkFileRequest>
@@ -167,7 +167,7 @@ void Acinerella::watchdogTimerFired()
 		if (m_videoDecoder)
 		{
 			auto *vd = static_cast<AcinerellaVideoDecoder*>(m_videoDecoder.get());
-			m_client->accSetFrameCounts(vd->decodedFrameCount(), vd->droppedFrameCount());
+			m_client->accSetFrameCounts(vd->decodedFrameCount(), vd->droppedFrameCount(), vd->lateFrameCount(), vd->totalFrameDelay());
 		}
 	}
 }
@@ -209,7 +209,7 @@ String Acinerella::referrer()
 
 void Acinerella::selectStream()
 {
-	HLSStreamInfo selected;
+	Vector<HLSStreamInfo> selected;
 	auto *hls = static_cast<AcinerellaNetworkBufferHLS*>(m_networkBuffer.get());
 
 #if OS(MORPHOS)
@@ -244,22 +244,16 @@ void Acinerella::selectStream()
 		if (!codecsOK)
 			continue;
 
-		if (!selected.m_url.length())
-		{
-			selected = info;
-		}
-		// try to pick the best bandwidth stream among the ones we have not ruled out already!
-		else if (selected.m_bandwidth < info.m_bandwidth)
-		{
-			selected = info;
-		}
+		// every stream we have not ruled out is a candidate, the network buffer picks among them as bandwidth allows
+		selected.append(info);
 	}
 	
-	if (selected.m_url.length())
+	if (selected.size())
 	{
-		DINIT(dprintf("HLS stream selected: %dx%d\n", selected.m_width, selected.m_height));
-		DINIT(for (const auto &codec : selected.m_codecs) { dprintf("\t\tcodec: %s\n", codec.utf8().data()); });
-		hls->selectStream(selected);
+		DINIT(for (const auto &info : selected) { dprintf("HLS stream candidate: %dx%d bw %d\n", info.m_width, info.m_height, info.m_bandwidth); });
+		hls->selectStreams(WTFMove(selected));
+		DINIT(dprintf("HLS stream selected: %dx%d\n", hls->selectedStream().m_width, hls->selectedStream().m_height));
+		DINIT(for (const auto &codec : hls->selectedStream().m_codecs) { dprintf("\t\tcodec: %s\n", codec.utf8().data()); });
 	}
 }
 
@@ -515,6 +509,7 @@ bool Acinerella::initialize()
 				if (-1 != videoIndex)
 				{
 					ac_get_stream_info(acinerella->instance(), videoIndex, &info);
+					AcinerellaVideoDecoder::configureThreading(acinerella->instance(), streamSettings());
 					acinerella->setDecoder(videoIndex, ac_create_decoder(acinerella->instance(), videoIndex));
 					DINIT(dprintf("video decoder: %p\n", acinerella->decoder(videoIndex)));
 					m_videoDecoder = AcinerellaVideoDecoder::create(this, acinerella, m_muxer, videoIndex, info, m_isLive);
@@ -688,7 +683,10 @@ void Acinerella::initializeAfterDiscontinuity()
 				acinerella->setDecoder(audioIndex, ac_create_decoder(acinerella->instance(), audioIndex));
 			
 			if (-1 != videoIndex)
+			{
+				AcinerellaVideoDecoder::configureThreading(acinerella->instance(), streamSettings());
 				acinerella->setDecoder(videoIndex, ac_create_decoder(acinerella->instance(), videoIndex));
+			}
 			
 			{
 				auto lock = holdLock(m_acinerellaLock);
@@ -189,6 +189,7 @@ bool AcinerellaDecoder::decodeNextFrame()
 				if (pts < m_dropToPTS)
 				{
 					m_needsKF = true; // dropped frames - we'll need a keyframe!
+					m_skippedFrameCount++;
 					ac_flush_buffers(decoder);
 					return true;
 				}
@@ -197,6 +198,7 @@ bool AcinerellaDecoder::decodeNextFrame()
 					m_droppingUntilKeyFrame = true;
 					m_droppingFrames = false;
 					m_needsKF = false;
+					m_skippedFrameCount++;
 					return true;
 				}
 				else
@@ -212,6 +214,7 @@ bool AcinerellaDecoder::decodeNextFrame()
 				}
 				else
 				{
+					m_skippedFrameCount++;
 					return true;
 				}
 			}
@@ -184,6 +184,7 @@ protected:
 	bool                               m_droppingUntilKeyFrame = false;
 	bool                               m_needsKF = false;
 	double                             m_dropToPTS;
+	unsigned                           m_skippedFrameCount = 0;
 };
 
 }
@@ -3,6 +3,7 @@
 #if ENABLE(VIDEO)
 
 #include <proto/exec.h>
+#include <cmath>
 
 namespace WebCore {
 namespace Acinerella {
@@ -233,6 +234,115 @@ double HLSStream::initialTimeStamp() const
 	return 0.0;
 }
 
+void HLSStream::switchVariant(HLSStream& variant, int64_t lastMediaSequence)
+{
+	while (!m_chunks.empty())
+		m_chunks.pop();
+
+	// variants of a presentation share their media sequence numbering
+	m_mediaSequence = lastMediaSequence;
+
+	while (!variant.m_chunks.empty())
+	{
+		if (variant.m_chunks.front().m_mediaSequence > lastMediaSequence)
+		{
+			m_mediaSequence = variant.m_chunks.front().m_mediaSequence;
+			m_chunks.emplace(WTFMove(variant.m_chunks.front()));
+		}
+
+		variant.m_chunks.pop();
+	}
+
+	m_ended = variant.m_ended;
+
+	if (variant.m_targetDuration > 0)
+		m_targetDuration = variant.m_targetDuration;
+}
+
+void HLSThroughputEstimator::EWMA::sample(double weight, double value)
+{
+	double alpha = std::pow(0.5, weight / m_halfLife);
+	m_estimate = value * (1.0 - alpha) + alpha * m_estimate;
+	m_totalWeight += weight;
+}
+
+double HLSThroughputEstimator::EWMA::value() const
+{
+	// the estimate starts at 0, undo that bias while only few samples went in
+	double zeroFactor = 1.0 - std::pow(0.5, m_totalWeight / m_halfLife);
+	return m_estimate / zeroFactor;
+}
+
+void HLSThroughputEstimator::addSample(uint64_t bytes, Seconds downloadTime)
+{
+	if (bytes < minimumSampleBytes || downloadTime <= 0_s)
+		return;
+
+	double bitsPerSecond = double(bytes) * 8.0 / downloadTime.value();
+	m_fast.sample(downloadTime.value(), bitsPerSecond);
+	m_slow.sample(downloadTime.value(), bitsPerSecond);
+	m_totalBytes += bytes;
+}
+
+void HLSThroughputEstimator::reset()
+{
+	m_fast = EWMA(m_fast.m_halfLife);
+	m_slow = EWMA(m_slow.m_halfLife);
+	m_totalBytes = 0;
+}
+
+double HLSThroughputEstimator::estimate() const
+{
+	if (!hasEstimate())
+		return defaultEstimate;
+	return std::min(m_fast.value(), m_slow.value());
+}
+
+size_t HLSAdaptiveController::highestVariantFor(const Vector<HLSStreamInfo> &variants, double bandwidth) const
+{
+	size_t index = 0;
+	for (size_t i = 1; i < variants.size(); i++)
+	{
+		if (double(variants[i].m_bandwidth) <= bandwidth)
+			index = i;
+	}
+	return index;
+}
+
+size_t HLSAdaptiveController::initialVariant(const Vector<HLSStreamInfo> &variants, const HLSThroughputEstimator &estimator) const
+{
+	return highestVariantFor(variants, estimator.estimate() * sustainableFactor);
+}
+
+size_t HLSAdaptiveController::nextVariant(const Vector<HLSStreamInfo> &variants, size_t current, const HLSThroughputEstimator &estimator,
+	double bufferedDuration, double chunkDuration, bool stalled)
+{
+	if (variants.size() < 2 || current >= variants.size())
+		return current;
+
+	m_chunksSinceSwitch++;
+
+	double estimate = estimator.estimate();
+
+	// ran dry: get down quick, even if the estimate lags behind
+	size_t sustainable = highestVariantFor(variants, estimate * (stalled ? panicFactor : sustainableFactor));
+	if (sustainable < current)
+	{
+		m_chunksSinceSwitch = 0;
+		return sustainable;
+	}
+
+	if (current + 1 < variants.size() && m_chunksSinceSwitch >= upswitchHoldChunks
+		&& bufferedDuration >= chunkDuration * upswitchBufferedChunks
+		&& double(variants[current + 1].m_bandwidth) <= estimate * upswitchFactor)
+	{
+		m_chunksSinceSwitch = 0;
+		return current + 1;
+	}
+
+	return current;
+}
+
 AcinerellaNetworkBufferHLS::AcinerellaNetworkBufferHLS(AcinerellaNetworkBufferResourceLoaderProvider *resourceProvider, const String &url, size_t readAhead)
 	: AcinerellaNetworkBuffer(resourceProvider, url, readAhead)
 	, m_playlistRefreshTimer(RunLoop::current(), this, &AcinerellaNetworkBufferHLS::refreshTimerFired)
@@ -278,18 +388,21 @@ void AcinerellaNetworkBufferHLS::stop()
 	if (m_hlsRequest)
 		m_hlsRequest->cancel();
 	m_hlsRequest = nullptr;
-	
-	if (m_chunkRequest)
-		m_chunkRequest->stop();
+	m_pendingVariant = WTF::notFound;
+
+	std::deque<ChunkRequest> chunkRequests;
 
 	{
 		auto lock = holdLock(m_lock);
-		m_chunkRequest = nullptr;
+		chunkRequests.swap(m_chunkRequests);
 		
 		if (m_chunkRequestInRead)
 			m_chunkRequestInRead->die();
 	}
 
+	for (auto &chunk : chunkRequests)
+		chunk.m_request->die();
+
 	m_event.signal();
 
 	D(dprintf("%s(%p) killing old chunks\n", __func__, this));
@@ -320,8 +433,11 @@ void AcinerellaNetworkBufferHLS::masterPlaylistReceived(bool succ)
 			{
 				m_provider->selectStream();
 				D(dprintf("%s(%p): selected %dx%d %s \n", __func__, this, m_selectedStream.m_width, m_selectedStream.m_height, m_selectedStream.m_url.utf8().data()));
-				m_hlsRequest = AcinerellaNetworkFileRequest::create(m_selectedStream.m_url, [this](bool succ) { childPlaylistReceived(succ); });
-				return;
+				if (m_selectedStream.m_url.length())
+				{
+					m_hlsRequest = AcinerellaNetworkFileRequest::create(m_selectedStream.m_url, [this](bool succ) { childPlaylistReceived(succ); });
+					return;
+				}
 			}
 		}
 	}
@@ -331,15 +447,26 @@ void AcinerellaNetworkBufferHLS::masterPlaylistReceived(bool succ)
 	m_hlsRequest = nullptr;
 }
 
-void AcinerellaNetworkBufferHLS::selectStream(const HLSStreamInfo &stream)
+void AcinerellaNetworkBufferHLS::selectStreams(Vector<HLSStreamInfo>&& streams)
 {
-	m_selectedStream = stream;
+	m_variants = WTFMove(streams);
+	std::stable_sort(m_variants.begin(), m_variants.end(), [](const HLSStreamInfo &a, const HLSStreamInfo &b) {
+		return a.m_bandwidth < b.m_bandwidth;
+	});
+
+	if (m_variants.isEmpty())
+		return;
+
+	m_selectedVariant = m_controller.initialVariant(m_variants, m_throughput);
+	m_selectedStream = m_variants[m_selectedVariant];
 }
 
 // main thread
 void AcinerellaNetworkBufferHLS::childPlaylistReceived(bool succ)
 {
 	D(dprintf("%s(%p) \n", __func__, this));
+	bool switched = false;
+
 	if (succ && m_hlsRequest)
 	{
 		auto buffer = m_hlsRequest->buffer();
@@ -347,30 +474,32 @@ void AcinerellaNetworkBufferHLS::childPlaylistReceived(bool succ)
 
 		if (buffer && buffer->size())
 		{
-			HLSStream stream(m_baseURL, String::fromUTF8(buffer->data(), buffer->size()));
-			m_stream += stream; // append and merge :)
-			
-			D(dprintf("%s(%p) queue %d mediaseq %llu %d cr %p\n", __func__, this, m_stream.size(), m_stream.mediaSequence(), m_stream.empty(), m_chunkRequest.get()));
-			// start loading chunks!
-			if (!m_stream.empty() && !m_chunkRequest)
+			bool switching = m_pendingVariant != WTF::notFound;
+			const auto &playlistURL = switching ? m_variants[m_pendingVariant].m_url : m_selectedStream.m_url;
+			HLSStream stream(URL({}, playlistURL), String::fromUTF8(buffer->data(), buffer->size()));
+
+			if (switching)
 			{
-				D(dprintf("%s(%p) chunk '%s' duration %f\n", __func__, this, m_stream.current().m_url.utf8().data(), m_stream.current().m_duration));
-				auto chunkRequest = AcinerellaNetworkBuffer::createDisregardingFileType(m_provider, m_stream.current().m_url);
-				m_stream.pop();
-				
-				{
-					auto lock = holdLock(m_lock);
-					m_chunkRequest = chunkRequest;
-				}
-				
-				chunkRequest->start();
-				
-				// wake up the ::read
-				m_event.signal();
+				m_selectedVariant = m_pendingVariant;
+				m_selectedStream = m_variants[m_selectedVariant];
+				m_pendingVariant = WTF::notFound;
+				m_stream.switchVariant(stream, m_lastRequestedSequence);
+				switched = true;
+				D(dprintf("%s(%p) switched to %dx%d bw %d, estimate %f\n", __func__, this, m_selectedStream.m_width, m_selectedStream.m_height, m_selectedStream.m_bandwidth, m_throughput.estimate()));
+			}
+			else
+			{
+				m_stream += stream; // append and merge :)
 			}
+			
+			D(dprintf("%s(%p) queue %d mediaseq %llu %d\n", __func__, this, m_stream.size(), m_stream.mediaSequence(), m_stream.empty()));
 		}
 	}
 
+	// a failed switch keeps loading from the current variant
+	bool switchFailed = m_pendingVariant != WTF::notFound;
+	m_pendingVariant = WTF::notFound;
+
 	double duration = m_stream.targetDuration();
 	if (duration <= 1.0 && !m_stream.empty())
 		duration = std::min(m_stream.current().m_duration, duration);
@@ -391,6 +520,9 @@ void AcinerellaNetworkBufferHLS::childPlaylistReceived(bool succ)
 	if (m_hlsRequest)
 		m_hlsRequest->cancel();
 	m_hlsRequest = nullptr;
+
+	// start loading chunks! no need to reconsider the variant right after a switch
+	requestChunks(!switched && !switchFailed);
 }
 
 // main thread
@@ -399,13 +531,14 @@ void AcinerellaNetworkBufferHLS::refreshTimerFired()
 	D(dprintf("%s(%p) \n", __func__, this));
 	if (m_hlsRequest)
 		m_hlsRequest->cancel();
-	m_hlsRequest = AcinerellaNetworkFileRequest::create(m_selectedStream.m_url, [this](bool succ) { childPlaylistReceived(succ); });
+	const auto &url = m_pendingVariant != WTF::notFound ? m_variants[m_pendingVariant].m_url : m_selectedStream.m_url;
+	m_hlsRequest = AcinerellaNetworkFileRequest::create(url, [this](bool succ) { childPlaylistReceived(succ); });
 }
 
 // main thread
 void AcinerellaNetworkBufferHLS::chunkSwallowed()
 {
-	D(dprintf("%s(%p): cr %p streams %d\n", __func__, this, m_chunkRequest.get(), m_stream.size()));
+	D(dprintf("%s(%p): streams %d\n", __func__, this, m_stream.size()));
 
 	{
 		auto lock = holdLock(m_lock);
@@ -416,22 +549,120 @@ void AcinerellaNetworkBufferHLS::chunkSwallowed()
 		}
 	}
 
-	if (!m_stream.empty())
+	requestChunks();
+}
+
+// main thread
+void AcinerellaNetworkBufferHLS::requestChunks(bool allowSwitch)
+{
+	bool didStart = false;
+
+	while (!m_stopping && !m_stream.empty())
 	{
-		auto chunkRequest = AcinerellaNetworkBuffer::createDisregardingFileType(m_provider, m_stream.current().m_url);
-		D(dprintf("%s(%p): load '%s' queue %d -> cr %p\n", __func__, this, m_stream.current().m_url.utf8().data(), m_stream.size(), chunkRequest.get()));
+		{
+			auto lock = holdLock(m_lock);
+			if (m_chunkRequests.size() >= maxPrefetchedChunks)
+				break;
+		}
+
+		// chunk boundary, see if we should continue from another variant
+		if (allowSwitch)
+			switchVariantIfNeeded();
+
+		if (m_pendingVariant != WTF::notFound)
+			break;
+
+		const auto &chunk = m_stream.current();
+
+		// let prefetched chunks download in whole rather than stall on the read ahead limit
+		size_t expectedSize = size_t(double(m_selectedStream.m_bandwidth) / 8.0 * chunk.m_duration * 1.5);
+		size_t readAhead = std::max(size_t(m_readAhead), std::min(expectedSize, size_t(8 * 1024 * 1024)));
+
+		auto chunkRequest = AcinerellaNetworkBuffer::createDisregardingFileType(m_provider, chunk.m_url, readAhead);
+		D(dprintf("%s(%p): load '%s' queue %d -> cr %p\n", __func__, this, chunk.m_url.utf8().data(), m_stream.size(), chunkRequest.get()));
+
+		AcinerellaNetworkBuffer *chunkRequestPtr = chunkRequest.get();
+		chunkRequest->setDownloadObserver([this, chunkRequestPtr](uint64_t bytes, MonotonicTime started, Seconds activeTime) {
+			chunkDownloaded(chunkRequestPtr, bytes, started, activeTime);
+		});
+
+		double duration = chunk.m_duration;
+		m_lastRequestedSequence = chunk.m_mediaSequence;
 		m_stream.pop();
-		
+
 		{
 			auto lock = holdLock(m_lock);
-			m_chunkRequest = chunkRequest;
+			m_chunkRequests.push_back({ chunkRequest, duration, false });
 		}
-		
+
 		chunkRequest->start();
-		
-		// wake up the ::read
+		didStart = true;
+		allowSwitch = true;
+	}
+
+	// wake up the ::read
+	if (didStart)
 		m_event.signal();
+}
+
+// main thread
+void AcinerellaNetworkBufferHLS::chunkDownloaded(AcinerellaNetworkBuffer *chunk, uint64_t bytes, MonotonicTime started, Seconds activeTime)
+{
+	{
+		auto lock = holdLock(m_lock);
+		for (auto &request : m_chunkRequests)
+		{
+			if (request.m_request.get() == chunk)
+			{
+				request.m_downloaded = true;
+				break;
+			}
+		}
+	}
+
+	// chunks load in parallel, only credit this one with the time since the previous one completed
+	// so the overlapping part isn't counted twice
+	auto now = MonotonicTime::now();
+	Seconds downloadTime = std::min(activeTime, now - std::max(started, m_lastDownloadFinished));
+	m_lastDownloadFinished = now;
+
+	m_throughput.addSample(bytes, downloadTime);
+	D(dprintf("%s(%p): %llu bytes in %f, estimate %f\n", __func__, this, bytes, downloadTime.value(), m_throughput.estimate()));
+}
+
+// main thread
+void AcinerellaNetworkBufferHLS::switchVariantIfNeeded()
+{
+	if (m_variants.size() < 2 || m_pendingVariant != WTF::notFound)
+		return;
+
+	double buffered = 0;
+	bool stalled;
+
+	{
+		auto lock = holdLock(m_lock);
+		for (const auto &chunk : m_chunkRequests)
+		{
+			if (chunk.m_downloaded)
+				buffered += chunk.m_duration;
+		}
+		stalled = m_stalled;
+		m_stalled = false;
 	}
+
+	double chunkDuration = m_stream.empty() ? m_stream.targetDuration() : m_stream.current().m_duration;
+	size_t variant = m_controller.nextVariant(m_variants, m_selectedVariant, m_throughput, buffered, chunkDuration, stalled);
+	if (variant == m_selectedVariant)
+		return;
+
+	D(dprintf("%s(%p): %d -> %d, buffered %f stalled %d estimate %f\n", __func__, this, int(m_selectedVariant), int(variant), buffered, stalled, m_throughput.estimate()));
+
+	// chunks continue once the playlist of the new variant is in
+	m_pendingVariant = variant;
+	m_playlistRefreshTimer.stop();
+	if (m_hlsRequest)
+		m_hlsRequest->cancel();
+	m_hlsRequest = AcinerellaNetworkFileRequest::create(m_variants[variant].m_url, [this](bool succ) { childPlaylistReceived(succ); });
 }
 
 int64_t AcinerellaNetworkBufferHLS::length()
@@ -469,7 +700,7 @@ int AcinerellaNetworkBufferHLS::read(uint8_t *outBuffer, int size, int64_t readP
 
 				{
 					auto lock = holdLock(m_lock);
-					ended = m_stream.empty() && m_stream.ended();
+					ended = m_chunkRequests.empty() && m_stream.empty() && m_stream.ended();
 					m_chunksRequestPreviouslyRead.emplace(m_chunkRequestInRead);
 					m_chunkRequestInRead = nullptr;
 					DIO(dprintf("%s(%p): discontinuity, ended %d \n", __PRETTY_FUNCTION__, this, ended));
@@ -487,8 +718,15 @@ int AcinerellaNetworkBufferHLS::read(uint8_t *outBuffer, int size, int64_t readP
 
 		{
 			auto lock = holdLock(m_lock);
-			m_chunkRequestInRead = m_chunkRequest;
-			m_chunkRequest = nullptr;
+			if (!m_chunkRequests.empty())
+			{
+				// reaching a chunk that is still loading means we've run out of prefetched data
+				if (m_didReadChunk && !m_chunkRequests.front().m_downloaded)
+					m_stalled = true;
+				m_chunkRequestInRead = m_chunkRequests.front().m_request;
+				m_chunkRequests.pop_front();
+				m_didReadChunk = true;
+			}
 			needsToWait = m_chunkRequestInRead.get() == nullptr;
 			DIO(dprintf("%s(%p): chunk swapped to %p needswait %d\n", __PRETTY_FUNCTION__, this, m_chunkRequestInRead.get(), needsToWait));
 		}
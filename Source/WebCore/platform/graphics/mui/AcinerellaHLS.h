@@ -7,6 +7,7 @@
 #include "AcinerellaBuffer.h"
 #include <wtf/RunLoop.h>
 #include <wtf/URL.h>
+#include <deque>
 
 namespace WebCore {
 
@@ -49,6 +50,9 @@ public:
 	int64_t initialMediaSequence() const { return m_initialMediaSequence; }
 	double initialTimeStamp() const;
 
+	// Replaces the queued chunks with the ones of another variant, continuing after lastMediaSequence
+	void switchVariant(HLSStream& variant, int64_t lastMediaSequence);
+
 protected:
 	std::queue<HLSChunk> m_chunks;
 	int64_t              m_mediaSequence = -1;
@@ -57,6 +61,67 @@ protected:
 	bool                 m_ended = false;
 };
 
+// Estimates the network throughput from completed chunk downloads. Keeps a fast and a slow exponentially
+// weighted moving average (weighted by download time) and reports the lower one, so a single quick
+// download won't cause an upswitch while a sudden drop is picked up right away.
+class HLSThroughputEstimator
+{
+public:
+	void addSample(uint64_t bytes, Seconds downloadTime);
+	void reset();
+
+	bool hasEstimate() const { return m_totalBytes >= minimumTotalBytes; }
+	// bits per second
+	double estimate() const;
+
+	static constexpr double defaultEstimate = 1000000.0;
+
+protected:
+	struct EWMA
+	{
+		EWMA(double halfLife) : m_halfLife(halfLife) { }
+		void sample(double weight, double value);
+		double value() const;
+
+		double m_halfLife;
+		double m_estimate = 0;
+		double m_totalWeight = 0;
+	};
+
+	// tiny downloads are dominated by request latency and would drag the estimate down
+	static constexpr uint64_t minimumSampleBytes = 16 * 1024;
+	static constexpr uint64_t minimumTotalBytes = 128 * 1024;
+
+	EWMA     m_fast { 2.0 };
+	EWMA     m_slow { 5.0 };
+	uint64_t m_totalBytes = 0;
+};
+
+// Picks the variant to load the next chunk from. Variants must be sorted by bandwidth, lowest first.
+// Downswitches happen as soon as the estimate no longer covers the current variant; upswitches go one
+// step at a time and only once enough chunks are buffered ahead and the previous switch has settled.
+class HLSAdaptiveController
+{
+public:
+	size_t initialVariant(const Vector<HLSStreamInfo> &variants, const HLSThroughputEstimator &estimator) const;
+	size_t nextVariant(const Vector<HLSStreamInfo> &variants, size_t current, const HLSThroughputEstimator &estimator,
+		double bufferedDuration, double chunkDuration, bool stalled);
+
+protected:
+	size_t highestVariantFor(const Vector<HLSStreamInfo> &variants, double bandwidth) const;
+
+	// fractions of the estimated throughput a variant may use
+	static constexpr double sustainableFactor = 0.85;
+	static constexpr double upswitchFactor = 0.7;
+	static constexpr double panicFactor = 0.5;
+	// buffered chunks needed before moving up
+	static constexpr double upswitchBufferedChunks = 1.5;
+	// chunk boundaries to stay on a variant before moving up again
+	static constexpr unsigned upswitchHoldChunks = 3;
+
+	unsigned m_chunksSinceSwitch = 0;
+};
+
 class AcinerellaNetworkBufferHLS : public AcinerellaNetworkBuffer
 {
 public:
@@ -74,9 +139,13 @@ public:
 	int64_t position() override;
 
 	const Vector<HLSStreamInfo>& streams() const { return m_streams; }
-	void selectStream(const HLSStreamInfo &stream);
+	// Variants the player is willing to play, adaptively switched between at chunk boundaries
+	void selectStreams(Vector<HLSStreamInfo>&& streams);
 	bool hasStreamSelection() const override { return true; }
 
+	const HLSStreamInfo &selectedStream() const { return m_selectedStream; }
+	double throughputEstimate() const { return m_throughput.estimate(); }
+
 	double initialTimeStamp() const override { return m_stream.initialTimeStamp(); }
 
 protected:
@@ -87,14 +156,37 @@ protected:
 	void refreshTimerFired();
 	void chunkSwallowed();
 
+	void requestChunks(bool allowSwitch = true);
+	void chunkDownloaded(AcinerellaNetworkBuffer *chunk, uint64_t bytes, MonotonicTime started, Seconds activeTime);
+	void switchVariantIfNeeded();
+
+	struct ChunkRequest
+	{
+		RefPtr<AcinerellaNetworkBuffer> m_request;
+		double                          m_duration;
+		bool                            m_downloaded;
+	};
+
+	// chunks loaded in parallel ahead of the one being read
+	static constexpr size_t maxPrefetchedChunks = 2;
+
 protected:
 	RunLoop::Timer<AcinerellaNetworkBufferHLS>  m_playlistRefreshTimer;
-	RefPtr<AcinerellaNetworkBuffer>             m_chunkRequest;
+	std::deque<ChunkRequest>                    m_chunkRequests;
 	RefPtr<AcinerellaNetworkBuffer>             m_chunkRequestInRead;
 	std::queue<RefPtr<AcinerellaNetworkBuffer>> m_chunksRequestPreviouslyRead;
 	RefPtr<AcinerellaNetworkFileRequest>        m_hlsRequest;
 	Vector<HLSStreamInfo>                       m_streams;
+	Vector<HLSStreamInfo>                       m_variants;
 	HLSStreamInfo                               m_selectedStream;
+	size_t                                      m_selectedVariant = 0;
+	size_t                                      m_pendingVariant = WTF::notFound;
+	int64_t                                     m_lastRequestedSequence = -1;
+	HLSThroughputEstimator                      m_throughput;
+	HLSAdaptiveController                       m_controller;
+	MonotonicTime                               m_lastDownloadFinished;
+	bool                                        m_stalled = false;
+	bool                                        m_didReadChunk = false;
 	BinarySemaphore                             m_event;
 	HLSStream                                   m_stream;
 	Lock                                        m_lock;
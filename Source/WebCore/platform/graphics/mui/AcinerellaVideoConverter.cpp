@@ -0,0 +1,306 @@
+#include "AcinerellaVideoConverter.h"
+
+#if ENABLE(VIDEO)
+
+#include <libavcodec/avcodec.h>
+#include <cairo.h>
+#include <wtf/MonotonicTime.h>
+#include <wtf/text/StringConcatenateNumbers.h>
+
+#if CPU(X86_SSE2)
+#include <emmintrin.h>
+#elif CPU(ARM_NEON) && !CPU(BIG_ENDIAN)
+#include <arm_neon.h>
+#define ACINERELLA_NEON 1
+#endif
+
+namespace WebCore {
+namespace Acinerella {
+
+// BT.601 limited range coefficients in 6 bit fixed point, small enough for the SIMD kernels to stay
+// within saturating 16 bit lanes
+static const int16_t kY  = 75;  // 1.164
+static const int16_t kRV = 102; // 1.596
+static const int16_t kGU = 25;  // 0.391
+static const int16_t kGV = 52;  // 0.813
+static const int16_t kBU = 129; // 2.018
+
+static inline uint32_t clampToByte(int value)
+{
+	return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+static void convertRowScalar(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t *dst, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		int c = (y[i] - 16) * kY + 32;
+		int d = u[i] - 128;
+		int e = v[i] - 128;
+
+		dst[i] = (clampToByte((c + kRV * e) >> 6) << 16)
+			| (clampToByte((c - kGU * d - kGV * e) >> 6) << 8)
+			| clampToByte((c + kBU * d) >> 6);
+	}
+}
+
+#if CPU(X86_SSE2)
+static void convertRow(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t *dst, int count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i yOffset = _mm_set1_epi16(16);
+	const __m128i uvOffset = _mm_set1_epi16(128);
+	const __m128i rounding = _mm_set1_epi16(32);
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i yy = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(y + i)), zero);
+		__m128i uu = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + i)), zero), uvOffset);
+		__m128i vv = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + i)), zero), uvOffset);
+		__m128i c = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(yy, yOffset), _mm_set1_epi16(kY)), rounding);
+
+		__m128i r = _mm_adds_epi16(c, _mm_mullo_epi16(vv, _mm_set1_epi16(kRV)));
+		__m128i g = _mm_subs_epi16(_mm_subs_epi16(c, _mm_mullo_epi16(uu, _mm_set1_epi16(kGU))), _mm_mullo_epi16(vv, _mm_set1_epi16(kGV)));
+		__m128i b = _mm_adds_epi16(c, _mm_mullo_epi16(uu, _mm_set1_epi16(kBU)));
+
+		r = _mm_packus_epi16(_mm_srai_epi16(r, 6), zero);
+		g = _mm_packus_epi16(_mm_srai_epi16(g, 6), zero);
+		b = _mm_packus_epi16(_mm_srai_epi16(b, 6), zero);
+
+		// B G R 0 in memory is xRGB on little endian
+		__m128i bg = _mm_unpacklo_epi8(b, g);
+		__m128i r0 = _mm_unpacklo_epi8(r, zero);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi16(bg, r0));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 4), _mm_unpackhi_epi16(bg, r0));
+	}
+
+	convertRowScalar(y + i, u + i, v + i, dst + i, count - i);
+}
+
+const char *yuv420ConversionKernel()
+{
+	return "sse2";
+}
+#elif ACINERELLA_NEON
+static void convertRow(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t *dst, int count)
+{
+	const int16x8_t yOffset = vdupq_n_s16(16);
+	const int16x8_t uvOffset = vdupq_n_s16(128);
+	const int16x8_t rounding = vdupq_n_s16(32);
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		int16x8_t yy = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + i)));
+		int16x8_t uu = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + i))), uvOffset);
+		int16x8_t vv = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + i))), uvOffset);
+		int16x8_t c = vaddq_s16(vmulq_n_s16(vsubq_s16(yy, yOffset), kY), rounding);
+
+		int16x8_t r = vqaddq_s16(c, vmulq_n_s16(vv, kRV));
+		int16x8_t g = vqsubq_s16(vqsubq_s16(c, vmulq_n_s16(uu, kGU)), vmulq_n_s16(vv, kGV));
+		int16x8_t b = vqaddq_s16(c, vmulq_n_s16(uu, kBU));
+
+		uint8x8x4_t pixels;
+		pixels.val[0] = vqshrun_n_s16(b, 6);
+		pixels.val[1] = vqshrun_n_s16(g, 6);
+		pixels.val[2] = vqshrun_n_s16(r, 6);
+		pixels.val[3] = vdup_n_u8(0);
+		vst4_u8(reinterpret_cast<uint8_t *>(dst + i), pixels);
+	}
+
+	convertRowScalar(y + i, u + i, v + i, dst + i, count - i);
+}
+
+const char *yuv420ConversionKernel()
+{
+	return "neon";
+}
+#else
+static void convertRow(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t *dst, int count)
+{
+	convertRowScalar(y, u, v, dst, count);
+}
+
+const char *yuv420ConversionKernel()
+{
+	return "scalar";
+}
+#endif
+
+void convertYUV420ToRGB32(const AcinerellaYUV420Planes &src, uint8_t *dst, int dstStride, int dstWidth, int dstHeight)
+{
+	if (src.width <= 0 || src.height <= 0 || dstWidth <= 0 || dstHeight <= 0)
+		return;
+
+	// Source column of every output pixel, sampled at the pixel centers
+	bool scaleX = dstWidth != src.width;
+	Vector<int> lumaX(dstWidth);
+	uint32_t xStep = (uint32_t(src.width) << 16) / dstWidth;
+	uint32_t xPos = xStep >> 1;
+	for (int x = 0; x < dstWidth; x++, xPos += xStep)
+		lumaX[x] = scaleX ? std::min(src.width - 1, int(xPos >> 16)) : x;
+
+	Vector<uint8_t> lines(dstWidth * 3);
+	uint8_t *yLine = lines.data();
+	uint8_t *uLine = yLine + dstWidth;
+	uint8_t *vLine = uLine + dstWidth;
+
+	uint32_t yStep = (uint32_t(src.height) << 16) / dstHeight;
+	uint32_t yPos = yStep >> 1;
+	int lastRow = -1;
+	int lastChromaRow = -1;
+	uint8_t *lastOut = nullptr;
+
+	for (int dy = 0; dy < dstHeight; dy++, yPos += yStep)
+	{
+		int row = std::min(src.height - 1, int(yPos >> 16));
+		uint8_t *out = dst + dy * dstStride;
+
+		// Upscaling repeats rows, copy the one we already converted
+		if (row == lastRow)
+		{
+			memcpy(out, lastOut, dstWidth * 4);
+			continue;
+		}
+
+		const uint8_t *yRow = src.y + row * src.yStride;
+		if (scaleX)
+		{
+			for (int x = 0; x < dstWidth; x++)
+				yLine[x] = yRow[lumaX[x]];
+			yRow = yLine;
+		}
+
+		int chromaRow = row >> 1;
+		if (chromaRow != lastChromaRow)
+		{
+			const uint8_t *uRow = src.u + chromaRow * src.uStride;
+			const uint8_t *vRow = src.v + chromaRow * src.vStride;
+			for (int x = 0; x < dstWidth; x++)
+			{
+				uLine[x] = uRow[lumaX[x] >> 1];
+				vLine[x] = vRow[lumaX[x] >> 1];
+			}
+			lastChromaRow = chromaRow;
+		}
+
+		convertRow(yRow, uLine, vLine, reinterpret_cast<uint32_t *>(out), dstWidth);
+		lastRow = row;
+		lastOut = out;
+	}
+}
+
+AcinerellaVideoSurface::~AcinerellaVideoSurface()
+{
+	clear();
+}
+
+bool AcinerellaVideoSurface::canConvert(const AVFrame *frame)
+{
+	// YUVJ420P is full range and would come out with crushed contrast, leave it to swscale
+	return frame && frame->format == AV_PIX_FMT_YUV420P && frame->data[0] && frame->data[1] && frame->data[2]
+		&& frame->linesize[0] > 0 && frame->linesize[1] > 0 && frame->linesize[2] > 0;
+}
+
+cairo_surface_t *AcinerellaVideoSurface::update(const AVFrame *frame, int width, int height)
+{
+	if (!canConvert(frame) || width <= 0 || height <= 0)
+		return nullptr;
+
+	if (!m_surface || m_width != width || m_height != height)
+	{
+		clear();
+
+		m_surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+		if (cairo_surface_status(m_surface) != CAIRO_STATUS_SUCCESS)
+		{
+			clear();
+			return nullptr;
+		}
+
+		m_width = width;
+		m_height = height;
+	}
+
+	AcinerellaYUV420Planes planes = { frame->data[0], frame->data[1], frame->data[2],
+		frame->linesize[0], frame->linesize[1], frame->linesize[2], frame->width, frame->height };
+
+	cairo_surface_flush(m_surface);
+	convertYUV420ToRGB32(planes, cairo_image_surface_get_data(m_surface), cairo_image_surface_get_stride(m_surface), width, height);
+	cairo_surface_mark_dirty(m_surface);
+
+	return m_surface;
+}
+
+void AcinerellaVideoSurface::clear()
+{
+	if (m_surface)
+		cairo_surface_destroy(m_surface);
+	m_surface = nullptr;
+	m_width = m_height = 0;
+}
+
+#ifndef NDEBUG
+static double conversionFramesPerSecond(const AcinerellaYUV420Planes &planes, Vector<uint8_t> &output, int width, int height, unsigned frameCount)
+{
+	MonotonicTime start = MonotonicTime::now();
+	for (unsigned i = 0; i < frameCount; i++)
+		convertYUV420ToRGB32(planes, output.data(), width * 4, width, height);
+	Seconds elapsed = MonotonicTime::now() - start;
+
+	return elapsed.value() > 0 ? frameCount / elapsed.value() : 0;
+}
+
+String benchmarkYUV420Conversion(unsigned frameCount)
+{
+	static const struct { const char *name; int width; int height; } sizes[] = {
+		{ "720p", 1280, 720 },
+		{ "1080p", 1920, 1080 },
+	};
+
+	String result = makeString("kernel: ", yuv420ConversionKernel());
+
+	for (auto &size : sizes)
+	{
+		int chromaWidth = (size.width + 1) / 2;
+		int chromaHeight = (size.height + 1) / 2;
+		Vector<uint8_t> y(size.width * size.height);
+		Vector<uint8_t> u(chromaWidth * chromaHeight);
+		Vector<uint8_t> v(chromaWidth * chromaHeight);
+
+		// Gradients rather than a flat color so that every clamp path gets exercised
+		for (int row = 0; row < size.height; row++)
+			for (int x = 0; x < size.width; x++)
+				y[row * size.width + x] = (x + row) & 0xff;
+		for (int row = 0; row < chromaHeight; row++)
+		{
+			for (int x = 0; x < chromaWidth; x++)
+			{
+				u[row * chromaWidth + x] = (x * 2) & 0xff;
+				v[row * chromaWidth + x] = (row * 2) & 0xff;
+			}
+		}
+
+		AcinerellaYUV420Planes planes = { y.data(), u.data(), v.data(), size.width, chromaWidth, chromaWidth, size.width, size.height };
+
+		// Typical inline player size for the scaled case
+		int scaledWidth = (size.width * 2 / 3) & -2;
+		int scaledHeight = size.height * 2 / 3;
+		Vector<uint8_t> output(size.width * size.height * 4);
+
+		double native = conversionFramesPerSecond(planes, output, size.width, size.height, frameCount);
+		double scaled = conversionFramesPerSecond(planes, output, scaledWidth, scaledHeight, frameCount);
+
+		result = makeString(result, ' ', size.name, ": ", FormattedNumber::fixedWidth(native, 1), " fps",
+			" scaled to ", scaledWidth, 'x', scaledHeight, ": ", FormattedNumber::fixedWidth(scaled, 1), " fps");
+	}
+
+	return result;
+}
+#endif
+
+}
+}
+
+#endif
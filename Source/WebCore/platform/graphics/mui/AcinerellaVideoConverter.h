@@ -0,0 +1,64 @@
+#pragma once
+
+#include "config.h"
+
+#if ENABLE(VIDEO)
+
+#include <wtf/Vector.h>
+#include <wtf/text/WTFString.h>
+
+typedef struct _cairo_surface cairo_surface_t;
+struct AVFrame;
+
+namespace WebCore {
+namespace Acinerella {
+
+struct AcinerellaYUV420Planes
+{
+	const uint8_t *y;
+	const uint8_t *u;
+	const uint8_t *v;
+	int            yStride;
+	int            uStride;
+	int            vStride;
+	int            width;
+	int            height;
+};
+
+// Converts a YUV420P picture to cairo's RGB24 layout (xRGB in native endianess), scaling it to
+// dstWidth x dstHeight on the way with point sampling. Uses SSE2 or NEON when available.
+void convertYUV420ToRGB32(const AcinerellaYUV420Planes &src, uint8_t *dst, int dstStride, int dstWidth, int dstHeight);
+
+// Name of the conversion kernel compiled in, for diagnostics
+const char *yuv420ConversionKernel();
+
+// Keeps a cairo image surface to present decoded frames without a hardware overlay. The surface is only
+// reallocated when the presentation size changes.
+class AcinerellaVideoSurface
+{
+public:
+	AcinerellaVideoSurface() = default;
+	~AcinerellaVideoSurface();
+
+	static bool canConvert(const AVFrame *frame);
+
+	// Returns the surface holding the frame scaled to width x height, or nullptr on failure. Owned by this object.
+	cairo_surface_t *update(const AVFrame *frame, int width, int height);
+	void clear();
+
+protected:
+	cairo_surface_t *m_surface = nullptr;
+	int              m_width = 0;
+	int              m_height = 0;
+};
+
+#ifndef NDEBUG
+// Converts synthetic 720p and 1080p frames at their own size and scaled, reporting frames per second.
+// Only built into debug builds.
+String benchmarkYUV420Conversion(unsigned frameCount);
+#endif
+
+}
+}
+
+#endif
@@ -1,6 +1,7 @@
 #define SYSTEM_PRIVATE
 #include "AcinerellaVideoDecoder.h"
 #include "AcinerellaContainer.h"
+#include "MediaPlayerMorphOS.h"
 
 #if ENABLE(VIDEO)
 
@@ -15,6 +16,7 @@
 #include <libavformat/avformat.h>
 
 #include <cairo.h>
+#include <wtf/NumberOfCores.h>
 
 #include <proto/intuition.h>
 #include <intuition/intuition.h>
@@ -115,7 +117,16 @@ void AcinerellaVideoDecoder::onDecoderChanged(RefPtr<AcinerellaPointer> acinerel
 #if (CAIRO_BLIT)
 	ac_set_output_format(decoder, AC_OUTPUT_RGBA32);
 #endif
-    ac_decoder_set_loopfilter(decoder, int(m_client->streamSettings().m_loopFilter));
+	applyLateFramePolicy();
+}
+
+void AcinerellaVideoDecoder::configureThreading(ac_instance *instance, const MediaPlayerMorphOSStreamSettings &settings)
+{
+	// FFmpeg won't auto-detect more than 16 threads either
+	int threads = settings.m_decoderThreads > 0 ? settings.m_decoderThreads : std::min(WTF::numberOfProcessorCores(), 16);
+	int type = (settings.m_frameThreading ? AC_THREAD_FRAME : 0) | (settings.m_sliceThreading ? AC_THREAD_SLICE : 0);
+
+	ac_set_decoder_threads(instance, threads, threads > 1 ? type : 0);
 }
 
 bool AcinerellaVideoDecoder::isReadyToPlay() const
@@ -145,7 +156,7 @@ void AcinerellaVideoDecoder::startPlaying()
 	{
 		m_playing = true;
 		onPositionChanged();
-        ac_decoder_set_loopfilter(m_lastDecoder, int(m_client->streamSettings().m_loopFilter));
+		applyLateFramePolicy();
 		m_pullEvent.signal();
 		m_frameEvent.signal();
 	}
@@ -220,6 +231,78 @@ void AcinerellaVideoDecoder::dumpStatus()
 		isWarmedUp(), isReadyToPlay(), isPlaying(), float(bufferSize()), float(position()), m_didShowFirstFrame, m_decodedFrames.size(), m_isLive);
 }
 
+void AcinerellaVideoDecoder::updateLateFramePolicy(double lateness, double pts)
+{
+	if (lateness > m_frameDuration * 0.1)
+	{
+		m_lateFrameCount++;
+		m_totalFrameDelay += lateness;
+		m_lateStreak++;
+		m_onTimeStreak = 0;
+	}
+	else
+	{
+		m_onTimeStreak++;
+		m_lateStreak = 0;
+	}
+
+	// Escalate after a quarter of a second worth of late frames, step back after two seconds on time
+	unsigned escalateAfter = std::max(2, int(m_fps / 4));
+	unsigned relaxAfter = std::max(2, int(m_fps * 2));
+	auto maxPolicy = m_canDropKeyFrames ? LateFramePolicy::SkipToKeyFrame : LateFramePolicy::SkipNonReferenceFrames;
+	auto policy = m_latePolicy;
+
+	if (m_lateStreak >= escalateAfter)
+	{
+		m_lateStreak = 0;
+		if (policy < maxPolicy)
+			policy = LateFramePolicy(int(policy) + 1);
+
+		if (policy == LateFramePolicy::SkipToKeyFrame)
+		{
+			// Throw away the rest of the GOP, decoding resumes at the first key frame past where we should be
+			double dropTo = pts + lateness + readAheadTime();
+			DSYNC(dprintf("\033[36m[VD]%s: late by %f, skipping to key frame after %f\033[0m\n", __func__, float(lateness), float(dropTo)));
+			dispatch([this, dropTo]() {
+				dropUntilPTS(dropTo);
+			});
+		}
+	}
+	else if (m_onTimeStreak >= relaxAfter && policy != LateFramePolicy::None)
+	{
+		m_onTimeStreak = 0;
+		policy = LateFramePolicy(int(policy) - 1);
+	}
+
+	if (policy != m_latePolicy)
+	{
+		DSYNC(dprintf("\033[36m[VD]%s: late frame policy %d -> %d\033[0m\n", __func__, int(m_latePolicy), int(policy)));
+		m_latePolicy = policy;
+		dispatch([this, policy]() {
+			m_appliedLatePolicy = policy;
+			applyLateFramePolicy();
+		});
+	}
+}
+
+void AcinerellaVideoDecoder::applyLateFramePolicy()
+{
+	if (!m_lastDecoder || !m_client)
+		return;
+
+	using SkipLoopFilter = MediaPlayerMorphOSStreamSettings::SkipLoopFilter;
+	auto loopFilter = m_client->streamSettings().m_loopFilter;
+	auto skipFrame = SkipLoopFilter::Default;
+
+	if (m_appliedLatePolicy >= LateFramePolicy::SkipLoopFilter)
+		loopFilter = SkipLoopFilter::All;
+	if (m_appliedLatePolicy >= LateFramePolicy::SkipNonReferenceFrames)
+		skipFrame = SkipLoopFilter::NonRef;
+
+	ac_decoder_set_loopfilter(m_lastDecoder, int(loopFilter));
+	ac_decoder_set_skipframe(m_lastDecoder, int(skipFrame));
+}
+
 void AcinerellaVideoDecoder::setAudioPresentationTime(double apts)
 {
 	DSYNC(dprintf("\033[35m[VD]%s: %p -> %f\033[0m\n", __func__, this, float(apts)));
@@ -407,9 +490,42 @@ void AcinerellaVideoDecoder::updateOverlayCoords()
 #endif
 }
 
+bool AcinerellaVideoDecoder::paintFrameLocked(GraphicsContext& gc, const FloatRect& rect)
+{
+	if (!m_decodedFrames.size())
+		return false;
+
+	int width = rect.width();
+	int height = rect.height();
+	auto *surface = m_softwareSurface.update(ac_get_frame_real(m_decodedFrames.front().frame()), width, height);
+	if (!surface)
+		return false;
+
+	cairo_t* cr = gc.platformContext()->cr();
+	cairo_save(cr);
+	cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+	// same as the swscale path: integer coords and no rounded-edge clip keep this a plain blit
+	cairo_translate(cr, (int)rect.x(), (int)rect.y());
+	cairo_rectangle(cr, 0, 0, width, height);
+	cairo_reset_clip(cr);
+	cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+	cairo_set_source_surface(cr, surface, 0, 0);
+	cairo_fill(cr);
+	cairo_restore(cr);
+	return true;
+}
+
 void AcinerellaVideoDecoder::paint(GraphicsContext& gc, const FloatRect& rect)
 {
 #if (CGX_OVERLAY)
+	if (!m_overlayHandle)
+	{
+		// No overlay (yet), show the frame in the page instead of the color key
+		auto lock = holdLock(m_lock);
+		paintFrameLocked(gc, rect);
+		return;
+	}
+
 	WebCore::PlatformContextCairo *context = gc.platformContext();
 	cairo_t* cr = context->cr();
 	cairo_save(cr);
@@ -431,80 +547,13 @@ void AcinerellaVideoDecoder::paint(GraphicsContext& gc, const FloatRect& rect)
 		m_client->onDecoderRenderUpdate(makeRef(*this));
 	}
 
-#if 0
-// ?!? WE cannot paint since the data is in planar yuv or some other cgxvideo format
-
-	EP_SCOPE(paint);
-
-	auto lock = holdLock(m_lock);
-	if (m_decodedFrames.size())
-	{
-		MonotonicTime mtStart = MonotonicTime::now();
-	
-		const auto *frame = m_decodedFrames.front().frame();
-		WebCore::PlatformContextCairo *context = gc.platformContext();
-		cairo_t* cr = context->cr();
-		auto *avFrame = ac_get_frame(m_decodedFrames.front().pointer()->decoder(m_index));
-		// CAIRO_FORMAT_RGB24 is actually 00RRGGBB on BigEndian
-
-		if (rect.width() == m_frameWidth && rect.height() == m_frameHeight)
-		{
-			auto surface = cairo_image_surface_create_for_data(avFrame->data[0], CAIRO_FORMAT_RGB24, m_frameWidth, m_frameHeight, avFrame->linesize[0]);
-			if (surface)
-			{
-				cairo_save(cr);
-				cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-				cairo_translate(cr, rect.x(), rect.y());
-				cairo_rectangle(cr, 0, 0, rect.width(), rect.height());
-				cairo_clip(cr);
-				cairo_set_source_surface(cr, surface, 0, 0);
-				cairo_paint(cr);
-				cairo_restore(cr);
-				cairo_surface_destroy(surface);
-			}
-		}
-		else
-		{
-			auto surface = cairo_image_surface_create_for_data(avFrame->data[0], CAIRO_FORMAT_RGB24, m_frameWidth, m_frameHeight, avFrame->linesize[0]);
-			if (surface)
-			{
-				cairo_save(cr);
-				cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-				cairo_translate(cr, rect.x(), rect.y());
-				cairo_rectangle(cr, 0, 0, rect.width(), rect.height());
-				cairo_pattern_t *pattern = cairo_pattern_create_for_surface(surface);
-				if (pattern)
-				{
-					cairo_matrix_t matrix;
-					cairo_matrix_init_scale(&matrix, double(m_frameWidth) / rect.width(), double(m_frameHeight) / rect.height());
-					cairo_pattern_set_matrix(pattern, &matrix);
-					cairo_pattern_set_filter(pattern, CAIRO_FILTER_FAST);
-					cairo_set_source(cr, pattern);
-					cairo_clip(cr);
-					cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
-					cairo_paint(cr);
-					cairo_pattern_destroy(pattern);
-				}
-				cairo_restore(cr);
-				cairo_surface_destroy(surface);
-			}
-		}
-		
-		MonotonicTime mtEnd = MonotonicTime::now();
-		Seconds decodingTime = (mtEnd - mtStart);
-
-		m_accumulatedCairoCount ++;
-		m_accumulatedCairoTime += decodingTime;
-
-		if (m_accumulatedCairoCount % int(m_fps))
-			D(dprintf("\033[35m[VD]%s: paint time %f, avg %f\033[0m\n", __func__, float(decodingTime.value()),
-				float(m_accumulatedCairoTime.value() / float(m_accumulatedCairoCount))));
-				
-	}
-#endif
 #endif
 #if (CAIRO_BLIT)
 	auto lock = holdLock(m_lock);
+	if (paintFrameLocked(gc, rect))
+		return;
+
+	// Formats the software path does not handle go through swscale
 	if (m_decodedFrames.size())
 	{
 		WebCore::PlatformContextCairo *context = gc.platformContext();
@@ -774,7 +823,7 @@ void AcinerellaVideoDecoder::pullThreadEntryPoint()
 			while (m_playing && !m_terminating)
 			{
 				Seconds sleepFor = 0_s;
-				double pts;
+				double pts = 0;
 
 				// Grab time point (disregarding time it takes to swap vlayer buffers)
 				auto timeDisplayed = MonotonicTime::now();
@@ -909,6 +958,9 @@ void AcinerellaVideoDecoder::pullThreadEntryPoint()
 					m_pullEvent.waitFor(5_s);
 				}
 
+				if (m_playing && !m_terminating)
+					updateLateFramePolicy(-sleepFor.value(), pts);
+
 				if (sleepFor.value() > 0.0)
 				{
 					if (sleepFor.value() > 1.0)
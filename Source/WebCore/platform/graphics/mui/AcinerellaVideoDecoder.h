@@ -5,6 +5,7 @@
 #if ENABLE(VIDEO)
 
 #include "AcinerellaDecoder.h"
+#include "AcinerellaVideoConverter.h"
 struct VLayerHandle;
 struct Window;
 struct Library;
@@ -55,7 +56,12 @@ public:
 	void dumpStatus() override;
 
 	unsigned decodedFrameCount() const { return m_frameCount - m_droppedFrameCount; }
-	unsigned droppedFrameCount() const { return m_droppedFrameCount; }
+	unsigned droppedFrameCount() const { return m_droppedFrameCount + m_skippedFrameCount; }
+	unsigned lateFrameCount() const { return m_lateFrameCount; }
+	double totalFrameDelay() const { return m_totalFrameDelay; }
+
+	// Configures FFmpeg threading for the video decoders created on the instance from now on
+	static void configureThreading(ac_instance *instance, const MediaPlayerMorphOSStreamSettings &settings);
 
 protected:
 	void startPlaying() override;
@@ -73,10 +79,25 @@ protected:
 
 	void pullThreadEntryPoint();
 	void blitFrameLocked();
+	bool paintFrameLocked(GraphicsContext&, const FloatRect&);
 	void showFirstFrame(bool lock);
 	
 	void updateOverlayCoords();
 
+	// Steps taken in turn while the pump keeps presenting frames late, and undone once it catches up
+	enum class LateFramePolicy
+	{
+		None,
+		SkipLoopFilter,
+		SkipNonReferenceFrames,
+		SkipToKeyFrame
+	};
+
+	// call from: pull thread
+	void updateLateFramePolicy(double lateness, double pts);
+	// call from: Own thread
+	void applyLateFramePolicy();
+
 	bool getAudioPresentationTime(double &time);
 
 protected:
@@ -103,6 +124,13 @@ protected:
 	MonotonicTime   m_audioPositionRealTime;
 	bool            m_hasAudioPosition = false;
 	
+	LateFramePolicy m_latePolicy = LateFramePolicy::None;
+	LateFramePolicy m_appliedLatePolicy = LateFramePolicy::None;
+	unsigned        m_lateStreak = 0;
+	unsigned        m_onTimeStreak = 0;
+	unsigned        m_lateFrameCount = 0;
+	double          m_totalFrameDelay = 0.0;
+
 	bool            m_fakeDecode = false;
 	bool            m_canDropKeyFrames = false;
 	bool            m_didShowFirstFrame = false;
@@ -113,6 +141,7 @@ protected:
 	int             m_windowWidth, m_windowHeight;
 	int             m_visibleWidth, m_visibleHeight;
 	
+	AcinerellaVideoSurface m_softwareSurface;
 	uint32_t               m_overlayFillColor = 0;
 #if (CGX_OVERLAY)
 	struct ::VLayerHandle *m_overlayHandle = nullptr;
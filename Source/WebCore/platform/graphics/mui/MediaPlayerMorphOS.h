@@ -45,7 +45,12 @@ struct MediaPlayerMorphOSStreamSettings
         All
     };
 
-    SkipLoopFilter m_loopFilter = SkipLoopFilter::All;
+    SkipLoopFilter m_loopFilter = SkipLoopFilter::Default;
+
+    // FFmpeg video decoding threads: 0 uses one per CPU core, 1 disables threading
+    int  m_decoderThreads = 0;
+    bool m_frameThreading = true;
+    bool m_sliceThreading = true;
 };
 
 struct MediaPlayerMorphOSSettings
@@ -61,6 +66,9 @@ public:
 	Function<bool(WebCore::Page *page, const String &host)> m_supportVP9ForHost;
 	Function<bool(WebCore::Page *page, const String &host)> m_supportHVCForHost;
 
+	// Copied into the stream settings of every new player
+	MediaPlayerMorphOSStreamSettings m_defaultStreamSettings;
+
 	Function<void(WebCore::MediaPlayer *player, const String &url,
 		MediaPlayerMorphOSInfo &info, MediaPlayerMorphOSStreamSettings &settings,
 		Function<void()> &&yieldFunc)> m_load;
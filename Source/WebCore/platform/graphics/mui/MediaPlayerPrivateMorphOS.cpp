@@ -32,6 +32,32 @@ MediaPlayerMorphOSSettings &MediaPlayerMorphOSSettings::settings()
 	return m_playerSettings;
 }
 
+void setVideoDecoderThreading(int threads, bool frameThreading, bool sliceThreading)
+{
+	MediaPlayerMorphOSStreamSettings &defaults = MediaPlayerMorphOSSettings::settings().m_defaultStreamSettings;
+	defaults.m_decoderThreads = threads;
+	defaults.m_frameThreading = frameThreading;
+	defaults.m_sliceThreading = sliceThreading;
+}
+
+// Frame counts of all players since startup
+static unsigned s_decodedFrameTotal;
+static unsigned s_droppedFrameTotal;
+static unsigned s_lateFrameTotal;
+
+void videoFrameStatistics(unsigned& decoded, unsigned& dropped, unsigned& late)
+{
+	decoded = s_decodedFrameTotal;
+	dropped = s_droppedFrameTotal;
+	late = s_lateFrameTotal;
+}
+
+// Per player counts restart from zero when the decoder is recreated
+static inline unsigned frameCountDelta(unsigned count, unsigned previous)
+{
+	return count >= previous ? count - previous : count;
+}
+
 class MediaPlayerFactoryMediaSourceMorphOS {
 public:
 #if 0
@@ -259,6 +285,7 @@ public:
 
 MediaPlayerPrivateMorphOS::MediaPlayerPrivateMorphOS(MediaPlayer* player)
 	: m_player(player)
+	, m_streamSettings(MediaPlayerMorphOSSettings::settings().m_defaultStreamSettings)
 {
 	notImplemented();
 }
@@ -591,8 +618,10 @@ bool MediaPlayerPrivateMorphOS::paused() const
 Optional<VideoPlaybackQualityMetrics> MediaPlayerPrivateMorphOS::videoPlaybackQualityMetrics()
 {
 	VideoPlaybackQualityMetrics metrics;
-	metrics.totalVideoFrames = m_decodedFrameCount;
+	// total counts the frames we would have shown had none been dropped
+	metrics.totalVideoFrames = m_decodedFrameCount + m_droppedFrameCount;
 	metrics.droppedVideoFrames = m_droppedFrameCount;
+	metrics.totalFrameDelay = m_totalFrameDelay;
 	return metrics;
 }
 
@@ -695,10 +724,16 @@ bool MediaPlayerPrivateMorphOS::accCodecSupported(const String &codec)
 	return MediaPlayerFactoryMediaSourceMorphOS::s_supportsTypeAndCodecs(parameters) == MediaPlayer::SupportsType::IsSupported;
 }
 
-void MediaPlayerPrivateMorphOS::accSetFrameCounts(unsigned decoded, unsigned dropped)
+void MediaPlayerPrivateMorphOS::accSetFrameCounts(unsigned decoded, unsigned dropped, unsigned late, double totalDelay)
 {
+	s_decodedFrameTotal += frameCountDelta(decoded, m_decodedFrameCount);
+	s_droppedFrameTotal += frameCountDelta(dropped, m_droppedFrameCount);
+	s_lateFrameTotal += frameCountDelta(late, m_lateFrameCount);
+
 	m_decodedFrameCount = decoded;
 	m_droppedFrameCount = dropped;
+	m_lateFrameCount = late;
+	m_totalFrameDelay = totalDelay;
 }
 
 bool MediaPlayerPrivateMorphOS::didLoadingProgress() const
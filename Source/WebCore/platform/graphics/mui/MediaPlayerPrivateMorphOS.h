@@ -55,6 +55,7 @@ public:
 
     unsigned decodedFrameCount() const { return m_decodedFrameCount; }
     unsigned droppedFrameCount() const { return m_droppedFrameCount; }
+    unsigned lateFrameCount() const { return m_lateFrameCount; }
 
 	float maxTimeSeekable() const final;
     float currentTime() const final { return m_currentTime; }
@@ -98,7 +99,7 @@ public:
 	void accNoFramesReady() override;
 	void accFrameUpdateNeeded() override;
 	bool accCodecSupported(const String &codec) override;
-	void accSetFrameCounts(unsigned decoded, unsigned dropped) override;
+	void accSetFrameCounts(unsigned decoded, unsigned dropped, unsigned late, double totalDelay) override;
 	void setSize(const IntSize&) override;
 
 	void setLoadingProgresssed(bool flag) { m_didLoadingProgress = flag; }
@@ -124,6 +125,8 @@ protected:
 	bool  m_didDrawFrame = false;
 	unsigned m_decodedFrameCount = 0;
 	unsigned m_droppedFrameCount = 0;
+	unsigned m_lateFrameCount = 0;
+	double   m_totalFrameDelay = 0.0;
 	mutable bool  m_didLoadingProgress = false;
 
 #if ENABLE(MEDIA_SOURCE)
@@ -710,17 +710,20 @@ void MediaSourceBufferPrivateMorphOS::dumpStatus()
 	dprintf("\033[36m[MSB%p]: -- \033[0m\n", this);
 }
 
-void MediaSourceBufferPrivateMorphOS::getFrameCounts(unsigned& decoded, unsigned &dropped) const
+void MediaSourceBufferPrivateMorphOS::getFrameCounts(unsigned& decoded, unsigned &dropped, unsigned &late, double &totalDelay) const
 {
 	Acinerella::AcinerellaVideoDecoder *decoder = static_cast<Acinerella::AcinerellaVideoDecoder *>(m_paintingDecoder.get());
 	if (decoder)
 	{
 		decoded = decoder->decodedFrameCount();
 		dropped = decoder->droppedFrameCount();
+		late = decoder->lateFrameCount();
+		totalDelay = decoder->totalFrameDelay();
 	}
 	else
 	{
-		decoded = dropped = 0;
+		decoded = dropped = late = 0;
+		totalDelay = 0.0;
 	}
 }
 
@@ -911,6 +914,7 @@ void MediaSourceBufferPrivateMorphOS::initialize(bool success,
 		{
 		case AC_STREAM_TYPE_VIDEO:
 			DM(dprintf("video stream: %dx%d\n", info.additional_info.video_info.frame_width, info.additional_info.video_info.frame_height));
+			Acinerella::AcinerellaVideoDecoder::configureThreading(acinerella->instance(), streamSettings());
 			acinerella->setDecoder(i, ac_create_decoder(acinerella->instance(), i));
 			m_decoders[i] = Acinerella::AcinerellaVideoDecoder::create(this, acinerella, m_muxer, i, info, false);
 			if (!!m_decoders[i])
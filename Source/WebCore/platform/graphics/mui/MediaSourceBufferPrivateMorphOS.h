@@ -127,7 +127,7 @@ public:
     void onTrackEnabled(int index, bool enabled);
     void dumpStatus();
 
-	void getFrameCounts(unsigned& decoded, unsigned &dropped) const;
+	void getFrameCounts(unsigned& decoded, unsigned &dropped, unsigned &late, double &totalDelay) const;
 
 private:
 	explicit MediaSourceBufferPrivateMorphOS(MediaSourcePrivateMorphOS*);
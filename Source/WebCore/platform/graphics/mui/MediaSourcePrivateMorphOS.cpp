@@ -192,9 +192,10 @@ void MediaSourcePrivateMorphOS::watchdogTimerFired()
 		m_player->accSetPosition(m_position);
 		if (!!m_paintingBuffer)
 		{
-			unsigned decoded, dropped;
-			m_paintingBuffer->getFrameCounts(decoded, dropped);
-			m_player->accSetFrameCounts(decoded, dropped);
+			unsigned decoded, dropped, late;
+			double totalDelay;
+			m_paintingBuffer->getFrameCounts(decoded, dropped, late, totalDelay);
+			m_player->accSetFrameCounts(decoded, dropped, late, totalDelay);
 		}
 	}
 	
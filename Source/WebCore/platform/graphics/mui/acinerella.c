@@ -68,6 +68,9 @@ struct _ac_data {
 	uint8_t *probe_buffer;
 	size_t probe_buffer_size;
 	size_t probe_buffer_offs;
+
+	int thread_count;
+	int thread_type;
 };
 
 typedef struct _ac_data ac_data;
@@ -745,6 +748,13 @@ static void *ac_create_video_decoder(lp_ac_instance pacInstance,
 	ERR(pDecoder->pCodec =
 	          avcodec_find_decoder(pDecoder->pCodecCtx->codec_id));
 
+	// Threaded decoding, left at the codec defaults unless configured
+	if (self->thread_count > 0) {
+		pCodecCtx->thread_count = self->thread_count;
+		pCodecCtx->thread_type = ((self->thread_type & AC_THREAD_FRAME) ? FF_THREAD_FRAME : 0) |
+		                         ((self->thread_type & AC_THREAD_SLICE) ? FF_THREAD_SLICE : 0);
+	}
+
 	// Open codec
 	AV_ERR(avcodec_open2(pDecoder->pCodecCtx, pDecoder->pCodec, NULL));
 
@@ -780,9 +790,34 @@ error:
 	return NULL;
 }
 
+// Levels as in MediaPlayerMorphOSStreamSettings::SkipLoopFilter
+static enum AVDiscard ac_discard_level(int level)
+{
+	switch (level) {
+		case 1: return AVDISCARD_NONREF;
+		case 2: return AVDISCARD_BIDIR;
+		case 3: return AVDISCARD_NONINTRA;
+		case 4: return AVDISCARD_NONKEY;
+		case 5: return AVDISCARD_ALL;
+	}
+	return AVDISCARD_DEFAULT;
+}
+
 void ac_decoder_set_loopfilter(lp_ac_decoder pDecoder, int lflevel)
 {
-    ((lp_ac_video_decoder)pDecoder)->pCodecCtx->skip_loop_filter = lflevel;
+    ((lp_ac_video_decoder)pDecoder)->pCodecCtx->skip_loop_filter = ac_discard_level(lflevel);
+}
+
+void ac_decoder_set_skipframe(lp_ac_decoder pDecoder, int skiplevel)
+{
+    ((lp_ac_video_decoder)pDecoder)->pCodecCtx->skip_frame = ac_discard_level(skiplevel);
+}
+
+void CALL_CONVT ac_set_decoder_threads(lp_ac_instance pacInstance, int thread_count, int thread_type)
+{
+	lp_ac_data self = (lp_ac_data)pacInstance;
+	self->thread_count = thread_count;
+	self->thread_type = thread_type;
 }
 
 int ac_get_audio_rate(lp_ac_decoder pDecoder)
@@ -559,6 +559,17 @@ EXTERN double ac_get_package_duration(lp_ac_instance pacInstance, lp_ac_package
 
 EXTERN void ac_decoder_fake_seek(lp_ac_decoder pDecoder);
 EXTERN void ac_decoder_set_loopfilter(lp_ac_decoder pDecoder, int lflevel);
+EXTERN void ac_decoder_set_skipframe(lp_ac_decoder pDecoder, int skiplevel);
+
+#define AC_THREAD_FRAME 1
+#define AC_THREAD_SLICE 2
+
+/**
+ * Sets the number of threads and the AC_THREAD_* threading modes used by
+ * video decoders created for this instance from now on. A thread_count of 1
+ * decodes on the calling thread only.
+ */
+EXTERN void CALL_CONVT ac_set_decoder_threads(lp_ac_instance pacInstance, int thread_count, int thread_type);
 #ifdef __cplusplus
 } //end extern "C"
 #endif
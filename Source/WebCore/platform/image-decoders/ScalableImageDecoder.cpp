@@ -215,13 +215,12 @@ bool ScalableImageDecoder::frameHasAlphaAtIndex(size_t index) const
     return frame.hasAlpha();
 }
 
-unsigned ScalableImageDecoder::frameBytesAtIndex(size_t index, SubsamplingLevel) const
+unsigned ScalableImageDecoder::frameBytesAtIndex(size_t index, SubsamplingLevel subsamplingLevel) const
 {
     LockHolder lockHolder(m_mutex);
     if (m_frameBufferCache.size() <= index)
         return 0;
-    // FIXME: Use the dimension of the requested frame.
-    return (m_size.area() * sizeof(uint32_t)).unsafeGet();
+    return (frameSizeAtIndex(index, subsamplingLevel).area() * sizeof(uint32_t)).unsafeGet();
 }
 
 Seconds ScalableImageDecoder::frameDurationAtIndex(size_t index) const
@@ -247,13 +246,16 @@ Seconds ScalableImageDecoder::frameDurationAtIndex(size_t index) const
     return duration;
 }
 
-NativeImagePtr ScalableImageDecoder::createFrameImageAtIndex(size_t index, SubsamplingLevel, const DecodingOptions&)
+NativeImagePtr ScalableImageDecoder::createFrameImageAtIndex(size_t index, SubsamplingLevel subsamplingLevel, const DecodingOptions&)
 {
     LockHolder lockHolder(m_mutex);
     // Zero-height images can cause problems for some ports. If we have an empty image dimension, just bail.
     if (size().isEmpty())
         return nullptr;
 
+    if (frameAllowSubsamplingAtIndex(index))
+        setSubsamplingLevel(subsamplingLevel);
+
     auto* buffer = frameBufferAtIndex(index);
     if (!buffer || buffer->isInvalid() || !buffer->hasBackingStore())
         return nullptr;
@@ -263,6 +265,14 @@ NativeImagePtr ScalableImageDecoder::createFrameImageAtIndex(size_t index, Subsa
     return buffer->backingStore()->image();
 }
 
+Optional<IntRect> ScalableImageDecoder::takeChangedRectOfFrameAtIndex(size_t index)
+{
+    LockHolder lockHolder(m_mutex);
+    if (index >= m_frameBufferCache.size())
+        return IntRect();
+    return m_frameBufferCache[index].takeChangedRect();
+}
+
 void ScalableImageDecoder::prepareScaleDataIfNecessary()
 {
     m_scaled = false;
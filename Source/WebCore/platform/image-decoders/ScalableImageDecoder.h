@@ -197,6 +197,13 @@ public:
     Optional<IntPoint> hotSpot() const override { return WTF::nullopt; }
 
 protected:
+    // Called before decoding a frame for decoders that allow subsampling. Decoding at another level
+    // than the frame buffers hold has to start over.
+    virtual void setSubsamplingLevel(SubsamplingLevel) { }
+
+    // For decoders marking the rows they write, see ScalableImageDecoderFrame::addChangedRows().
+    Optional<IntRect> takeChangedRectOfFrameAtIndex(size_t);
+
     void prepareScaleDataIfNecessary();
     int upperBoundScaledX(int origX, int searchStart = 0);
     int lowerBoundScaledX(int origX, int searchStart = 0);
@@ -54,6 +54,8 @@ ScalableImageDecoderFrame& ScalableImageDecoderFrame::operator=(const ScalableIm
     m_orientation = other.m_orientation;
     m_duration = other.m_duration;
     m_hasAlpha = other.m_hasAlpha;
+    m_changedRowsBegin = other.m_changedRowsBegin;
+    m_changedRowsEnd = other.m_changedRowsEnd;
     return *this;
 }
 
@@ -99,4 +101,13 @@ IntSize ScalableImageDecoderFrame::size() const
     return { };
 }
 
+IntRect ScalableImageDecoderFrame::takeChangedRect()
+{
+    IntRect changedRect;
+    if (m_changedRowsBegin < m_changedRowsEnd)
+        changedRect = IntRect(0, m_changedRowsBegin, size().width(), m_changedRowsEnd - m_changedRowsBegin);
+    m_changedRowsBegin = m_changedRowsEnd = 0;
+    return changedRect;
+}
+
 }
@@ -30,6 +30,7 @@
 #include "ImageBackingStore.h"
 #include "ImageOrientation.h"
 #include "ImageTypes.h"
+#include "IntRect.h"
 #include "IntSize.h"
 #include "NativeImage.h"
 #include <wtf/Seconds.h>
@@ -76,6 +77,15 @@ public:
     ImageBackingStore* backingStore() const { return m_backingStore ? m_backingStore.get() : nullptr; }
     bool hasBackingStore() const { return backingStore(); }
 
+    // Decoders that know which rows they wrote mark them, so that a partially received image
+    // only repaints what new data changed.
+    void addChangedRows(int begin, int end)
+    {
+        m_changedRowsBegin = m_changedRowsBegin < m_changedRowsEnd ? std::min(begin, m_changedRowsBegin) : begin;
+        m_changedRowsEnd = std::max(end, m_changedRowsEnd);
+    }
+    IntRect takeChangedRect();
+
 private:
     DecodingStatus m_decodingStatus { DecodingStatus::Invalid };
 
@@ -85,6 +95,8 @@ private:
     ImageOrientation m_orientation { DefaultImageOrientation };
     Seconds m_duration;
     bool m_hasAlpha { true };
+    int m_changedRowsBegin { 0 };
+    int m_changedRowsEnd { 0 };
 };
 
 }
@@ -331,6 +331,10 @@ public:
             // image is a sequential JPEG.
             m_info.buffered_image = jpeg_has_multiple_scans(&m_info);
 
+            // Let the IDCT scale the image down when it's displayed that small.
+            m_info.scale_num = 1;
+            m_info.scale_denom = m_decoder->scaleDenominator();
+
             // Used to set up image size so arrays can be allocated.
             jpeg_calc_output_dimensions(&m_info);
 
@@ -504,6 +508,10 @@ JPEGImageDecoder::~JPEGImageDecoder() = default;
 
 bool JPEGImageDecoder::setSize(const IntSize& size)
 {
+    // The header is read again when decoding starts over at another subsampling level.
+    if (isSizeAvailable() && size == this->size())
+        return true;
+
     if (!ScalableImageDecoder::setSize(size))
         return false;
 
@@ -511,6 +519,28 @@ bool JPEGImageDecoder::setSize(const IntSize& size)
     return true;
 }
 
+IntSize JPEGImageDecoder::frameSizeAtIndex(size_t, SubsamplingLevel subsamplingLevel) const
+{
+    if (m_scaled || subsamplingLevel == SubsamplingLevel::Default)
+        return size();
+
+    // Rounded up the way jpeg_calc_output_dimensions() does it.
+    int denominator = 1 << static_cast<int>(subsamplingLevel);
+    return IntSize((size().width() + denominator - 1) / denominator, (size().height() + denominator - 1) / denominator);
+}
+
+void JPEGImageDecoder::setSubsamplingLevel(SubsamplingLevel subsamplingLevel)
+{
+    if (subsamplingLevel == m_subsamplingLevel)
+        return;
+
+    // The reader computed its output size for the previous level, so start over from the header.
+    // Native images created from the old frame keep a reference to its pixels.
+    m_subsamplingLevel = subsamplingLevel;
+    m_reader = nullptr;
+    m_frameBufferCache.clear();
+}
+
 ScalableImageDecoderFrame* JPEGImageDecoder::frameBufferAtIndex(size_t index)
 {
     if (index)
@@ -580,6 +610,7 @@ bool JPEGImageDecoder::outputScanlines(ScalableImageDecoderFrame& buffer)
             setPixel<colorSpace>(buffer, currentAddress, samples, isScaled ? m_scaledColumns[x] : x);
             ++currentAddress;
         }
+        buffer.addChangedRows(destY, destY + 1);
     }
     return true;
 }
@@ -598,7 +629,7 @@ bool JPEGImageDecoder::outputScanlines()
     // Initialize the framebuffer if needed.
     auto& buffer = m_frameBufferCache[0];
     if (buffer.isInvalid()) {
-        if (!buffer.initialize(scaledSize(), m_premultiplyAlpha))
+        if (!buffer.initialize(m_scaled ? scaledSize() : frameSizeAtIndex(0, m_subsamplingLevel), m_premultiplyAlpha))
             return setFailed();
         buffer.setDecodingStatus(DecodingStatus::Partial);
         // The buffer is transparent outside the decoded area while the image is
@@ -611,9 +642,11 @@ bool JPEGImageDecoder::outputScanlines()
 #if defined(TURBO_JPEG_RGB_SWIZZLE)
     if (!m_scaled && turboSwizzled(info->out_color_space)) {
         while (info->output_scanline < info->output_height) {
-            unsigned char* row = reinterpret_cast<unsigned char*>(buffer.backingStore()->pixelAt(0, info->output_scanline));
+            int y = info->output_scanline;
+            unsigned char* row = reinterpret_cast<unsigned char*>(buffer.backingStore()->pixelAt(0, y));
             if (jpeg_read_scanlines(info, &row, 1) != 1)
                 return false;
+            buffer.addChangedRows(y, y + 1);
          }
          return true;
      }
@@ -53,7 +53,10 @@ namespace WebCore {
         // ScalableImageDecoder
         String filenameExtension() const override { return "jpg"_s; }
         bool setSize(const IntSize&) override;
+        IntSize frameSizeAtIndex(size_t, SubsamplingLevel) const override;
+        bool frameAllowSubsamplingAtIndex(size_t) const override { return !m_scaled; }
         ScalableImageDecoderFrame* frameBufferAtIndex(size_t index) override;
+        Optional<IntRect> takeChangedRectAtIndex(size_t index) override { return takeChangedRectOfFrameAtIndex(index); }
         // CAUTION: setFailed() deletes |m_reader|.  Be careful to avoid
         // accessing deleted memory, especially when calling this from inside
         // JPEGImageReader!
@@ -70,9 +73,13 @@ namespace WebCore {
 
         void setOrientation(ImageOrientation orientation) { m_orientation = orientation; }
 
+        // libjpeg scales the image down by this while computing the IDCT, see scale_denom.
+        unsigned scaleDenominator() const { return 1 << static_cast<int>(m_subsamplingLevel); }
+
     private:
         JPEGImageDecoder(AlphaOption, GammaAndColorProfileOption);
         void tryDecodeSize(bool allDataReceived) override { decode(true, allDataReceived); }
+        void setSubsamplingLevel(SubsamplingLevel) override;
 
         // Decodes the image.  If |onlySize| is true, stops decoding after
         // calculating the image size.  If decoding fails but there is no more
@@ -86,6 +93,7 @@ namespace WebCore {
         bool outputScanlines(ScalableImageDecoderFrame& buffer);
 
         std::unique_ptr<JPEGImageReader> m_reader;
+        SubsamplingLevel m_subsamplingLevel { SubsamplingLevel::Default };
     };
 
 } // namespace WebCore
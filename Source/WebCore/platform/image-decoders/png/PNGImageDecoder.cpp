@@ -534,6 +534,8 @@ void PNGImageDecoder::rowAvailable(unsigned char* rowBuffer, unsigned rowIndex,
 
     if (nonTrivialAlphaMask && !buffer.hasAlpha())
         buffer.setHasAlpha(true);
+
+    buffer.addChangedRows(y, y + 1);
 }
 
 void PNGImageDecoder::pngComplete()
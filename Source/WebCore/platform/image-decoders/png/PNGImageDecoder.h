@@ -52,6 +52,7 @@ namespace WebCore {
 #endif
         bool setSize(const IntSize&) override;
         ScalableImageDecoderFrame* frameBufferAtIndex(size_t index) override;
+        Optional<IntRect> takeChangedRectAtIndex(size_t index) override { return takeChangedRectOfFrameAtIndex(index); }
         // CAUTION: setFailed() deletes |m_reader|.  Be careful to avoid
         // accessing deleted memory, especially when calling this from inside
         // PNGImageReader!
@@ -273,6 +273,7 @@ private:
     void restartRequestWithCredential(const ProtectionSpace&, const Credential&);
 
     void handleDataURL();
+    bool startFromCache();
 #endif
 
     friend class ResourceHandleInternal;
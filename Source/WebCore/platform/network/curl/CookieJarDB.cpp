@@ -28,9 +28,11 @@
 #include "CookieUtil.h"
 #include "Logging.h"
 #include "SQLiteFileSystem.h"
+#include "SQLiteTransaction.h"
 #include <wtf/FileSystem.h>
 #include <wtf/MonotonicTime.h>
 #include <wtf/URL.h>
+#include <wtf/WallTime.h>
 #include <wtf/text/StringConcatenateNumbers.h>
 
 #if ENABLE(PUBLIC_SUFFIX_LIST)
@@ -38,6 +40,7 @@
 #endif
 
 #include <sys/stat.h>
+#include <stdio.h>
 #include <aros/debug.h>
 
 namespace WebCore {
@@ -64,10 +67,8 @@ namespace WebCore {
     "CREATE INDEX IF NOT EXISTS domain_index ON Cookie(domain);"
 #define CREATE_PATH_INDEX_SQL \
     "CREATE INDEX IF NOT EXISTS path_index ON Cookie(path);"
-#define SELECT_ALL_DOMAINS_SQL \
-    "SELECT DISTINCT domain FROM Cookie;"
-#define CHECK_EXISTS_HTTPONLY_COOKIE_SQL \
-    "SELECT name FROM Cookie WHERE (name = ?) AND (domain = ?) AND (path = ?) AND (httponly = 1);"
+#define SELECT_ALL_COOKIES_SQL \
+    "SELECT name, value, domain, path, expires, httponly, secure, session FROM Cookie ORDER BY lastupdated;"
 #define SET_COOKIE_SQL \
     "INSERT OR REPLACE INTO Cookie (name, value, domain, path, expires, size, session, httponly, secure) "\
     "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);"
@@ -90,6 +91,41 @@ namespace WebCore {
 // - Add upgrade logic in verifySchemaVersion to migrate databases from the previous schema version
 static constexpr int schemaVersion = 1;
 
+// Lets a burst of Set-Cookie headers reach the database in a single transaction.
+static constexpr Seconds writeBatchDelay { 500_ms };
+
+// Bounds the host to bucket key cache.
+static const unsigned maxBucketKeys = 1024;
+
+static double currentTimeInSeconds()
+{
+    return WallTime::now().secondsSinceEpoch().seconds();
+}
+
+static String registrableDomain(const String& host)
+{
+    if (CookieUtil::isIPAddress(host) || !host.contains('.'))
+        return host;
+
+#if ENABLE(PUBLIC_SUFFIX_LIST)
+    String topPrivateDomain = topPrivatelyControlledDomain(host);
+    return topPrivateDomain.isEmpty() ? host : topPrivateDomain;
+#else
+    // Fallback to the second level domain e.g. domain.com
+    // Multilevel tlds such as co.uk share a bucket, their cookies get filtered out by domainMatch().
+    size_t topLevelSeparator = host.reverseFind('.');
+    size_t secondLevelSeparator = host.reverseFind('.', topLevelSeparator - 1);
+    return secondLevelSeparator == notFound ? host : host.substring(secondLevelSeparator + 1);
+#endif
+}
+
+static String hostForDomain(const String& domain)
+{
+    String host = domain.convertToASCIILowercase();
+    if (host.startsWith('.'))
+        host.remove(0, 1);
+    return host;
+}
 
 void CookieJarDB::setEnabled(bool enable)
 {
@@ -171,17 +207,25 @@ bool CookieJarDB::openDatabase()
 
     // create prepared statements
     createPrepareStatement(SET_COOKIE_SQL);
-    createPrepareStatement(CHECK_EXISTS_HTTPONLY_COOKIE_SQL);
     createPrepareStatement(DELETE_COOKIE_BY_NAME_DOMAIN_PATH_SQL);
     createPrepareStatement(DELETE_COOKIE_BY_NAME_DOMAIN_SQL);
     createPrepareStatement(DELETE_COOKIES_BY_DOMAIN_SQL);
     createPrepareStatement(DELETE_COOKIES_BY_DOMAIN_EXCEPT_HTTP_ONLY_SQL);
 
+    loadCookies();
+
+    // From now on the database is only used by the writer thread.
+    m_database.disableThreadingChecks();
+
     return true;
 }
 
 void CookieJarDB::closeDatabase()
 {
+    stopWriterThread();
+    m_cookies.clear();
+    m_bucketKeys.clear();
+
     if (m_database.isOpen()) {
         for (const auto& statement : m_statements)
             statement.value.get()->finalize();
@@ -338,69 +382,29 @@ Optional<Vector<Cookie>> CookieJarDB::searchCookies(const String& requestUrl, co
     if (requestPath.isEmpty())
         requestPath = "/";
 
-    const String sql =
-        "SELECT name, value, domain, path, expires, httponly, secure, session FROM Cookie WHERE "\
-        "(NOT ((session = 0) AND (datetime(expires, 'unixepoch') < datetime('now')))) "\
-        "AND (httponly = COALESCE(NULLIF(?, -1), httponly)) "\
-        "AND (secure = COALESCE(NULLIF(?, -1), secure)) "\
-        "AND (session = COALESCE(NULLIF(?, -1), session)) "\
-        "AND ((domain = ?) OR (domain GLOB ?)) "\
-        "ORDER BY length(path) DESC, lastupdated";
-
-    auto pstmt = std::make_unique<SQLiteStatement>(m_database, sql);
-    if (!pstmt)
-        return WTF::nullopt;
+    Vector<Cookie> results;
 
-    pstmt->prepare();
-    pstmt->bindInt(1, httpOnly ? *httpOnly : -1);
-    pstmt->bindInt(2, secure ? *secure : -1);
-    pstmt->bindInt(3, session ? *session : -1);
-    pstmt->bindText(4, requestHost);
+    auto bucket = m_cookies.find(bucketKeyForHost(requestHost));
+    if (bucket == m_cookies.end())
+        return results;
 
-    if (CookieUtil::isIPAddress(requestHost) || !requestHost.contains('.'))
-        pstmt->bindNull(5);
-    else {
-#if ENABLE(PUBLIC_SUFFIX_LIST)
-        String topPrivateDomain = topPrivatelyControlledDomain(requestHost);
-        if (!topPrivateDomain.isEmpty())
-            pstmt->bindText(5, String("*.") + topPrivateDomain);
-        else
-            pstmt->bindNull(5);
-#else
-        // Fallback to glob for cookies under the second level domain e.g. *.domain.com
-        // This will return too many cookies under multilevel tlds such as *.co.uk, but they will get filtered out later.
-        size_t topLevelSeparator = requestHost.reverseFind('.');
-        size_t secondLevelSeparator = requestHost.reverseFind('.', topLevelSeparator-1);
-        String localDomain = secondLevelSeparator == notFound ? requestHost : requestHost.substring(secondLevelSeparator+1);
-
-        ASSERT(!localDomain.isEmpty());
-        pstmt->bindText(5, String("*.") + localDomain);
-#endif
-    }
-
-    if (!pstmt)
-        return WTF::nullopt;
+    double now = currentTimeInSeconds();
+    Vector<const StoredCookie*> matches;
 
-    Vector<Cookie> results;
+    for (auto& stored : bucket->value) {
+        const Cookie& cookie = stored.cookie;
 
-    while (pstmt->step() == SQLITE_ROW) {
-
-        if (results.size() > MAX_COOKIE_PER_DOMAIN)
-            break;
+        if (!cookie.session && cookie.expires < now)
+            continue;
 
-        String cookieName = pstmt->getColumnText(0);
-        String cookieValue = pstmt->getColumnText(1);
-        String cookieDomain = pstmt->getColumnText(2).convertToASCIILowercase();
-        String cookiePath = pstmt->getColumnText(3).convertToASCIILowercase();
-        double cookieExpires = (double)pstmt->getColumnInt64(4) * 1000;
-        bool cookieHttpOnly = (pstmt->getColumnInt(5) == 1);
-        bool cookieSecure = (pstmt->getColumnInt(6) == 1);
-        bool cookieSession = (pstmt->getColumnInt(7) == 1);
+        if ((httpOnly && cookie.httpOnly != *httpOnly) || (secure && cookie.secure != *secure) || (session && cookie.session != *session))
+            continue;
 
-        if (!CookieUtil::domainMatch(cookieDomain, requestHost))
+        if (!CookieUtil::domainMatch(stored.matchDomain, requestHost))
             continue;
 
         // https://tools.ietf.org/html/rfc6265#section-5.1.4 "Paths and Path-Match"
+        const String& cookiePath = stored.matchPath;
         bool isPathMatched = cookiePath == requestPath
             || (requestPath.startsWith(cookiePath) && cookiePath.endsWith('/'))
             || (requestPath.startsWith(cookiePath) && (requestPath.characterAt(cookiePath.length()) == '/'));
@@ -408,18 +412,31 @@ Optional<Vector<Cookie>> CookieJarDB::searchCookies(const String& requestUrl, co
         if (!isPathMatched)
             continue;
 
+        matches.append(&stored);
+    }
+
+    std::sort(matches.begin(), matches.end(), [](const StoredCookie* a, const StoredCookie* b) {
+        if (a->matchPath.length() != b->matchPath.length())
+            return a->matchPath.length() > b->matchPath.length();
+        return a->lastUpdated < b->lastUpdated;
+    });
+
+    for (auto* stored : matches) {
+
+        if (results.size() > MAX_COOKIE_PER_DOMAIN)
+            break;
+
         Cookie cookie;
-        cookie.name = cookieName;
-        cookie.value = cookieValue;
-        cookie.domain = cookieDomain;
-        cookie.path = cookiePath;
-        cookie.expires = cookieExpires;
-        cookie.httpOnly = cookieHttpOnly;
-        cookie.secure = cookieSecure;
-        cookie.session = cookieSession;
+        cookie.name = stored->cookie.name;
+        cookie.value = stored->cookie.value;
+        cookie.domain = stored->matchDomain;
+        cookie.path = stored->matchPath;
+        cookie.expires = stored->cookie.expires * 1000;
+        cookie.httpOnly = stored->cookie.httpOnly;
+        cookie.secure = stored->cookie.secure;
+        cookie.session = stored->cookie.session;
         results.append(WTFMove(cookie));
     }
-    pstmt->finalize();
 
     return results;
 }
@@ -429,38 +446,28 @@ Vector<Cookie> CookieJarDB::getAllCookies()
     Vector<Cookie> result;
     if (!isEnabled() || !m_database.isOpen())
         return result;
-    const String sql = "SELECT name, value, domain, path, expires, httponly, secure, session FROM Cookie"_s;
-    auto pstmt = std::make_unique<SQLiteStatement>(m_database, sql);
-    if (!pstmt)
-        return result;
-    pstmt->prepare();
-    while (pstmt->step() == SQLITE_ROW) {
-        Cookie cookie;
-        cookie.name = pstmt->getColumnText(0);
-        cookie.value = pstmt->getColumnText(1);
-        cookie.domain = pstmt->getColumnText(2).convertToASCIILowercase();
-        cookie.path = pstmt->getColumnText(3);
-        double cookieExpires = (double)pstmt->getColumnInt64(4);
-        if (cookieExpires)
-            cookie.expires = cookieExpires;
-        cookie.httpOnly = (pstmt->getColumnInt(5) == 1);
-        cookie.secure = (pstmt->getColumnInt(6) == 1);
-        cookie.session = (pstmt->getColumnInt(7) == 1);
-        result.append(WTFMove(cookie));
+
+    for (auto& bucket : m_cookies.values()) {
+        for (auto& stored : bucket) {
+            Cookie cookie = stored.cookie;
+            cookie.domain = stored.matchDomain;
+            result.append(WTFMove(cookie));
+        }
     }
-    pstmt->finalize();
     return result;
 }
 
 bool CookieJarDB::hasHttpOnlyCookie(const String& name, const String& domain, const String& path)
 {
-    auto& statement = preparedStatement(CHECK_EXISTS_HTTPONLY_COOKIE_SQL);
-
-    statement.bindText(1, name);
-    statement.bindText(2, domain);
-    statement.bindText(3, path);
+    auto bucket = m_cookies.find(bucketKeyForHost(hostForDomain(domain)));
+    if (bucket == m_cookies.end())
+        return false;
 
-    return statement.step() == SQLITE_ROW;
+    for (auto& stored : bucket->value) {
+        if (stored.cookie.httpOnly && stored.cookie.name == name && stored.cookie.domain == domain && stored.cookie.path == path)
+            return true;
+    }
+    return false;
 }
 
 bool CookieJarDB::canAcceptCookie(const Cookie& cookie, const String& host, CookieJarDB::Source source)
@@ -482,22 +489,32 @@ bool CookieJarDB::canAcceptCookie(const Cookie& cookie, const String& host, Cook
 
 bool CookieJarDB::setCookie(const Cookie& cookie)
 {
-    if (!cookie.session && MonotonicTime::fromRawSeconds(cookie.expires) <= MonotonicTime::now())
-        return deleteCookieInternal(cookie.name, cookie.domain, cookie.path);
+    if (!isEnabled() || !m_database.isOpen())
+        return false;
 
-    auto& statement = preparedStatement(SET_COOKIE_SQL);
+    // Cookie expiry is expressed in seconds since the UNIX epoch.
+    if (!cookie.session && cookie.expires <= currentTimeInSeconds())
+        return deleteCookieInternal(cookie.name, cookie.domain, cookie.path);
 
-    // FIXME: We should have some eviction policy when a domain goes over MAX_COOKIE_PER_DOMAIN
-    statement.bindText(1, cookie.name);
-    statement.bindText(2, cookie.value);
-    statement.bindText(3, cookie.domain);
-    statement.bindText(4, cookie.path);
-    statement.bindInt64(5, cookie.session ? 0 : static_cast<int64_t>(cookie.expires));
-    statement.bindInt(6, cookie.value.length());
-    statement.bindInt(7, cookie.session ? 1 : 0);
-    statement.bindInt(8, cookie.httpOnly ? 1 : 0);
-    statement.bindInt(9, cookie.secure ? 1 : 0);
-    return checkSQLiteReturnCode(statement.step());
+    // Keep the cookie as it will read back from the database.
+    Cookie stored;
+    stored.name = cookie.name;
+    stored.value = cookie.value;
+    stored.domain = cookie.domain;
+    stored.path = cookie.path;
+    stored.expires = cookie.session ? 0 : static_cast<int64_t>(cookie.expires);
+    stored.httpOnly = cookie.httpOnly;
+    stored.secure = cookie.secure;
+    stored.session = cookie.session;
+    storeCookie(stored);
+
+    PendingWrite write { PendingWrite::Type::Set, stored.name.isolatedCopy(), stored.value.isolatedCopy(), stored.domain.isolatedCopy(), stored.path.isolatedCopy() };
+    write.expires = static_cast<int64_t>(stored.expires);
+    write.session = stored.session;
+    write.httpOnly = stored.httpOnly;
+    write.secure = stored.secure;
+    enqueueWrite(WTFMove(write));
+    return true;
 }
 
 bool CookieJarDB::setCookie(const String& url, const String& body, CookieJarDB::Source source)
@@ -530,16 +547,11 @@ bool CookieJarDB::setCookie(const String& url, const String& body, CookieJarDB::
 
 HashSet<String> CookieJarDB::allDomains()
 {
-    SQLiteStatement statement(m_database, SELECT_ALL_DOMAINS_SQL);
-    statement.prepare();
-
     HashSet<String> domains;
-    while (statement.step() == SQLITE_ROW) {
-        auto domain = statement.getColumnText(0);
-        domains.add(domain);
+    for (auto& bucket : m_cookies.values()) {
+        for (auto& stored : bucket)
+            domains.add(stored.cookie.domain);
     }
-
-    statement.finalize();
     return domains;
 }
 
@@ -564,12 +576,17 @@ bool CookieJarDB::deleteCookie(const String& url, const String& name)
 
 bool CookieJarDB::deleteCookieInternal(const String& name, const String& domain, const String& path)
 {
-    auto& statement = preparedStatement(path.isEmpty() ? DELETE_COOKIE_BY_NAME_DOMAIN_SQL : DELETE_COOKIE_BY_NAME_DOMAIN_PATH_SQL);
-    statement.bindText(1, name);
-    statement.bindText(2, domain);
-    if (!path.isEmpty())
-        statement.bindText(3, path);
-    return checkSQLiteReturnCode(statement.step());
+    auto bucket = m_cookies.find(bucketKeyForHost(hostForDomain(domain)));
+    if (bucket != m_cookies.end()) {
+        bucket->value.removeAllMatching([&](const StoredCookie& stored) {
+            return stored.cookie.name == name && stored.cookie.domain == domain && (path.isEmpty() || stored.cookie.path == path);
+        });
+        if (bucket->value.isEmpty())
+            m_cookies.remove(bucket);
+    }
+
+    enqueueWrite({ PendingWrite::Type::Delete, name.isolatedCopy(), String(), domain.isolatedCopy(), path.isolatedCopy() });
+    return true;
 }
 
 bool CookieJarDB::deleteCookies(const String&)
@@ -581,9 +598,24 @@ bool CookieJarDB::deleteCookies(const String&)
 
 bool CookieJarDB::deleteCookiesForHostname(const String& hostname, IncludeHttpOnlyCookies includeHttpOnlyCookies)
 {
-    auto& statement = preparedStatement(includeHttpOnlyCookies == IncludeHttpOnlyCookies::Yes ? DELETE_COOKIES_BY_DOMAIN_SQL : DELETE_COOKIES_BY_DOMAIN_EXCEPT_HTTP_ONLY_SQL);
-    statement.bindText(1, hostname);
-    return checkSQLiteReturnCode(statement.step());
+    if (!isEnabled() || !m_database.isOpen())
+        return false;
+
+    bool includeHttpOnly = includeHttpOnlyCookies == IncludeHttpOnlyCookies::Yes;
+
+    auto bucket = m_cookies.find(bucketKeyForHost(hostForDomain(hostname)));
+    if (bucket != m_cookies.end()) {
+        bucket->value.removeAllMatching([&](const StoredCookie& stored) {
+            return stored.cookie.domain == hostname && (includeHttpOnly || !stored.cookie.httpOnly);
+        });
+        if (bucket->value.isEmpty())
+            m_cookies.remove(bucket);
+    }
+
+    PendingWrite write { PendingWrite::Type::DeleteDomain, String(), String(), hostname.isolatedCopy() };
+    write.httpOnly = includeHttpOnly;
+    enqueueWrite(WTFMove(write));
+    return true;
 }
 
 bool CookieJarDB::deleteAllCookies()
@@ -591,9 +623,232 @@ bool CookieJarDB::deleteAllCookies()
     if (!isEnabled() || !m_database.isOpen())
         return false;
 
-    return executeSql(DELETE_ALL_COOKIE_SQL);
+    m_cookies.clear();
+    enqueueWrite({ PendingWrite::Type::DeleteAll });
+    return true;
+}
+
+void CookieJarDB::loadCookies()
+{
+    m_cookies.clear();
+
+    SQLiteStatement statement(m_database, SELECT_ALL_COOKIES_SQL);
+    if (statement.prepare() != SQLITE_OK)
+        return;
+
+    double now = currentTimeInSeconds();
+    while (statement.step() == SQLITE_ROW) {
+        Cookie cookie;
+        cookie.name = statement.getColumnText(0);
+        cookie.value = statement.getColumnText(1);
+        cookie.domain = statement.getColumnText(2);
+        cookie.path = statement.getColumnText(3);
+        cookie.expires = (double)statement.getColumnInt64(4);
+        cookie.httpOnly = (statement.getColumnInt(5) == 1);
+        cookie.secure = (statement.getColumnInt(6) == 1);
+        cookie.session = (statement.getColumnInt(7) == 1);
+
+        if (!cookie.session && cookie.expires < now)
+            continue;
+
+        storeCookie(cookie);
+    }
+    statement.finalize();
+}
+
+String CookieJarDB::bucketKeyForHost(const String& host)
+{
+    auto it = m_bucketKeys.find(host);
+    if (it != m_bucketKeys.end())
+        return it->value;
+
+    if (m_bucketKeys.size() >= maxBucketKeys)
+        m_bucketKeys.clear();
+
+    String key = registrableDomain(host);
+    m_bucketKeys.add(host, key);
+    return key;
+}
+
+void CookieJarDB::storeCookie(const Cookie& cookie)
+{
+    StoredCookie stored { cookie, cookie.domain.convertToASCIILowercase(), cookie.path.convertToASCIILowercase(), ++m_updateCounter };
+
+    auto& bucket = m_cookies.ensure(bucketKeyForHost(hostForDomain(cookie.domain)), [] {
+        return Vector<StoredCookie>();
+    }).iterator->value;
+
+    // Same as the UNIQUE(name, domain, path) constraint of the Cookie table
+    bucket.removeFirstMatching([&](const StoredCookie& existing) {
+        return existing.cookie.name == cookie.name && existing.cookie.domain == cookie.domain && existing.cookie.path == cookie.path;
+    });
+    bucket.append(WTFMove(stored));
+}
+
+void CookieJarDB::enqueueWrite(PendingWrite&& write)
+{
+    auto locker = holdLock(m_writeLock);
+    m_pendingWrites.append(WTFMove(write));
+    if (!m_writerThread) {
+        m_stopWriter = false;
+        m_writerThread = Thread::create("Cookie database writer", [this] {
+            writerThread();
+        });
+    }
+    m_writeCondition.notifyOne();
+}
+
+void CookieJarDB::stopWriterThread()
+{
+    RefPtr<Thread> thread;
+    {
+        auto locker = holdLock(m_writeLock);
+        thread = WTFMove(m_writerThread);
+        m_stopWriter = true;
+        m_writeCondition.notifyOne();
+    }
+
+    // The writer drains the pending writes before it exits.
+    if (thread)
+        thread->waitForCompletion();
+}
+
+void CookieJarDB::writerThread()
+{
+    while (true) {
+        Vector<PendingWrite> writes;
+        {
+            auto locker = holdLock(m_writeLock);
+            m_writeCondition.wait(m_writeLock, [this] {
+                return m_stopWriter || !m_pendingWrites.isEmpty();
+            });
+
+            if (m_pendingWrites.isEmpty())
+                return;
+
+            if (!m_stopWriter) {
+                m_writeCondition.waitFor(m_writeLock, writeBatchDelay, [this] {
+                    return m_stopWriter;
+                });
+            }
+            writes = WTFMove(m_pendingWrites);
+        }
+
+        if (writeChanges(writes))
+            continue;
+
+        // Put the batch back in front of what got queued meanwhile, it is
+        // retried after the batch delay.
+        auto locker = holdLock(m_writeLock);
+        if (m_stopWriter) {
+            LOG_ERROR("Dropping %zu cookie database writes", writes.size() + m_pendingWrites.size());
+            return;
+        }
+        writes.appendVector(m_pendingWrites);
+        m_pendingWrites = WTFMove(writes);
+    }
+}
+
+bool CookieJarDB::writeChanges(const Vector<PendingWrite>& writes)
+{
+    SQLiteTransaction transaction(m_database);
+    transaction.begin();
+    if (!transaction.inProgress()) {
+        LOG_ERROR("Unable to begin a cookie database transaction (%d %s)", m_database.lastError(), m_database.lastErrorMsg());
+        return false;
+    }
+
+    for (auto& write : writes) {
+        switch (write.type) {
+        case PendingWrite::Type::Set: {
+            auto& statement = preparedStatement(SET_COOKIE_SQL);
+
+            // FIXME: We should have some eviction policy when a domain goes over MAX_COOKIE_PER_DOMAIN
+            statement.bindText(1, write.name);
+            statement.bindText(2, write.value);
+            statement.bindText(3, write.domain);
+            statement.bindText(4, write.path);
+            statement.bindInt64(5, write.expires);
+            statement.bindInt(6, write.value.length());
+            statement.bindInt(7, write.session ? 1 : 0);
+            statement.bindInt(8, write.httpOnly ? 1 : 0);
+            statement.bindInt(9, write.secure ? 1 : 0);
+            checkSQLiteReturnCode(statement.step());
+            break;
+        }
+        case PendingWrite::Type::Delete: {
+            auto& statement = preparedStatement(write.path.isEmpty() ? DELETE_COOKIE_BY_NAME_DOMAIN_SQL : DELETE_COOKIE_BY_NAME_DOMAIN_PATH_SQL);
+            statement.bindText(1, write.name);
+            statement.bindText(2, write.domain);
+            if (!write.path.isEmpty())
+                statement.bindText(3, write.path);
+            checkSQLiteReturnCode(statement.step());
+            break;
+        }
+        case PendingWrite::Type::DeleteDomain: {
+            // httpOnly tells whether the HttpOnly cookies of the domain go as well.
+            auto& statement = preparedStatement(write.httpOnly ? DELETE_COOKIES_BY_DOMAIN_SQL : DELETE_COOKIES_BY_DOMAIN_EXCEPT_HTTP_ONLY_SQL);
+            statement.bindText(1, write.domain);
+            checkSQLiteReturnCode(statement.step());
+            break;
+        }
+        case PendingWrite::Type::DeleteAll:
+            executeSql(DELETE_ALL_COOKIE_SQL);
+            break;
+        }
+    }
+
+    transaction.commit();
+    return true;
 }
 
+#if PLATFORM(MUI) && !defined(NDEBUG)
+/*
+ * Replays a recorded list of URLs (one per line) against the cookie store
+ * and reports the lookup throughput. Only built into debug builds.
+ */
+String CookieJarDB::benchmarkLookups(const char* urlListPath)
+{
+    if (!isEnabled() || !m_database.isOpen())
+        return "ERROR: cookie database is not open";
+
+    FILE *file = fopen(urlListPath, "r");
+    if (!file)
+        return "ERROR: cannot open URL list";
+
+    Vector<String> urls;
+    char buf[4096];
+    while (fgets(buf, sizeof(buf), file)) {
+        String line = String(buf).stripWhiteSpace();
+        if (!line.isEmpty())
+            urls.append(line);
+    }
+    fclose(file);
+
+    static const unsigned rounds = 10;
+    unsigned lookups = 0;
+    size_t matched = 0;
+    MonotonicTime start = MonotonicTime::now();
+    for (unsigned round = 0; round < rounds; round++) {
+        for (auto& url : urls) {
+            if (auto cookies = searchCookies(url, WTF::nullopt, WTF::nullopt, WTF::nullopt))
+                matched += cookies->size();
+            lookups++;
+        }
+    }
+    double elapsed = (MonotonicTime::now() - start).milliseconds();
+
+    size_t storedCookies = 0;
+    for (auto& bucket : m_cookies.values())
+        storedCookies += bucket.size();
+
+    return makeString("cookies: ", storedCookies, " domains: ", m_cookies.size(),
+        " urls: ", urls.size(), " lookups: ", lookups, " matches: ", matched,
+        " time: ", FormattedNumber::fixedWidth(elapsed, 2), " ms",
+        " lookups/s: ", FormattedNumber::fixedWidth(elapsed ? lookups * 1000 / elapsed : 0, 0));
+}
+#endif
+
 void CookieJarDB::createPrepareStatement(const String& sql)
 {
     auto statement = std::make_unique<SQLiteStatement>(m_database, sql);
@@ -28,9 +28,12 @@
 #include "CookieJar.h"
 #include "SQLiteDatabase.h"
 #include "SQLiteStatement.h"
+#include <wtf/Condition.h>
 #include <wtf/HashMap.h>
+#include <wtf/Lock.h>
 #include <wtf/Noncopyable.h>
 #include <wtf/Optional.h>
+#include <wtf/Threading.h>
 #include <wtf/Vector.h>
 #include <wtf/text/StringHash.h>
 #include <wtf/text/WTFString.h>
@@ -67,10 +70,41 @@ public:
     bool deleteCookiesForHostname(const String& hostname, IncludeHttpOnlyCookies);
     bool deleteAllCookies();
 
+#if PLATFORM(MUI) && !defined(NDEBUG)
+    String benchmarkLookups(const char* urlListPath);
+#endif
+
     WEBCORE_EXPORT CookieJarDB(const String& databasePath);
     WEBCORE_EXPORT ~CookieJarDB();
 
 private:
+    // Cookies are served from memory, bucketed by the registrable domain
+    // (eTLD+1) of their domain. The database only receives the changes,
+    // which a writer thread applies in batches.
+    struct StoredCookie {
+        Cookie cookie; // as stored in the database
+        String matchDomain;
+        String matchPath;
+        uint64_t lastUpdated;
+    };
+
+    struct PendingWrite {
+        enum class Type : uint8_t {
+            Set,
+            Delete,
+            DeleteDomain,
+            DeleteAll
+        };
+        Type type;
+        String name;
+        String value;
+        String domain;
+        String path;
+        int64_t expires { 0 };
+        bool session { false };
+        bool httpOnly { false };
+        bool secure { false };
+    };
 
     bool m_isEnabled { true };
     String m_databasePath;
@@ -101,8 +135,27 @@ private:
     bool hasHttpOnlyCookie(const String& name, const String& domain, const String& path);
     bool canAcceptCookie(const Cookie&, const String& host, CookieJarDB::Source);
 
+    void loadCookies();
+    String bucketKeyForHost(const String&);
+    void storeCookie(const Cookie&);
+
+    void enqueueWrite(PendingWrite&&);
+    void stopWriterThread();
+    void writerThread();
+    bool writeChanges(const Vector<PendingWrite>&);
+
     SQLiteDatabase m_database;
     HashMap<String, std::unique_ptr<SQLiteStatement>> m_statements;
+
+    HashMap<String, Vector<StoredCookie>> m_cookies;
+    HashMap<String, String> m_bucketKeys;
+    uint64_t m_updateCounter { 0 };
+
+    Lock m_writeLock;
+    Condition m_writeCondition;
+    Vector<PendingWrite> m_pendingWrites;
+    bool m_stopWriter { false };
+    RefPtr<Thread> m_writerThread;
 };
 
 } // namespace WebCore
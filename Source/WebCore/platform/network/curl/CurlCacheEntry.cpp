@@ -30,6 +30,8 @@
 
 #include "CurlCacheEntry.h"
 
+#include "CacheValidation.h"
+#include "CurlCacheIOQueue.h"
 #include "HTTPHeaderMap.h"
 #include "HTTPHeaderNames.h"
 #include "HTTPParsers.h"
@@ -43,120 +45,35 @@
 #include <wtf/DateMath.h>
 #include <wtf/HexNumber.h>
 #include <wtf/MD5.h>
+#include <wtf/text/StringBuilder.h>
 
-#if PLATFORM(MUI)
-#include <aros/debug.h>
-#include <proto/dos.h>
-#include <wtf/FileSystem.h>
-#endif
 
 namespace WebCore {
 
-#if PLATFORM(MUI)
-class DirCache{
-public:
-    DirCache() : inited(false)
-    {
-    }
-
-    void initOnce(const String& dir)
-    {
-        BPTR lock;
-        const LONG bufferSize = 4096;
-        struct ExAllData *ead;
-        struct ExAllControl *eac;
-        BOOL loop;
-
-        if(inited)
-            return;
-
-        lock = Lock(dir.latin1().data(), SHARED_LOCK);
-        if (!lock)
-            return;
-
-        ead = (struct ExAllData *)AllocVec(bufferSize, MEMF_CLEAR | MEMF_PUBLIC);
-        eac = (struct ExAllControl *)AllocDosObject(DOS_EXALLCONTROL, NULL);
-        eac->eac_LastKey = 0;
-
-        do
-        {
-            loop = ExAll(lock, ead, bufferSize, ED_COMMENT, eac);
-
-            if (!loop && IoErr() != ERROR_NO_MORE_ENTRIES)
-                break;
-
-            if (eac->eac_Entries != 0)
-            {
-                struct ExAllData * tmp = ead;
-
-                do
-                {
-                    if (tmp->ed_Type == ST_FILE)
-                        m_sizes.set(tmp->ed_Name, tmp->ed_Size);
-
-                    tmp = tmp->ed_Next;
-                }
-                while (tmp != NULL);
-            }
-
-        }while(loop);
-
-        FreeDosObject(DOS_EXALLCONTROL, eac);
-        UnLock(lock);
-        FreeVec(ead);
-
-        inited = true;
-    }
-
-    bool getFileSize(const String& path, long long& result)
-    {
-        String filename = FileSystem::pathGetFileName(path);
-        auto it = m_sizes.find(filename);
-        if (it != m_sizes.end())
-        {
-            result = it->value;
-            // only one time read, next time through filesystem
-            m_sizes.remove(filename);
-            return true;
-        }
-
-        return FileSystem::getFileSize(path, result);
-    }
-
-private:
-    HashMap<String, int> m_sizes;
-    bool inited;
-};
-
-DirCache dc;
-
-bool CurlCacheEntry::getFileSize(const String& path, long long& result) const
-{
-    return dc.getFileSize(path, result);
-}
-#endif
-
-CurlCacheEntry::CurlCacheEntry(const String& url, ResourceHandle* job, const String& cacheDir)
-    : m_headerFilename(cacheDir)
-    , m_contentFilename(cacheDir)
-    , m_contentFile(FileSystem::invalidPlatformFileHandle)
-    , m_entrySize(0)
+static uint64_t nextEntryIdentifier;
+
+CurlCacheEntry::CurlCacheEntry(const String& url, ResourceHandle* job, const String& cacheDir, CurlCacheIOQueue& ioQueue)
+    : m_contentFilename(cacheDir)
+    , m_identifier(++nextEntryIdentifier)
+    , m_urlHash(0)
+    , m_ioQueue(ioQueue)
+    , m_contentFileOpen(false)
+    , m_contentComplete(false)
+    , m_contentSize(0)
+    , m_headersSize(0)
+    , m_bytecodeSize(0)
     , m_expireDate(WallTime::fromRawSeconds(-1))
+    , m_staleWhileRevalidate(0_s)
     , m_headerParsed(false)
     , m_isLoading(false)
     , m_job(job)
+    , m_journalHeaders(nullptr)
+    , m_journalHeadersLength(0)
 {
     generateBaseFilename(url.latin1());
 
-    m_headerFilename.append(m_basename);
-    m_headerFilename.append(".header");
-
     m_contentFilename.append(m_basename);
     m_contentFilename.append(".content");
-
-#if PLATFORM(MUI)
-    dc.initOnce(cacheDir);
-#endif
 }
 
 CurlCacheEntry::~CurlCacheEntry()
@@ -172,83 +89,104 @@ bool CurlCacheEntry::isLoading() const
 // Cache manager should invalidate the entry on false
 bool CurlCacheEntry::isCached()
 {
-    if (!FileSystem::fileExists(m_contentFilename) || !FileSystem::fileExists(m_headerFilename))
-        return false;
-
+    // Entries restored from the journal are validated on first use
     if (!m_headerParsed) {
         if (!loadResponseHeaders())
             return false;
+        if (!FileSystem::fileExists(m_bodyFilename))
+            return false;
     }
 
-    if (m_expireDate < WallTime::now()) {
-        m_headerParsed = false;
-        return false;
-    }
-
-    if (!entrySize())
-        return false;
+    // Until its body is stored, an entry is only valid while loading
+    if (m_bodyName.isEmpty())
+        return m_isLoading;
 
     return true;
 }
 
-bool CurlCacheEntry::saveCachedData(const char* data, size_t size)
+bool CurlCacheEntry::isFresh() const
 {
-    if (!openContentFile())
-        return false;
-
-    // Append
-    FileSystem::writeToFile(m_contentFile, data, size);
-
-    return true;
+    return m_expireDate >= WallTime::now();
 }
 
-bool CurlCacheEntry::readCachedData(ResourceHandle* job)
+// Cache-Control: stale-while-revalidate allows serving the stored response
+// for a while after it expired, while it is revalidated in the background
+bool CurlCacheEntry::isStaleWhileRevalidate() const
 {
-    ASSERT(job->client());
+    return m_staleWhileRevalidate && m_expireDate + m_staleWhileRevalidate >= WallTime::now();
+}
 
-    Vector<char> buffer;
-    if (!loadFileToBuffer(m_contentFilename, buffer))
+bool CurlCacheEntry::saveCachedData(const char* data, size_t size)
+{
+    if (!openContentFile())
         return false;
 
-    if (buffer.size())
-        job->getInternal()->client()->didReceiveBuffer(job, SharedBuffer::create(buffer.data(), buffer.size()), buffer.size());
+    // Append, write errors are reported by the queue
+    m_ioQueue.append(m_contentFilename, data, size);
 
+    m_contentSize += size;
     return true;
 }
 
+// Headers are kept in memory and written to the index journal by the cache
+// manager once the entry has finished loading
 bool CurlCacheEntry::saveResponseHeaders(const ResourceResponse& response)
 {
-    FileSystem::PlatformFileHandle headerFile = FileSystem::openFile(m_headerFilename, FileSystem::FileOpenMode::Write);
-    if (!FileSystem::isHandleValid(headerFile)) {
-        LOG(Network, "Cache Error: Could not open %s for write\n", m_headerFilename.latin1().data());
-        return false;
-    }
-
-    // Headers
     HTTPHeaderMap::const_iterator it = response.httpHeaderFields().begin();
     HTTPHeaderMap::const_iterator end = response.httpHeaderFields().end();
     while (it != end) {
-        String headerField = it->key;
-        headerField.append(": ");
-        headerField.append(it->value);
-        headerField.append("\n");
-        CString headerFieldLatin1 = headerField.latin1();
-        FileSystem::writeToFile(headerFile, headerFieldLatin1.data(), headerFieldLatin1.length());
         m_cachedResponse.setHTTPHeaderField(it->key, it->value);
         ++it;
     }
 
-    FileSystem::closeFile(headerFile);
+    m_headersSize = serializedResponseHeaders().length();
     return true;
 }
 
+CString CurlCacheEntry::serializedResponseHeaders() const
+{
+    // Not parsed yet, the journal copy is still current
+    if (!m_headerParsed && m_journalHeaders)
+        return CString(m_journalHeaders, m_journalHeadersLength);
+
+    StringBuilder headers;
+    HTTPHeaderMap::const_iterator it = m_cachedResponse.httpHeaderFields().begin();
+    HTTPHeaderMap::const_iterator end = m_cachedResponse.httpHeaderFields().end();
+    while (it != end) {
+        headers.append(it->key);
+        headers.appendLiteral(": ");
+        headers.append(it->value);
+        headers.append('\n');
+        ++it;
+    }
+    return headers.toString().latin1();
+}
+
+void CurlCacheEntry::restoreFromJournal(WallTime expireDate, const char* headers, unsigned headersLength)
+{
+    m_expireDate = expireDate;
+    m_headersSize = headersLength;
+    setJournalHeaders(headers, headersLength);
+}
+
+void CurlCacheEntry::setBody(const String& name, const String& filename)
+{
+    m_bodyName = name;
+    m_bodyFilename = filename;
+}
+
+void CurlCacheEntry::setJournalHeaders(const char* headers, unsigned headersLength)
+{
+    m_journalHeaders = headers;
+    m_journalHeadersLength = headersLength;
+}
+
 bool CurlCacheEntry::loadResponseHeaders()
 {
-    Vector<char> buffer;
-    if (!loadFileToBuffer(m_headerFilename, buffer))
+    if (!m_journalHeaders)
         return false;
 
-    String headerContent = String(buffer.data(), buffer.size());
+    String headerContent = String(m_journalHeaders, m_journalHeadersLength);
     Vector<String> headerFields = headerContent.split('\n');
 
     Vector<String>::const_iterator it = headerFields.begin();
@@ -260,7 +198,13 @@ bool CurlCacheEntry::loadResponseHeaders()
         ++it;
     }
 
-    return parseResponseHeaders(m_cachedResponse);
+    // The expiration date was restored from the journal
+    return parseValidators(m_cachedResponse);
+}
+
+String CurlCacheEntry::mimeType() const
+{
+    return extractMIMETypeFromMediaType(m_cachedResponse.httpHeaderField(HTTPHeaderName::ContentType));
 }
 
 // Set response headers from memory
@@ -299,6 +243,12 @@ void CurlCacheEntry::didFail()
 }
 
 void CurlCacheEntry::didFinishLoading()
+{
+    closeContentFile();
+    m_contentComplete = true;
+}
+
+void CurlCacheEntry::didStoreBody()
 {
     setIsLoading(false);
 }
@@ -312,53 +262,18 @@ void CurlCacheEntry::generateBaseFilename(const CString& url)
     md5.checksum(sum);
     uint8_t* rawdata = sum.data();
 
+    m_urlHash = 0;
+    for (size_t i = 0; i < sizeof(m_urlHash); i++)
+        m_urlHash = (m_urlHash << 8) | rawdata[i];
+
     for (size_t i = 0; i < MD5::hashSize; i++)
         appendByteAsHex(rawdata[i], m_basename, Lowercase);
 }
 
-bool CurlCacheEntry::loadFileToBuffer(const String& filepath, Vector<char>& buffer)
-{
-    // Open the file
-    FileSystem::PlatformFileHandle inputFile = FileSystem::openFile(filepath, FileSystem::FileOpenMode::Read);
-    if (!FileSystem::isHandleValid(inputFile)) {
-        LOG(Network, "Cache Error: Could not open %s for read\n", filepath.latin1().data());
-        return false;
-    }
-
-    long long filesize = -1;
-    if (!FileSystem::getFileSize(filepath, filesize)) {
-        LOG(Network, "Cache Error: Could not get file size of %s\n", filepath.latin1().data());
-        FileSystem::closeFile(inputFile);
-        return false;
-    }
-
-    // Load the file content into buffer
-    buffer.resize(filesize);
-    int bufferPosition = 0;
-    int bufferReadSize = 40960;
-    int bytesRead = 0;
-    while (filesize > bufferPosition) {
-        if (filesize - bufferPosition < bufferReadSize)
-            bufferReadSize = filesize - bufferPosition;
-
-        bytesRead = FileSystem::readFromFile(inputFile, buffer.data() + bufferPosition, bufferReadSize);
-        if (bytesRead != bufferReadSize) {
-            LOG(Network, "Cache Error: Could not read from %s\n", filepath.latin1().data());
-            FileSystem::closeFile(inputFile);
-            return false;
-        }
-
-        bufferPosition += bufferReadSize;
-    }
-    FileSystem::closeFile(inputFile);
-    return true;
-}
-
 void CurlCacheEntry::invalidate()
 {
-    closeContentFile();
-    FileSystem::deleteFile(m_headerFilename);
-    FileSystem::deleteFile(m_contentFilename);
+    m_contentFileOpen = false;
+    m_ioQueue.remove(m_contentFilename);
     LOG(Network, "Cache: invalidated %s\n", m_basename.latin1().data());
 }
 
@@ -367,35 +282,77 @@ bool CurlCacheEntry::parseResponseHeaders(const ResourceResponse& response)
     if (response.cacheControlContainsNoCache() || response.cacheControlContainsNoStore() || !response.hasCacheValidatorFields())
         return false;
 
-    WallTime fileTime;
-
-    if (auto fileTimeFromFile = FileSystem::getFileModificationTime(m_headerFilename))
-        fileTime = fileTimeFromFile.value();
-    else
-        fileTime = WallTime::now(); // GMT
+    WallTime fileTime = WallTime::now(); // GMT
 
     auto maxAge = response.cacheControlMaxAge();
     auto lastModificationDate = response.lastModified();
     auto responseDate = response.date();
     auto expirationDate = response.expires();
+    // Time the response already spent in other caches
+    Seconds age = response.age().valueOr(0_s);
 
-    if (maxAge && !response.cacheControlContainsMustRevalidate()) {
+    if (maxAge) {
         // When both the cache entry and the response contain max-age, the lesser one takes priority
-        WallTime expires = fileTime + *maxAge;
+        WallTime expires = fileTime + *maxAge - age;
         if (m_expireDate == WallTime::fromRawSeconds(-1) || m_expireDate > expires)
             m_expireDate = expires;
-    } else if (responseDate && expirationDate) {
-        if (*expirationDate >= *responseDate)
-            m_expireDate = fileTime + (*expirationDate - *responseDate);
+    } else if (expirationDate) {
+        WallTime date = responseDate.valueOr(fileTime);
+        m_expireDate = *expirationDate >= date ? fileTime + (*expirationDate - date) - age : WallTime::fromRawSeconds(0);
     }
-    // If there is no lifetime information
+    // If there is no lifetime information, the heuristic lifetime only applies
+    // to responses that do not ask for revalidation (no-cache ones are not stored)
     if (m_expireDate == WallTime::fromRawSeconds(-1)) {
-        if (lastModificationDate)
+        if (lastModificationDate && !response.cacheControlContainsMustRevalidate())
             m_expireDate = fileTime + (fileTime - *lastModificationDate) * 0.1;
         else
             m_expireDate = WallTime::fromRawSeconds(0);
     }
 
+    return parseValidators(response);
+}
+
+// A 304 refreshes the stored headers and the expiration date, the stored
+// body is kept as is
+bool CurlCacheEntry::didRevalidate(const ResourceResponse& validatingResponse)
+{
+    updateResponseHeadersAfterRevalidation(m_cachedResponse, validatingResponse);
+    m_headersSize = serializedResponseHeaders().length();
+
+    m_expireDate = WallTime::fromRawSeconds(-1);
+    m_requestHeaders.clear();
+    return parseResponseHeaders(m_cachedResponse);
+}
+
+static Seconds parseStaleWhileRevalidate(const String& cacheControl)
+{
+    for (auto& directive : cacheControl.split(',')) {
+        String trimmed = directive.stripWhiteSpace();
+        if (!trimmed.startsWithIgnoringASCIICase("stale-while-revalidate="))
+            continue;
+        bool ok;
+        unsigned seconds = trimmed.substring(strlen("stale-while-revalidate=")).toUIntStrict(&ok);
+        if (ok)
+            return Seconds(seconds);
+    }
+    return 0_s;
+}
+
+bool CurlCacheEntry::parseValidators(const ResourceResponse& response)
+{
+    // must-revalidate forbids serving the response once it is stale
+    if (!response.cacheControlContainsMustRevalidate())
+        m_staleWhileRevalidate = parseStaleWhileRevalidate(response.httpHeaderField(HTTPHeaderName::CacheControl));
+    else
+        m_staleWhileRevalidate = 0_s;
+
+    // The request headers named by Vary are not kept with the entry, so it
+    // can't be matched against a new request and is always revalidated
+    if (!response.httpHeaderField(HTTPHeaderName::Vary).isEmpty()) {
+        m_expireDate = WallTime::fromRawSeconds(0);
+        m_staleWhileRevalidate = 0_s;
+    }
+
     String etag = response.httpHeaderField(HTTPHeaderName::ETag);
     if (!etag.isNull())
         m_requestHeaders.set(HTTPHeaderName::IfNoneMatch, etag);
@@ -420,58 +377,23 @@ void CurlCacheEntry::setIsLoading(bool isLoading)
         closeContentFile();
 }
 
-size_t CurlCacheEntry::entrySize()
-{
-    if (!m_entrySize) {
-        long long headerFileSize;
-        long long contentFileSize;
-
-#if PLATFORM(MUI)
-        if (!getFileSize(m_headerFilename, headerFileSize)) {
-#else
-        if (!FileSystem::getFileSize(m_headerFilename, headerFileSize)) {
-#endif
-            LOG(Network, "Cache Error: Could not get file size of %s\n", m_headerFilename.latin1().data());
-            return m_entrySize;
-        }
-#if PLATFORM(MUI)
-        if (!getFileSize(m_contentFilename, contentFileSize)) {
-#else
-        if (!FileSystem::getFileSize(m_contentFilename, contentFileSize)) {
-#endif
-            LOG(Network, "Cache Error: Could not get file size of %s\n", m_contentFilename.latin1().data());
-            return m_entrySize;
-        }
-
-        m_entrySize = headerFileSize + contentFileSize;
-    }
-
-    return m_entrySize;
-}
-
-
 bool CurlCacheEntry::openContentFile()
 {
-    if (FileSystem::isHandleValid(m_contentFile))
+    if (m_contentFileOpen)
         return true;
-    
-    m_contentFile = FileSystem::openFile(m_contentFilename, FileSystem::FileOpenMode::Write);
 
-    if (FileSystem::isHandleValid(m_contentFile))
-        return true;
-    
-    LOG(Network, "Cache Error: Could not open %s for write\n", m_contentFilename.latin1().data());
-    return false;
+    m_ioQueue.open(m_contentFilename);
+    m_contentFileOpen = true;
+    return true;
 }
 
 bool CurlCacheEntry::closeContentFile()
 {
-    if (!FileSystem::isHandleValid(m_contentFile))
+    if (!m_contentFileOpen)
         return true;
 
-    FileSystem::closeFile(m_contentFile);
-    m_contentFile = FileSystem::invalidPlatformFileHandle;
-
+    m_ioQueue.close(m_contentFilename);
+    m_contentFileOpen = false;
     return true;
 }
 
@@ -39,28 +39,61 @@
 
 namespace WebCore {
 
+class CurlCacheIOQueue;
+
 class CurlCacheEntry {
 
 public:
-    CurlCacheEntry(const String& url, ResourceHandle* job, const String& cacheDir);
+    CurlCacheEntry(const String& url, ResourceHandle* job, const String& cacheDir, CurlCacheIOQueue&);
     ~CurlCacheEntry();
 
+    // Expired entries stay cached, they are revalidated with the network
     bool isCached();
+    bool isFresh() const;
+    bool isStaleWhileRevalidate() const;
     bool isLoading() const;
-    size_t entrySize();
+    uint64_t identifier() const { return m_identifier; }
+    uint64_t urlHash() const { return m_urlHash; }
+    const String& basename() const { return m_basename; }
+    WallTime expireDate() const { return m_expireDate; }
     HTTPHeaderMap& requestHeaders() { return m_requestHeaders; }
 
+    // Content is written through the cache I/O queue to a file of the
+    // entry and then stored by the cache manager as a body named by its
+    // content, which entries with the same content share
     bool saveCachedData(const char* data, size_t);
-    bool readCachedData(ResourceHandle*);
+    const String& contentFilename() const { return m_contentFilename; }
+    size_t contentSize() const { return m_contentSize; }
+    size_t headersSize() const { return m_headersSize; }
+
+    void setBody(const String& name, const String& filename);
+    const String& bodyName() const { return m_bodyName; }
+    const String& bodyFilename() const { return m_bodyFilename; }
+    String mimeType() const;
+
+    // Size of the bytecode stored for the script of the entry, 0 until it
+    // was stored or loaded in this session
+    size_t bytecodeSize() const { return m_bytecodeSize; }
+    void setBytecodeSize(size_t size) { m_bytecodeSize = size; }
 
     bool saveResponseHeaders(const ResourceResponse&);
     void setResponseFromCachedHeaders(ResourceResponse&);
 
+    // State restored from the cache index journal. The headers point into
+    // the mapped journal and are only parsed once the entry is used.
+    void restoreFromJournal(WallTime expireDate, const char* headers, unsigned headersLength);
+    void setJournalHeaders(const char* headers, unsigned headersLength);
+    CString serializedResponseHeaders() const;
+
     void invalidate();
     void didFail();
+    // The entry keeps loading until its body is stored
     void didFinishLoading();
+    bool didFinishReceivingContent() const { return m_contentComplete; }
+    void didStoreBody();
 
     bool parseResponseHeaders(const ResourceResponse&);
+    bool didRevalidate(const ResourceResponse&);
 
     void setIsLoading(bool);
 
@@ -72,13 +105,21 @@ public:
 
 private:
     String m_basename;
-    String m_headerFilename;
     String m_contentFilename;
-
-    FileSystem::PlatformFileHandle m_contentFile;
-
-    size_t m_entrySize;
+    String m_bodyName;
+    String m_bodyFilename;
+    uint64_t m_identifier;
+    uint64_t m_urlHash;
+
+    CurlCacheIOQueue& m_ioQueue;
+    bool m_contentFileOpen;
+    bool m_contentComplete;
+
+    size_t m_contentSize;
+    size_t m_headersSize;
+    size_t m_bytecodeSize;
     WallTime m_expireDate;
+    Seconds m_staleWhileRevalidate;
     bool m_headerParsed;
     bool m_isLoading;
     ListHashSet<ResourceHandle*> m_clients;
@@ -88,16 +129,15 @@ private:
 
     ResourceHandle* m_job;
 
+    const char* m_journalHeaders;
+    unsigned m_journalHeadersLength;
+
     void generateBaseFilename(const CString& url);
-    bool loadFileToBuffer(const String& filepath, Vector<char>& buffer);
     bool loadResponseHeaders();
+    bool parseValidators(const ResourceResponse&);
 
     bool openContentFile();
     bool closeContentFile();
-
-#if PLATFORM(MUI)
-    bool getFileSize(const String& path, long long& result) const;
-#endif
 };
 
 } // namespace WebCore
@@ -0,0 +1,426 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "CurlCacheIOQueue.h"
+
+#if USE(CURL)
+
+#include "Logging.h"
+#include <wtf/FileSystem.h>
+#include <wtf/HexNumber.h>
+#include <wtf/MainThread.h>
+#include <wtf/text/CString.h>
+#include <wtf/text/StringBuilder.h>
+#include <wtf/text/StringConcatenate.h>
+#include <zlib.h>
+
+namespace WebCore {
+
+// Compressed files start with the length of their uncompressed content
+static Optional<Vector<char>> deflateData(const Vector<char>& data)
+{
+    uint64_t length = data.size();
+    uLongf compressedLength = compressBound(data.size());
+    Vector<char> buffer(sizeof(length) + compressedLength);
+    memcpy(buffer.data(), &length, sizeof(length));
+    // Favour speed, text bodies shrink well even at the lowest level
+    if (compress2(reinterpret_cast<Bytef*>(buffer.data() + sizeof(length)), &compressedLength, reinterpret_cast<const Bytef*>(data.data()), data.size(), Z_BEST_SPEED) != Z_OK)
+        return WTF::nullopt;
+    buffer.shrink(sizeof(length) + compressedLength);
+    return buffer;
+}
+
+static Optional<Vector<char>> inflateData(const Vector<char>& data)
+{
+    uint64_t length;
+    if (data.size() < sizeof(length))
+        return WTF::nullopt;
+    memcpy(&length, data.data(), sizeof(length));
+
+    // Deflate can not do better than about 1:1032
+    Vector<char> buffer;
+    if (length > (data.size() - sizeof(length)) * 1032 || !buffer.tryReserveCapacity(length))
+        return WTF::nullopt;
+    buffer.grow(length);
+
+    uLongf bufferLength = length;
+    if (uncompress(reinterpret_cast<Bytef*>(buffer.data()), &bufferLength, reinterpret_cast<const Bytef*>(data.data() + sizeof(length)), data.size() - sizeof(length)) != Z_OK || bufferLength != length) {
+        LOG(Network, "Cache Error: Could not inflate cached data\n");
+        return WTF::nullopt;
+    }
+    return buffer;
+}
+
+CurlCacheIOQueue::CurlCacheIOQueue(WriteFailureHandler&& writeFailureHandler)
+    : m_writeFailureHandler(WTFMove(writeFailureHandler))
+{
+}
+
+void CurlCacheIOQueue::open(const String& path)
+{
+    enqueue(OperationType::Open, path);
+}
+
+void CurlCacheIOQueue::append(const String& path, const char* data, size_t length)
+{
+    ASSERT(isMainThread());
+
+    {
+        auto locker = holdLock(m_lock);
+        waitForQueueSpace();
+        // Merge with a pending append to the same file unless another
+        // operation on that file was queued after it
+        for (auto it = m_operations.rbegin(); it != m_operations.rend(); ++it) {
+            if (it->path != path)
+                continue;
+            if (it->type != OperationType::Append)
+                break;
+            it->data.append(data, length);
+            m_queuedBytes += length;
+            return;
+        }
+    }
+
+    Vector<char> buffer;
+    buffer.append(data, length);
+    enqueue(OperationType::Append, path, WTFMove(buffer));
+}
+
+void CurlCacheIOQueue::close(const String& path)
+{
+    enqueue(OperationType::Close, path);
+}
+
+void CurlCacheIOQueue::remove(const String& path)
+{
+    enqueue(OperationType::Remove, path);
+}
+
+void CurlCacheIOQueue::appendToFile(const String& path, Vector<char>&& data)
+{
+    enqueue(OperationType::AppendToFile, path, WTFMove(data));
+}
+
+void CurlCacheIOQueue::replaceFile(const String& path, Vector<char>&& data)
+{
+    enqueue(OperationType::ReplaceFile, path, WTFMove(data));
+}
+
+void CurlCacheIOQueue::finishFile(const String& path, DigestCompletionHandler&& completionHandler)
+{
+    Operation operation;
+    operation.type = OperationType::FinishFile;
+    operation.path = path;
+    operation.digestCompletionHandler = WTFMove(completionHandler);
+    enqueue(WTFMove(operation));
+}
+
+void CurlCacheIOQueue::storeFile(const String& path, const String& destinationPath, bool compress, StoreCompletionHandler&& completionHandler)
+{
+    Operation operation;
+    operation.type = OperationType::StoreFile;
+    operation.path = path;
+    operation.destinationPath = destinationPath.isolatedCopy();
+    operation.compressed = compress;
+    operation.storeCompletionHandler = WTFMove(completionHandler);
+    enqueue(WTFMove(operation));
+}
+
+void CurlCacheIOQueue::read(const String& path, bool decompress, ReadCompletionHandler&& completionHandler)
+{
+    Operation operation;
+    operation.type = OperationType::Read;
+    operation.path = path;
+    operation.compressed = decompress;
+    operation.completionHandler = WTFMove(completionHandler);
+    enqueue(WTFMove(operation));
+}
+
+void CurlCacheIOQueue::enqueue(OperationType type, const String& path, Vector<char>&& data)
+{
+    Operation operation;
+    operation.type = type;
+    operation.path = path;
+    operation.data = WTFMove(data);
+    enqueue(WTFMove(operation));
+}
+
+void CurlCacheIOQueue::enqueue(Operation&& operation)
+{
+    ASSERT(isMainThread());
+
+    operation.path = operation.path.isolatedCopy();
+    {
+        auto locker = holdLock(m_lock);
+        waitForQueueSpace();
+        m_queuedBytes += operation.data.size();
+        m_operations.append(WTFMove(operation));
+    }
+    m_condition.notifyAll();
+
+    startThreadIfNeeded();
+}
+
+// Called with m_lock held
+void CurlCacheIOQueue::waitForQueueSpace()
+{
+    m_condition.wait(m_lock, [this] {
+        return m_queuedBytes < maximumQueuedBytes || m_stopping;
+    });
+}
+
+void CurlCacheIOQueue::startThreadIfNeeded()
+{
+    if (m_thread)
+        return;
+
+    m_thread = Thread::create("Curl cache I/O", [this] {
+        workerThread();
+    });
+}
+
+void CurlCacheIOQueue::stop()
+{
+    ASSERT(isMainThread());
+
+    if (!m_thread)
+        return;
+
+    {
+        auto locker = holdLock(m_lock);
+        m_stopping = true;
+    }
+    m_condition.notifyAll();
+
+    m_thread->waitForCompletion();
+    m_thread = nullptr;
+    m_stopping = false;
+}
+
+void CurlCacheIOQueue::workerThread()
+{
+    for (;;) {
+        Operation operation;
+        {
+            auto locker = holdLock(m_lock);
+            m_condition.wait(m_lock, [this] {
+                return !m_operations.isEmpty() || m_stopping;
+            });
+            if (m_operations.isEmpty())
+                break;
+            operation = m_operations.takeFirst();
+        }
+
+        size_t queuedBytes = operation.data.size();
+        bool success = perform(operation);
+
+        {
+            auto locker = holdLock(m_lock);
+            m_queuedBytes -= queuedBytes;
+        }
+        m_condition.notifyAll();
+
+        if (!success) {
+            callOnMainThread([this, path = operation.path.isolatedCopy()] {
+                m_writeFailureHandler(path);
+            });
+        }
+    }
+
+    for (auto* file : m_openFiles.values())
+        fclose(file);
+    m_openFiles.clear();
+}
+
+bool CurlCacheIOQueue::perform(Operation& operation)
+{
+    const String& path = operation.path;
+
+    switch (operation.type) {
+    case OperationType::Open: {
+        if (auto* file = m_openFiles.take(path))
+            fclose(file);
+        FILE* file = fopen(FileSystem::fileSystemRepresentation(path).data(), "wb");
+        if (!file) {
+            LOG(Network, "Cache Error: Could not open %s for write\n", path.latin1().data());
+            return false;
+        }
+        m_openFiles.set(path, file);
+        m_digests.set(path, MD5());
+        return true;
+    }
+    case OperationType::Append: {
+        FILE* file = m_openFiles.get(path);
+        if (!file || fwrite(operation.data.data(), 1, operation.data.size(), file) != operation.data.size()) {
+            m_digests.remove(path);
+            return false;
+        }
+        auto digest = m_digests.find(path);
+        if (digest != m_digests.end())
+            digest->value.addBytes(reinterpret_cast<const uint8_t*>(operation.data.data()), operation.data.size());
+        return true;
+    }
+    case OperationType::Close:
+        if (auto* file = m_openFiles.take(path)) {
+            if (fclose(file)) {
+                m_digests.remove(path);
+                return false;
+            }
+        }
+        return true;
+    case OperationType::Remove:
+        if (auto* file = m_openFiles.take(path))
+            fclose(file);
+        m_digests.remove(path);
+        FileSystem::deleteFile(path);
+        return true;
+    case OperationType::AppendToFile: {
+        FILE* file = fopen(FileSystem::fileSystemRepresentation(path).data(), "ab");
+        if (!file) {
+            LOG(Network, "Cache Error: Could not open %s for append\n", path.latin1().data());
+            return false;
+        }
+        bool success = fwrite(operation.data.data(), 1, operation.data.size(), file) == operation.data.size();
+        return !fclose(file) && success;
+    }
+    case OperationType::ReplaceFile: {
+        String temporaryPath = makeString(path, ".tmp");
+        if (!writeFile(temporaryPath, operation.data))
+            return false;
+        FileSystem::deleteFile(path);
+        return FileSystem::moveFile(temporaryPath, path);
+    }
+    case OperationType::FinishFile:
+        callOnMainThread([completionHandler = WTFMove(operation.digestCompletionHandler), digest = finishFile(path)]() mutable {
+            completionHandler(WTFMove(digest));
+        });
+        return true;
+    case OperationType::StoreFile:
+        callOnMainThread([completionHandler = WTFMove(operation.storeCompletionHandler), storedSize = storeFile(path, operation.destinationPath, operation.compressed)]() mutable {
+            completionHandler(storedSize);
+        });
+        return true;
+    case OperationType::Read: {
+        auto data = readFile(path);
+        if (data && operation.compressed)
+            data = inflateData(*data);
+        callOnMainThread([completionHandler = WTFMove(operation.completionHandler), data = WTFMove(data)]() mutable {
+            completionHandler(WTFMove(data));
+        });
+        return true;
+    }
+    }
+
+    ASSERT_NOT_REACHED();
+    return false;
+}
+
+bool CurlCacheIOQueue::writeFile(const String& path, const Vector<char>& data)
+{
+    FileSystem::PlatformFileHandle file = FileSystem::openFile(path, FileSystem::FileOpenMode::Write);
+    if (!FileSystem::isHandleValid(file)) {
+        LOG(Network, "Cache Error: Could not open %s for write\n", path.latin1().data());
+        return false;
+    }
+    bool success = FileSystem::writeToFile(file, data.data(), data.size()) == static_cast<int>(data.size());
+    FileSystem::closeFile(file);
+    if (!success)
+        FileSystem::deleteFile(path);
+    return success;
+}
+
+Optional<String> CurlCacheIOQueue::finishFile(const String& path)
+{
+    // The digest is dropped when a write fails
+    bool hasDigest = m_digests.contains(path);
+    auto digest = m_digests.take(path);
+    if (auto* file = m_openFiles.take(path)) {
+        if (fclose(file))
+            return WTF::nullopt;
+    }
+    if (!hasDigest)
+        return WTF::nullopt;
+
+    MD5::Digest sum;
+    digest.checksum(sum);
+    StringBuilder name;
+    for (size_t i = 0; i < MD5::hashSize; i++)
+        appendByteAsHex(sum[i], name, Lowercase);
+    return name.toString();
+}
+
+Optional<size_t> CurlCacheIOQueue::storeFile(const String& path, const String& destinationPath, bool compress)
+{
+    FileSystem::deleteFile(destinationPath);
+
+    Optional<size_t> storedSize;
+    if (compress) {
+        auto data = readFile(path);
+        Optional<Vector<char>> compressed;
+        if (data)
+            compressed = deflateData(*data);
+        if (compressed && writeFile(destinationPath, *compressed))
+            storedSize = compressed->size();
+        FileSystem::deleteFile(path);
+    } else {
+        long long size;
+        if (FileSystem::getFileSize(path, size) && size >= 0 && FileSystem::moveFile(path, destinationPath))
+            storedSize = static_cast<size_t>(size);
+        else
+            FileSystem::deleteFile(path);
+    }
+
+    if (!storedSize)
+        LOG(Network, "Cache Error: Could not store %s\n", destinationPath.latin1().data());
+    return storedSize;
+}
+
+Optional<Vector<char>> CurlCacheIOQueue::readFile(const String& path)
+{
+    FileSystem::PlatformFileHandle file = FileSystem::openFile(path, FileSystem::FileOpenMode::Read);
+    if (!FileSystem::isHandleValid(file)) {
+        LOG(Network, "Cache Error: Could not open %s for read\n", path.latin1().data());
+        return WTF::nullopt;
+    }
+
+    long long size;
+    if (!FileSystem::getFileSize(file, size) || size < 0) {
+        FileSystem::closeFile(file);
+        return WTF::nullopt;
+    }
+
+    Vector<char> buffer(static_cast<size_t>(size));
+    bool success = FileSystem::readFromFile(file, buffer.data(), buffer.size()) == static_cast<int>(buffer.size());
+    FileSystem::closeFile(file);
+    if (!success) {
+        LOG(Network, "Cache Error: Could not read from %s\n", path.latin1().data());
+        return WTF::nullopt;
+    }
+    return buffer;
+}
+
+} // namespace WebCore
+
+#endif // USE(CURL)
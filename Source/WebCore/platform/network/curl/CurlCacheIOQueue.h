@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <wtf/Condition.h>
+#include <wtf/Deque.h>
+#include <wtf/Function.h>
+#include <wtf/HashMap.h>
+#include <wtf/Lock.h>
+#include <wtf/MD5.h>
+#include <wtf/Noncopyable.h>
+#include <wtf/Optional.h>
+#include <wtf/Threading.h>
+#include <wtf/Vector.h>
+#include <wtf/text/StringHash.h>
+#include <wtf/text/WTFString.h>
+
+namespace WebCore {
+
+// Performs the file I/O of the disk cache on a dedicated thread. Writes are
+// queued behind the caller and consecutive appends to a file are coalesced
+// into one write. The queue is bounded: the caller waits while more than
+// maximumQueuedBytes are pending. Operations run in the order they were
+// queued, so a read sees every write queued before it.
+//
+// Files written with open()/append() are hashed as they are written so that
+// finishFile() can name their content without reading it back.
+class CurlCacheIOQueue {
+    WTF_MAKE_NONCOPYABLE(CurlCacheIOQueue);
+public:
+    using ReadCompletionHandler = WTF::Function<void(Optional<Vector<char>>&&)>;
+    using DigestCompletionHandler = WTF::Function<void(Optional<String>&&)>;
+    using StoreCompletionHandler = WTF::Function<void(Optional<size_t>)>;
+    using WriteFailureHandler = WTF::Function<void(const String& path)>;
+
+    static const size_t maximumQueuedBytes = 4 * 1024 * 1024;
+
+    // The failure handler is called on the main thread
+    explicit CurlCacheIOQueue(WriteFailureHandler&&);
+
+    // Truncates the file and keeps it open for append()
+    void open(const String& path);
+    void append(const String& path, const char* data, size_t);
+    void close(const String& path);
+    void remove(const String& path);
+    // Appends to a file that is not kept open
+    void appendToFile(const String& path, Vector<char>&&);
+    // Replaces a file through a temporary one
+    void replaceFile(const String& path, Vector<char>&&);
+
+    // The completion handlers are called on the main thread
+
+    // Closes a file written with append() and reports the MD5 of its
+    // content in hex, or nothing if a write to it failed
+    void finishFile(const String& path, DigestCompletionHandler&&);
+    // Moves a file to destinationPath, deflating it on the way if asked.
+    // Reports the size of the stored file.
+    void storeFile(const String& path, const String& destinationPath, bool compress, StoreCompletionHandler&&);
+    // Reads a file, inflating a file stored compressed by storeFile()
+    void read(const String& path, bool decompress, ReadCompletionHandler&&);
+
+    // Runs the queued operations and stops the thread
+    void stop();
+
+private:
+    enum class OperationType { Open, Append, Close, Remove, AppendToFile, ReplaceFile, FinishFile, StoreFile, Read };
+
+    struct Operation {
+        OperationType type { OperationType::Open };
+        String path;
+        Vector<char> data;
+        String destinationPath;
+        bool compressed { false };
+        ReadCompletionHandler completionHandler;
+        DigestCompletionHandler digestCompletionHandler;
+        StoreCompletionHandler storeCompletionHandler;
+    };
+
+    void enqueue(OperationType, const String& path, Vector<char>&& = { });
+    void enqueue(Operation&&);
+    void waitForQueueSpace();
+    void startThreadIfNeeded();
+    void workerThread();
+
+    bool perform(Operation&);
+    Optional<Vector<char>> readFile(const String& path);
+    bool writeFile(const String& path, const Vector<char>&);
+    Optional<String> finishFile(const String& path);
+    Optional<size_t> storeFile(const String& path, const String& destinationPath, bool compress);
+
+    Lock m_lock;
+    Condition m_condition;
+    Deque<Operation> m_operations;
+    size_t m_queuedBytes { 0 };
+    bool m_stopping { false };
+    RefPtr<Thread> m_thread;
+
+    // Only used on the I/O thread
+    HashMap<String, FILE*> m_openFiles;
+    HashMap<String, MD5> m_digests;
+
+    WriteFailureHandler m_writeFailureHandler;
+};
+
+} // namespace WebCore
@@ -30,20 +30,154 @@
 
 #include "CurlCacheManager.h"
 
+#include "CurlContext.h"
+#include "CurlRequest.h"
+#include "CurlRequestClient.h"
+#include "CurlResponse.h"
 #include "HTTPHeaderMap.h"
 #include "Logging.h"
+#include "MIMETypeRegistry.h"
 #include "ResourceHandleClient.h"
 #include "ResourceHandleInternal.h"
 #include "ResourceRequest.h"
+#include "SharedBuffer.h"
 #include <wtf/FileSystem.h>
+#include <wtf/ThreadSafeRefCounted.h>
 #include <wtf/HashMap.h>
 #include <wtf/NeverDestroyed.h>
+#include <wtf/StdLibExtras.h>
 #include <wtf/text/CString.h>
-
-#define IO_BUFFERSIZE 40960
+#include <wtf/text/StringConcatenate.h>
+
+#define JOURNAL_FILENAME "index.journal"
+#define JOURNAL_VERSION 2
+#define LEGACY_INDEX_FILENAME "index.dat"
+// Rewrite the journal once it holds this many records per live entry
+#define JOURNAL_COMPACTION_RATIO 2
+#define JOURNAL_COMPACTION_MINIMUM 256
+#define BODY_EXTENSION ".body"
+#define COMPRESSED_BODY_SUFFIX "-z"
+#define BYTECODE_EXTENSION ".jsc"
 
 namespace WebCore {
 
+/*
+ * Index journal
+ *
+ * The index is a single append-only file: a header followed by records of
+ * fixed size, each insert record followed by the URL and the response
+ * headers of its entry. Touch records move an entry up in the LRU list and
+ * remove records drop it. At startup the journal is mapped and replayed
+ * without opening any entry file; the headers of an entry are parsed from
+ * the mapping and its body file checked only when the entry is first used.
+ * Records are buffered in memory and handed to the I/O thread by saveIndex(),
+ * which rewrites the journal instead once it holds mostly dead records.
+ */
+struct CacheJournalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+enum CacheJournalRecordType : uint32_t {
+    CacheJournalInsert = 1,
+    CacheJournalTouch,
+    CacheJournalRemove
+};
+
+enum CacheJournalRecordFlags : uint32_t {
+    CacheJournalCompressedBody = 1 << 0
+};
+
+struct CacheJournalRecord {
+    uint32_t type;
+    uint32_t urlLength;
+    uint32_t headersLength;
+    uint32_t flags;
+    uint64_t urlHash;
+    uint64_t bodySize;
+    double expireDate;
+    uint64_t stamp;
+    char bodyHash[32];
+};
+
+static const char journalMagic[8] = { 'O', 'W', 'B', 'C', 'J', 'R', 'N', 'L' };
+
+// Keeps the records 8 byte aligned in the mapping
+static size_t journalPayloadLength(const CacheJournalRecord& record)
+{
+    return roundUpToMultipleOf<8>(static_cast<size_t>(record.urlLength) + record.headersLength);
+}
+
+static bool isCompressedBody(const String& name)
+{
+    return name.endsWith(COMPRESSED_BODY_SUFFIX);
+}
+
+// Text compresses well and is cheap to inflate, media types are already
+// compressed
+static bool isCompressibleMIMEType(const String& mimeType)
+{
+    return mimeType.startsWithIgnoringASCIICase("text/")
+        || MIMETypeRegistry::isSupportedJavaScriptMIMEType(mimeType)
+        || MIMETypeRegistry::isSupportedJSONMIMEType(mimeType)
+        || MIMETypeRegistry::isXMLMIMEType(mimeType);
+}
+
+// Sends the conditional request for an entry served under
+// stale-while-revalidate. Only a 304 refreshes the entry; any other answer
+// drops it and the next load fetches it in full with the page's cookies.
+class CurlCacheRevalidator final : public ThreadSafeRefCounted<CurlCacheRevalidator>, public CurlRequestClient {
+public:
+    static Ref<CurlCacheRevalidator> create(const String& url, const HTTPHeaderMap& validators)
+    {
+        return adoptRef(*new CurlCacheRevalidator(url, validators));
+    }
+
+    void ref() override { ThreadSafeRefCounted<CurlCacheRevalidator>::ref(); }
+    void deref() override { ThreadSafeRefCounted<CurlCacheRevalidator>::deref(); }
+
+    void start()
+    {
+        CurlContext::singleton();
+        m_curlRequest->start();
+    }
+
+private:
+    CurlCacheRevalidator(const String& url, const HTTPHeaderMap& validators)
+        : m_url(url)
+    {
+        ResourceRequest request { URL({ }, url) };
+        for (const auto& header : validators)
+            request.addHTTPHeaderField(header.key, header.value);
+        m_curlRequest = CurlRequest::create(request, *this);
+    }
+
+    void curlDidSendData(CurlRequest&, unsigned long long, unsigned long long) override { }
+
+    void curlDidReceiveResponse(CurlRequest& request, const CurlResponse& receivedResponse) override
+    {
+        request.invalidateClient();
+        request.cancel();
+        CurlCacheManager::singleton().didRevalidateInBackground(m_url, ResourceResponse(receivedResponse));
+    }
+
+    void curlDidReceiveBuffer(CurlRequest&, Ref<SharedBuffer>&&) override { }
+
+    void curlDidComplete(CurlRequest&) override
+    {
+        CurlCacheManager::singleton().m_revalidations.remove(m_url);
+    }
+
+    void curlDidFailWithError(CurlRequest&, const ResourceError&) override
+    {
+        CurlCacheManager::singleton().m_revalidations.remove(m_url);
+    }
+
+    String m_url;
+    RefPtr<CurlRequest> m_curlRequest;
+};
+
 CurlCacheManager& CurlCacheManager::singleton()
 {
     static NeverDestroyed<CurlCacheManager> sharedInstance;
@@ -52,8 +186,12 @@ CurlCacheManager& CurlCacheManager::singleton()
 
 CurlCacheManager::CurlCacheManager()
     : m_disabled(true)
+    , m_ioQueue([this](const String& path) { didFailToWrite(path); })
     , m_currentStorageSize(0)
     , m_storageSizeLimit(52428800) // 50 * 1024 * 1024 bytes
+    , m_journalRecordCount(0)
+    , m_journalStamp(0)
+    , m_journalNeedsCompaction(true)
 {
     // Call setCacheDirectory() to enable the Cache Manager
 }
@@ -64,6 +202,7 @@ CurlCacheManager::~CurlCacheManager()
         return;
 
     saveIndex();
+    m_ioQueue.stop();
 }
 
 void CurlCacheManager::setCacheDirectory(const String& directory)
@@ -88,6 +227,7 @@ void CurlCacheManager::setCacheDirectory(const String& directory)
 
     m_disabled = false;
     loadIndex();
+    loadBytecodeSizes();
 }
 
 void CurlCacheManager::setStorageSizeLimit(size_t sizeLimit)
@@ -95,69 +235,226 @@ void CurlCacheManager::setStorageSizeLimit(size_t sizeLimit)
     m_storageSizeLimit = sizeLimit;
 }
 
+String CurlCacheManager::journalPath() const
+{
+    return makeString(m_cacheDir, JOURNAL_FILENAME);
+}
+
+String CurlCacheManager::bodyPath(const String& name) const
+{
+    return makeString(m_cacheDir, name, BODY_EXTENSION);
+}
+
+String CurlCacheManager::bytecodePath(const CurlCacheEntry& entry) const
+{
+    return makeString(m_cacheDir, entry.basename(), '-', entry.bodyName(), BYTECODE_EXTENSION);
+}
+
+// Counts the bytecode files of the indexed entries in the storage size and
+// deletes the ones whose entry was dropped while the cache wasn't running
+void CurlCacheManager::loadBytecodeSizes()
+{
+    HashMap<String, CurlCacheEntry*> entries;
+    for (auto& entry : m_index.values()) {
+        if (!entry->bodyName().isEmpty())
+            entries.add(FileSystem::pathGetFileName(bytecodePath(*entry)), entry.get());
+    }
+
+    for (auto& path : FileSystem::listDirectory(m_cacheDir, "*" BYTECODE_EXTENSION)) {
+        long long size;
+        CurlCacheEntry* entry = entries.get(FileSystem::pathGetFileName(path));
+        if (!entry || !FileSystem::getFileSize(path, size)) {
+            m_ioQueue.remove(path);
+            continue;
+        }
+        entry->setBytecodeSize(size);
+        m_currentStorageSize += size;
+    }
+
+    makeRoomForNewEntry();
+}
+
+static void removeCacheFiles(const String& directory)
+{
+    for (auto& path : FileSystem::listDirectory(directory, "*.header"))
+        FileSystem::deleteFile(path);
+    for (auto& path : FileSystem::listDirectory(directory, "*.content"))
+        FileSystem::deleteFile(path);
+    for (auto& path : FileSystem::listDirectory(directory, "*" BODY_EXTENSION))
+        FileSystem::deleteFile(path);
+    for (auto& path : FileSystem::listDirectory(directory, "*" BYTECODE_EXTENSION))
+        FileSystem::deleteFile(path);
+    FileSystem::deleteFile(makeString(directory, LEGACY_INDEX_FILENAME));
+}
+
 void CurlCacheManager::loadIndex()
 {
     if (m_disabled)
         return;
 
-    String indexFilePath(m_cacheDir);
-    indexFilePath.append("index.dat");
+    // Entries of the old text index keep their headers in separate files
+    if (FileSystem::fileExists(makeString(m_cacheDir, LEGACY_INDEX_FILENAME))) {
+        LOG(Network, "Cache: discarding entries of the old index format\n");
+        removeCacheFiles(m_cacheDir);
+        return;
+    }
 
-    FileSystem::PlatformFileHandle indexFile = FileSystem::openFile(indexFilePath, FileSystem::FileOpenMode::Read);
-    if (!FileSystem::isHandleValid(indexFile)) {
-        LOG(Network, "Cache Warning: Could not open %s for read\n", indexFilePath.latin1().data());
+    String indexFilePath = journalPath();
+    bool success;
+    FileSystem::MappedFileData journal(indexFilePath, success);
+    if (!success) {
+        LOG(Network, "Cache Warning: Could not map %s\n", indexFilePath.latin1().data());
         return;
     }
 
-    long long filesize = -1;
-    if (!FileSystem::getFileSize(indexFilePath, filesize)) {
-        LOG(Network, "Cache Error: Could not get file size of %s\n", indexFilePath.latin1().data());
-        FileSystem::closeFile(indexFile);
+    const char* data = static_cast<const char*>(journal.data());
+    size_t size = journal.size();
+    auto* header = reinterpret_cast<const CacheJournalHeader*>(data);
+    if (size < sizeof(CacheJournalHeader) || memcmp(header->magic, journalMagic, sizeof(journalMagic)) || header->version != JOURNAL_VERSION) {
+        LOG(Network, "Cache Error: Invalid index %s, discarding cache\n", indexFilePath.latin1().data());
+        removeCacheFiles(m_cacheDir);
         return;
     }
 
-    // Load the file content into buffer
-    Vector<char> buffer;
-    buffer.resize(filesize);
-    int bufferPosition = 0;
-    int bufferReadSize = IO_BUFFERSIZE;
-    while (filesize > bufferPosition) {
-        if (filesize - bufferPosition < bufferReadSize)
-            bufferReadSize = filesize - bufferPosition;
-
-        FileSystem::readFromFile(indexFile, buffer.data() + bufferPosition, bufferReadSize);
-        bufferPosition += bufferReadSize;
+    // Replay the journal, last record for a URL hash wins
+    struct JournalEntry {
+        const CacheJournalRecord* record;
+        uint64_t stamp;
+    };
+    HashMap<uint64_t, JournalEntry> entries;
+    size_t offset = sizeof(CacheJournalHeader);
+    size_t recordCount = 0;
+    while (size - offset >= sizeof(CacheJournalRecord)) {
+        auto* record = reinterpret_cast<const CacheJournalRecord*>(data + offset);
+        size_t payloadLength = journalPayloadLength(*record);
+        if (payloadLength > size - offset - sizeof(CacheJournalRecord))
+            break;
+        offset += sizeof(CacheJournalRecord) + payloadLength;
+        recordCount++;
+
+        m_journalStamp = std::max(m_journalStamp, record->stamp);
+        if (!HashMap<uint64_t, JournalEntry>::isValidKey(record->urlHash))
+            continue;
+
+        switch (record->type) {
+        case CacheJournalInsert:
+            entries.set(record->urlHash, JournalEntry { record, record->stamp });
+            break;
+        case CacheJournalTouch: {
+            auto it = entries.find(record->urlHash);
+            if (it != entries.end())
+                it->value.stamp = record->stamp;
+            break;
+        }
+        case CacheJournalRemove:
+            entries.remove(record->urlHash);
+            break;
+        }
     }
-    FileSystem::closeFile(indexFile);
-
-    // Create strings from buffer
-    String headerContent = String(buffer.data(), buffer.size());
-    Vector<String> indexURLs = headerContent.split('\n');
-    buffer.clear();
-
-    // Add entries to index
-    Vector<String>::const_iterator it = indexURLs.begin();
-    Vector<String>::const_iterator end = indexURLs.end();
-    if (indexURLs.size() > 1)
-        --end; // Last line is empty
-    while (it != end) {
-        String url = it->stripWhiteSpace();
-        auto cacheEntry = std::make_unique<CurlCacheEntry>(url, nullptr, m_cacheDir);
 
-#if PLATFORM(MUI)
-        if (cacheEntry->entrySize() && cacheEntry->entrySize() < m_storageSizeLimit) {
-#else
-        if (cacheEntry->isCached() && cacheEntry->entrySize() < m_storageSizeLimit) {
-#endif
-            m_currentStorageSize += cacheEntry->entrySize();
+    // A partially written tail is dropped by rewriting the journal
+    m_journalNeedsCompaction = offset != size;
+    m_journalRecordCount = recordCount;
+
+    Vector<JournalEntry> liveEntries;
+    liveEntries.reserveInitialCapacity(entries.size());
+    for (auto& entry : entries.values())
+        liveEntries.uncheckedAppend(entry);
+    std::sort(liveEntries.begin(), liveEntries.end(), [](const JournalEntry& a, const JournalEntry& b) {
+        return a.stamp < b.stamp;
+    });
+
+    // Add entries to index, least recently used first
+    for (auto& liveEntry : liveEntries) {
+        const CacheJournalRecord& record = *liveEntry.record;
+        const char* payload = reinterpret_cast<const char*>(liveEntry.record + 1);
+        String url(payload, record.urlLength);
+        String bodyName = makeString(String(record.bodyHash, sizeof(record.bodyHash)), (record.flags & CacheJournalCompressedBody) ? COMPRESSED_BODY_SUFFIX : "");
+        auto cacheEntry = std::make_unique<CurlCacheEntry>(url, nullptr, m_cacheDir, m_ioQueue);
+        cacheEntry->restoreFromJournal(WallTime::fromRawSeconds(record.expireDate), payload + record.urlLength, record.headersLength);
+        cacheEntry->setBody(bodyName, bodyPath(bodyName));
+
+        if (record.bodySize + record.headersLength < m_storageSizeLimit) {
+            m_currentStorageSize += cacheEntry->headersSize();
+            retainBody(bodyName, record.bodySize);
             makeRoomForNewEntry();
             m_LRUEntryList.prependOrMoveToFirst(url);
             m_index.set(url, WTFMove(cacheEntry));
-        } else
-            cacheEntry->invalidate();
+        } else {
+            if (!m_bodies.contains(bodyName))
+                m_ioQueue.remove(bodyPath(bodyName));
+            m_journalNeedsCompaction = true;
+        }
+    }
+
+    m_journal = WTFMove(journal);
+}
 
-        ++it;
+void CurlCacheManager::appendJournalRecord(uint32_t type, const String& url, CurlCacheEntry& entry)
+{
+    CacheJournalRecord record { };
+    record.type = type;
+    record.urlHash = entry.urlHash();
+    record.stamp = ++m_journalStamp;
+
+    CString urlLatin1;
+    CString headers;
+    if (type == CacheJournalInsert) {
+        urlLatin1 = url.latin1();
+        headers = entry.serializedResponseHeaders();
+        record.urlLength = urlLatin1.length();
+        record.headersLength = headers.length();
+        record.expireDate = entry.expireDate().secondsSinceEpoch().seconds();
+
+        const String& bodyName = entry.bodyName();
+        ASSERT(bodyName.length() >= sizeof(record.bodyHash));
+        record.bodySize = m_bodies.get(bodyName).storedSize;
+        if (isCompressedBody(bodyName))
+            record.flags |= CacheJournalCompressedBody;
+        for (size_t i = 0; i < sizeof(record.bodyHash) && i < bodyName.length(); i++)
+            record.bodyHash[i] = bodyName[i];
+    }
+
+    size_t recordOffset = m_pendingJournal.size();
+    m_pendingJournal.grow(recordOffset + sizeof(CacheJournalRecord) + journalPayloadLength(record));
+    char* buffer = m_pendingJournal.data() + recordOffset;
+    memset(buffer, 0, m_pendingJournal.size() - recordOffset);
+    memcpy(buffer, &record, sizeof(record));
+    if (record.urlLength)
+        memcpy(buffer + sizeof(record), urlLatin1.data(), record.urlLength);
+    if (record.headersLength)
+        memcpy(buffer + sizeof(record) + record.urlLength, headers.data(), record.headersLength);
+
+    m_journalRecordCount++;
+}
+
+void CurlCacheManager::flushJournal()
+{
+    if (m_pendingJournal.isEmpty())
+        return;
+
+    m_ioQueue.appendToFile(journalPath(), std::exchange(m_pendingJournal, { }));
+}
+
+void CurlCacheManager::compactJournal()
+{
+    CacheJournalHeader header { };
+    memcpy(header.magic, journalMagic, sizeof(journalMagic));
+    header.version = JOURNAL_VERSION;
+
+    // Rebuild the journal from memory, oldest entry first so that replaying
+    // it restores the LRU order
+    m_pendingJournal.clear();
+    m_pendingJournal.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_journalRecordCount = 0;
+    m_journalStamp = 0;
+    for (auto it = m_LRUEntryList.rbegin(); it != m_LRUEntryList.rend(); ++it) {
+        auto entry = m_index.find(*it);
+        if (entry != m_index.end() && !entry->value->isLoading())
+            appendJournalRecord(CacheJournalInsert, *it, *entry->value);
     }
+
+    m_ioQueue.replaceFile(journalPath(), std::exchange(m_pendingJournal, { }));
 }
 
 void CurlCacheManager::saveIndex()
@@ -165,29 +462,115 @@ void CurlCacheManager::saveIndex()
     if (m_disabled)
         return;
 
-    String indexFilePath(m_cacheDir);
-    indexFilePath.append("index.dat");
+    bool needsCompaction = m_journalNeedsCompaction
+        || (m_journalRecordCount > JOURNAL_COMPACTION_MINIMUM && m_journalRecordCount > m_index.size() * JOURNAL_COMPACTION_RATIO);
+    // Write errors are reported through didFailToWrite()
+    m_journalNeedsCompaction = false;
+    if (needsCompaction)
+        compactJournal();
+    else
+        flushJournal();
+}
 
-    FileSystem::deleteFile(indexFilePath);
-    FileSystem::PlatformFileHandle indexFile = FileSystem::openFile(indexFilePath, FileSystem::FileOpenMode::Write);
-    if (!FileSystem::isHandleValid(indexFile)) {
-        LOG(Network, "Cache Error: Could not open %s for write\n", indexFilePath.latin1().data());
+#if PLATFORM(MUI)
+void CurlCacheManager::shutdown()
+{
+    saveIndex();
+    m_ioQueue.stop();
+}
+#endif
+
+void CurlCacheManager::didFailToWrite(const String& path)
+{
+    if (path == journalPath()) {
+        m_journalNeedsCompaction = true;
         return;
     }
 
-    auto it = m_LRUEntryList.begin();
-    const auto& end = m_LRUEntryList.end();
-    while (it != end) {
-        auto iit = m_index.find(*it);
-        if (iit != m_index.end() && !iit->value->isLoading()) {
-            const CString& urlLatin1 = it->latin1();
-            FileSystem::writeToFile(indexFile, urlLatin1.data(), urlLatin1.length());
-            FileSystem::writeToFile(indexFile, "\n", 1);
+    for (auto& entry : m_index) {
+        if (entry.value->contentFilename() == path) {
+            invalidateCacheEntry(entry.key);
+            return;
         }
-        ++it;
     }
+}
 
-    FileSystem::closeFile(indexFile);
+void CurlCacheManager::decreaseStorageSize(size_t size)
+{
+    if (m_currentStorageSize < size)
+        m_currentStorageSize = 0;
+    else
+        m_currentStorageSize -= size;
+}
+
+void CurlCacheManager::retainBody(const String& name, size_t storedSize)
+{
+    auto& body = m_bodies.add(name, CacheBody { }).iterator->value;
+    body.refCount++;
+    if (storedSize > body.storedSize) {
+        m_currentStorageSize += storedSize - body.storedSize;
+        body.storedSize = storedSize;
+    }
+}
+
+void CurlCacheManager::releaseBody(const String& name)
+{
+    auto body = m_bodies.find(name);
+    if (body == m_bodies.end() || --body->value.refCount)
+        return;
+
+    decreaseStorageSize(body->value.storedSize);
+    m_ioQueue.remove(bodyPath(name));
+    m_bodies.remove(body);
+}
+
+CurlCacheEntry* CurlCacheManager::loadingEntry(const String& url, uint64_t identifier)
+{
+    auto it = m_index.find(url);
+    if (it == m_index.end() || it->value->identifier() != identifier || !it->value->isLoading())
+        return nullptr;
+    return it->value.get();
+}
+
+// The content of a loaded entry replaces its content file by the body with
+// the same content, or becomes a new body
+void CurlCacheManager::storeBody(const String& url, CurlCacheEntry& entry, const String& bodyName)
+{
+    decreaseStorageSize(entry.contentSize());
+    entry.setBody(bodyName, bodyPath(bodyName));
+
+    bool isStored = m_bodies.contains(bodyName);
+    retainBody(bodyName, 0);
+    if (isStored) {
+        m_ioQueue.remove(entry.contentFilename());
+        didStoreBody(url, entry);
+        return;
+    }
+
+    m_ioQueue.storeFile(entry.contentFilename(), bodyPath(bodyName), isCompressedBody(bodyName), [this, url = url, identifier = entry.identifier(), bodyName](Optional<size_t> storedSize) {
+        // The body may have been released while it was stored
+        auto body = m_bodies.find(bodyName);
+        if (storedSize && body != m_bodies.end()) {
+            body->value.storedSize = *storedSize;
+            m_currentStorageSize += *storedSize;
+        }
+
+        auto* entry = loadingEntry(url, identifier);
+        if (!entry)
+            return;
+        if (!storedSize) {
+            invalidateCacheEntry(url);
+            return;
+        }
+        didStoreBody(url, *entry);
+        makeRoomForNewEntry();
+    });
+}
+
+void CurlCacheManager::didStoreBody(const String& url, CurlCacheEntry& entry)
+{
+    entry.didStoreBody();
+    appendJournalRecord(CacheJournalInsert, url, entry);
 }
 
 void CurlCacheManager::makeRoomForNewEntry()
@@ -226,7 +609,9 @@ void CurlCacheManager::didReceiveResponse(ResourceHandle& job, ResourceResponse&
         if (job.firstRequest().httpMethod() != "GET")
             return;
 
-        auto cacheEntry = std::make_unique<CurlCacheEntry>(url, &job, m_cacheDir);
+        m_statistics.misses++;
+
+        auto cacheEntry = std::make_unique<CurlCacheEntry>(url, &job, m_cacheDir, m_ioQueue);
         bool cacheable = cacheEntry->parseResponseHeaders(response);
         if (cacheable) {
             cacheEntry->setIsLoading(true);
@@ -250,8 +635,22 @@ void CurlCacheManager::didFinishLoading(ResourceHandle& job)
 
     const String& url = job.firstRequest().url().string();
     auto it = m_index.find(url);
-    if (it != m_index.end())
-        it->value->didFinishLoading();
+    if (it == m_index.end() || !it->value->isLoading() || it->value->didFinishReceivingContent())
+        return;
+
+    auto& entry = *it->value;
+    entry.didFinishLoading();
+    bool compress = isCompressibleMIMEType(entry.mimeType());
+    m_ioQueue.finishFile(entry.contentFilename(), [this, url = url, identifier = entry.identifier(), compress](Optional<String>&& contentHash) {
+        auto* entry = loadingEntry(url, identifier);
+        if (!entry)
+            return;
+        if (!contentHash) {
+            invalidateCacheEntry(url);
+            return;
+        }
+        storeBody(url, *entry, compress ? makeString(*contentHash, COMPRESSED_BODY_SUFFIX) : *contentHash);
+    });
 }
 
 bool CurlCacheManager::isCached(const String& url)
@@ -281,16 +680,105 @@ HTTPHeaderMap& CurlCacheManager::requestHeaders(const String& url)
     return m_index.find(url)->value->requestHeaders();
 }
 
+// Called with the 304 answering a conditional request
 bool CurlCacheManager::getCachedResponse(const String& url, ResourceResponse& response)
 {
     auto it = m_index.find(url);
     if (it != m_index.end() && it->value->isCached() && !it->value->isLoading()) {
+        revalidateEntry(url, *it->value, response);
+        m_statistics.revalidatedHits++;
         it->value->setResponseFromCachedHeaders(response);
         return true;
     }
     return false;
 }
 
+bool CurlCacheManager::getFreshResponse(const String& url, ResourceResponse& response)
+{
+    if (!isCached(url))
+        return false;
+
+    auto& entry = *m_index.find(url)->value;
+    if (entry.isFresh())
+        m_statistics.freshHits++;
+    else if (entry.isStaleWhileRevalidate()) {
+        m_statistics.staleHits++;
+        revalidateInBackground(url, entry);
+    } else
+        return false;
+
+    entry.setResponseFromCachedHeaders(response);
+    return true;
+}
+
+CurlCacheEntry* CurlCacheManager::entryWithBody(const String& url)
+{
+    if (!isCached(url))
+        return nullptr;
+
+    auto& entry = *m_index.find(url)->value;
+    return entry.bodyName().isEmpty() ? nullptr : &entry;
+}
+
+// Read on the calling thread, the script waits for it anyway
+FileSystem::MappedFileData CurlCacheManager::loadBytecode(const String& url)
+{
+    auto* entry = entryWithBody(url);
+    if (!entry || !entry->bytecodeSize())
+        return { };
+
+    bool success;
+    return FileSystem::MappedFileData(bytecodePath(*entry), success);
+}
+
+bool CurlCacheManager::storeBytecode(const String& url, Vector<char>&& bytecode)
+{
+    auto* entry = entryWithBody(url);
+    if (!entry)
+        return false;
+
+    decreaseStorageSize(entry->bytecodeSize());
+    entry->setBytecodeSize(bytecode.size());
+    m_currentStorageSize += bytecode.size();
+    m_ioQueue.replaceFile(bytecodePath(*entry), WTFMove(bytecode));
+    makeRoomForNewEntry();
+    return true;
+}
+
+void CurlCacheManager::revalidateInBackground(const String& url, CurlCacheEntry& entry)
+{
+    if (m_revalidations.contains(url))
+        return;
+
+    auto revalidator = CurlCacheRevalidator::create(url, entry.requestHeaders());
+    m_revalidations.add(url, revalidator.copyRef());
+    revalidator->start();
+}
+
+void CurlCacheManager::didRevalidateInBackground(const String& url, const ResourceResponse& response)
+{
+    auto protectedRevalidator = m_revalidations.take(url);
+
+    auto it = m_index.find(url);
+    if (it == m_index.end() || it->value->isLoading())
+        return;
+
+    if (response.httpStatusCode() != 304 || !revalidateEntry(url, *it->value, response))
+        invalidateCacheEntry(url);
+}
+
+bool CurlCacheManager::revalidateEntry(const String& url, CurlCacheEntry& entry, const ResourceResponse& response)
+{
+    size_t headersSize = entry.headersSize();
+    bool cacheable = entry.didRevalidate(response);
+    decreaseStorageSize(headersSize);
+    m_currentStorageSize += entry.headersSize();
+
+    if (cacheable)
+        appendJournalRecord(CacheJournalInsert, url, entry);
+    return cacheable;
+}
+
 void CurlCacheManager::didReceiveData(ResourceHandle& job, const char* data, size_t size)
 {
     if (m_disabled)
@@ -320,9 +808,12 @@ void CurlCacheManager::saveResponseHeaders(const String& url, ResourceResponse&
         return;
 
     auto it = m_index.find(url);
-    if (it != m_index.end())
+    if (it != m_index.end()) {
         if (!it->value->saveResponseHeaders(response))
             invalidateCacheEntry(url);
+        else
+            m_currentStorageSize += it->value->headersSize();
+    }
 }
 
 void CurlCacheManager::invalidateCacheEntry(const String& url)
@@ -332,11 +823,20 @@ void CurlCacheManager::invalidateCacheEntry(const String& url)
 
     auto it = m_index.find(url);
     if (it != m_index.end()) {
-        if (m_currentStorageSize < it->value->entrySize())
-            m_currentStorageSize = 0;
-        else
-            m_currentStorageSize -= it->value->entrySize();
+        // Until its body is stored the content of an entry is its own
+        decreaseStorageSize(it->value->headersSize());
+        if (it->value->bodyName().isEmpty())
+            decreaseStorageSize(it->value->contentSize());
+        else {
+            releaseBody(it->value->bodyName());
+            if (it->value->bytecodeSize()) {
+                decreaseStorageSize(it->value->bytecodeSize());
+                m_ioQueue.remove(bytecodePath(*it->value));
+            }
+        }
 
+        if (!it->value->isLoading())
+            appendJournalRecord(CacheJournalRemove, url, *it->value);
         it->value->invalidate();
         m_index.remove(url);
     }
@@ -386,9 +886,33 @@ void CurlCacheManager::readCachedData(const String& url, ResourceHandle* job, Re
     if (it != m_index.end()) {
         it->value->setResponseFromCachedHeaders(response);
         m_LRUEntryList.prependOrMoveToFirst(url);
-        if (!it->value->readCachedData(job))
-            invalidateCacheEntry(url);
+        appendJournalRecord(CacheJournalTouch, url, *it->value);
+
+        // The body is read on the I/O thread and handed over without a copy
+        m_pendingReads.add(job, Vector<WTF::Function<void()>>());
+        const String& bodyName = it->value->bodyName();
+        m_ioQueue.read(it->value->bodyFilename(), isCompressedBody(bodyName), [this, url = url, job = makeRef(*job)](Optional<Vector<char>>&& data) {
+            if (!data)
+                invalidateCacheEntry(url);
+            else if (!data->isEmpty() && !job->cancelledOrClientless()) {
+                size_t size = data->size();
+                job->getInternal()->client()->didReceiveBuffer(job.ptr(), SharedBuffer::create(WTFMove(*data)), size);
+            }
+
+            for (auto& task : m_pendingReads.take(job.ptr()))
+                task();
+        });
+    }
+}
+
+void CurlCacheManager::callAfterCachedDataDelivered(ResourceHandle& job, WTF::Function<void()>&& task)
+{
+    auto it = m_pendingReads.find(&job);
+    if (it == m_pendingReads.end()) {
+        task();
+        return;
     }
+    it->value.append(WTFMove(task));
 }
 
 }
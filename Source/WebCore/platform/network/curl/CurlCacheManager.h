@@ -27,14 +27,19 @@
 #pragma once
 
 #include "CurlCacheEntry.h"
+#include "CurlCacheIOQueue.h"
 #include "ResourceHandle.h"
 #include "ResourceResponse.h"
+#include <wtf/FileSystem.h>
 #include <wtf/HashMap.h>
 #include <wtf/ListHashSet.h>
+#include <wtf/Vector.h>
 #include <wtf/text/WTFString.h>
 
 namespace WebCore {
 
+class CurlCacheRevalidator;
+
 class CurlCacheManager {
     friend NeverDestroyed<CurlCacheManager>;
 public:
@@ -44,9 +49,24 @@ public:
     const String& cacheDirectory() { return m_cacheDir; }
     void setStorageSizeLimit(size_t);
 
+    struct Statistics {
+        unsigned freshHits { 0 };
+        unsigned staleHits { 0 };
+        unsigned revalidatedHits { 0 };
+        unsigned misses { 0 };
+    };
+
     bool isCached(const String&);
     HTTPHeaderMap& requestHeaders(const String&); // Load headers
     bool getCachedResponse(const String& url, ResourceResponse&);
+    // Response of an entry that can be used without a network request
+    bool getFreshResponse(const String& url, ResourceResponse&);
+    const Statistics& statistics() const { return m_statistics; }
+
+    // Bytecode of a cached script is stored next to the body of its entry,
+    // in a file named by the URL and the body. It is removed with the entry.
+    FileSystem::MappedFileData loadBytecode(const String& url);
+    bool storeBytecode(const String& url, Vector<char>&&);
 
     void didReceiveResponse(ResourceHandle&, ResourceResponse&);
     void didReceiveData(ResourceHandle&, const char*, size_t); // Save data
@@ -55,12 +75,19 @@ public:
 #if PLATFORM(MUI)
     void didCancel(ResourceHandle&);
     void saveIndex();
+    void shutdown();
 #endif
 
+    // Cached bodies are delivered asynchronously, the task runs once the
+    // body being read for the job has been handed to its client
+    void callAfterCachedDataDelivered(ResourceHandle&, WTF::Function<void()>&&);
+
     void addCacheEntryClient(const String& url, ResourceHandle* job);
     void removeCacheEntryClient(const String& url, ResourceHandle* job);
 
 private:
+    friend class CurlCacheRevalidator;
+
     CurlCacheManager();
     ~CurlCacheManager();
     CurlCacheManager(CurlCacheManager const&);
@@ -69,17 +96,59 @@ private:
     bool m_disabled;
     String m_cacheDir;
     HashMap<String, std::unique_ptr<CurlCacheEntry>> m_index;
+    CurlCacheIOQueue m_ioQueue;
+    HashMap<ResourceHandle*, Vector<WTF::Function<void()>>> m_pendingReads;
+    HashMap<String, RefPtr<CurlCacheRevalidator>> m_revalidations;
+    Statistics m_statistics;
+
+    // Bodies are stored once per content and shared by the entries with
+    // that content. A body is named by the MD5 of its content, with a "-z"
+    // suffix when it is stored deflated.
+    struct CacheBody {
+        unsigned refCount { 0 };
+        size_t storedSize { 0 };
+    };
+    HashMap<String, CacheBody> m_bodies;
 
     ListHashSet<String> m_LRUEntryList;
     size_t m_currentStorageSize;
     size_t m_storageSizeLimit;
 
+    // Append-only index journal, see loadIndex()
+    // Kept for the lifetime of the manager, entries that were never used
+    // refer to their headers in it
+    FileSystem::MappedFileData m_journal;
+    Vector<char> m_pendingJournal;
+    size_t m_journalRecordCount;
+    uint64_t m_journalStamp;
+    bool m_journalNeedsCompaction;
+
 #if !PLATFORM(MUI)
     void saveIndex();
 #endif
     void loadIndex();
     void makeRoomForNewEntry();
 
+    String journalPath() const;
+    void appendJournalRecord(uint32_t type, const String& url, CurlCacheEntry&);
+    void flushJournal();
+    void compactJournal();
+
+    String bodyPath(const String& name) const;
+    String bytecodePath(const CurlCacheEntry&) const;
+    void loadBytecodeSizes();
+    CurlCacheEntry* entryWithBody(const String& url);
+    void retainBody(const String& name, size_t storedSize);
+    void releaseBody(const String& name);
+    void storeBody(const String& url, CurlCacheEntry&, const String& bodyName);
+    void didStoreBody(const String& url, CurlCacheEntry&);
+    CurlCacheEntry* loadingEntry(const String& url, uint64_t identifier);
+    void decreaseStorageSize(size_t);
+
+    void didFailToWrite(const String& path);
+    bool revalidateEntry(const String& url, CurlCacheEntry&, const ResourceResponse&);
+    void revalidateInBackground(const String& url, CurlCacheEntry&);
+    void didRevalidateInBackground(const String& url, const ResourceResponse&);
     void saveResponseHeaders(const String&, ResourceResponse&);
     void invalidateCacheEntry(const String&);
     void readCachedData(const String&, ResourceHandle*, ResourceResponse&);
@@ -262,19 +262,21 @@ CURLMcode CurlMultiHandle::removeHandle(CURL* handle)
     return curl_multi_remove_handle(m_multiHandle, handle);
 }
 
-CURLMcode CurlMultiHandle::getFdSet(fd_set& readFdSet, fd_set& writeFdSet, fd_set& excFdSet, int& maxFd)
+void CurlMultiHandle::setSocketCallback(curl_socket_callback callback, void* userData)
 {
-    FD_ZERO(&readFdSet);
-    FD_ZERO(&writeFdSet);
-    FD_ZERO(&excFdSet);
-    maxFd = 0;
+    curl_multi_setopt(m_multiHandle, CURLMOPT_SOCKETFUNCTION, callback);
+    curl_multi_setopt(m_multiHandle, CURLMOPT_SOCKETDATA, userData);
+}
 
-    return curl_multi_fdset(m_multiHandle, &readFdSet, &writeFdSet, &excFdSet, &maxFd);
+void CurlMultiHandle::setTimerCallback(curl_multi_timer_callback callback, void* userData)
+{
+    curl_multi_setopt(m_multiHandle, CURLMOPT_TIMERFUNCTION, callback);
+    curl_multi_setopt(m_multiHandle, CURLMOPT_TIMERDATA, userData);
 }
 
-CURLMcode CurlMultiHandle::perform(int& runningHandles)
+CURLMcode CurlMultiHandle::socketAction(curl_socket_t socket, int eventsBitmask, int& runningHandles)
 {
-    return curl_multi_perform(m_multiHandle, &runningHandles);
+    return curl_multi_socket_action(m_multiHandle, socket, eventsBitmask, &runningHandles);
 }
 
 CURLMsg* CurlMultiHandle::readInfo(int& messagesInQueue)
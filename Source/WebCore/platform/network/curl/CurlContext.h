@@ -166,8 +166,9 @@ public:
     CURLMcode addHandle(CURL*);
     CURLMcode removeHandle(CURL*);
 
-    CURLMcode getFdSet(fd_set&, fd_set&, fd_set&, int&);
-    CURLMcode perform(int&);
+    void setSocketCallback(curl_socket_callback, void*);
+    void setTimerCallback(curl_multi_timer_callback, void*);
+    CURLMcode socketAction(curl_socket_t, int eventsBitmask, int& runningHandles);
     CURLMsg* readInfo(int&);
 
 private:
@@ -33,6 +33,12 @@
 #include "CurlRequestSchedulerClient.h"
 
 #if PLATFORM(MUI)
+#include "CurlRequest.h"
+#include "CurlRequestClient.h"
+#include "ResourceRequest.h"
+#include <wtf/MessageQueue.h>
+#include <wtf/ThreadSafeRefCounted.h>
+#include <wtf/text/StringConcatenateNumbers.h>
 #include <proto/exec.h>
 #include <proto/bsdsocket.h>
 #include <unistd.h>
@@ -92,6 +98,7 @@ void CurlRequestScheduler::callOnWorkerThread(WTF::Function<void()>&& task)
     {
         auto locker = holdLock(m_mutex);
         m_taskQueue.append(WTFMove(task));
+        wakeUpWorkerThread();
     }
 
     startThreadIfNeeded();
@@ -208,6 +215,7 @@ void CurlRequestScheduler::stopThread()
     {
         auto locker = holdLock(m_mutex);
         m_runThread = false;
+        wakeUpWorkerThread();
     }
 
     if (m_thread) {
@@ -231,14 +239,76 @@ void CurlRequestScheduler::executeTasks()
         task();
 }
 
+// Called with m_mutex held
+void CurlRequestScheduler::wakeUpWorkerThread()
+{
+    if (m_socketReactor)
+        m_socketReactor->wakeUp();
+}
+
+int CurlRequestScheduler::socketCallback(CURL*, curl_socket_t socket, int what, void* userData, void*)
+{
+    auto* scheduler = static_cast<CurlRequestScheduler*>(userData);
+
+    switch (what) {
+    case CURL_POLL_IN:
+        scheduler->m_socketReactor->watch(socket, CurlSocketReactor::Readable);
+        break;
+    case CURL_POLL_OUT:
+        scheduler->m_socketReactor->watch(socket, CurlSocketReactor::Writable);
+        break;
+    case CURL_POLL_INOUT:
+        scheduler->m_socketReactor->watch(socket, CurlSocketReactor::Readable | CurlSocketReactor::Writable);
+        break;
+    case CURL_POLL_REMOVE:
+        scheduler->m_socketReactor->unwatch(socket);
+        break;
+    }
+    return 0;
+}
+
+int CurlRequestScheduler::timerCallback(CURLM*, long timeoutMS, void* userData)
+{
+    auto* scheduler = static_cast<CurlRequestScheduler*>(userData);
+
+    // -1 removes the timer, 0 asks for an immediate timeout action
+    if (timeoutMS < 0)
+        scheduler->m_curlTimeout = MonotonicTime::infinity();
+    else
+        scheduler->m_curlTimeout = MonotonicTime::now() + Seconds::fromMilliseconds(timeoutMS);
+    return 0;
+}
+
+static int curlEventsBitmask(uint8_t events)
+{
+    int bitmask = 0;
+    if (events & CurlSocketReactor::Readable)
+        bitmask |= CURL_CSELECT_IN;
+    if (events & CurlSocketReactor::Writable)
+        bitmask |= CURL_CSELECT_OUT;
+    if (events & CurlSocketReactor::Error)
+        bitmask |= CURL_CSELECT_ERR;
+    return bitmask;
+}
+
 void CurlRequestScheduler::workerThread()
 {
     ASSERT(!isMainThread());
 
+    {
+        auto locker = holdLock(m_mutex);
+        m_socketReactor = std::make_unique<CurlSocketReactor>();
+    }
+    m_curlTimeout = MonotonicTime::infinity();
+
     m_curlMultiHandle = std::make_unique<CurlMultiHandle>();
     m_curlMultiHandle->setMaxConnects(m_maxConnects);
     m_curlMultiHandle->setMaxTotalConnections(m_maxTotalConnections);
     m_curlMultiHandle->setMaxHostConnections(m_maxHostConnections);
+    m_curlMultiHandle->setSocketCallback(socketCallback, this);
+    m_curlMultiHandle->setTimerCallback(timerCallback, this);
+
+    Vector<CurlSocketReactor::Socket> readySockets;
 
     while (true) {
         {
@@ -249,58 +319,32 @@ void CurlRequestScheduler::workerThread()
 
         executeTasks();
 
-        // Retry 'select' if it was interrupted by a process signal.
-        int rc = 0;
 #if PLATFORM(MUI)
         fd_set fdread;
         fd_set fdwrite;
         fd_set fdexcep;
-#endif
-        do {
-#if PLATFORM(MUI)
-            FD_ZERO(&fdread);
-            FD_ZERO(&fdwrite);
-            FD_ZERO(&fdexcep);
-            int maxfd = 0;
-
-            struct timeval timeout;
-            timeout.tv_sec = 0;
-            timeout.tv_usec = 500; // shorter timeouts give better outgoing performance
-#else
-            fd_set fdread;
-            fd_set fdwrite;
-            fd_set fdexcep;
-            int maxfd = 0;
-
-            const int selectTimeoutMS = 5;
-
-            struct timeval timeout;
-            timeout.tv_sec = 0;
-            timeout.tv_usec = selectTimeoutMS * 1000; // select waits microseconds
+        int maxfd = -1;
+        FD_ZERO(&fdread);
+        FD_ZERO(&fdwrite);
+        FD_ZERO(&fdexcep);
+        for (auto& stream : m_streamList.values())
+            stream->appendMonitoringFd(fdread, fdwrite, fdexcep, maxfd);
+        m_socketReactor->setStreamFdSets(&fdread, &fdwrite, &fdexcep, maxfd);
 #endif
 
-            m_curlMultiHandle->getFdSet(fdread, fdwrite, fdexcep, maxfd);
-#if PLATFORM(MUI)
-            for (auto& stream : m_streamList.values())
-                stream->appendMonitoringFd(fdread, fdwrite, fdexcep, maxfd);
-#endif
+        // Sleeps until a socket is ready, curl's timer expires or a task is
+        // queued
+        readySockets.shrink(0);
+        m_socketReactor->wait(m_curlTimeout - MonotonicTime::now(), readySockets);
 
-            // When the 3 file descriptors are empty, winsock will return -1
-            // and bail out, stopping the file download. So make sure we
-            // have valid file descriptors before calling select.
-            if (maxfd >= 0)
-#if PLATFORM(MUI)
-                rc = WaitSelect(maxfd + 1, &fdread, &fdwrite, &fdexcep, &timeout, nullptr);
-            else {
-                usleep(100 * 1000);
-            }
-#else
-                rc = ::select(maxfd + 1, &fdread, &fdwrite, &fdexcep, &timeout);
-#endif
-        } while (rc == -1 && errno == EINTR);
+        int runningHandles = 0;
+        for (auto& ready : readySockets)
+            m_curlMultiHandle->socketAction(ready.socket, curlEventsBitmask(ready.events), runningHandles);
 
-        int activeCount = 0;
-        while (m_curlMultiHandle->perform(activeCount) == CURLM_CALL_MULTI_PERFORM) { }
+        if (m_curlTimeout <= MonotonicTime::now()) {
+            m_curlTimeout = MonotonicTime::infinity();
+            m_curlMultiHandle->socketAction(CURL_SOCKET_TIMEOUT, 0, runningHandles);
+        }
 
         // check the curl messages indicating completed transfers
         // and free their resources
@@ -324,6 +368,9 @@ void CurlRequestScheduler::workerThread()
     }
 
     m_curlMultiHandle = nullptr;
+
+    auto locker = holdLock(m_mutex);
+    m_socketReactor = nullptr;
 }
 
 void CurlRequestScheduler::startTransfer(CurlRequestSchedulerClient* client)
@@ -346,6 +393,7 @@ void CurlRequestScheduler::startTransfer(CurlRequestSchedulerClient* client)
     auto locker = holdLock(m_mutex);
     m_activeJobs.add(client);
     m_taskQueue.append(WTFMove(task));
+    wakeUpWorkerThread();
 }
 
 void CurlRequestScheduler::completeTransfer(CurlRequestSchedulerClient* client, CURLcode result)
@@ -386,8 +434,116 @@ void CurlRequestScheduler::finalizeTransfer(CurlRequestSchedulerClient* client,
     };
 
     m_taskQueue.append(WTFMove(task));
+    wakeUpWorkerThread();
 }
 
+#if PLATFORM(MUI) && !defined(NDEBUG)
+
+// Loads a URL synchronously and times the response and the end of the body
+// from start()
+class CurlLatencyProbe final : public ThreadSafeRefCounted<CurlLatencyProbe>, public CurlRequestClient {
+public:
+    static Ref<CurlLatencyProbe> create() { return adoptRef(*new CurlLatencyProbe); }
+
+    void ref() override { ThreadSafeRefCounted<CurlLatencyProbe>::ref(); }
+    void deref() override { ThreadSafeRefCounted<CurlLatencyProbe>::deref(); }
+
+    bool load(const URL& url)
+    {
+        m_done = false;
+        m_failed = false;
+        m_startTime = MonotonicTime::now();
+
+        auto curlRequest = CurlRequest::create(ResourceRequest(url), *this, CurlRequest::ShouldSuspend::No, CurlRequest::EnableMultipart::No, CurlRequest::CaptureNetworkLoadMetrics::Basic, &m_messageQueue);
+        curlRequest->start();
+        while (!m_done) {
+            if (auto task = m_messageQueue.waitForMessage())
+                (*task)();
+            else
+                return false;
+        }
+        curlRequest->invalidateClient();
+        return !m_failed;
+    }
+
+    Seconds responseTime() const { return m_responseTime; }
+    Seconds completionTime() const { return m_completionTime; }
+
+private:
+    void curlDidSendData(CurlRequest&, unsigned long long, unsigned long long) override { }
+
+    void curlDidReceiveResponse(CurlRequest& request, const CurlResponse&) override
+    {
+        m_responseTime = MonotonicTime::now() - m_startTime;
+        request.completeDidReceiveResponse();
+    }
+
+    void curlDidReceiveBuffer(CurlRequest&, Ref<SharedBuffer>&&) override { }
+
+    void curlDidComplete(CurlRequest&) override
+    {
+        m_completionTime = MonotonicTime::now() - m_startTime;
+        m_done = true;
+    }
+
+    void curlDidFailWithError(CurlRequest&, const ResourceError&) override
+    {
+        m_failed = true;
+        m_done = true;
+    }
+
+    MessageQueue<Function<void()>> m_messageQueue;
+    MonotonicTime m_startTime;
+    Seconds m_responseTime;
+    Seconds m_completionTime;
+    bool m_done { false };
+    bool m_failed { false };
+};
+
+static String formatLatencies(Vector<double>& milliseconds)
+{
+    if (milliseconds.isEmpty())
+        return "-";
+
+    std::sort(milliseconds.begin(), milliseconds.end());
+    size_t count = milliseconds.size();
+    return makeString("median ", FormattedNumber::fixedWidth(milliseconds[count / 2], 2),
+        " p95 ", FormattedNumber::fixedWidth(milliseconds[std::min(count - 1, count * 95 / 100)], 2),
+        " max ", FormattedNumber::fixedWidth(milliseconds.last(), 2), " ms");
+}
+
+/*
+ * Loads a URL count times in a row and reports the time to the response and
+ * to the end of the body. Point it at a small local HTTP server so that the
+ * figures measure the request scheduling rather than the network. Only built
+ * into debug builds.
+ */
+String benchmarkCurlLatency(const char* url, unsigned count)
+{
+    URL parsed({ }, String(url));
+    if (!parsed.isValid() || !parsed.protocolIsInHTTPFamily())
+        return "ERROR: not a HTTP URL";
+
+    auto probe = CurlLatencyProbe::create();
+    Vector<double> responseTimes;
+    Vector<double> completionTimes;
+    unsigned failed = 0;
+    for (unsigned i = 0; i < count; i++) {
+        if (!probe->load(parsed)) {
+            failed++;
+            continue;
+        }
+        responseTimes.append(probe->responseTime().milliseconds());
+        completionTimes.append(probe->completionTime().milliseconds());
+    }
+
+    return makeString("requests: ", count, " failed: ", failed,
+        " response: ", formatLatencies(responseTimes),
+        " complete: ", formatLatencies(completionTimes));
+}
+
+#endif
+
 }
 
 #endif
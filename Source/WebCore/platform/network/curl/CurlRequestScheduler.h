@@ -28,8 +28,10 @@
 #pragma once
 
 #include "CurlContext.h"
+#include "CurlSocketReactor.h"
 #include <wtf/HashMap.h>
 #include <wtf/Lock.h>
+#include <wtf/MonotonicTime.h>
 #include <wtf/Noncopyable.h>
 #include <wtf/Threading.h>
 
@@ -72,9 +74,13 @@ private:
     void stopThread();
 
     void executeTasks();
+    void wakeUpWorkerThread();
 
     void workerThread();
 
+    static int socketCallback(CURL*, curl_socket_t, int what, void* userData, void* socketData);
+    static int timerCallback(CURLM*, long timeoutMS, void* userData);
+
     void startTransfer(CurlRequestSchedulerClient*);
     void completeTransfer(CurlRequestSchedulerClient*, CURLcode);
     void cancelTransfer(CurlRequestSchedulerClient*);
@@ -89,6 +95,9 @@ private:
     HashMap<CURL*, CurlRequestSchedulerClient*> m_clientMaps;
 
     std::unique_ptr<CurlMultiHandle> m_curlMultiHandle;
+    // Created and used by the worker thread, woken up under m_mutex
+    std::unique_ptr<CurlSocketReactor> m_socketReactor;
+    MonotonicTime m_curlTimeout { MonotonicTime::infinity() };
 
     long m_maxConnects;
     long m_maxTotalConnections;
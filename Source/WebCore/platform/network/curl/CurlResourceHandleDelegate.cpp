@@ -176,7 +176,10 @@ void CurlResourceHandleDelegate::curlDidComplete(CurlRequest& request)
     m_response.setDeprecatedNetworkLoadMetrics(request.networkLoadMetrics().isolatedCopy());
 
     CurlCacheManager::singleton().didFinishLoading(m_handle);
-    client()->didFinishLoading(&m_handle);
+    CurlCacheManager::singleton().callAfterCachedDataDelivered(m_handle, [this, protectedHandle = makeRef(m_handle)] {
+        if (!cancelledOrClientless())
+            client()->didFinishLoading(&m_handle);
+    });
 }
 
 void CurlResourceHandleDelegate::curlDidFailWithError(CurlRequest& request, const ResourceError& resourceError)
@@ -188,7 +191,10 @@ void CurlResourceHandleDelegate::curlDidFailWithError(CurlRequest& request, cons
         return;
 
     CurlCacheManager::singleton().didFail(m_handle);
-    client()->didFail(&m_handle, resourceError);
+    CurlCacheManager::singleton().callAfterCachedDataDelivered(m_handle, [this, protectedHandle = makeRef(m_handle), resourceError = resourceError.isolatedCopy()] {
+        if (!cancelledOrClientless())
+            client()->didFail(&m_handle, resourceError);
+    });
 }
 
 #if PLATFORM(MUI)
@@ -0,0 +1,328 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "CurlSocketReactor.h"
+
+#if USE(CURL)
+
+#include <wtf/MathExtras.h>
+
+#if PLATFORM(MUI)
+#include <proto/bsdsocket.h>
+#include <proto/exec.h>
+#elif OS(LINUX)
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#elif !OS(WINDOWS)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace WebCore {
+
+#if OS(WINDOWS) || PLATFORM(MUI)
+// Bounds the wait when a wake up can not interrupt it
+static const Seconds uninterruptibleWaitLimit = 5_ms;
+#endif
+
+#if !OS(WINDOWS) && !PLATFORM(MUI)
+static int timeoutInMilliseconds(Seconds timeout)
+{
+    if (timeout.isInfinity())
+        return -1;
+    return clampTo<int>(std::ceil(std::max(timeout, 0_s).milliseconds()));
+}
+
+static bool createWakeUpPipe(int fds[2])
+{
+    if (pipe(fds))
+        return false;
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    return true;
+}
+
+static void drainWakeUpPipe(int fd)
+{
+    char buffer[64];
+    while (read(fd, buffer, sizeof(buffer)) > 0) { }
+}
+#endif
+
+CurlSocketReactor::CurlSocketReactor()
+{
+#if PLATFORM(MUI)
+    m_task = FindTask(nullptr);
+    m_wakeUpSignal = AllocSignal(-1);
+#elif OS(LINUX)
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (createWakeUpPipe(m_wakeUpPipe)) {
+        struct epoll_event event { };
+        event.events = EPOLLIN;
+        event.data.fd = m_wakeUpPipe[0];
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeUpPipe[0], &event);
+    }
+#elif !OS(WINDOWS)
+    createWakeUpPipe(m_wakeUpPipe);
+#endif
+}
+
+CurlSocketReactor::~CurlSocketReactor()
+{
+#if PLATFORM(MUI)
+    if (m_wakeUpSignal >= 0)
+        FreeSignal(m_wakeUpSignal);
+#elif !OS(WINDOWS)
+#if OS(LINUX)
+    if (m_epollFd >= 0)
+        close(m_epollFd);
+#endif
+    for (int fd : m_wakeUpPipe) {
+        if (fd >= 0)
+            close(fd);
+    }
+#endif
+}
+
+void CurlSocketReactor::watch(curl_socket_t socket, uint8_t events)
+{
+#if OS(LINUX)
+    struct epoll_event event { };
+    event.events = ((events & Readable) ? EPOLLIN : 0) | ((events & Writable) ? EPOLLOUT : 0);
+    event.data.fd = socket;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, socket, &event) && errno == ENOENT)
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, socket, &event);
+#else
+    for (auto& watched : m_sockets) {
+        if (watched.socket == socket) {
+            watched.events = events;
+            return;
+        }
+    }
+    m_sockets.append({ socket, events });
+#endif
+}
+
+void CurlSocketReactor::unwatch(curl_socket_t socket)
+{
+#if OS(LINUX)
+    // Fails harmlessly when curl already closed the socket
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, socket, nullptr);
+#else
+    m_sockets.removeFirstMatching([socket](const Socket& watched) {
+        return watched.socket == socket;
+    });
+#endif
+}
+
+void CurlSocketReactor::wakeUp()
+{
+#if PLATFORM(MUI)
+    if (m_wakeUpSignal >= 0)
+        Signal(m_task, 1UL << m_wakeUpSignal);
+#elif !OS(WINDOWS)
+    if (m_wakeUpPipe[1] >= 0) {
+        char byte = 0;
+        // A full pipe already wakes the thread up
+        ssize_t written = write(m_wakeUpPipe[1], &byte, 1);
+        UNUSED_VARIABLE(written);
+    }
+#endif
+}
+
+#if PLATFORM(MUI)
+void CurlSocketReactor::setStreamFdSets(fd_set* read, fd_set* write, fd_set* except, int maxFd)
+{
+    m_streamReadFds = read;
+    m_streamWriteFds = write;
+    m_streamExceptFds = except;
+    m_streamMaxFd = maxFd;
+}
+#endif
+
+#if OS(LINUX)
+
+void CurlSocketReactor::wait(Seconds timeout, Vector<Socket>& readySockets)
+{
+    struct epoll_event events[64];
+    int count;
+    do {
+        count = epoll_wait(m_epollFd, events, WTF_ARRAY_LENGTH(events), timeoutInMilliseconds(timeout));
+    } while (count == -1 && errno == EINTR);
+
+    for (int i = 0; i < count; i++) {
+        int fd = events[i].data.fd;
+        if (fd == m_wakeUpPipe[0]) {
+            drainWakeUpPipe(fd);
+            continue;
+        }
+
+        uint8_t ready = 0;
+        if (events[i].events & (EPOLLIN | EPOLLHUP))
+            ready |= Readable;
+        if (events[i].events & EPOLLOUT)
+            ready |= Writable;
+        if (events[i].events & EPOLLERR)
+            ready |= Error;
+        readySockets.append({ fd, ready });
+    }
+}
+
+#elif !OS(WINDOWS) && !PLATFORM(MUI)
+
+void CurlSocketReactor::wait(Seconds timeout, Vector<Socket>& readySockets)
+{
+    Vector<struct pollfd, 16> fds;
+    fds.append({ m_wakeUpPipe[0], POLLIN, 0 });
+    for (auto& watched : m_sockets) {
+        short events = ((watched.events & Readable) ? POLLIN : 0) | ((watched.events & Writable) ? POLLOUT : 0);
+        fds.append({ watched.socket, events, 0 });
+    }
+
+    int rc;
+    do {
+        rc = ::poll(fds.data(), fds.size(), timeoutInMilliseconds(timeout));
+    } while (rc == -1 && errno == EINTR);
+
+    if (rc <= 0)
+        return;
+
+    if (fds[0].revents)
+        drainWakeUpPipe(fds[0].fd);
+
+    for (size_t i = 1; i < fds.size(); i++) {
+        if (!fds[i].revents)
+            continue;
+
+        uint8_t ready = 0;
+        if (fds[i].revents & (POLLIN | POLLHUP))
+            ready |= Readable;
+        if (fds[i].revents & POLLOUT)
+            ready |= Writable;
+        if (fds[i].revents & (POLLERR | POLLNVAL))
+            ready |= Error;
+        readySockets.append({ fds[i].fd, ready });
+    }
+}
+
+#else
+
+void CurlSocketReactor::wait(Seconds timeout, Vector<Socket>& readySockets)
+{
+    fd_set readFds;
+    fd_set writeFds;
+    fd_set exceptFds;
+    FD_ZERO(&readFds);
+    FD_ZERO(&writeFds);
+    FD_ZERO(&exceptFds);
+
+    int maxFd = -1;
+    for (auto& watched : m_sockets) {
+        if (watched.events & Readable)
+            FD_SET(watched.socket, &readFds);
+        if (watched.events & Writable)
+            FD_SET(watched.socket, &writeFds);
+        FD_SET(watched.socket, &exceptFds);
+        maxFd = std::max(maxFd, static_cast<int>(watched.socket));
+    }
+
+#if PLATFORM(MUI)
+    if (m_streamReadFds) {
+        for (int fd = 0; fd <= m_streamMaxFd; fd++) {
+            if (FD_ISSET(fd, m_streamReadFds))
+                FD_SET(fd, &readFds);
+            if (FD_ISSET(fd, m_streamWriteFds))
+                FD_SET(fd, &writeFds);
+            if (FD_ISSET(fd, m_streamExceptFds))
+                FD_SET(fd, &exceptFds);
+        }
+        maxFd = std::max(maxFd, m_streamMaxFd);
+    }
+
+    if (m_wakeUpSignal < 0)
+        timeout = std::min(timeout, uninterruptibleWaitLimit);
+#else
+    timeout = std::min(timeout, uninterruptibleWaitLimit);
+#endif
+    timeout = std::max(timeout, 0_s);
+
+    struct timeval selectTimeout;
+    int64_t usec = timeout.isInfinity() ? 0 : timeout.microsecondsAs<int64_t>();
+    selectTimeout.tv_sec = usec / 1000000;
+    selectTimeout.tv_usec = usec % 1000000;
+
+#if PLATFORM(MUI)
+    // Without sockets WaitSelect() still waits for the signal or the timeout
+    ULONG signals = m_wakeUpSignal >= 0 ? 1UL << m_wakeUpSignal : 0;
+    int rc = WaitSelect(maxFd + 1, &readFds, &writeFds, &exceptFds, timeout.isInfinity() ? nullptr : &selectTimeout, &signals);
+#else
+    // Winsock fails select() on empty sets
+    if (maxFd < 0) {
+        ::Sleep(static_cast<DWORD>(timeout.milliseconds()));
+        return;
+    }
+    int rc = ::select(maxFd + 1, &readFds, &writeFds, &exceptFds, &selectTimeout);
+#endif
+
+#if PLATFORM(MUI)
+    if (m_streamReadFds) {
+        if (rc > 0) {
+            *m_streamReadFds = readFds;
+            *m_streamWriteFds = writeFds;
+            *m_streamExceptFds = exceptFds;
+        } else {
+            FD_ZERO(m_streamReadFds);
+            FD_ZERO(m_streamWriteFds);
+            FD_ZERO(m_streamExceptFds);
+        }
+        m_streamReadFds = m_streamWriteFds = m_streamExceptFds = nullptr;
+    }
+#endif
+
+    if (rc <= 0)
+        return;
+
+    for (auto& watched : m_sockets) {
+        uint8_t ready = 0;
+        if (FD_ISSET(watched.socket, &readFds))
+            ready |= Readable;
+        if (FD_ISSET(watched.socket, &writeFds))
+            ready |= Writable;
+        if (FD_ISSET(watched.socket, &exceptFds))
+            ready |= Error;
+        if (ready)
+            readySockets.append({ watched.socket, ready });
+    }
+}
+
+#endif
+
+} // namespace WebCore
+
+#endif // USE(CURL)
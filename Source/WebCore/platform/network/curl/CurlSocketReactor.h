@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "CurlContext.h"
+#include <wtf/Noncopyable.h>
+#include <wtf/Seconds.h>
+#include <wtf/Vector.h>
+
+#if PLATFORM(MUI)
+struct Task;
+#endif
+
+namespace WebCore {
+
+// Waits for activity on the sockets curl asks to watch. wait() returns when
+// a watched socket is ready, when the timeout expires or when wakeUp() is
+// called from another thread. Linux uses epoll, other POSIX systems poll(),
+// and both are woken through a pipe. AROS uses WaitSelect() woken by a task
+// signal. Windows can not wait on a pipe, it uses select() with a short cap
+// on the timeout instead.
+class CurlSocketReactor {
+    WTF_MAKE_NONCOPYABLE(CurlSocketReactor);
+    WTF_MAKE_FAST_ALLOCATED;
+public:
+    enum Event : uint8_t {
+        Readable = 1 << 0,
+        Writable = 1 << 1,
+        Error = 1 << 2
+    };
+
+    struct Socket {
+        curl_socket_t socket;
+        uint8_t events;
+    };
+
+    // Must be created on the thread that calls wait()
+    CurlSocketReactor();
+    ~CurlSocketReactor();
+
+    void watch(curl_socket_t, uint8_t events);
+    void unwatch(curl_socket_t);
+
+    // Waits forever when the timeout is infinite
+    void wait(Seconds timeout, Vector<Socket>& readySockets);
+    // Can be called from any thread
+    void wakeUp();
+
+#if PLATFORM(MUI)
+    // Sockets of CurlStream are not driven by the multi handle. They are
+    // added to the sets of the next wait(), which leaves the ready ones.
+    void setStreamFdSets(fd_set* read, fd_set* write, fd_set* except, int maxFd);
+#endif
+
+private:
+#if OS(LINUX)
+    int m_epollFd { -1 };
+#else
+    Vector<Socket> m_sockets;
+#endif
+
+#if PLATFORM(MUI)
+    struct Task* m_task { nullptr };
+    int m_wakeUpSignal { -1 };
+    fd_set* m_streamReadFds { nullptr };
+    fd_set* m_streamWriteFds { nullptr };
+    fd_set* m_streamExceptFds { nullptr };
+    int m_streamMaxFd { -1 };
+#elif !OS(WINDOWS)
+    int m_wakeUpPipe[2] { -1, -1 };
+#endif
+};
+
+} // namespace WebCore
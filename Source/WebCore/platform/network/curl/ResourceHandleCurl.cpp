@@ -92,6 +92,9 @@ bool ResourceHandle::start()
 
     d->m_startTime = MonotonicTime::now();
 
+    if (startFromCache())
+        return true;
+
 #if PLATFORM(MUI)
     if ((!d->m_user.isEmpty() || !d->m_pass.isEmpty()) && !shouldUseCredentialStorage()) {
         // Credentials for ftp can only be passed in URL, the didReceiveAuthenticationChallenge delegate call won't be made.
@@ -158,6 +161,62 @@ void ResourceHandle::addCacheValidationHeaders(ResourceRequest& request)
     }
 }
 
+// Serves a fresh disk cache entry without sending the request. The response
+// is delivered asynchronously, as it would be from the network.
+bool ResourceHandle::startFromCache()
+{
+    const auto& request = firstRequest();
+    if (request.httpMethod() != "GET" || !request.url().protocolIsInHTTPFamily())
+        return false;
+
+    auto cachePolicy = request.cachePolicy();
+    if (cachePolicy == ResourceRequestCachePolicy::ReloadIgnoringCacheData
+        || cachePolicy == ResourceRequestCachePolicy::DoNotUseAnyCache
+        || cachePolicy == ResourceRequestCachePolicy::RefreshAnyCacheData)
+        return false;
+
+    if (request.httpHeaderFields().contains(HTTPHeaderName::IfModifiedSince) || request.httpHeaderFields().contains(HTTPHeaderName::IfNoneMatch))
+        return false;
+
+    auto& cache = CurlCacheManager::singleton();
+    URL cacheUrl = request.url();
+    cacheUrl.removeFragmentIdentifier();
+
+    ResourceResponse response;
+    if (!cache.getFreshResponse(cacheUrl, response))
+        return false;
+
+    // Keeps the entry from being invalidated until the response is handed
+    // over, every path below unregisters again
+    cache.addCacheEntryClient(cacheUrl, this);
+
+    response.setURL(request.url());
+    response.setHTTPStatusCode(200);
+    response.setHTTPStatusText("OK");
+
+    callOnMainThread([this, protectedThis = makeRef(*this), cacheUrl = cacheUrl.string(), response = WTFMove(response)]() mutable {
+        if (cancelledOrClientless()) {
+            CurlCacheManager::singleton().removeCacheEntryClient(cacheUrl, this);
+            return;
+        }
+
+        didReceiveResponse(ResourceResponse(response), [this, protectedThis = makeRef(*this), cacheUrl = WTFMove(cacheUrl), response = WTFMove(response)]() mutable {
+            auto& cache = CurlCacheManager::singleton();
+            cache.removeCacheEntryClient(cacheUrl, this);
+            if (cancelledOrClientless())
+                return;
+
+            cache.didReceiveResponse(*this, response);
+            cache.callAfterCachedDataDelivered(*this, [this, protectedThis = makeRef(*this)] {
+                if (!cancelledOrClientless())
+                    client()->didFinishLoading(this);
+            });
+        });
+    });
+
+    return true;
+}
+
 Ref<CurlRequest> ResourceHandle::createCurlRequest(ResourceRequest&& request, RequestStatus status)
 {
     ASSERT(isMainThread());
@@ -356,8 +356,9 @@ void RenderImage::repaintOrMarkForLayout(ImageSizeChangeType imageSizeChange, co
     LayoutRect repaintRect = contentBoxRect();
     if (rect) {
         // The image changed rect is in source image coordinates (pre-zooming),
-        // so map from the bounds of the image to the contentsBox.
-        repaintRect.intersect(enclosingIntRect(mapRect(*rect, FloatRect(FloatPoint(), imageResource().imageSize(1.0f)), repaintRect)));
+        // so map from the bounds of the image to where object-fit and object-position
+        // place it, which may extend past the contentsBox.
+        repaintRect.intersect(enclosingIntRect(mapRect(*rect, FloatRect(FloatPoint(), imageResource().imageSize(1.0f)), replacedContentRect())));
     }
         
     repaintRectangle(repaintRect);
@@ -54,6 +54,7 @@ list(APPEND WebKitLegacy_SOURCES
     mui/UI/downloadwindowclass.cpp
     mui/UI/faviconclass.cpp
     mui/UI/findtextclass.cpp
+    mui/UI/FrameTimingRecorder.cpp
     mui/UI/historybuttonclass.cpp
     mui/UI/historylistclass.cpp
     mui/UI/historylisttreeclass.cpp
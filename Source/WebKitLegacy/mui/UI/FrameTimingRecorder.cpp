@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "FrameTimingRecorder.h"
+
+#include <wtf/JSONValues.h>
+#include <wtf/text/StringBuilder.h>
+#include <wtf/text/StringConcatenateNumbers.h>
+#include <algorithm>
+
+namespace WebCore {
+
+FrameTimingRecorder::FrameTimingRecorder()
+{
+    m_frames.reserveInitialCapacity(capacity);
+}
+
+void FrameTimingRecorder::addScrollTime(Seconds duration)
+{
+    m_pendingScroll += duration;
+}
+
+void FrameTimingRecorder::record(Frame&& frame)
+{
+    frame.scroll += m_pendingScroll;
+    m_pendingScroll = Seconds();
+
+    if (m_frames.size() < capacity)
+        m_frames.append(WTFMove(frame));
+    else
+        m_frames[m_next] = WTFMove(frame);
+    m_next = (m_next + 1) % capacity;
+}
+
+void FrameTimingRecorder::clear()
+{
+    m_frames.clear();
+    m_next = 0;
+    m_pendingScroll = Seconds();
+}
+
+Vector<FrameTimingRecorder::Frame> FrameTimingRecorder::frames() const
+{
+    if (m_frames.size() < capacity)
+        return m_frames;
+
+    Vector<Frame> frames;
+    frames.reserveInitialCapacity(capacity);
+    frames.append(m_frames.data() + m_next, capacity - m_next);
+    frames.append(m_frames.data(), m_next);
+    return frames;
+}
+
+String FrameTimingRecorder::toJSON() const
+{
+    auto array = JSON::Array::create();
+    for (auto& frame : frames()) {
+        auto object = JSON::Object::create();
+        object->setDouble("start"_s, frame.startTime.secondsSinceEpoch().milliseconds());
+        object->setDouble("scroll"_s, frame.scroll.milliseconds());
+        object->setDouble("style"_s, frame.style.milliseconds());
+        object->setDouble("layout"_s, frame.layout.milliseconds());
+        object->setDouble("paint"_s, frame.paint.milliseconds());
+        object->setDouble("blit"_s, frame.blit.milliseconds());
+        object->setDouble("total"_s, frame.total().milliseconds());
+        object->setDouble("dirtyArea"_s, frame.dirtyArea);
+        object->setDouble("paintedArea"_s, frame.paintedArea);
+        object->setInteger("rects"_s, frame.rectCount);
+        array->pushObject(WTFMove(object));
+    }
+    return array->toJSONString();
+}
+
+static double percentile(const Vector<double>& sorted, unsigned percent)
+{
+    return sorted[std::min(sorted.size() - 1, sorted.size() * percent / 100)];
+}
+
+static void appendPercentiles(StringBuilder& builder, const char* name, Vector<double>&& values)
+{
+    std::sort(values.begin(), values.end());
+    builder.append(makeString(name, " p50 ", FormattedNumber::fixedWidth(percentile(values, 50), 2),
+        " p95 ", FormattedNumber::fixedWidth(percentile(values, 95), 2),
+        " p99 ", FormattedNumber::fixedWidth(percentile(values, 99), 2),
+        " max ", FormattedNumber::fixedWidth(values.last(), 2), '\n'));
+}
+
+/*
+ * Percentiles of each phase in milliseconds (areas in pixels), followed by a
+ * histogram of the total frame cost against common frame budgets.
+ */
+String FrameTimingRecorder::histogramReport() const
+{
+    Vector<Frame> frames = this->frames();
+    if (frames.isEmpty())
+        return "no frames"_s;
+
+    auto collect = [&frames](const auto& value) {
+        Vector<double> values;
+        values.reserveInitialCapacity(frames.size());
+        for (auto& frame : frames)
+            values.uncheckedAppend(value(frame));
+        return values;
+    };
+
+    StringBuilder builder;
+    builder.append(makeString("frames ", frames.size(), '\n'));
+    appendPercentiles(builder, "total", collect([](const Frame& frame) { return frame.total().milliseconds(); }));
+    appendPercentiles(builder, "scroll", collect([](const Frame& frame) { return frame.scroll.milliseconds(); }));
+    appendPercentiles(builder, "style", collect([](const Frame& frame) { return frame.style.milliseconds(); }));
+    appendPercentiles(builder, "layout", collect([](const Frame& frame) { return frame.layout.milliseconds(); }));
+    appendPercentiles(builder, "paint", collect([](const Frame& frame) { return frame.paint.milliseconds(); }));
+    appendPercentiles(builder, "blit", collect([](const Frame& frame) { return frame.blit.milliseconds(); }));
+    appendPercentiles(builder, "dirty", collect([](const Frame& frame) { return static_cast<double>(frame.dirtyArea); }));
+    appendPercentiles(builder, "painted", collect([](const Frame& frame) { return static_cast<double>(frame.paintedArea); }));
+
+    static const double bucketLimits[] = { 4, 8, 16.7, 33.3, 66.7 };
+    const size_t bucketCount = WTF_ARRAY_LENGTH(bucketLimits) + 1;
+    unsigned buckets[bucketCount] = { };
+    for (auto& frame : frames) {
+        double milliseconds = frame.total().milliseconds();
+        size_t bucket = 0;
+        while (bucket < WTF_ARRAY_LENGTH(bucketLimits) && milliseconds >= bucketLimits[bucket])
+            bucket++;
+        buckets[bucket]++;
+    }
+
+    for (size_t i = 0; i < bucketCount; i++) {
+        if (i < WTF_ARRAY_LENGTH(bucketLimits))
+            builder.append(makeString("< ", FormattedNumber::fixedWidth(bucketLimits[i], 1), " ms: ", buckets[i], '\n'));
+        else
+            builder.append(makeString(">= ", FormattedNumber::fixedWidth(bucketLimits[i - 1], 1), " ms: ", buckets[i], '\n'));
+    }
+
+    return builder.toString();
+}
+
+}
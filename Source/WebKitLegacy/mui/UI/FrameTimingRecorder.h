@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FrameTimingRecorder_h
+#define FrameTimingRecorder_h
+
+#include <wtf/MonotonicTime.h>
+#include <wtf/Seconds.h>
+#include <wtf/Vector.h>
+#include <wtf/text/WTFString.h>
+
+namespace WebCore {
+
+// Keeps the cost of the last frames painted by a view so that it can be
+// aggregated, instead of printing it as it happens.
+class FrameTimingRecorder {
+public:
+    struct Frame {
+        MonotonicTime startTime;
+        Seconds scroll;
+        Seconds style;
+        Seconds layout;
+        Seconds paint;
+        Seconds blit;
+        uint64_t dirtyArea { 0 };
+        uint64_t paintedArea { 0 };
+        unsigned rectCount { 0 };
+
+        Seconds total() const { return scroll + style + layout + paint + blit; }
+    };
+
+    static const size_t capacity = 1024;
+
+    FrameTimingRecorder();
+
+    // Scrolling the backing store happens before the expose that repaints
+    // it, so its time is added to the next recorded frame.
+    void addScrollTime(Seconds);
+    void record(Frame&&);
+    void clear();
+
+    size_t size() const { return m_frames.size(); }
+    // Oldest first.
+    Vector<Frame> frames() const;
+
+    String toJSON() const;
+    String histogramReport() const;
+
+private:
+    Vector<Frame> m_frames;
+    size_t m_next { 0 };
+    Seconds m_pendingScroll;
+};
+
+}
+
+#endif // FrameTimingRecorder_h
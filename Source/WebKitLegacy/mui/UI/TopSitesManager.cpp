@@ -28,13 +28,16 @@
 #include "SharedBuffer.h"
 #include "SQLiteDatabase.h"
 #include "SQLiteStatement.h"
+#include "SQLiteTransaction.h"
 #include "WebHistory.h"
 #include "WebHistoryItem.h"
 #include "WebPreferences.h"
 #include "WebView.h"
 #include "WebFrame.h"
+#include <wtf/MainThread.h>
 #include <wtf/text/WTFString.h>
 
+#include "cairo.h"
 #include "gui.h"
 #include <clib/debug_protos.h>
 
@@ -58,6 +61,23 @@ namespace WebCore {
 #define HOUR 60*60
 #define DAY 24*HOUR
 #define SCREENSHOT_UPDATE_DELAY 1*HOUR
+#define VISITS_FLUSH_DELAY 10
+
+#define SELECT_ENTRY_SQL "SELECT title, visitCount, lastAccessed, length(screenshot) FROM topsites WHERE url=?1;"
+#define SELECT_SCREENSHOT_SQL "SELECT screenshot FROM topsites WHERE url=?1;"
+#define COUNT_ENTRIES_SQL "SELECT count(*) FROM topsites;"
+#define REQUIRED_VISIT_COUNT_SQL "SELECT MIN(visitCount) FROM(SELECT visitCount FROM topsites ORDER BY visitCount DESC LIMIT 0, ?1);"
+#define UPDATE_VISIT_SQL "UPDATE topsites SET title=?1, visitCount=visitCount+?2, lastAccessed=?3 WHERE url=?4;"
+#define INSERT_VISIT_SQL "INSERT INTO topsites (url, title, screenshot, visitCount, lastAccessed) VALUES (?1, ?2, NULL, ?3, ?4);"
+#define UPDATE_SCREENSHOT_SQL "UPDATE topsites SET screenshot=?1 WHERE url=?2;"
+#define DELETE_ENTRY_SQL "DELETE FROM topsites WHERE url=?1;"
+#define SELECT_TOPSITES_SQL "SELECT url, title, screenshot, lastAccessed, visitCount FROM topsites ORDER by visitCount DESC, lastAccessed DESC;"
+#define CLEAR_SCREENSHOTS_SQL "UPDATE topsites SET screenshot = NULL WHERE visitCount <= ?1;"
+#define DELETE_OLDER_ENTRIES_SQL "DELETE FROM topsites WHERE lastAccessed < ?1;"
+#define UPDATE_DISPLAY_MODE_SQL "UPDATE settings SET displayMode=?1;"
+#define UPDATE_FILTER_MODE_SQL "UPDATE settings SET filterMode=?1;"
+#define UPDATE_MAX_ENTRIES_SQL "UPDATE settings SET maxEntries=?1;"
+#define UPDATE_SCREENSHOT_SIZE_SQL "UPDATE settings SET screenshotSize=?1;"
 
 static SQLiteDatabase m_topSitesDB;
 static bool m_disableScreenShots = getenv("OWB_DISABLE_TOPSITES_SCREENSHOTS");
@@ -74,6 +94,8 @@ TopSitesManager::TopSitesManager()
     , m_filterMode(SHOW_ALL)
     , m_displayMode(TEMPLATE_GRID)    
     , m_screenshotSize(SCREENSHOT_WIDTH)
+    , m_flushTimer(*this, &TopSitesManager::flush)
+    , m_encoderQueue(WorkQueue::create("org.webkit.TopSitesEncoder"))
 { 
     m_topSitesDB.open(TOPSITESDB);
     
@@ -83,6 +105,13 @@ TopSitesManager::TopSitesManager()
         {
             m_topSitesDB.executeCommand("CREATE TABLE topsites (url TEXT, title TEXT, screenshot BLOB, visitCount INTEGER, lastAccessed DOUBLE);");    
         }
+
+        // All lookups and updates go through the url, older databases may hold duplicates
+        if(!m_topSitesDB.executeCommand("CREATE UNIQUE INDEX IF NOT EXISTS topsites_url ON topsites(url);"))
+        {
+            m_topSitesDB.executeCommand("DELETE FROM topsites WHERE rowid NOT IN (SELECT MAX(rowid) FROM topsites GROUP BY url);");
+            m_topSitesDB.executeCommand("CREATE UNIQUE INDEX IF NOT EXISTS topsites_url ON topsites(url);");
+        }
         
         if(!m_topSitesDB.tableExists("settings"))
         {
@@ -125,130 +154,164 @@ TopSitesManager::TopSitesManager()
 
 TopSitesManager::~TopSitesManager()
 {
+    flush();
+
+    m_statements.clear();
+
     if(m_topSitesDB.isOpen())
         m_topSitesDB.close();
 }
 
-void TopSitesManager::setDisplayMode(displaymode_t mode) 
-{ 
-    m_displayMode = mode; 
-
-    SQLiteStatement updateStmt(m_topSitesDB, "UPDATE settings SET displayMode=?1;");
+SQLiteStatement* TopSitesManager::preparedStatement(const char *sql)
+{
+    auto it = m_statements.find(sql);
 
-    if(updateStmt.prepare())
+    if(it == m_statements.end())
     {
-        return;
+        auto statement = std::make_unique<SQLiteStatement>(m_topSitesDB, sql);
+
+        if(statement->prepare() != SQLITE_OK)
+            return 0;
+
+        it = m_statements.add(sql, WTFMove(statement)).iterator;
     }
 
-    updateStmt.bindInt(1, m_displayMode);
+    it->value->reset();
+    return it->value.get();
+}
 
-    if(!updateStmt.executeCommand())
-        return;
+void TopSitesManager::setDisplayMode(displaymode_t mode) 
+{ 
+    m_displayMode = mode; 
+
+    updateSetting(UPDATE_DISPLAY_MODE_SQL, m_displayMode);
 }
 
 void TopSitesManager::setFilterMode(filtermode_t mode) 
 { 
     m_filterMode = mode; 
 
-    SQLiteStatement updateStmt(m_topSitesDB, "UPDATE settings SET filterMode=?1;");
-
-    if(updateStmt.prepare())
-    {
-        return;
-    }
-
-    updateStmt.bindInt(1, m_filterMode);
-
-    if(!updateStmt.executeCommand())
-        return;
+    updateSetting(UPDATE_FILTER_MODE_SQL, m_filterMode);
 }
 
 void TopSitesManager::setMaxEntries(int maxEntries) 
 { 
     m_maxEntries = maxEntries; 
 
-    SQLiteStatement updateStmt(m_topSitesDB, "UPDATE settings SET maxEntries=?1;");
-
-    if(updateStmt.prepare())
-    {
-        return;
-    }
-
-    updateStmt.bindInt(1, m_maxEntries);
-
-    if(!updateStmt.executeCommand())
-        return;
+    updateSetting(UPDATE_MAX_ENTRIES_SQL, m_maxEntries);
 }
 
 void TopSitesManager::setScreenshotSize(int width)
 {
     m_screenshotSize = width;
 
-    SQLiteStatement updateStmt(m_topSitesDB, "UPDATE settings SET screenshotSize=?1;");
-
-    if(updateStmt.prepare())
-    {
-        return;
-    }
+    updateSetting(UPDATE_SCREENSHOT_SIZE_SQL, m_screenshotSize);
+}
 
-    updateStmt.bindInt(1, m_screenshotSize);
+void TopSitesManager::updateSetting(const char *sql, int value)
+{
+    SQLiteStatement *update = preparedStatement(sql);
 
-    if(!updateStmt.executeCommand())
+    if(!update)
         return;
+
+    update->bindInt(1, value);
+    update->step();
+    update->reset();
 }
 
 int TopSitesManager::entries()
 {
-    SQLiteStatement select(m_topSitesDB, "SELECT count(*) FROM topsites;");
+    int count = 0;
+    SQLiteStatement *select = preparedStatement(COUNT_ENTRIES_SQL);
 
-    if(select.prepare())
+    if(!select)
         return 0;
         
-    if(select.step() == SQLITE_ROW)
+    if(select->step() == SQLITE_ROW)
     {
-        return select.getColumnInt(0);
+        count = select->getColumnInt(0);
     }
 
-    return 0;
+    select->reset();
+    return count;
 }
 
-String TopSitesManager::title(URL &url)
+bool TopSitesManager::entry(URL &url, Entry &entry)
 {
-    String title;
+    bool found = false;
+    SQLiteStatement *select = preparedStatement(SELECT_ENTRY_SQL);
 
-    SQLiteStatement select(m_topSitesDB, "SELECT title FROM topsites WHERE url=?1;");
-    if(select.prepare())
-        return title;
+    if(select)
+    {
+        select->bindText(1, url.string());
 
-    select.bindText(1, url.string());
-        
-    if(select.step() == SQLITE_ROW)
+        if(select->step() == SQLITE_ROW)
+        {
+            found = true;
+            entry.title = select->getColumnText(0);
+            entry.visitCount = select->getColumnInt(1);
+            entry.lastAccessed = select->getColumnDouble(2);
+            entry.hasScreenshot = select->getColumnInt(3) > 0;
+        }
+
+        select->reset();
+    }
+
+    auto visit = m_pendingVisits.find(url.string());
+    if(visit != m_pendingVisits.end())
     {
-        title = select.getColumnText(0);
-    }    
-    
-    return title;
+        found = true;
+        entry.title = visit->value.title;
+        entry.visitCount += visit->value.visits;
+        entry.lastAccessed = visit->value.lastAccessed;
+    }
+
+    if(m_pendingScreenshots.contains(url.string()))
+    {
+        entry.hasScreenshot = true;
+    }
+
+    return found;
+}
+
+String TopSitesManager::title(URL &url)
+{
+    Entry e;
+    entry(url, e);
+    return e.title;
 }
 
 RefPtr<Image> TopSitesManager::screenshot(URL &url)
 {
     RefPtr<Image> image;
+    Vector<char> data;
     
-    SQLiteStatement select(m_topSitesDB, "SELECT screenshot FROM topsites WHERE url=?1;");
+    auto pending = m_pendingScreenshots.find(url.string());
+    if(pending != m_pendingScreenshots.end())
+    {
+        data = pending->value;
+    }
+    else
+    {
+        SQLiteStatement *select = preparedStatement(SELECT_SCREENSHOT_SQL);
 
-    if(select.prepare())
-        return image;
-    
-    select.bindText(1, url.string());
-    
-    if (select.step() == SQLITE_ROW)
+        if(!select)
+            return image;
+
+        select->bindText(1, url.string());
+
+        if(select->step() == SQLITE_ROW)
+        {
+            select->getColumnBlobAsVector(0, data);
+        }
+
+        select->reset();
+    }
+
+    if(data.size())
     {
-        Vector<char> data;
-        RefPtr<SharedBuffer> imageData;
-        
-        select.getColumnBlobAsVector(0, data);
-        
-        imageData = SharedBuffer::create(data.data(), data.size());
+        RefPtr<SharedBuffer> imageData = SharedBuffer::create(data.data(), data.size());
         
         image = BitmapImage::create();                                                            
         image->setData(WTFMove(imageData), true);
@@ -259,77 +322,29 @@ RefPtr<Image> TopSitesManager::screenshot(URL &url)
 
 double TopSitesManager::lastAccessed(URL &url)
 {
-    double lastAccessed = 0;
-    
-    SQLiteStatement select(m_topSitesDB, "SELECT lastAccessed FROM topsites WHERE url=?1;");
-
-    if(select.prepare())
-        return lastAccessed;
-
-    select.bindText(1, url.string());
-        
-    if(select.step() == SQLITE_ROW)
-    {
-        lastAccessed = select.getColumnDouble(0);
-    }    
-    
-    return lastAccessed;
+    Entry e;
+    entry(url, e);
+    return e.lastAccessed;
 }
 
 int TopSitesManager::visitCount(URL &url)
 {
-    int visitCount = 0;
-    
-    SQLiteStatement select(m_topSitesDB, "SELECT visitCount FROM topsites WHERE url=?1;");
-
-    if(select.prepare())
-        return visitCount;
-
-    select.bindText(1, url.string());
-        
-    if(select.step() == SQLITE_ROW)
-    {
-        visitCount = select.getColumnInt(0);
-    }    
-    
-    return visitCount;
+    Entry e;
+    entry(url, e);
+    return e.visitCount;
 }
 
 bool TopSitesManager::contains(URL &url)
 {
-    bool found = false;
-    
-    SQLiteStatement select(m_topSitesDB, "SELECT count(*) FROM topsites WHERE url=?1;");
-
-    if(select.prepare())
-        return found;
-
-    select.bindText(1, url.string());
-        
-    if(select.step() == SQLITE_ROW)
-    {
-        found = select.getColumnInt(0) > 0;
-    }    
-    
-    return found;    
+    Entry e;
+    return entry(url, e);
 }
 
 bool TopSitesManager::hasScreenshot(URL &url)
 {
-    bool hasScreenshot = false;
-    SQLiteStatement select(m_topSitesDB, "SELECT screenshot FROM topsites WHERE url=?1;");
-
-    if(select.prepare())
-        return hasScreenshot;
-
-    select.bindText(1, url.string());
-    
-    if (select.step() == SQLITE_ROW)
-    {
-        hasScreenshot = select.isColumnNull(0);
-    }
-    
-    return hasScreenshot;
+    Entry e;
+    entry(url, e);
+    return e.hasScreenshot;
 }
 
 bool TopSitesManager::shouldAppear(URL &url)
@@ -337,17 +352,19 @@ bool TopSitesManager::shouldAppear(URL &url)
     bool result = false;
     int minVisitCount = 0;
     
-    SQLiteStatement select(m_topSitesDB, "SELECT MIN(visitCount) FROM topsites ORDER BY visitCount DESC LIMIT 0, ?1;");
+    SQLiteStatement *select = preparedStatement(REQUIRED_VISIT_COUNT_SQL);
 
-    if(select.prepare())
+    if(!select)
         return result;
 
-    select.bindInt(1, maxEntries());
+    select->bindInt(1, maxEntries());
         
-    if(select.step() == SQLITE_ROW)
+    if(select->step() == SQLITE_ROW)
     {
-        minVisitCount = select.getColumnInt(0);
+        minVisitCount = select->getColumnInt(0);
     }    
+
+    select->reset();
     
     result = visitCount(url) >= minVisitCount;
     
@@ -358,17 +375,19 @@ int TopSitesManager::requiredVisitCount()
 {
     int minVisitCount = 0;
     
-    SQLiteStatement select(m_topSitesDB, "SELECT MIN(visitCount) FROM(SELECT visitCount FROM topsites ORDER BY visitCount DESC LIMIT 0, ?1);");
+    SQLiteStatement *select = preparedStatement(REQUIRED_VISIT_COUNT_SQL);
 
-    if(select.prepare())
+    if(!select)
         return minVisitCount;
 
-    select.bindInt(1, maxEntries());
+    select->bindInt(1, maxEntries());
         
-    if(select.step() == SQLITE_ROW)
+    if(select->step() == SQLITE_ROW)
     {
-        minVisitCount = select.getColumnInt(0);
+        minVisitCount = select->getColumnInt(0);
     }    
+
+    select->reset();
     
     //kprintf("requiredVisitCount %d\n", minVisitCount);
     //kprintf("entries < maxEntries %d\n",entries() < maxEntries());
@@ -446,131 +465,190 @@ bool TopSitesManager::shouldAdd(URL &url)
 
 void TopSitesManager::pruneOlderEntries()
 {
-    SQLiteStatement updateStmt(m_topSitesDB, "UPDATE topsites SET screenshot = NULL WHERE visitCount <= ?1;");
+    int visitCount = requiredVisitCount() - 1; // Improve this
+    SQLiteStatement *updateStmt = preparedStatement(CLEAR_SCREENSHOTS_SQL);
 
-    if(updateStmt.prepare())
+    if(!updateStmt)
     {
         return;
     }
 
-    updateStmt.bindInt(1, requiredVisitCount() - 1); // Improve this
+    updateStmt->bindInt(1, visitCount);
 
-    if(!updateStmt.executeCommand())
-        return;    
+    bool updated = updateStmt->step() == SQLITE_DONE;
+    updateStmt->reset();
+    if(!updated)
+        return;
         
     double maxAge = WebPreferences::sharedStandardPreferences()->historyAgeInDaysLimit();
     double minAge = MonotonicTime::now().secondsSinceEpoch().value() - maxAge*DAY;
-    SQLiteStatement deleteStmt(m_topSitesDB, "DELETE FROM topsites WHERE lastAccessed < ?1;");
+    SQLiteStatement *deleteStmt = preparedStatement(DELETE_OLDER_ENTRIES_SQL);
 
-    if(deleteStmt.prepare())
+    if(!deleteStmt)
     {
         return;
     }
 
-    deleteStmt.bindDouble(1, minAge);
+    deleteStmt->bindDouble(1, minAge);
     
-    deleteStmt.executeCommand();        
+    deleteStmt->step();
+    deleteStmt->reset();
 }
 
 bool TopSitesManager::addOrUpdate(WebView *webView, URL &url, String &title)
 {    
     double timestamp = MonotonicTime::now().secondsSinceEpoch().value();
-    int visitCount = 1;
-    double lastAccessed = 0;
-    Vector<char> screenshot;
-    bool found = false;
+    Entry previous;
+    int visitCount = entry(url, previous) ? previous.visitCount + 1 : 1;
 
     //kprintf("addOrUpdate <%s>\n", url.string().utf8().data());
 
-    SQLiteStatement select(m_topSitesDB, "SELECT visitCount, screenshot, lastAccessed FROM topsites WHERE url=?1;");
-    if(select.prepare())
-        return false;
+    //kprintf("visitCount %d required : %d screenshot %d timestamp %f lastaccessed %d\n", visitCount, requiredVisitCount(), previous.hasScreenshot, timestamp, previous.lastAccessed);
+    bool generateScreenshot = !m_disableScreenShots && !m_encodingScreenshots.contains(url.string())
+        && (visitCount >= requiredVisitCount()) && (!previous.hasScreenshot || (timestamp >= previous.lastAccessed + SCREENSHOT_UPDATE_DELAY));
 
-    select.bindText(1, url.string());
-        
-    if(select.step() == SQLITE_ROW)
+    // Written with the other visits at the next flush
+    PendingVisit &visit = m_pendingVisits.ensure(url.string(), [] { return PendingVisit(); }).iterator->value;
+    visit.title = title;
+    visit.visits++;
+    visit.lastAccessed = timestamp;
+
+    scheduleFlush();
+
+    if(generateScreenshot)
     {
-        found = true;
-        visitCount = select.getColumnInt(0) + 1;
-        select.getColumnBlobAsVector(1, screenshot);
-        lastAccessed = select.getColumnDouble(2);        
-    }    
+        int width = m_screenshotSize;
+        int height;
 
-    //kprintf("visitCount %d required : %d screenshot %d timestamp %f lastaccessed %d\n", visitCount, requiredVisitCount(), screenshot.size(), timestamp, lastAccessed);
-    bool generateScreenshot = !m_disableScreenShots && (visitCount >= requiredVisitCount()) && (screenshot.size() == 0 || (timestamp >= lastAccessed + SCREENSHOT_UPDATE_DELAY));
+        //kprintf("Generate screenshot for <%s>\n", url.string().utf8().data());
 
-    if(found)
-    {    
-        SQLiteStatement updateStmt(m_topSitesDB, "UPDATE topsites SET title=?1, visitCount=?2, lastAccessed=?3 WHERE url=?4;");
+        // Painting needs the main thread, the PNG encoding is done by the encoder queue
+        void *surface = webView->screenshotSurface(width, height);
 
-        if(updateStmt.prepare())
+        if(surface)
         {
-            return false;
+            encodeScreenshot(url.string(), surface);
         }
+    }        
+    
+    return true;
+}
 
-        updateStmt.bindText(1, title);
-        updateStmt.bindInt(2, visitCount);
-        updateStmt.bindDouble(3, timestamp);
-        updateStmt.bindText(4, url.string());
+static cairo_status_t writeFunction(void* output, const unsigned char* data, unsigned int length)
+{
+    if (!reinterpret_cast<Vector<char>*>(output)->tryAppend(reinterpret_cast<const char*>(data), length))
+        return CAIRO_STATUS_WRITE_ERROR;
+    return CAIRO_STATUS_SUCCESS;
+}
 
-        if(!updateStmt.executeCommand())
-            return false;                
-    }    
-    else
-    {        
-        SQLiteStatement insertStmt(m_topSitesDB, "INSERT INTO topsites (url, title, screenshot, visitCount, lastAccessed) VALUES (?1, ?2, ?3, ?4, ?5);");
+void TopSitesManager::encodeScreenshot(const String &url, void *surface)
+{
+    m_encodingScreenshots.add(url);
 
-        if(insertStmt.prepare())
-            return false;
+    m_encoderQueue->dispatch([this, url = url.isolatedCopy(), surface = static_cast<cairo_surface_t *>(surface)] {
+        Vector<char> imageData;
 
-        insertStmt.bindText(1, url.string());
-        insertStmt.bindText(2, title);    
-        insertStmt.bindNull(3);    
-        insertStmt.bindInt(4, visitCount);        
-        insertStmt.bindDouble(5, timestamp);
+        if(cairo_surface_write_to_png_stream(surface, writeFunction, &imageData) != CAIRO_STATUS_SUCCESS)
+            imageData.clear();
 
-        if(!insertStmt.executeCommand())
-            return false;            
-    }    
-    
-    if(generateScreenshot)
+        cairo_surface_destroy(surface);
+
+        callOnMainThread([this, url = url.isolatedCopy(), imageData = WTFMove(imageData)]() mutable {
+            didEncodeScreenshot(url, WTFMove(imageData));
+        });
+    });
+}
+
+void TopSitesManager::didEncodeScreenshot(const String &url, Vector<char>&& imageData)
+{
+    m_encodingScreenshots.remove(url);
+
+    // Dropped if the entry was removed meanwhile
+    URL entryURL({ }, url);
+    Entry e;
+    if(imageData.isEmpty() || !entry(entryURL, e))
+        return;
+
+    m_pendingScreenshots.set(url, WTFMove(imageData));
+    scheduleFlush();
+}
+
+void TopSitesManager::scheduleFlush()
+{
+    if(!m_flushTimer.isActive())
+        m_flushTimer.startOneShot(Seconds(VISITS_FLUSH_DELAY));
+}
+
+void TopSitesManager::flush()
+{
+    m_flushTimer.stop();
+
+    if(!m_topSitesDB.isOpen() || (m_pendingVisits.isEmpty() && m_pendingScreenshots.isEmpty()))
+        return;
+
+    SQLiteTransaction transaction(m_topSitesDB);
+    transaction.begin();
+
+    for(auto &visit : m_pendingVisits)
     {
-        int width = m_screenshotSize;
-        int height;
-        Vector<char> imageData;
+        SQLiteStatement *update = preparedStatement(UPDATE_VISIT_SQL);
 
-        //kprintf("Generate screenshot for <%s>\n", url.string().utf8().data());
-        webView->screenshot(width, height, &imageData);
-        
-        SQLiteStatement updateScreenShotStmt(m_topSitesDB, "UPDATE topsites SET screenshot=?1 WHERE url=?2;");
+        if(!update)
+            break;
 
-        if(updateScreenShotStmt.prepare())
-        {
-            return false;
-        }
+        update->bindText(1, visit.value.title);
+        update->bindInt(2, visit.value.visits);
+        update->bindDouble(3, visit.value.lastAccessed);
+        update->bindText(4, visit.key);
 
-        updateScreenShotStmt.bindBlob(1, imageData.data(), imageData.size());            
-        updateScreenShotStmt.bindText(2, url.string());        
+        if(update->step() != SQLITE_DONE || m_topSitesDB.lastChanges())
+            continue;
 
-        if(!updateScreenShotStmt.executeCommand())
-            return false;
-    }        
-    
-    return true;
+        SQLiteStatement *insert = preparedStatement(INSERT_VISIT_SQL);
+
+        if(!insert)
+            break;
+
+        insert->bindText(1, visit.key);
+        insert->bindText(2, visit.value.title);
+        insert->bindInt(3, visit.value.visits);
+        insert->bindDouble(4, visit.value.lastAccessed);
+        insert->step();
+    }
+
+    for(auto &screenshot : m_pendingScreenshots)
+    {
+        SQLiteStatement *update = preparedStatement(UPDATE_SCREENSHOT_SQL);
+
+        if(!update)
+            break;
+
+        update->bindBlob(1, screenshot.value.data(), screenshot.value.size());
+        update->bindText(2, screenshot.key);
+        update->step();
+    }
+
+    transaction.commit();
+
+    m_pendingVisits.clear();
+    m_pendingScreenshots.clear();
 }
 
 void TopSitesManager::remove(URL &url)
 {
-    SQLiteStatement deleteStmt(m_topSitesDB, "DELETE FROM topsites WHERE url=?1;");
+    m_pendingVisits.remove(url.string());
+    m_pendingScreenshots.remove(url.string());
+
+    SQLiteStatement *deleteStmt = preparedStatement(DELETE_ENTRY_SQL);
 
-    if(deleteStmt.prepare())
+    if(!deleteStmt)
     {
         return;
     }
 
-    deleteStmt.bindText(1, url.string());
+    deleteStmt->bindText(1, url.string());
     
-    deleteStmt.executeCommand();
+    deleteStmt->step();
 }
 
 void TopSitesManager::generateTemplate(WebView *webView, String originurl)
@@ -616,10 +694,14 @@ void TopSitesManager::generateTemplate(WebView *webView, String originurl)
         String contents;
         int countEntries = 0;
 
-        SQLiteStatement select(m_topSitesDB, "SELECT url, title, screenshot, lastAccessed, visitCount FROM topsites ORDER by visitCount DESC, lastAccessed DESC;");
+        flush();
+
+        SQLiteStatement *selectStmt = preparedStatement(SELECT_TOPSITES_SQL);
 
-        if(select.prepare())
+        if(!selectStmt)
             return;
+
+        SQLiteStatement &select = *selectStmt;
             
         while(select.step() == SQLITE_ROW && countEntries < maxEntries())
         {
@@ -720,6 +802,8 @@ void TopSitesManager::generateTemplate(WebView *webView, String originurl)
                 }        
             }
         }
+
+        select.reset();
         
         if(contents.isEmpty())
         {
@@ -19,11 +19,19 @@
 #ifndef TopSitesManager_h
 #define TopSitesManager_h
 
+#include <wtf/HashMap.h>
+#include <wtf/HashSet.h>
 #include <wtf/RefPtr.h>
 #include <wtf/RefCounted.h>
+#include <wtf/WorkQueue.h>
+#include <wtf/text/StringHash.h>
+#include <wtf/text/WTFString.h>
+#include <memory>
 
 #include "WebKitTypes.h"
 #include "SQLiteDatabase.h"
+#include "SQLiteStatement.h"
+#include "Timer.h"
 
 namespace WTF {
 class String;
@@ -62,6 +70,15 @@ protected:
     bool shouldAppear(URL &url);
     int requiredVisitCount();
 
+    // All the attributes of an entry, including the visits not written yet
+    struct Entry {
+        WTF::String title;
+        int visitCount { 0 };
+        double lastAccessed { 0 };
+        bool hasScreenshot { false };
+    };
+    bool entry(URL &url, Entry &entry);
+
     // Attributes
     WTF::String title(URL &url);
     WTF::RefPtr<Image> screenshot(URL &url);
@@ -74,13 +91,33 @@ protected:
     void remove(URL &url);
     void pruneOlderEntries();
 
+    // Visits and screenshots are kept here and written in a single transaction by flush()
+    struct PendingVisit {
+        WTF::String title;
+        int visits { 0 };
+        double lastAccessed { 0 };
+    };
+    void scheduleFlush();
+    void flush();
+    void encodeScreenshot(const WTF::String &url, void *surface);
+    void didEncodeScreenshot(const WTF::String &url, Vector<char>&& imageData);
+
+    SQLiteStatement* preparedStatement(const char *sql);
+    void updateSetting(const char *sql, int value);
+
     int    m_maxEntries;
     filtermode_t m_filterMode;    
     displaymode_t m_displayMode;
     int m_screenshotSize;
     WTF::RefPtr<SharedBuffer> m_placeholderImage;
     WTF::RefPtr<SharedBuffer> m_closeImage;
-    
+
+    HashMap<WTF::String, std::unique_ptr<SQLiteStatement>> m_statements;
+    HashMap<WTF::String, PendingVisit> m_pendingVisits;
+    HashMap<WTF::String, Vector<char>> m_pendingScreenshots;
+    HashSet<WTF::String> m_encodingScreenshots;
+    Timer m_flushTimer;
+    RefPtr<WorkQueue> m_encoderQueue;
 };
 
 } // WebCore
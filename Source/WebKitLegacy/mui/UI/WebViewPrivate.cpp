@@ -760,6 +760,60 @@ WebViewPrivate::WebViewPrivate(WebView *webView)
 //      webView->setWebResourceLoadDelegate(MorphOSResourceLoadDelegate::createInstance());
 }
 
+// Every FrameView::paint call pays for clip setup, a render tree walk and a
+// blit, whatever the size of the rect. This is that cost in pixels.
+static const uint64_t paintOverheadInPixels = 128 * 128;
+static const size_t maxDamageRects = 32;
+
+static uint64_t rectArea(const IntRect& rect)
+{
+    return static_cast<uint64_t>(rect.width()) * rect.height();
+}
+
+// Turns the damage into disjoint rects to paint. Two rects are merged when the
+// clean pixels their union adds cost less than the paint calls it saves; a
+// union that would partially overlap another rect is rejected so that no pixel
+// is painted twice.
+static Vector<IntRect> paintRectsForDamage(const Region& damage)
+{
+    Vector<IntRect> rects = damage.rects();
+    if (rects.size() > maxDamageRects)
+        return { damage.bounds() };
+
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < rects.size() && !merged; ++i) {
+            for (size_t j = i + 1; j < rects.size() && !merged; ++j) {
+                IntRect candidate = unionRect(rects[i], rects[j]);
+                uint64_t coveredArea = 0;
+                unsigned absorbed = 0;
+                bool overlaps = false;
+                for (auto& rect : rects) {
+                    if (!candidate.intersects(rect))
+                        continue;
+                    if (!candidate.contains(rect)) {
+                        overlaps = true;
+                        break;
+                    }
+                    coveredArea += rectArea(rect);
+                    absorbed++;
+                }
+                if (overlaps || rectArea(candidate) - coveredArea >= paintOverheadInPixels * (absorbed - 1))
+                    continue;
+
+                rects.removeAllMatching([&candidate](const IntRect& rect) {
+                    return candidate.contains(rect);
+                });
+                rects.append(candidate);
+                merged = true;
+            }
+        }
+    }
+
+    return rects;
+}
+
 BalRectangle WebViewPrivate::onExpose(BalEventExpose event)
 {
     Frame* frame = core(m_webView->mainFrame());
@@ -777,9 +831,6 @@ BalRectangle WebViewPrivate::onExpose(BalEventExpose event)
     if (!widget->window)
         return IntRect();
 
-    volatile double start = 0, layout = 0, paint = 0, blit = 0, inspector = 0; //
-    if(renderBenchmark) start = MonotonicTime::now().secondsSinceEpoch().value(); //
-
     PlatformGraphicsContext pctx(widget->cr);
     GraphicsContext ctx(&pctx);
     IntRect rect(m_webView->dirtyRegion());
@@ -788,78 +839,63 @@ BalRectangle WebViewPrivate::onExpose(BalEventExpose event)
 
     if (frame->contentRenderer() && frame->view() && !rect.isEmpty() && !getv(widget->browser, MA_OWBBrowser_VideoElement))
     {
-        bool coalesce = shouldCoalesce(rect);
+        FrameTimingRecorder::Frame timing;
+        timing.startTime = MonotonicTime::now();
 
-        if(renderBenchmark) { kprintf("dirtyRegion [%d %d %d %d] rects %ld coalesce %d\n", rect.x(), rect.y(), rect.width(), rect.height(), m_dirtyRegions.size(), coalesce); } //
-
-        if(coalesce)
-        {
-            if(renderBenchmark) { kprintf("*** Coalescing rects\n"); } //
+        Region damage = WTFMove(m_dirtyRegion);
+        clearDirtyRegion();
 
-            clearDirtyRegion();
+        Vector<IntRect> paintRects = paintRectsForDamage(damage);
+        timing.dirtyArea = damage.totalArea();
+        timing.rectCount = paintRects.size();
 
-            frame->view()->updateLayoutAndStyleIfNeededRecursive();
+        if(renderBenchmark) { kprintf("dirtyRegion [%d %d %d %d] bands %ld paint rects %ld\n", rect.x(), rect.y(), rect.width(), rect.height(), damage.rects().size(), paintRects.size()); } //
 
-            if(renderBenchmark)    { layout = MonotonicTime::now().secondsSinceEpoch().value() - start; start = MonotonicTime::now().secondsSinceEpoch().value(); kprintf("Painting [%d %d %d %d]\n", rect.x(), rect.y(), rect.width(), rect.height()); } //
-
-            ctx.save();
-            ctx.clip(rect);
-            frame->view()->paint(ctx, rect);
-            ctx.restore();
+        MonotonicTime phaseStart = MonotonicTime::now();
+        frame->document()->updateStyleIfNeeded();
+        timing.style = MonotonicTime::now() - phaseStart;
 
-            if(renderBenchmark)    { paint = MonotonicTime::now().secondsSinceEpoch().value() - start; start = MonotonicTime::now().secondsSinceEpoch().value(); kprintf("Painting inspector [%d %d %d %d]\n", rect.x(), rect.y(), rect.width(), rect.height()); } //
+        phaseStart = MonotonicTime::now();
+        frame->view()->updateLayoutAndStyleIfNeededRecursive();
+        timing.layout = MonotonicTime::now() - phaseStart;
 
-            updateView(widget, rect, false);
-
-            if(renderBenchmark)    { blit = MonotonicTime::now().secondsSinceEpoch().value() - start; } //
-        }
-        else
+        for (auto& paintRect : paintRects)
         {
-            if(renderBenchmark) { kprintf("*** Not Coalescing rects\n"); } //
-
-            Vector<IntRect> dirtyRegions = m_dirtyRegions; // urg
-            clearDirtyRegion();
-
-            frame->view()->updateLayoutAndStyleIfNeededRecursive();
-
-            if(renderBenchmark)    { layout = MonotonicTime::now().secondsSinceEpoch().value() - start; start = MonotonicTime::now().secondsSinceEpoch().value(); } //
-
-            for(size_t i = 0; i < dirtyRegions.size(); i++)
-            {
-                if(renderBenchmark) { kprintf("Painting [%d %d %d %d]\n", dirtyRegions[i].x(), dirtyRegions[i].y(), dirtyRegions[i].width(), dirtyRegions[i].height()); }
-                ctx.save();
-                ctx.clip(dirtyRegions[i]);
-                frame->view()->paint(ctx, dirtyRegions[i]);
-                ctx.restore();
-/*
-                ctx.save();
-                ctx.clip(dirtyRegions[i]);
-                frame->page()->inspectorController()->drawHighlight(ctx);
-                ctx.restore();
-*/
-                if(renderBenchmark)    { paint += MonotonicTime::now().secondsSinceEpoch().value() - start; start = MonotonicTime::now().secondsSinceEpoch().value(); kprintf("Blitting [%d %d %d %d]\n", dirtyRegions[i].x(), dirtyRegions[i].y(), dirtyRegions[i].width(), dirtyRegions[i].height()); } //
+            if(renderBenchmark) { kprintf("Painting [%d %d %d %d]\n", paintRect.x(), paintRect.y(), paintRect.width(), paintRect.height()); }
 
-                updateView(widget, dirtyRegions[i], false);
+            phaseStart = MonotonicTime::now();
+            ctx.save();
+            ctx.clip(paintRect);
+            frame->view()->paint(ctx, paintRect);
+            ctx.restore();
+            timing.paint += MonotonicTime::now() - phaseStart;
+            timing.paintedArea += rectArea(paintRect);
 
-                if(renderBenchmark)    { blit += MonotonicTime::now().secondsSinceEpoch().value() - start; start = MonotonicTime::now().secondsSinceEpoch().value(); } //
-            }
+            phaseStart = MonotonicTime::now();
+            updateView(widget, paintRect, false);
+            timing.blit += MonotonicTime::now() - phaseStart;
         }
 
+        phaseStart = MonotonicTime::now();
         updateView(widget, rect, true);
+        timing.blit += MonotonicTime::now() - phaseStart;
 
-        if(renderBenchmark) blit += MonotonicTime::now().secondsSinceEpoch().value() - start; //
-    }
+        if(renderBenchmark)
+        {
+            kprintf("WebViewPrivate::onExpose(%d,%d,%d,%d)\n  Style: %f ms\n  Layout: %f ms\n  Paint: %f ms\n  Blit: %f ms\n->Total: %f ms\n  Dirty: %lu px\n  Painted: %lu px\n  Overdraw: %lu px\n\n",
+                rect.x(), rect.y(), rect.width(), rect.height(),
+                timing.style.milliseconds(),
+                timing.layout.milliseconds(),
+                timing.paint.milliseconds(),
+                timing.blit.milliseconds(),
+                timing.total().milliseconds(),
+                (unsigned long)timing.dirtyArea,
+                (unsigned long)timing.paintedArea,
+                (unsigned long)(timing.paintedArea - timing.dirtyArea)
+                );
+        }
 
-    if(renderBenchmark)
-    {
-        kprintf("WebViewPrivate::onExpose(%d,%d,%d,%d)\n  Layout: %f ms\n  Paint: %f ms\n  Inspector: %f ms\n  Blit: %f ms\n->Total: %f ms\n\n",
-            rect.x(), rect.y(), rect.width(), rect.height(),
-            layout*1000,
-            paint*1000,
-            inspector*1000,
-            blit*1000,
-            (layout + paint + blit + inspector)*1000
-            );
+        m_frameTimings.record(WTFMove(timing));
     }
 
     return rect;
@@ -873,9 +909,26 @@ static cairo_status_t writeFunction(void* output, const unsigned char* data, uns
 }
 
 bool WebViewPrivate::screenshot(int &requested_width, int& requested_height, Vector<char> *imageData)
+{
+    cairo_surface_t *surface = screenshotSurface(requested_width, requested_height);
+
+    if(!surface)
+        return false;
+
+    cairo_surface_write_to_png_stream(surface, writeFunction, imageData);
+    cairo_surface_destroy(surface);
+
+    return true;
+}
+
+/*
+ * Paints the view scaled down to requested_width into a new image surface.
+ * The caller owns the surface, which may be encoded on another thread.
+ */
+cairo_surface_t* WebViewPrivate::screenshotSurface(int &requested_width, int& requested_height)
 {
     Frame* frame = core(m_webView->mainFrame());
-    if (frame && frame->view())
+    if (frame && frame->view() && frame->contentRenderer())
     {
         int view_width = m_rect.width();
         int view_height = m_rect.height();
@@ -885,13 +938,12 @@ bool WebViewPrivate::screenshot(int &requested_width, int& requested_height, Vec
 
         cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, requested_width, requested_height);
 
-        if(surface)
+        if(cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS)
         {
             cairo_t *cr = cairo_create(surface);
 
-            if(cr)
+            if(cairo_status(cr) == CAIRO_STATUS_SUCCESS)
             {
-                if (frame->contentRenderer())
                 {
                     PlatformGraphicsContext pctx(cr);
                     GraphicsContext ctx(&pctx);
@@ -899,25 +951,26 @@ bool WebViewPrivate::screenshot(int &requested_width, int& requested_height, Vec
                     IntRect rect(m_rect);
 
                     frame->view()->updateLayoutAndStyleIfNeededRecursive();
-                    
+
                     ctx.save();
                     ctx.scale(FloatSize(scale_ratio, scale_ratio));
                     frame->view()->paintContents(ctx, rect);
                     ctx.restore();
-
-                    cairo_surface_write_to_png_stream(surface, writeFunction, imageData);
-
-                    return true;
                 }
 
                 cairo_destroy(cr);
+                cairo_surface_flush(surface);
+
+                return surface;
             }
 
-            cairo_surface_destroy(surface);
+            cairo_destroy(cr);
         }
+
+        cairo_surface_destroy(surface);
     }
         
-    return false;
+    return 0;
 }
 
 bool WebViewPrivate::screenshot(String& path)
@@ -1553,21 +1606,16 @@ void WebViewPrivate::repaint(const WebCore::IntRect& windowRect, bool contentCha
 
 void WebViewPrivate::scrollBackingStore(WebCore::FrameView* view, int dx, int dy, const WebCore::IntRect& scrollViewRect, const WebCore::IntRect& clipRect)
 {
-    double start = 0;
+    MonotonicTime start = MonotonicTime::now();
     if(renderBenchmark)
     {
-        start = MonotonicTime::now().secondsSinceEpoch().value();
         kprintf("WebViewPrivate::scrollBackingStore(%d, %d, scrollViewRect[%d, %d, %d, %d], clipRect[%d, %d, %d, %d])\n", dx, dy,
                                 scrollViewRect.x(), scrollViewRect.y(), scrollViewRect.width(), scrollViewRect.height(),
                                 clipRect.x(), clipRect.y(), clipRect.width(), clipRect.height());
         kprintf("  dirtyRegion [%d, %d, %d, %d]\n", m_webView->dirtyRegion().x, m_webView->dirtyRegion().y, m_webView->dirtyRegion().w, m_webView->dirtyRegion().h);
     }
 
-    m_backingStoreDirtyRegion.move(dx, dy);
-    for(size_t i = 0; i < m_dirtyRegions.size(); i++)
-    {
-        m_dirtyRegions[i].move(dx, dy);
-    }
+    m_dirtyRegion.translate(IntSize(dx, dy));
 
     BalWidget* widget = m_webView->viewWindow();
     if (!widget || !widget->window)
@@ -1634,7 +1682,10 @@ void WebViewPrivate::scrollBackingStore(WebCore::FrameView* view, int dx, int dy
     sendExposeEvent(updateRect); // only processed at next expose event, potential lag
     //onExpose(0);               // immediate, but scrolling sideffect with fixed elements
 
-   if(renderBenchmark) { kprintf("WebViewPrivate::scrollBackingStore()\n  Scroll: %f ms\n", MonotonicTime::now().secondsSinceEpoch().value() - start); } //
+    Seconds scrollTime = MonotonicTime::now() - start;
+    m_frameTimings.addScrollTime(scrollTime);
+
+    if(renderBenchmark) { kprintf("WebViewPrivate::scrollBackingStore()\n  Scroll: %f ms\n", scrollTime.milliseconds()); } //
 }
 
 /* Implement these properly */
@@ -30,6 +30,8 @@
 
 #include "WebView.h"
 #include "IntRect.h"
+#include "Region.h"
+#include "FrameTimingRecorder.h"
 #include <wtf/Vector.h>
 #include "FrameView.h"
 #include <WebCore/Frame.h>
@@ -178,57 +180,31 @@ public:
     {
     }
 
-    bool shouldCoalesce(WebCore::IntRect rect)
-    {
-    const size_t cRectThreshold = 10;
-    const float cWastedSpaceThreshold = 0.75f;
-    size_t count = m_dirtyRegions.size();
-    bool useUnionedRect = (count <= 1) || (count > cRectThreshold);
-    if (!useUnionedRect)
-    {
-        // Attempt to guess whether or not we should use the unioned rect or the individual rects.
-        // We do this by computing the percentage of "wasted space" in the union.  If that wasted space
-        // is too large, then we will do individual rect painting instead.
-        float unionPixels = (rect.width() * rect.height());
-        float singlePixels = 0;
-        for (size_t i = 0; i < count; ++i)
-        singlePixels += m_dirtyRegions[i].width() * m_dirtyRegions[i].height();
-        float wastedSpace = 1 - (singlePixels / unionPixels);
-        if (wastedSpace <= cWastedSpaceThreshold)
-        useUnionedRect = true;
-    }
-    return useUnionedRect;
-    }
-    
     void clearDirtyRegion()
     {
-    m_dirtyRegions.clear();
-        m_backingStoreDirtyRegion.setX(0);
-        m_backingStoreDirtyRegion.setY(0);
-        m_backingStoreDirtyRegion.setWidth(0);
-        m_backingStoreDirtyRegion.setHeight(0);
+        m_dirtyRegion = WebCore::Region();
     }
 
     BalRectangle dirtyRegion()
     {
-        BalRectangle rect = {m_backingStoreDirtyRegion.x(), m_backingStoreDirtyRegion.y(), m_backingStoreDirtyRegion.width(), m_backingStoreDirtyRegion.height()};
+        WebCore::IntRect bounds = m_dirtyRegion.bounds();
+        BalRectangle rect = {bounds.x(), bounds.y(), bounds.width(), bounds.height()};
         return rect;
     }
 
     void addToDirtyRegion(const BalRectangle& dirtyRect)
     {
-        m_backingStoreDirtyRegion.unite(dirtyRect);
-    if(m_dirtyRegions.size() > 10)
-    {
-        m_dirtyRegions.clear();
-        m_dirtyRegions.append(m_backingStoreDirtyRegion);
-    }
-    else
-    {
-        m_dirtyRegions.append(dirtyRect);
-    }
+        // Past this many spans the region costs more to maintain than the
+        // clean pixels we would save by not painting its bounding box.
+        const unsigned cMaxDirtyRegionGridSize = 256;
+
+        m_dirtyRegion.unite(WebCore::Region(WebCore::IntRect(dirtyRect)));
+        if (m_dirtyRegion.gridSize() > cMaxDirtyRegionGridSize)
+            m_dirtyRegion = WebCore::Region(m_dirtyRegion.bounds());
     }
 
+    WebCore::FrameTimingRecorder& frameTimings() { return m_frameTimings; }
+
     BalRectangle onExpose(BalEventExpose event);
     bool onKeyDown(BalEventKey event);
     bool onKeyUp(BalEventKey event);
@@ -258,6 +234,7 @@ public:
     void setViewWindow(BalWidget*) {}
     
     bool screenshot(int &requested_width, int& requested_height, WTF::Vector<char> *imageData);
+    cairo_surface_t* screenshotSurface(int &requested_width, int& requested_height);
     bool screenshot(WTF::String& path);
     
     void requestMemoryRelease();
@@ -271,9 +248,9 @@ public:
     WebView *m_webView;
     bool isInitialized;
     
-    WTF::Vector<WebCore::IntRect> m_dirtyRegions;
     WebCore::IntPoint m_backingStoreSize;
-    WebCore::IntRect m_backingStoreDirtyRegion;
+    WebCore::Region m_dirtyRegion;
+    WebCore::FrameTimingRecorder m_frameTimings;
 
     WebCore::Timer m_closeWindowTimer;
 
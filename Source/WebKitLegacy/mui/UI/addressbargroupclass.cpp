@@ -49,19 +49,24 @@ struct Data
     LONG prevlen;
 };
 
+/* Only the most recent entries go to the popup list, completion queries the history index */
+#define MAX_POPUP_HISTORY_ENTRIES 100
+
 static void loadhistory(struct Data *data)
 {
     WebHistory* history = WebHistory::sharedHistory();
-    std::vector<WebHistoryItem *> historyList = *(history->historyList());
+    std::vector<WebHistoryItem *> *historyList = history->historyList();
 
     set((Object *) getv(data->pop_path, MUIA_Popobject_Object), MA_HistoryList_Complete, FALSE);
     set((Object *) getv(data->pop_path, MUIA_Popobject_Object), MUIA_List_Quiet, TRUE);
 
     DoMethod((Object *) getv(data->pop_path, MUIA_Popobject_Object), MUIM_List_Clear);
 
-    for(unsigned int i = 0; i < historyList.size(); i++)
+    unsigned int first = historyList->size() > MAX_POPUP_HISTORY_ENTRIES ? historyList->size() - MAX_POPUP_HISTORY_ENTRIES : 0;
+
+    for(unsigned int i = first; i < historyList->size(); i++)
     {
-        WebHistoryItem *webHistoryItem = historyList[i];
+        WebHistoryItem *webHistoryItem = (*historyList)[i];
 
         if(webHistoryItem)
         {
@@ -90,10 +90,12 @@
 #include <wtf/text/StringConcatenateNumbers.h>
 /* needed for shutting down */
 #include <WebCore/CurlContext.h>
+#include <WebCore/NetworkStorageSession.h>
 #include "NetworkStorageSessionMap.h"
 #include "WebStorageNamespaceProvider.h"
 #include "WebDatabaseProvider.h"
 #include <WebCore/CurlCacheManager.h>
+#include <WebCore/ScriptBytecodeCache.h>
 #include <WebCore/DOMWindow.h>
 #include <WebCore/MemoryCache.h>
 #include <WebCore/MemoryRelease.h>
@@ -155,8 +157,28 @@ extern char * _ProgramName;
 namespace WebCore
 {
     extern bool ad_block_enabled;
+    extern void decisionCacheStatistics(unsigned& hits, unsigned& misses, unsigned& size);
+#ifndef NDEBUG
+    extern String benchmarkAdBlock(const char *path);
+    extern String benchmarkCurlLatency(const char *url, unsigned count);
+    extern String benchmarkTextPainting(unsigned paintCount);
+#endif
+#if ENABLE(VIDEO)
+    extern void setVideoDecoderThreading(int threads, bool frameThreading, bool sliceThreading);
+    extern void videoFrameStatistics(unsigned& decoded, unsigned& dropped, unsigned& late);
+#endif
+#if ENABLE(VIDEO) && !defined(NDEBUG)
+    namespace Acinerella
+    {
+        extern String benchmarkYUV420Conversion(unsigned frameCount);
+    }
+#endif
 }
 
+#if OS(AROS)
+extern char * allocator_report();
+#endif
+
 Object *app;
 
 struct MinList window_list;
@@ -487,7 +509,28 @@ enum
     REXX_GETSELECTED,
     REXX_FULLSCREEN,
     REXX_GETTITLE,
-    REXX_STATUS
+    REXX_STATUS,
+#ifndef NDEBUG
+    REXX_ADBLOCKBENCHMARK,
+#endif
+    REXX_CACHESTATISTICS,
+#ifndef NDEBUG
+    REXX_CURLBENCHMARK,
+#endif
+#ifndef NDEBUG
+    REXX_COOKIEBENCHMARK,
+#endif
+    REXX_FRAMETIMINGS,
+#ifndef NDEBUG
+    REXX_VIDEOBENCHMARK,
+#endif
+    REXX_PAGEALLOCATOR,
+#ifndef NDEBUG
+    REXX_TEXTBENCHMARK,
+#endif
+#if ENABLE(VIDEO)
+    REXX_VIDEOSTATISTICS
+#endif
 };
 
 #if OS(MORPHOS)
@@ -526,6 +569,27 @@ REXXHOOK(RexxHookR, REXX_GETSELECTED);
 REXXHOOK(RexxHookS, REXX_FULLSCREEN);
 REXXHOOK(RexxHookT, REXX_GETTITLE);
 REXXHOOK(RexxHookU, REXX_STATUS);
+#ifndef NDEBUG
+REXXHOOK(RexxHookV, REXX_ADBLOCKBENCHMARK);
+#endif
+REXXHOOK(RexxHookW, REXX_CACHESTATISTICS);
+#ifndef NDEBUG
+REXXHOOK(RexxHookX, REXX_CURLBENCHMARK);
+#endif
+#ifndef NDEBUG
+REXXHOOK(RexxHookY, REXX_COOKIEBENCHMARK);
+#endif
+REXXHOOK(RexxHookZ, REXX_FRAMETIMINGS);
+#ifndef NDEBUG
+REXXHOOK(RexxHookAA, REXX_VIDEOBENCHMARK);
+#endif
+REXXHOOK(RexxHookAB, REXX_PAGEALLOCATOR);
+#ifndef NDEBUG
+REXXHOOK(RexxHookAC, REXX_TEXTBENCHMARK);
+#endif
+#if ENABLE(VIDEO)
+REXXHOOK(RexxHookAD, REXX_VIDEOSTATISTICS);
+#endif
 
 static const struct MUI_Command rexxcommands[] =
 {
@@ -550,6 +614,28 @@ static const struct MUI_Command rexxcommands[] =
     { "FULLSCREEN"    , "MODE/K", 1, (struct Hook *)&RexxHookS, { 0 } },
     { "GETTITLE"      , NULL    , 0, (struct Hook *)&RexxHookT, { 0 } },
     { "STATUS"        , NULL    , 0, (struct Hook *)&RexxHookU, { 0 } },
+    /* Benchmarks are only built into debug builds */
+#ifndef NDEBUG
+    { "ADBLOCKBENCHMARK", "FILE/A", 1, (struct Hook *)&RexxHookV, { 0 } },
+#endif
+    { "CACHESTATISTICS", NULL   , 0, (struct Hook *)&RexxHookW, { 0 } },
+#ifndef NDEBUG
+    { "CURLBENCHMARK" , "URL/A,COUNT/N", 2, (struct Hook *)&RexxHookX, { 0 } },
+#endif
+#ifndef NDEBUG
+    { "COOKIEBENCHMARK", "FILE/A", 1, (struct Hook *)&RexxHookY, { 0 } },
+#endif
+    { "FRAMETIMINGS"  , "JSON/S,RESET/S", 2, (struct Hook *)&RexxHookZ, { 0 } },
+#ifndef NDEBUG
+    { "VIDEOBENCHMARK", "COUNT/N", 1, (struct Hook *)&RexxHookAA, { 0 } },
+#endif
+    { "PAGEALLOCATOR" , NULL    , 0, (struct Hook *)&RexxHookAB, { 0 } },
+#ifndef NDEBUG
+    { "TEXTBENCHMARK" , "COUNT/N", 1, (struct Hook *)&RexxHookAC, { 0 } },
+#endif
+#if ENABLE(VIDEO)
+    { "VIDEOSTATISTICS", NULL   , 0, (struct Hook *)&RexxHookAD, { 0 } },
+#endif
     { NULL            , NULL    , 0, NULL, { 0 } }
 };
 
@@ -581,6 +667,78 @@ AROS_UFH3
     {
         DoMethod(obj, MM_OWBApp_About);
     }
+#ifndef NDEBUG
+    else if ((IPTR)h->h_Data == REXX_ADBLOCKBENCHMARK)
+    {
+        String result = WebCore::benchmarkAdBlock((const char *)*params);
+        set(app, MUIA_Application_RexxString, result.latin1().data());
+    }
+#endif
+    else if ((IPTR)h->h_Data == REXX_CACHESTATISTICS)
+    {
+        const CurlCacheManager::Statistics& statistics = CurlCacheManager::singleton().statistics();
+        const ScriptBytecodeCache::Statistics& bytecodeStatistics = ScriptBytecodeCache::singleton().statistics();
+        unsigned adBlockHits, adBlockMisses, adBlockEntries;
+        WebCore::decisionCacheStatistics(adBlockHits, adBlockMisses, adBlockEntries);
+        char result[320];
+        snprintf(result, sizeof(result), "FRESH %u STALE %u REVALIDATED %u MISS %u BYTECODEHITS %u BYTECODEREJECTED %u BYTECODESTORED %u PARSESAVEDMS %.0f ADBLOCKHITS %u ADBLOCKMISSES %u ADBLOCKENTRIES %u",
+            statistics.freshHits, statistics.staleHits, statistics.revalidatedHits, statistics.misses,
+            bytecodeStatistics.hits, bytecodeStatistics.rejected, bytecodeStatistics.stores, bytecodeStatistics.timeSaved.milliseconds(),
+            adBlockHits, adBlockMisses, adBlockEntries);
+        set(app, MUIA_Application_RexxString, result);
+    }
+#ifndef NDEBUG
+    else if ((IPTR)h->h_Data == REXX_CURLBENCHMARK)
+    {
+        unsigned count = params[1] ? *(LONG *)params[1] : 100;
+        String result = WebCore::benchmarkCurlLatency((const char *)params[0], count);
+        set(app, MUIA_Application_RexxString, result.latin1().data());
+    }
+#endif
+#ifndef NDEBUG
+    else if ((IPTR)h->h_Data == REXX_COOKIEBENCHMARK)
+    {
+        String result = NetworkStorageSessionMap::defaultStorageSession().cookieDatabase().benchmarkLookups((const char *)*params);
+        set(app, MUIA_Application_RexxString, result.latin1().data());
+    }
+#endif
+#if ENABLE(VIDEO) && !defined(NDEBUG)
+    else if ((IPTR)h->h_Data == REXX_VIDEOBENCHMARK)
+    {
+        unsigned count = *params ? *(LONG *)*params : 100;
+        String result = WebCore::Acinerella::benchmarkYUV420Conversion(count);
+        set(app, MUIA_Application_RexxString, result.latin1().data());
+    }
+#endif
+#ifndef NDEBUG
+    else if ((IPTR)h->h_Data == REXX_TEXTBENCHMARK)
+    {
+        unsigned count = *params ? *(LONG *)*params : 50;
+        String result = WebCore::benchmarkTextPainting(count);
+        set(app, MUIA_Application_RexxString, result.latin1().data());
+    }
+#endif
+#if ENABLE(VIDEO)
+    else if ((IPTR)h->h_Data == REXX_VIDEOSTATISTICS)
+    {
+        unsigned decoded, dropped, late;
+        WebCore::videoFrameStatistics(decoded, dropped, late);
+        char result[96];
+        snprintf(result, sizeof(result), "DECODED %u DROPPED %u LATE %u", decoded, dropped, late);
+        set(app, MUIA_Application_RexxString, result);
+    }
+#endif
+#if OS(AROS)
+    else if ((IPTR)h->h_Data == REXX_PAGEALLOCATOR)
+    {
+        char *result = allocator_report();
+        if (result)
+        {
+            set(app, MUIA_Application_RexxString, result);
+            free(result);
+        }
+    }
+#endif
     else if (window)
     {
         switch ((IPTR)h->h_Data)
@@ -748,6 +906,31 @@ AROS_UFH3
                 }
                 break;
 
+            case REXX_FRAMETIMINGS:
+                {
+                    Object *browser = (Object *) getv(window, MA_OWBWindow_ActiveBrowser);
+
+                    if(browser)
+                    {
+                        BalWidget *widget = (BalWidget *) getv(browser, MA_OWBBrowser_Widget);
+
+                        if(widget)
+                        {
+                            char *timings = widget->webView->frameTimings(params[0] != 0);
+
+                            if(timings)
+                            {
+                                set(app, MUIA_Application_RexxString, timings);
+                                free(timings);
+                            }
+
+                            if(params[1])
+                                widget->webView->clearFrameTimings();
+                        }
+                    }
+                }
+                break;
+
             case REXX_GETTITLE:
                 {
                     Object *browser = (Object *) getv(window, MA_OWBWindow_ActiveBrowser);
@@ -1229,7 +1412,8 @@ DEFDISP
     WebCore::AsyncFileStream::shutdown();
     WebCore::shutdownBlobRegistryImpl();
     /* !!! Manually call save as destructors for static objects are not getting called (where saveIndex is called) !!! */
-    CurlCacheManager::singleton().saveIndex();
+    ScriptBytecodeCache::singleton().writePendingBytecode();
+    CurlCacheManager::singleton().shutdown();
 
     GCController::singleton().garbageCollectNow();
 //    FontCache::singleton().invalidate(); // trashes memory like fuck on https://testdrive-archive.azurewebsites.net/Graphics/CanvasPinball/default.html
@@ -2536,11 +2720,24 @@ void prefs_update(Object *obj, struct Data *data)
     if (FindToolType(data->diskobject->do_ToolTypes, "CONCURRENT_JIT"))
         JSC::Options::useConcurrentJIT() = true;
 
+    /* Keep bytecode of cached scripts in the disk cache */
+    ScriptBytecodeCache::singleton().setEnabled(FindToolType(data->diskobject->do_ToolTypes, "JSC_BYTECODE_CACHE") != NULL);
+
 
 
     /* Force full collection */
     JSC::Options::useGenerationalGC() = true;
 
+#if ENABLE(VIDEO)
+    /* FFmpeg video decoding threads, 0 uses one per CPU core */
+    {
+        STRPTR threads = (STRPTR) FindToolType(data->diskobject->do_ToolTypes, "VIDEO_DECODER_THREADS");
+        WebCore::setVideoDecoderThreading(threads ? atoi((char *) threads) : 0,
+            FindToolType(data->diskobject->do_ToolTypes, "NO_VIDEO_FRAME_THREADING") == NULL,
+            FindToolType(data->diskobject->do_ToolTypes, "NO_VIDEO_SLICE_THREADING") == NULL);
+    }
+#endif
+
     if (FindToolType(data->diskobject->do_ToolTypes, "MSE"))
         sharedPreferences->setMediaSourceEnabled(true);
     else
@@ -2922,27 +3119,9 @@ DEFSMETHOD(History_Remove)
 
 DEFSMETHOD(History_ContainsURL)
 {
-    ULONG found = FALSE;
     WebHistory* history = WebHistory::sharedHistory();
-    std::vector<WebHistoryItem *> historyList = *(history->historyList());
-
-    for(unsigned int i = 0; i < historyList.size(); i++)
-    {
-        WebHistoryItem *webHistoryItem = historyList[i];
-
-        if(webHistoryItem)
-        {
-            char *wurl = (char *) webHistoryItem->URLString();
-            if(!strcmp(wurl, (char *) msg->url))
-            {
-                found = TRUE;
-                break;
-            }
-            free(wurl);
-        }
-    }
 
-    return found;
+    return history->containsURL((char *) msg->url) ? TRUE : FALSE;
 }
 
 /* Misc */
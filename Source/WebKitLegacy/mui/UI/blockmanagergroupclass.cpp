@@ -49,6 +49,8 @@ namespace WebCore
 {
     extern bool ad_block_enabled;
     extern void loadCache();
+    extern size_t cacheEntryCount(int type);
+    extern void *cacheEntryAt(int type, size_t index, String& rule);
     extern void flushCache();
     extern bool writeCache();
     extern void *addCacheEntry(String rule, int type);
@@ -59,6 +61,9 @@ namespace WebCore
 
 #define LABEL(x) (STRPTR)MSG_BLOCKMANAGERGROUP_##x
 
+/* Number of rules inserted in the list per Populate call */
+#define POPULATE_BATCH 500
+
 STATIC CONST CONST_STRPTR filtertypes[] =
 {
     LABEL(DENY),
@@ -90,8 +95,12 @@ struct Data
     Object *lv_rules;
     Object *st_rule;
     Object *cy_type;
+    Object *bt_add;
     Object *bt_remove;
     ULONG loaded;
+    int populate_type;
+    size_t populate_index;
+    size_t populate_count[2];
 };
 
 DEFNEW
@@ -122,6 +131,7 @@ DEFNEW
     {
         GETDATA;
 
+        data->bt_add = bt_add;
         data->bt_remove = bt_remove;
         data->lv_rules = lv_rules;
         data->st_rule = st_rule;
@@ -156,7 +166,71 @@ DEFTMETHOD(BlockManagerGroup_Load)
     {
         data->loaded = TRUE;
         WebCore::loadCache();
+
+        /* Rules added later on are inserted through DidInsert */
+        data->populate_type = 1;
+        data->populate_index = 0;
+        data->populate_count[0] = WebCore::cacheEntryCount(0);
+        data->populate_count[1] = WebCore::cacheEntryCount(1);
+
+        set(data->lv_rules, MUIA_Disabled, TRUE);
+        set(data->bt_add, MUIA_Disabled, TRUE);
+
+        DoMethod(app, MUIM_Application_PushMethod, obj, 1, MM_BlockManagerGroup_Populate);
+    }
+    return 0;
+}
+
+/* Fills the rule list in batches from the event loop, so that a large
+   filter list doesn't block startup. */
+DEFTMETHOD(BlockManagerGroup_Populate)
+{
+    GETDATA;
+    int inserted = 0;
+
+    set(data->lv_rules, MUIA_List_Quiet, TRUE);
+
+    while(data->populate_type >= 0 && inserted < POPULATE_BATCH)
+    {
+        if(data->populate_index >= data->populate_count[data->populate_type])
+        {
+            data->populate_type--;
+            data->populate_index = 0;
+            continue;
+        }
+
+        String rule;
+        void *ptr = WebCore::cacheEntryAt(data->populate_type, data->populate_index++, rule);
+
+        if(ptr)
+        {
+            struct block_entry *entry = (struct block_entry *) malloc(sizeof(*entry));
+
+            if(entry)
+            {
+                entry->rule = strdup(rule.utf8().data());
+                entry->type = data->populate_type;
+                entry->ptr = ptr;
+
+                DoMethod(data->lv_rules, MUIM_List_InsertSingle, entry, MUIV_List_Insert_Bottom);
+            }
+        }
+
+        inserted++;
     }
+
+    set(data->lv_rules, MUIA_List_Quiet, FALSE);
+
+    if(data->populate_type >= 0)
+    {
+        DoMethod(app, MUIM_Application_PushMethod, obj, 1, MM_BlockManagerGroup_Populate);
+    }
+    else
+    {
+        set(data->lv_rules, MUIA_Disabled, FALSE);
+        set(data->bt_add, MUIA_Disabled, FALSE);
+    }
+
     return 0;
 }
 
@@ -277,6 +351,7 @@ BEGINMTABLE
 DECNEW
 DECDISP
 DECTMETHOD(BlockManagerGroup_Load)
+DECTMETHOD(BlockManagerGroup_Populate)
 DECSMETHOD(BlockManagerGroup_DidInsert)
 DECTMETHOD(BlockManagerGroup_Add)
 DECTMETHOD(BlockManagerGroup_Remove)
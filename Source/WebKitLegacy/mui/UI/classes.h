@@ -697,6 +697,7 @@ enum {
 
     /* Block Manager */
     MM_BlockManagerGroup_Load,
+    MM_BlockManagerGroup_Populate,
     MM_BlockManagerGroup_DidInsert,
     MM_BlockManagerGroup_Add,
     MM_BlockManagerGroup_Remove,
@@ -2957,39 +2957,6 @@ DEFSMETHOD(OWBWindow_JavaScriptPrompt)
 
 /* AutoCompletion */
 
-class matching_entry
-{
-public:
-    ULONG cursorstart;
-    WebHistoryItem *entry;
-
-    matching_entry(WebHistoryItem *e, ULONG start)
-        : cursorstart(start)
-        , entry(e)
-    {
-    }
-
-    friend bool operator<(const matching_entry &e1, const matching_entry &e2);
-};
-
-bool operator<(const matching_entry &e1, const matching_entry &e2)
-{
-    if(e1.cursorstart < e2.cursorstart)
-    {
-        return true;
-    }
-    else if(e1.cursorstart > e2.cursorstart)
-    {
-        return false;
-    }
-    else
-    {
-        std::string s1 = e1.entry->getPrivateItem()->m_historyItem->urlString().utf8().data();
-        std::string s2 = e2.entry->getPrivateItem()->m_historyItem->urlString().utf8().data();
-        return s1 < s2;
-    }
-}
-
 struct completion_thread_arg
 {
     struct IClass *cl;
@@ -3003,81 +2970,25 @@ static void completion_thread_start(void* p)
     Object * obj = arg->obj;
     GETDATA;
 
-    String prefixes[] = { String(""), String("http://"), String("http://www."), String("https://"), String("https://www.") };
-
     WebHistory* history = WebHistory::sharedHistory();
-    std::vector<WebHistoryItem *> *historyList;
-    std::vector<matching_entry> matching_list;
 
     STRPTR url         = strdup(data->url_to_complete.utf8().data());
     ULONG len          = strlen(url);
     ULONG maxEntries   = 50;
-    ULONG countEntries = 0;
 
     free(p);
 
-    historyList = history->historyList();
+    // In String completion mode, only match the url that start with what we type
+    // Otherwise, match anything
+    std::vector<WebHistoryMatch> matching_list = history->matchingItems(data->url_to_complete, data->completion_mode_string, maxEntries);
 
-    for(size_t i = historyList->size(); i > 0 && (countEntries < maxEntries); i--)
+    for(unsigned int i = 0; i < matching_list.size(); i++)
     {
-        if(data->abort_completion)
-            break;
-
-        WebHistoryItem *webHistoryItem = (*historyList)[i-1];
-
-        if(webHistoryItem)
-        {
-            char *item = (char *) webHistoryItem->URLString();
-
-            if(item)
-            {
-                String historyURL = item;
-                int offset = -1;
-                bool match = false;
-
-                webHistoryItem->setFragment(url);
-
-                // In String completion mode, only match the url that start with what we type
-                if(data->completion_mode_string)
-                {
-                    for(unsigned int j = 0; j < sizeof(prefixes)/sizeof(String); j++)
-                    {
-                        String urlToCompare = prefixes[j];
-                        urlToCompare.append(url);
-                        match = historyURL.startsWith(urlToCompare);
-
-                        if(match)
-                        {
-                            len = urlToCompare.length();
-                            offset = 0;
-                            break;
-                        }
-                    }
-                }
-                // Otherwise, match anything
-                else if(data->completion_mode_popup)
-                {
-                    offset = historyURL.find(url, 0);
-                    match = offset != -1;
-                }
-
-                if(historyURL.length() >= len && match)
-                {
-                    matching_entry entry(webHistoryItem, len + offset);
-                    matching_list.push_back(entry);
-
-                    countEntries++;
-                }
-
-                free(item);
-            }
-        }
+        matching_list[i].item->setFragment(url);
     }
 
     if(matching_list.size())
     {
-        std::sort(matching_list.begin(), matching_list.end());
-
         /* Popup Mode */
         if(data->completion_mode_popup)
         {
@@ -3089,7 +3000,7 @@ static void completion_thread_start(void* p)
 
             for(unsigned int i = 0; i < matching_list.size() && !data->abort_completion; i++)
             {
-                methodstack_push(data->lv_completion, 3, MUIM_List_InsertSingle, matching_list[i].entry, MUIV_List_Insert_Bottom);
+                methodstack_push(data->lv_completion, 3, MUIM_List_InsertSingle, matching_list[i].item, MUIV_List_Insert_Bottom);
             }
 
             methodstack_push(data->lv_completion, 3, MUIM_Set, MUIA_List_Quiet, FALSE);
@@ -3101,11 +3012,11 @@ static void completion_thread_start(void* p)
             /* Only autocomplete if new text is longer than previous text (to allow deletion easily */
             if(len >= 1 && len > data->completion_prevlen)
             {
-                char *item = (char *) matching_list[0].entry->URLString();
+                char *item = (char *) matching_list[0].item->URLString();
 
                 if(item)
                 {
-                    ULONG markstart = matching_list[0].cursorstart;
+                    ULONG markstart = matching_list[0].cursorStart;
                     ULONG markend = strlen(item) - 1;
                     ULONG cursorpos = markend;
 
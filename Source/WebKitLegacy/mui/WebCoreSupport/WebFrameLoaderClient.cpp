@@ -62,6 +62,7 @@
 #include <CachedFrame.h>
 #include <DNS.h>
 #include <CredentialStorage.h>
+#include <Document.h>
 #include <DocumentLoader.h>
 #include <FormState.h>
 #include <Frame.h>
@@ -105,6 +106,11 @@
 using namespace WebCore;
 using namespace HTMLNames;
 
+namespace WebCore
+{
+    extern void injectElementHidingStyleSheet(Document& document);
+}
+
 static WebDataSource* getWebDataSource(DocumentLoader* loader)
 {
     return loader ? static_cast<WebDocumentLoader*>(loader)->dataSource() : 0;
@@ -335,6 +341,10 @@ void WebFrameLoaderClient::dispatchDidReceiveTitle(const WebCore::StringWithDire
 
 void WebFrameLoaderClient::dispatchDidCommitLoad(Optional<HasInsecureContent>)
 {
+    Frame* coreFrame = core(m_webFrame);
+    if (coreFrame && coreFrame->document())
+        injectElementHidingStyleSheet(*coreFrame->document());
+
     SharedPtr<WebFrameLoadDelegate> webFrameLoadDelegate = m_webFrame->webView()->webFrameLoadDelegate();
     if (webFrameLoadDelegate)
         webFrameLoadDelegate->didCommitLoad(m_webFrame);
@@ -37,7 +37,10 @@
 #include "WebVisitedLinkStore.h"
 #include "SQLiteDatabase.h"
 #include "SQLiteStatement.h"
+#include <wtf/HashMap.h>
+#include <wtf/Lock.h>
 #include <wtf/MonotonicTime.h>
+#include <wtf/text/StringHash.h>
 #include "wtf/Vector.h"
 #include "PageGroup.h"
 #include "HistoryItem.h"
@@ -47,6 +50,7 @@
 #endif
 
 #include "gui.h"
+#include <algorithm>
 #include <clib/debug_protos.h>
 #undef String
 #undef PageGroup
@@ -59,15 +63,172 @@ static SQLiteDatabase m_historyDB;
 
 static std::vector<WebHistoryItem *> m_historyList;
 
-std::vector<WebHistoryItem *> *WebHistory::historyList()
+/*
+ * Index of m_historyList used for exact URL lookups and address bar completion.
+ * A visit gives the URL a new entry id, so ids grow with the access time and
+ * walking them backwards walks the history from the most recent visit.
+ * Removed entries are only cleared, posting lists are rebuilt from time to time.
+ */
+struct HistoryIndexEntry
 {
-    return &m_historyList;
+    WebHistoryItem *item; // 0 once removed
+    String url;
+    unsigned hostOffset;  // length of the leading http(s):// and www.
+    double lastAccessed;
+    unsigned visitCount;
+};
+
+static Lock m_historyIndexLock;
+static Vector<HistoryIndexEntry> m_historyEntries;
+static unsigned m_removedHistoryEntries = 0;
+static HashMap<String, unsigned> m_historyURLs;
+static HashMap<uint64_t, Vector<unsigned>> m_historyTrigrams;
+static Vector<unsigned> m_historyHosts; // ids sorted by URL without the hostOffset part
+
+// Matches examined for ranking when the typed text is too common to be selective.
+#define HISTORY_MAX_CANDIDATES 500
+
+static unsigned hostOffset(const String& url)
+{
+    unsigned offset = 0;
+
+    if(url.startsWith("http://"))
+        offset = 7;
+    else if(url.startsWith("https://"))
+        offset = 8;
+
+    if(url.length() >= offset + 4 && StringView(url).substring(offset, 4) == "www.")
+        offset += 4;
+
+    return offset;
 }
 
-bool WebHistory::loadHistoryFromDatabase(int sortCriterium, bool desc, std::vector<WebHistoryItem *> *destList)
+static StringView hostKey(const HistoryIndexEntry& entry)
 {
-    unsigned int maxItems =  historyItemLimit();
-    unsigned int maxAge = historyAgeInDaysLimit();
+    return StringView(entry.url).substring(entry.hostOffset);
+}
+
+static bool hostKeyLessThan(const StringView& a, const StringView& b)
+{
+    unsigned length = std::min(a.length(), b.length());
+
+    for(unsigned i = 0; i < length; i++)
+    {
+        if(a[i] != b[i])
+            return a[i] < b[i];
+    }
+
+    return a.length() < b.length();
+}
+
+static uint64_t trigramAt(const StringView& string, unsigned i)
+{
+    return (static_cast<uint64_t>(string[i]) << 32) | (static_cast<uint64_t>(string[i + 1]) << 16) | string[i + 2];
+}
+
+static double frecency(const HistoryIndexEntry& entry, double now)
+{
+    double days = (now - entry.lastAccessed) / (24 * 3600);
+    double recency = days < 4 ? 100 : days < 14 ? 70 : days < 31 ? 50 : days < 90 ? 30 : 10;
+
+    return entry.visitCount * recency;
+}
+
+static void indexHistoryEntry(unsigned id)
+{
+    const HistoryIndexEntry& entry = m_historyEntries[id];
+    StringView url(entry.url);
+
+    m_historyURLs.set(entry.url, id);
+
+    Vector<uint64_t> trigrams;
+    for(unsigned i = 0; i + 3 <= url.length(); i++)
+        trigrams.append(trigramAt(url, i));
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.resize(std::unique(trigrams.begin(), trigrams.end()) - trigrams.begin());
+
+    for(uint64_t trigram : trigrams)
+        m_historyTrigrams.ensure(trigram, [] { return Vector<unsigned>(); }).iterator->value.append(id);
+
+    StringView key = hostKey(entry);
+    auto position = std::upper_bound(m_historyHosts.begin(), m_historyHosts.end(), key, [](const StringView& key, unsigned other) {
+        return hostKeyLessThan(key, hostKey(m_historyEntries[other]));
+    });
+    m_historyHosts.insert(position - m_historyHosts.begin(), id);
+}
+
+static void rebuildHistoryIndex()
+{
+    Vector<HistoryIndexEntry> entries = WTFMove(m_historyEntries);
+
+    m_historyEntries.clear();
+    m_historyURLs.clear();
+    m_historyTrigrams.clear();
+    m_historyHosts.clear();
+    m_removedHistoryEntries = 0;
+
+    for(auto& entry : entries)
+    {
+        if(!entry.item)
+            continue;
+
+        m_historyEntries.append(WTFMove(entry));
+        indexHistoryEntry(m_historyEntries.size() - 1);
+    }
+}
+
+static void addHistoryEntry(WebHistoryItem *item, const String& url, double lastAccessed, unsigned visitCount)
+{
+    auto locker = holdLock(m_historyIndexLock);
+
+    m_historyEntries.append({ item, url, hostOffset(url), lastAccessed, visitCount });
+    indexHistoryEntry(m_historyEntries.size() - 1);
+}
+
+// Returns the visit count of the removed entry, 0 if the URL was not in the history.
+static unsigned removeHistoryEntry(const String& url)
+{
+    auto locker = holdLock(m_historyIndexLock);
+
+    auto it = m_historyURLs.find(url);
+    if(it == m_historyURLs.end())
+        return 0;
+
+    unsigned id = it->value;
+    m_historyURLs.remove(it);
+
+    HistoryIndexEntry& entry = m_historyEntries[id];
+    unsigned visitCount = entry.visitCount;
+    entry.item = 0;
+
+    // Equal keys are possible (http:// and https:// variants), look for the id in the whole range.
+    StringView key = hostKey(entry);
+    auto position = std::lower_bound(m_historyHosts.begin(), m_historyHosts.end(), key, [](unsigned other, const StringView& key) {
+        return hostKeyLessThan(hostKey(m_historyEntries[other]), key);
+    });
+    for(; position != m_historyHosts.end() && *position != id; position++) { }
+    if(position != m_historyHosts.end())
+        m_historyHosts.remove(position - m_historyHosts.begin());
+
+    m_removedHistoryEntries++;
+    if(m_removedHistoryEntries > 1024 && m_removedHistoryEntries > m_historyEntries.size() / 2)
+        rebuildHistoryIndex();
+
+    return visitCount;
+}
+
+static WebHistoryItem *historyItemForURL(const String& url)
+{
+    auto locker = holdLock(m_historyIndexLock);
+
+    auto it = m_historyURLs.find(url);
+    return it != m_historyURLs.end() ? m_historyEntries[it->value].item : 0;
+}
+
+static bool openHistoryDatabase(bool create)
+{
+    static bool upgraded = false;
 
     if(!m_historyDB.isOpen() && !m_historyDB.open(HISTORYDB))
     {
@@ -78,7 +239,50 @@ bool WebHistory::loadHistoryFromDatabase(int sortCriterium, bool desc, std::vect
     // Check that the database is correctly initialized.
     if(!m_historyDB.tableExists(String("history")))
     {
-        m_historyDB.close();
+        if(!create)
+        {
+            m_historyDB.close();
+            return false;
+        }
+
+        m_historyDB.executeCommand(String("CREATE TABLE history (url TEXT, title TEXT, lastAccessed DOUBLE, visitCount INTEGER NOT NULL DEFAULT 1);"));
+    }
+
+    if(!upgraded)
+    {
+        // Databases from older versions have no visit count and may hold duplicate URLs.
+        SQLiteStatement probe(m_historyDB, String("SELECT visitCount FROM history LIMIT 1;"));
+        if(probe.prepare() != SQLITE_OK)
+        {
+            probe.finalize();
+            m_historyDB.executeCommand(String("ALTER TABLE history ADD COLUMN visitCount INTEGER NOT NULL DEFAULT 1;"));
+        }
+
+        if(!m_historyDB.executeCommand(String("CREATE UNIQUE INDEX IF NOT EXISTS history_url ON history(url);")))
+        {
+            m_historyDB.executeCommand(String("DELETE FROM history WHERE rowid NOT IN (SELECT MAX(rowid) FROM history GROUP BY url);"));
+            m_historyDB.executeCommand(String("CREATE UNIQUE INDEX IF NOT EXISTS history_url ON history(url);"));
+        }
+
+        m_historyDB.executeCommand(String("CREATE INDEX IF NOT EXISTS history_lastAccessed ON history(lastAccessed);"));
+        upgraded = true;
+    }
+
+    return true;
+}
+
+std::vector<WebHistoryItem *> *WebHistory::historyList()
+{
+    return &m_historyList;
+}
+
+bool WebHistory::loadHistoryFromDatabase(int sortCriterium, bool desc, std::vector<WebHistoryItem *> *destList)
+{
+    unsigned int maxItems =  historyItemLimit();
+    unsigned int maxAge = historyAgeInDaysLimit();
+
+    if(!openHistoryDatabase(false))
+    {
         return false;
     }
 
@@ -108,7 +312,7 @@ bool WebHistory::loadHistoryFromDatabase(int sortCriterium, bool desc, std::vect
     snprintf(deleteStmt2buf, sizeof(deleteStmt2buf), "DELETE FROM history WHERE lastAccessed < (SELECT lastAccessed FROM history ORDER BY lastAccessed ASC LIMIT 1 OFFSET (SELECT count(*) FROM history) - min(%d, (SELECT count(*) FROM history)));", maxItems);
     m_historyDB.executeCommand(String(deleteStmt2buf));
 
-    String request = "SELECT url, title, lastAccessed FROM history";
+    String request = "SELECT url, title, lastAccessed, visitCount FROM history";
     String end = ";";
     String direction;
 
@@ -171,6 +375,11 @@ bool WebHistory::loadHistoryFromDatabase(int sortCriterium, bool desc, std::vect
 
             destList->push_back(item);
 
+            if(destList == &m_historyList)
+            {
+                addHistoryEntry(item, select.getColumnText(0), select.getColumnDouble(2), std::max(select.getColumnInt(3), 1));
+            }
+
 #if 0
 // broken 2.18
             // Retain it for icondatabase
@@ -184,35 +393,36 @@ bool WebHistory::loadHistoryFromDatabase(int sortCriterium, bool desc, std::vect
 
 bool WebHistory::insertHistoryItemIntoDatabase(String& url, String& title, double lastAccessed)
 {
-    if(!m_historyDB.isOpen() && !m_historyDB.open(HISTORYDB))
+    if(!openHistoryDatabase(true))
     {
-        LOG_ERROR("Cannot open the history database");
         return false;
     }
 
-    if(!m_historyDB.tableExists(String("history")))
-    {
-        m_historyDB.executeCommand(String("CREATE TABLE history (url TEXT, title TEXT, lastAccessed DOUBLE);"));
-    }
-
-    SQLiteStatement deleteStmt(m_historyDB, String("DELETE FROM history WHERE url=?1;"));
+    // Update the existing row through the url index, insert only for new URLs.
+    SQLiteStatement update(m_historyDB, String("UPDATE history SET title=?2, lastAccessed=?3, visitCount=visitCount+1 WHERE url=?1;"));
 
-    if(deleteStmt.prepare())
+    if(update.prepare())
     {
         return false;
     }
 
-    // Binds all the values
-    if(deleteStmt.bindText(1, url))
+    if(update.bindText(1, url) || update.bindText(2, title) || update.bindDouble(3, lastAccessed))
     {
         LOG_ERROR("Cannot save history");
+        return false;
     }
 
-    if(!deleteStmt.executeCommand()) {
+    if(!update.executeCommand()) {
         LOG_ERROR("Cannot save history");
+        return false;
     }
 
-    SQLiteStatement insert(m_historyDB, String("INSERT INTO history (url, title, lastAccessed) VALUES (?1, ?2, ?3);"));
+    if(m_historyDB.lastChanges())
+    {
+        return true;
+    }
+
+    SQLiteStatement insert(m_historyDB, String("INSERT INTO history (url, title, lastAccessed, visitCount) VALUES (?1, ?2, ?3, 1);"));
 
     if(insert.prepare())
     {
@@ -314,22 +524,126 @@ WebHistoryItem* WebHistory::itemForURL(const char* url)
 {
     //kprintf("WebHistory::itemForURL(%s)\n", url.latin1().data());
 
-    for(unsigned int i=0; i < m_historyList.size(); i++)
+    WebHistoryItem *item = historyItemForURL(String::fromUTF8(url));
+
+    free((char *)url);
+
+    return item;
+}
+
+bool WebHistory::containsURL(const char* url)
+{
+    return historyItemForURL(String::fromUTF8(url)) != 0;
+}
+
+std::vector<WebHistoryMatch> WebHistory::matchingItems(const String& text, bool prefixOnly, unsigned maxResults)
+{
+    std::vector<WebHistoryMatch> matches;
+    double now = MonotonicTime::now().secondsSinceEpoch().value();
+
+    auto locker = holdLock(m_historyIndexLock);
+
+    auto addMatch = [&](unsigned id, unsigned cursorStart) {
+        const HistoryIndexEntry& entry = m_historyEntries[id];
+        WebHistoryMatch match = { entry.item, cursorStart, frecency(entry, now) };
+        matches.push_back(match);
+    };
+
+    // Walks the history from the most recent visit until enough matches are found,
+    // for text that is too short or too common for the indexes to narrow down.
+    auto scanRecent = [&](const Vector<unsigned>* ids, const auto& matchEntry) {
+        size_t count = ids ? ids->size() : m_historyEntries.size();
+        for(size_t i = count; i > 0 && matches.size() < HISTORY_MAX_CANDIDATES; i--)
+        {
+            unsigned id = ids ? (*ids)[i - 1] : i - 1;
+            unsigned cursorStart;
+
+            if(m_historyEntries[id].item && matchEntry(m_historyEntries[id], cursorStart))
+                addMatch(id, cursorStart);
+        }
+    };
+
+    if(prefixOnly)
     {
-        char *wurl = (char *) m_historyList[i]->URLString();
-        WTF::String itemURL = wurl;
-        free(wurl);
+        // Ignore the scheme and www. on both sides, as the typed text may or may not have them.
+        unsigned offset = hostOffset(text);
+        StringView typed = StringView(text).substring(offset);
 
-        if(itemURL == url)
+        // Still typing the scheme or www.: try the text after each usual prefix.
+        if(typed.isEmpty() || String("https://www.").startsWith(text) || String("http://www.").startsWith(text) || String("www.").startsWith(text))
         {
+            static const char* const prefixes[] = { "", "http://", "http://www.", "https://", "https://www." };
+
+            scanRecent(0, [&](const HistoryIndexEntry& entry, unsigned& cursorStart) {
+                for(const char* prefix : prefixes)
+                {
+                    StringView prefixView(prefix);
+                    StringView url(entry.url);
+                    if(url.startsWith(prefixView) && url.substring(prefixView.length()).startsWith(text))
+                    {
+                        cursorStart = prefixView.length() + text.length();
+                        return true;
+                    }
+                }
+                return false;
+            });
+        }
+        else
+        {
+            auto position = std::lower_bound(m_historyHosts.begin(), m_historyHosts.end(), typed, [](unsigned other, const StringView& key) {
+                return hostKeyLessThan(hostKey(m_historyEntries[other]), key);
+            });
 
-            return m_historyList[i];
+            for(; position != m_historyHosts.end() && hostKey(m_historyEntries[*position]).startsWith(typed); position++)
+            {
+                const HistoryIndexEntry& entry = m_historyEntries[*position];
+                addMatch(*position, entry.hostOffset + typed.length());
+            }
         }
     }
+    else
+    {
+        auto matchSubstring = [&](const HistoryIndexEntry& entry, unsigned& cursorStart) {
+            size_t offset = entry.url.find(text);
+            if(offset == notFound)
+                return false;
+            cursorStart = offset + text.length();
+            return true;
+        };
+
+        if(text.length() < 3)
+        {
+            scanRecent(0, matchSubstring);
+        }
+        else
+        {
+            // Only the URLs holding the rarest trigram of the text can match.
+            StringView typed(text);
+            const Vector<unsigned>* candidates = 0;
 
-    free((char *)url);
+            for(unsigned i = 0; i + 3 <= typed.length(); i++)
+            {
+                auto it = m_historyTrigrams.find(trigramAt(typed, i));
+                if(it == m_historyTrigrams.end())
+                    return matches;
 
-    return 0;
+                if(!candidates || it->value.size() < candidates->size())
+                    candidates = &it->value;
+            }
+
+            scanRecent(candidates, matchSubstring);
+        }
+    }
+
+    size_t count = std::min<size_t>(maxResults, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + count, matches.end(), [](const WebHistoryMatch& a, const WebHistoryMatch& b) {
+        if(a.frecency != b.frecency)
+            return a.frecency > b.frecency;
+        return a.cursorStart < b.cursorStart;
+    });
+    matches.resize(count);
+
+    return matches;
 }
 
 void WebHistory::addVisitedLinksToVisitedLinkStore(WebVisitedLinkStore& visitedLinkStore)
@@ -385,30 +699,29 @@ int WebHistory::historyAgeInDaysLimit()
 void WebHistory::visitedURL(const char* url, const char* title, const char* httpMethod, bool wasFailure)
 {
     double lastAccessed = MonotonicTime::now().secondsSinceEpoch().value();
+    String urlString = String::fromUTF8(url);
+    unsigned visitCount = 1;
 
     // Don't allow duplicates
-    for(std::vector<WebHistoryItem *>::iterator it = m_historyList.begin(); it != m_historyList.end(); it++)
+    WebHistoryItem *previousItem = historyItemForURL(urlString);
+    if(previousItem)
     {
-        WebHistoryItem *item = *(it);
-        char *wurl = (char *) item->URLString();
-        WTF::String itemURL = wurl;
-        free(wurl);
+        std::vector<WebHistoryItem *>::iterator it = std::find(m_historyList.begin(), m_historyList.end(), previousItem);
+        if(it != m_historyList.end())
+            m_historyList.erase(it);
 
-        if(itemURL == url)
-        {
-            m_historyList.erase(it, it+1);
-            DoMethod(app, MM_History_Remove, item);
-            delete item; // Careful with that one
-            break;
-        }
+        visitCount += removeHistoryEntry(urlString);
+        DoMethod(app, MM_History_Remove, previousItem);
+        delete previousItem; // Careful with that one
     }
 
     WebHistoryItem *item = WebHistoryItem::createInstance();
 
     if(item)
     {
-        item->initWithURLString(String::fromUTF8(url), String::fromUTF8(title), lastAccessed);
+        item->initWithURLString(urlString, String::fromUTF8(title), lastAccessed);
         m_historyList.push_back(item);
+        addHistoryEntry(item, urlString, lastAccessed, visitCount);
 
         DoMethod(app, MM_History_Insert, item);
 
@@ -42,6 +42,16 @@ class WebHistoryItem;
 class WebError;
 class WebVisitedLinkStore;
 
+/**
+ * A history item matching the text typed in the address bar.
+ */
+struct WebHistoryMatch
+{
+    WebHistoryItem* item;
+    unsigned cursorStart; // position in the URL right after the matched text
+    double frecency;      // visit count weighted by how recent the last visit is
+};
+
 enum
 {
     HISTORY_SORT_NONE,
@@ -184,6 +194,21 @@ public:
      */
     WebHistoryItem* itemForURLString(const char* url) const;
 
+    /**
+     * @brief tells whether a URL is in the history
+     * @param url the URL
+     */
+    bool containsURL(const char* url);
+
+    /**
+     * @brief find the history items matching the text typed in the address bar, best ranked first.
+     * @param text the typed text
+     * @param prefixOnly match the beginning of the URL (with or without scheme and www.) instead of any part of it
+     * @param maxResults the maximum number of items returned
+     * @return the matching items, sorted by decreasing frecency.
+     */
+    std::vector<WebHistoryMatch> matchingItems(const WTF::String& text, bool prefixOnly, unsigned maxResults);
+
     /**
      * @brief returns all the WebHistoryItem for the history
      * @return a std::vector containing the WebHistoryItem.
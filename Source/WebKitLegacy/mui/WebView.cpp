@@ -113,6 +113,7 @@
 #include <Frame.h>
 #include <GeolocationController.h>
 #include <GeolocationError.h>
+#include <GlyphRasterCacheCairo.h>
 #include <GraphicsContext.h>
 #include <HistoryController.h>
 #include <WebCore/CookieJar.h>
@@ -125,6 +126,7 @@
 #include <LibWebRTCProvider.h>
 #include <Logging.h>
 #include <MemoryCache.h>
+#include <MemoryRelease.h>
 #include <MIMETypeRegistry.h>
 #include <NotImplemented.h>
 #include <ObserverData.h>
@@ -170,6 +172,7 @@
 #include "WTF/wtf/unicode/icu/EncodingICU.h"
 #include <wtf/HashSet.h>
 #include <wtf/MainThread.h>
+#include <wtf/MemoryPressureHandler.h>
 #include <wtf/RAMSize.h>
 
 #include "owb-config.h"
@@ -685,6 +688,10 @@ void WebView::setCacheModel(WebCacheModel cacheModel)
 
     CurlCacheManager::singleton().setStorageSizeLimit(cacheDiskCapacity);
 
+    // Rasterized glyphs are shared by all views. A text heavy page needs well under a megabyte,
+    // more helps with pages using many fonts and sizes.
+    GlyphRasterCache::singleton().setCapacity(std::min<unsigned>(std::max<unsigned>(cacheTotalCapacity / 16, MB), 4 * MB));
+
     s_didSetCacheModel = true;
     s_cacheModel = cacheModel;
     return;
@@ -1246,6 +1253,14 @@ void WebView::initWithFrame(BalRectangle& frame, const char* frameName, const ch
         WebKitInitializeWebDatabasesIfNecessary();
         WebKitEnableDiskCacheIfNecessary();
 
+        // Trim caches as the footprint grows instead of waiting for requestMemoryRelease()
+        auto& memoryPressureHandler = MemoryPressureHandler::singleton();
+        memoryPressureHandler.setLowMemoryHandler([] (Critical critical, Synchronous synchronous) {
+            WebCore::releaseMemory(critical, synchronous);
+        });
+        memoryPressureHandler.setShouldUsePeriodicMemoryMonitor(true);
+        memoryPressureHandler.install();
+
         didOneTimeInitialization = true;
     }
 
@@ -3207,8 +3222,24 @@ bool WebView::screenshot(int &requested_width, int& requested_height, void *imag
     return d->screenshot(requested_width, requested_height, (Vector<char> *) imageData);
 }
 
+void* WebView::screenshotSurface(int &requested_width, int& requested_height)
+{
+    return d->screenshotSurface(requested_width, requested_height);
+}
+
 bool WebView::screenshot(char* path)
 {
     String p = String(path);
     return d->screenshot(p);
 }
+
+char* WebView::frameTimings(bool asJSON)
+{
+    String timings = asJSON ? d->frameTimings().toJSON() : d->frameTimings().histogramReport();
+    return strdup(timings.utf8().data());
+}
+
+void WebView::clearFrameTimings()
+{
+    d->frameTimings().clear();
+}
@@ -1509,8 +1509,20 @@ void exitFullScreenForElement(WebCore::Element* element);
     void sendExposeEvent(BalRectangle rect);
 
     bool screenshot(int &requested_width, int& requested_height, void *imageData);
+    /**
+     * Paints the view scaled down to requested_width and returns the cairo image surface,
+     * owned by the caller, or 0.
+     */
+    void* screenshotSurface(int &requested_width, int& requested_height);
     bool screenshot(char* path);
 
+    /**
+     * Returns the timings of the last frames painted by this view, as a JSON array
+     * or as per-phase percentiles and a frame budget histogram. The caller frees it.
+     */
+    char* frameTimings(bool asJSON);
+    void clearFrameTimings();
+
 private:
 
     /**
@@ -233,4 +233,24 @@ TEST(WTF_SynchronizedFixedQueue, Limits)
     EXPECT_EQ(converter.consumeCount(), count);
 }
 
+TEST(WTF_SynchronizedFixedQueue, TryEnqueueDequeue)
+{
+    auto queue = SynchronizedFixedQueue<CString, 2U>::create();
+    CString item;
+
+    EXPECT_FALSE(queue->tryDequeue(item));
+
+    EXPECT_TRUE(queue->tryEnqueue(textItem(0)));
+    EXPECT_TRUE(queue->tryEnqueue(textItem(1)));
+    EXPECT_FALSE(queue->tryEnqueue(textItem(2)));
+
+    EXPECT_TRUE(queue->tryDequeue(item));
+    EXPECT_STREQ(textItem(0), item.data());
+    EXPECT_TRUE(queue->tryEnqueue(textItem(2)));
+
+    queue->close();
+    EXPECT_FALSE(queue->tryEnqueue(textItem(3)));
+    EXPECT_FALSE(queue->tryDequeue(item));
+}
+
 }
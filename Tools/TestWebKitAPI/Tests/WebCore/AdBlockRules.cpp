@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "Test.h"
+#include <WebCore/AdBlockRule.h>
+
+namespace TestWebKitAPI {
+
+using namespace WebCore;
+
+static void expectSplit(const char* rule, const char* pattern, const char* options)
+{
+    AdBlockRuleParts parts = splitAdBlockRule(rule);
+    EXPECT_STREQ(pattern, parts.pattern.utf8().data());
+    EXPECT_STREQ(options, parts.options.utf8().data());
+}
+
+TEST(AdBlockRules, DollarOptions)
+{
+    expectSplit("||ads.example.com^$image,third-party", "||ads.example.com^", "image,third-party");
+    expectSplit("/banner/*$~script,domain=example.com|~news.example.com", "/banner/*", "~script,domain=example.com|~news.example.com");
+    expectSplit("/ads$/$script", "/ads$/", "script");
+}
+
+TEST(AdBlockRules, HashOptions)
+{
+    expectSplit("http://example.com/banner.png#image", "http://example.com/banner.png", "image");
+    expectSplit("http://example.com/*#subdocument", "http://example.com/*", "subdocument");
+    // What follows '$' is no option list, so the legacy separator applies.
+    expectSplit("http://example.com/a$b#image", "http://example.com/a$b", "image");
+}
+
+TEST(AdBlockRules, NoOptions)
+{
+    expectSplit("||ads.example.com^", "||ads.example.com^", "");
+    expectSplit("/banner\\d+$/", "/banner\\d+$/", "");
+    expectSplit("http://example.com/ad$", "http://example.com/ad$", "");
+}
+
+TEST(AdBlockRules, ElementHiding)
+{
+    EXPECT_TRUE(isElementHidingRule("example.com##.ad"));
+    EXPECT_TRUE(isElementHidingRule("##div[id^=\"banner\"]"));
+    EXPECT_TRUE(isElementHidingRule("example.com#@#.ad"));
+    EXPECT_FALSE(isElementHidingRule("http://example.com/banner.png#image"));
+    EXPECT_FALSE(isElementHidingRule("||ads.example.com^$image"));
+
+    // Neither the request filters nor the bytecode compiler take these.
+    EXPECT_TRUE(splitAdBlockRule("example.com##.ad").pattern.isNull());
+    EXPECT_TRUE(splitAdBlockRule("example.com#@#.ad").pattern.isNull());
+}
+
+} // namespace TestWebKitAPI